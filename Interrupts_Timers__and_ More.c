@@ -1,6 +1,9 @@
 /*
 connect external LEDs to PD6 and PD7
 connect button input to PD2
+
+All the work is done in the two ISRs, so the main loop only puts the CPU to sleep with power_sleep() (see power.h). Timer1 and the
+edge triggered INT0 need the I/O clock, so this is idle mode, and the CPU wakes once a second and on every button edge.
 */
 
 #ifndef F_CPU
@@ -9,32 +12,40 @@ connect button input to PD2
 
 #include <avr/io.h>
 #include <avr/interrupt.h>
+#include "power.h"
+#include "pins.h"
+#include "timer_calc.h"
+
+#define LED0 PIN_D(6)   // This will set variable LED0 as PD6
+#define LED1 PIN_D(7)   // This will set variable LED1 as PD7
+#define BUTTON PIN_D(2) // This will set variable BUTTON as PD2
 
-#define LED0 PD6        // This will set variable LED0 as PD6
-#define LED1 PD7        // This will set variable LED1 as PD7
-#define BUTTON PD2      // This will set variable BUTTON as PD2
+#define BLINK_MS 1000   // Time between LED0 toggles
+#if !TIMER_OK(1, TIMER_MS(BLINK_MS), 0)
+#error "Timer1 cannot make BLINK_MS exactly at this F_CPU"
+#endif
 
 int main(void)
 {
 
     //This block configures the data direction register (DDR) and the port data register (PORT) for the LEDs and the button
     
-    DDRD |= (1 << LED0) | (1 << LED1);  // Set LED0 and LED1 pins as outputs. This is done by setting the corresponding bits in DDRD to 1.
-    DDRD &= ~(1 << BUTTON);             // Set BUTTON as input. This is done by setting the corresponding bit in DDRD to 0.
-    PORTD |= (1 << BUTTON);             // Enable pull-up resistor for BUTTON. When the BUTTON pin is configured as an input, 
+    PIN_GROUP_OUTPUT(PIN_GROUP(LED0, LED1)); // Set LED0 and LED1 pins as outputs. This is done by setting the corresponding bits in DDRD to 1.
+    PIN_INPUT(BUTTON);                  // Set BUTTON as input. This is done by setting the corresponding bit in DDRD to 0.
+    PIN_HIGH(BUTTON);                   // Enable pull-up resistor for BUTTON. When the BUTTON pin is configured as an input, 
                                         //writing a 1 to the corresponding bit in PORTD will enable the internal pull-up resistor.
 
 
     // This block sets up Timer1 to generate an interrupt every second
     TCCR1A = 0;                                               // No special output mode needed, so all bits in TCCR1A are set to 0.
-    TCCR1B = (1 << WGM12) | (1 << CS12) | (1 << CS10);        // WGM12 bit is set to enable CTC (Clear Timer on Compare match) mode. 
-                                                              // CS12 and CS10 are set to configure the prescaler as 1024.
+    TCCR1B = (1 << WGM12) | TIMER_CS(1, TIMER_MS(BLINK_MS));  // WGM12 bit is set to enable CTC (Clear Timer on Compare match) mode. 
+                                                              // TIMER_CS sets the smallest prescaler that can count to BLINK_MS, 256 at 16 MHz.
     TIMSK1 = (1 << OCIE1A);                                   // OCIE1A bit is set in TIMSK1 to enable the output compare A match interrupt. 
                                                               // This will cause an interrupt to be triggered every time the timer value 
                                                               //matches the value in OCR1A.
-    OCR1A = 15624;                                            // OCR1A is set to 15624. With a 16 MHz clock and a 1024 prescaler, the 
-                                                              //timer will reach this value approximately every second 
-                                                              //(16,000,000 / 1024 / 1 = 15625).
+    OCR1A = TIMER_TOP(1, TIMER_MS(BLINK_MS));                 // OCR1A is set to 62499. With a 16 MHz clock and a 256 prescaler, the 
+                                                              //timer will reach this value every second 
+                                                              //(16,000,000 / 256 / 1 = 62500). timer_calc.h works it out from F_CPU.
 
 
     // This block sets up external interrupt INT0 (which corresponds to digital pin 2 on the Arduino Uno) to trigger an 
@@ -45,24 +56,25 @@ int main(void)
     EIMSK = (1 << INT0);          // INT0 bit is set in EIMSK to enable the external interrupt INT0.
 
 
+    power_init();                 // Starts the Timer2 clock that counts the time spent asleep
     sei();
 
     while (1) 
     {
-        // NO CODE SHOULD EXIST
+        power_sleep();            // Sleeps until the next interrupt; NO OTHER CODE SHOULD EXIST
     }
 
     return(0);  
 }
 
 ISR(TIMER1_COMPA_vect) {
-    PORTD ^= (1 << LED0); // Toggle LED0
+    PIN_TOGGLE(LED0); // Toggle LED0
 }
 
 ISR(INT0_vect){
-    if (!(PIND & (1 << BUTTON))) { // If button is pressed
-        PORTD |= (1 << LED1); // Turn LED1 on
+    if (PIN_IS_LOW(BUTTON)) { // If button is pressed
+        PIN_HIGH(LED1); // Turn LED1 on
     } else { // If button is not pressed
-        PORTD &= ~(1 << LED1); // Turn LED1 off
+        PIN_LOW(LED1); // Turn LED1 off
     }
 }
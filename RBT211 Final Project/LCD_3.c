@@ -13,56 +13,192 @@ Here is a brief description of the contents of this file:
    - `lcd_gotoxy(unsigned char x, unsigned char y)`: This function moves the cursor to the specified position on the LCD.
    - `lcd_puts(const char *s)`: This function displays a string on the LCD. It sends the characters of the string one by one using the `lcd_data` function.
    - `lcd_clrscr()`: This function clears the LCD screen. It sends the `LCD_CLEAR` command to the LCD and then waits for the command to be processed.
+   - `lcd_fb_*()`: These functions draw into the `fb` shadow buffer only. `lcd_flush()` compares `fb` with `shown`, which holds what the LCD 
+   currently displays, and sends only the cells that differ. `lcd_flush_async()` does the same through the queue in `lcd_async.c`.
+   - `lcd_fb_glyph()`: This function finds a CGRAM slot for a custom character. `glyphs` is a copy of what each of the 8 slots holds, so a
+   bitmap that is already there costs nothing. On a miss the bitmap goes into a free slot, or else into the least recently used slot that no
+   cell of `fb` shows and no `lcd_fb_glyph()` call since the last flush has asked for, and the slot is marked in `glyphs_pending`. The flush
+   uploads the pending slots before it sends the cells, so the new bitmap is in place when the cells that use it appear.
 
-2. **Delay Functions**: The `_delay_us` and `_delay_ms` functions from the AVR `util/delay.h` library are used throughout this file to introduce delays 
+2. **Delay Functions**: How long the driver waits after each byte depends on `LCD_WAIT_MODE` (see `lcd.h`). The busy flag is polled when the 
+RW pin is wired, otherwise the datasheet time of each instruction is taken from `lcd_timing.h`. Until `lcd_init` has switched the LCD to 4-bit mode, 
+the original fixed delays are always used. With `LCD_I2C` the bytes go out through `lcd_i2c.c`; a short instruction needs no wait
+there, because the I2C bytes after it take longer, and the other waits start once the TWI has sent the last byte. The `_delay_us` and `_delay_ms` functions from the AVR `util/delay.h` library are used throughout this file to introduce delays 
 between certain operations. These delays are necessary because some operations on the LCD take a certain amount of time to complete, and trying to perform 
 another operation before the previous one has completed can cause errors.
 
 These functions allow the microcontroller to control the LCD, sending commands to it, writing data to it, clearing its screen, and moving the cursor to 
 different positions on the screen.
  */ 
-#include "lcd.h"
+#include "LCD_3.h"
 #include <avr/io.h>
 #include <util/delay.h>
+#include <string.h>
+#include "lcd_timing.h"
 
-void lcd_command(unsigned char cmnd) {
-	LCD_DATA_PORT = (LCD_DATA_PORT & 0x0F) | (cmnd & 0xF0); // send upper nibble
-	LCD_CONTROL_PORT &= ~(1<<RS); // RS=0, command reg.
-	LCD_CONTROL_PORT |= (1<<E); // E=1
-	_delay_us(1);
-	LCD_CONTROL_PORT &= ~(1<<E); // E=0
-	_delay_us(200);
-	LCD_DATA_PORT = (LCD_DATA_PORT & 0x0F) | (cmnd << 4); // send lower nibble
+static char fb[LCD_ROWS][LCD_COLS]; // What the program wants on the screen
+static char shown[LCD_ROWS][LCD_COLS]; // What the LCD is displaying right now
+static unsigned char shown_valid = 0; // 0 when the LCD may not match `shown`
+static unsigned char fb_x = 0, fb_y = 0; // Shadow cursor position
+static unsigned long cells_written = 0;
+static unsigned long cells_skipped = 0;
+
+static unsigned char glyphs[8][8]; // Bitmap in each CGRAM slot
+static unsigned char glyphs_valid = 0; // Bit n is set when slot n holds a bitmap
+static unsigned char glyphs_pending = 0; // Slots to upload at the next flush
+static unsigned char glyphs_asked = 0; // Slots asked for since the last flush
+static unsigned int glyph_used[8]; // Value of glyph_clock when each slot was last asked for
+static unsigned int glyph_clock = 0;
+static unsigned char glyph_uploads = 0; // Slots uploaded by the last flush
+static unsigned long glyphs_uploaded = 0;
+
+static unsigned char lcd_ready = 0; // Set once lcd_init has switched the LCD to 4-bit mode
+static unsigned int busy_timeouts = 0;
+#if LCD_WAIT_MODE == LCD_WAIT_BUSY
+static unsigned char busy_flag_ok = 1; // Cleared after a timeout, then the fixed waits are used
+#endif
+
+#ifdef LCD_USE_RW
+// Reads one nibble from the data pins while E is high
+static unsigned char lcd_read_nibble(void) {
+	unsigned char n;
 	LCD_CONTROL_PORT |= (1<<E);
-	_delay_us(1);
+	_delay_us(1); // Data is valid 360 ns after E rises
+	n = LCD_DATA_PIN & 0xF0;
 	LCD_CONTROL_PORT &= ~(1<<E);
+	_delay_us(1);
+	return n;
+}
+
+// Reads the busy flag (bit 7) and the address counter (bits 6-0)
+static unsigned char lcd_read_status(void) {
+	unsigned char status;
+	LCD_DATA_DDR &= 0x0F; // Data pins become inputs
+	LCD_DATA_PORT &= 0x0F; // No pull-ups
+	LCD_CONTROL_PORT &= ~(1<<RS); // RS=0, instruction reg.
+	LCD_RW_PORT |= (1<<RW); // RW=1, read
+	status = lcd_read_nibble();
+	status |= lcd_read_nibble() >> 4;
+	LCD_RW_PORT &= ~(1<<RW); // RW=0, write
+	LCD_DATA_DDR |= 0xF0;
+	return status;
+}
+
+unsigned char lcd_read_address(void) {
+	return lcd_read_status() & 0x7F;
+}
+#endif
+
+#if LCD_WAIT_MODE == LCD_WAIT_BUSY
+// Waits for the busy flag to clear. Returns 0 if it did not clear in time.
+static unsigned char lcd_wait_busy(void) {
+	unsigned int n;
+	for (n = 0; n < LCD_BUSY_TIMEOUT; n++) {
+		if (!(lcd_read_status() & 0x80))
+		return 1;
+	}
+	return 0;
+}
+#endif
+
+// Waits until the LCD has finished executing `value`
+static void lcd_wait(unsigned char rs, unsigned char value) {
+#ifdef LCD_I2C
+	if (lcd_ready && LCD_WAIT_MODE == LCD_WAIT_TABLE && !lcd_exec_is_long(rs, value))
+	return; // Covered by the I2C bytes that follow it
+	lcd_i2c_flush(); // The LCD only gets the byte when the TWI has sent it
+#endif
+	if (!lcd_ready) { // The busy flag can't be read before 4-bit mode is set, so use the original wait
+		_delay_ms(2);
+		return;
+	}
+#if LCD_WAIT_MODE == LCD_WAIT_BUSY
+	if (busy_flag_ok) {
+		if (lcd_wait_busy())
+		return;
+		busy_timeouts++;
+		busy_flag_ok = 0;
+	}
+	_delay_ms(2);
+#elif LCD_WAIT_MODE == LCD_WAIT_TABLE
+	if (lcd_exec_is_long(rs, value))
+	_delay_us(LCD_EXEC_WITH_MARGIN(LCD_EXEC_LONG_US));
+	else
+	_delay_us(LCD_EXEC_WITH_MARGIN(LCD_EXEC_DATA_US));
+#else
 	_delay_ms(2);
+#endif
 }
 
-void lcd_data(unsigned char data) {
-	LCD_DATA_PORT = (LCD_DATA_PORT & 0x0F) | (data & 0xF0); // send upper nibble
+// Sends a byte to the LCD as two nibbles, with RS = rs
+static void lcd_write(unsigned char rs, unsigned char value) {
+#ifdef LCD_I2C
+	if (lcd_ready)
+	lcd_i2c_write(rs, value);
+	else { // Before 4-bit mode each nibble is executed on its own
+		lcd_i2c_nibble(rs, value);
+		lcd_i2c_flush();
+		_delay_us(200);
+		lcd_i2c_nibble(rs, value << 4);
+	}
+#else
+	LCD_DATA_PORT = (LCD_DATA_PORT & 0x0F) | (value & 0xF0); // send upper nibble
+	if (rs)
 	LCD_CONTROL_PORT |= (1<<RS); // RS=1, data reg.
-	LCD_CONTROL_PORT|= (1<<E);
+	else
+	LCD_CONTROL_PORT &= ~(1<<RS); // RS=0, command reg.
+	LCD_CONTROL_PORT |= (1<<E); // E=1
 	_delay_us(1);
-	LCD_CONTROL_PORT &= ~(1<<E);
-	_delay_us(200);
-	LCD_DATA_PORT = (LCD_DATA_PORT & 0x0F) | (data << 4); // send lower nibble
+	LCD_CONTROL_PORT &= ~(1<<E); // E=0
+	if (lcd_ready)
+	_delay_us(1); // In 4-bit mode the two nibbles form one instruction
+	else
+	_delay_us(200); // Before 4-bit mode each nibble is executed on its own
+	LCD_DATA_PORT = (LCD_DATA_PORT & 0x0F) | (value << 4); // send lower nibble
 	LCD_CONTROL_PORT |= (1<<E);
 	_delay_us(1);
 	LCD_CONTROL_PORT &= ~(1<<E);
-	_delay_ms(2);
+#endif
+	lcd_wait(rs, value);
+}
+
+void lcd_command(unsigned char cmnd) {
+	lcd_write(0, cmnd);
+}
+
+void lcd_data(unsigned char data) {
+	lcd_write(1, data);
+}
+
+unsigned int lcd_busy_timeouts(void) {
+	return busy_timeouts;
 }
 
 void lcd_init(void) {
+#ifdef LCD_I2C
+	lcd_i2c_init(); // The backpack drives all the LCD pins
+#else
 	LCD_DATA_DDR |= 0xF0; // make PORT data direction register output
 	LCD_CONTROL_DDR |= (1<<E) | (1<<RS); // make E and RS data direction register output
+#endif
+#ifdef LCD_USE_RW
+	LCD_RW_DDR |= (1<<RW);
+	LCD_RW_PORT &= ~(1<<RW); // RW=0, write
+#endif
+	lcd_ready = 0;
 	_delay_ms(20); // LCD Power ON delay always >15ms
 	lcd_command(0x02); // send for 4 bit initialization of LCD
 	lcd_command(0x28); // 2 line, 5*7 matrix in 4-bit mode
+	lcd_ready = 1; // From here on the LCD is in 4-bit mode
 	lcd_command(0x0C); // Display on cursor off
 	lcd_command(0x06); // Increment cursor (shift cursor to right)
 	lcd_command(0x01); // Clear display screen
 	_delay_ms(2);
+	memset(shown, ' ', sizeof(shown)); // A cleared display is all spaces
+	shown_valid = 1;
+	glyphs_valid = 0; // CGRAM holds random data after power on
+	glyphs_pending = 0;
+	lcd_fb_clear();
 }
 
 void lcd_gotoxy(unsigned char x, unsigned char y) {
@@ -78,8 +214,150 @@ void lcd_puts(const char *s) {
 }
 
 void lcd_clrscr() {
-	lcd_command(LCD_CLEAR);
-	_delay_ms(2);
+	lcd_command(LCD_CLEAR); // lcd_command waits for the clear to finish
+	memset(shown, ' ', sizeof(shown));
+	shown_valid = 1;
+}
+
+void lcd_fb_clear(void) {
+	memset(fb, ' ', sizeof(fb));
+	fb_x = 0;
+	fb_y = 0;
+}
+
+void lcd_fb_gotoxy(unsigned char x, unsigned char y) {
+	fb_x = x;
+	fb_y = y;
+}
+
+void lcd_fb_putc(char c) {
+	if (fb_y < LCD_ROWS && fb_x < LCD_COLS) // Text past the end of a row is clipped
+	fb[fb_y][fb_x] = c;
+	fb_x++;
+}
+
+void lcd_fb_puts(const char *s) {
+	while (*s)
+	lcd_fb_putc(*s++);
+}
+
+// Call this after writing to the LCD directly so the next flush redraws everything
+void lcd_fb_invalidate(void) {
+	shown_valid = 0;
+}
+
+// Returns the character code (0-7) of a CGRAM slot holding `bitmap`, 8 rows of 5 pixels in bits 4-0, or LCD_GLYPH_NONE if all slots are in use
+char lcd_fb_glyph(const unsigned char *bitmap) {
+	unsigned char slot, victim = 8, busy, x, y;
+
+	for (slot = 0; slot < 8; slot++) {
+		if ((glyphs_valid & (1 << slot)) && memcmp(glyphs[slot], bitmap, 8) == 0)
+		break;
+	}
+	if (slot == 8) { // Miss, find a slot to replace
+		busy = glyphs_asked;
+		for (y = 0; y < LCD_ROWS; y++) {
+			for (x = 0; x < LCD_COLS; x++) {
+				if ((unsigned char)fb[y][x] < 8)
+				busy |= (1 << fb[y][x]);
+			}
+		}
+		for (slot = 0; slot < 8; slot++) {
+			if (busy & (1 << slot))
+			continue;
+			if (!(glyphs_valid & (1 << slot))) {
+				victim = slot;
+				break;
+			}
+			if (victim == 8 || glyph_clock - glyph_used[slot] > glyph_clock - glyph_used[victim])
+			victim = slot;
+		}
+		if (victim == 8)
+		return LCD_GLYPH_NONE;
+		slot = victim;
+		memcpy(glyphs[slot], bitmap, 8);
+		glyphs_valid |= (1 << slot);
+		glyphs_pending |= (1 << slot);
+	}
+	glyphs_asked |= (1 << slot);
+	glyph_used[slot] = ++glyph_clock;
+	return slot;
+}
+
+// Sends the changed cells through `command`/`data`, which are either the blocking or the queued functions
+static void lcd_flush_with(void (*command)(unsigned char), void (*data)(unsigned char)) {
+	unsigned char x, y;
+	unsigned char cursor_ok; // 1 while the LCD address counter already points at (x, y)
+
+	// New glyphs first; the CGRAM address counter also advances, so neighbouring slots need only one address
+	glyph_uploads = 0;
+	cursor_ok = 0;
+	for (y = 0; y < 8; y++) {
+		if (!(glyphs_pending & (1 << y))) {
+			cursor_ok = 0;
+			continue;
+		}
+		if (!cursor_ok) {
+			command(LCD_SET_CGRAM + (y << 3));
+			cursor_ok = 1;
+		}
+		for (x = 0; x < 8; x++)
+		data(glyphs[y][x]);
+		glyph_uploads++;
+	}
+	glyphs_uploaded += glyph_uploads;
+	glyphs_pending = 0;
+	glyphs_asked = 0;
+
+	for (y = 0; y < LCD_ROWS; y++) {
+		cursor_ok = 0;
+		for (x = 0; x < LCD_COLS; x++) {
+			if (shown_valid && fb[y][x] == shown[y][x]) {
+				cells_skipped++;
+				cursor_ok = 0;
+				continue;
+			}
+			if (!cursor_ok) {
+				command((y == 0 ? LCD_LINE_1 : LCD_LINE_2) + x);
+				cursor_ok = 1;
+			}
+			data(fb[y][x]);
+			shown[y][x] = fb[y][x];
+			cells_written++;
+		}
+	}
+	shown_valid = 1;
+}
+
+void lcd_flush(void) {
+	lcd_flush_with(lcd_command, lcd_data);
+}
+
+void lcd_flush_async(void) {
+	lcd_flush_with(lcd_command_async, lcd_data_async);
+}
+
+unsigned long lcd_fb_cells_written(void) {
+	return cells_written;
+}
+
+unsigned long lcd_fb_cells_skipped(void) {
+	return cells_skipped;
+}
+
+// CGRAM slots uploaded by the last flush; 0 once the glyphs on screen have settled
+unsigned char lcd_fb_glyph_uploads(void) {
+	return glyph_uploads;
+}
+
+unsigned long lcd_fb_glyphs_uploaded(void) {
+	return glyphs_uploaded;
+}
+
+void lcd_fb_clear_stats(void) {
+	cells_written = 0;
+	cells_skipped = 0;
+	glyphs_uploaded = 0;
 }
 
 
@@ -14,6 +14,30 @@ commands (`LCD_DISP_ON`, `LCD_DISP_OFF`, etc.) that are used to control the oper
    - `lcd_gotoxy(unsigned char x, unsigned char y)`: This function moves the cursor to the specified position on the LCD.
    - `lcd_clrscr()`: This function clears the LCD screen.
 
+3. **Wait Modes**: `LCD_WAIT_MODE` selects how the driver waits for the LCD to finish each byte. `LCD_WAIT_FIXED` is the original 2 ms wait 
+after every byte. `LCD_WAIT_TABLE` (the default) waits only the datasheet time of each instruction from `lcd_timing.h`. `LCD_WAIT_BUSY` reads 
+the busy flag and needs the LCD RW pin wired to `LCD_RW_PORT`/`RW` (PC5 by default) instead of ground; it is the default when `LCD_USE_RW` is defined. If the 
+busy flag never clears, the driver counts a timeout and falls back to the fixed waits.
+
+4. **Shadow Framebuffer**: The `lcd_fb_*` functions write into a RAM copy of the 2x16 display instead of the LCD itself, so they cost almost 
+nothing. `lcd_flush()` then compares the copy against what the LCD is already showing and only sends the cells that changed. Rows and columns 
+are counted from 0. The LCD's address counter advances on every write, so a run of changed cells next to each other needs only one cursor move. 
+`lcd_fb_cells_written()` and `lcd_fb_cells_skipped()` count how many cells were sent and how many were left alone.
+
+5. **Queued Output**: The `*_async` functions in `lcd_async.c` queue bytes for a Timer0 interrupt to send, and return immediately. 
+`lcd_flush_async()` is the framebuffer flush built on them. `lcd_idle()` returns 1 once the queue has drained.
+
+6. **Custom Characters**: `lcd_fb_glyph()` returns the character code (0-7) of a CGRAM slot that holds a given 5x8 bitmap, to be drawn with 
+`lcd_fb_putc()` (not `lcd_fb_puts()`, since code 0 ends a string). The driver remembers what each slot holds and only uploads a bitmap that 
+is not there yet, during the next flush. `lcd_fb_glyph_uploads()` tells how many slots the last flush uploaded, which is 0 once the frames 
+stop asking for new bitmaps. `lcd_fb_bar()` and `lcd_fb_big_number()` in `lcd_glyph.c` draw a horizontal bar graph with 5 steps per cell 
+(80 across the display) and numbers 3 cells wide and 2 rows high; together they need at most 7 slots, so they never evict each other.
+
+7. **I2C Backpack**: Define `LCD_I2C` to drive the LCD through a PCF8574 I2C backpack on PC4/PC5 instead of the six PORTD pins, which 
+frees PD2-PD7 for the button, the speaker and the antenna in `pindefines.h`. `lcd_i2c.c` sends the nibbles with the TWI master in 
+`twi.c` at `TWI_FREQ` (400 kHz), and the same `lcd_*` functions work as before. The expander pins are set with `LCD_I2C_RS` ... 
+`LCD_I2C_BACKLIGHT`, and `LCD_I2C_ADDRESS` is 0x27 (0x3F for a PCF8574A). The busy flag is not read over I2C.
+
 These functions are defined in the `lcd.c` file, and they are used in the main program to control the LCD.tions and AVR I/O operations. They encapsulate the 
 low-level details of interfacing with the LCD module.
 */
@@ -22,6 +46,7 @@ low-level details of interfacing with the LCD module.
 #define LCD_H_
 
 #include <avr/io.h>
+#include "../pins.h"
 
 #define LCD_DATA_DDR DDRD
 #define LCD_DATA_PORT PORTD
@@ -29,6 +54,65 @@ low-level details of interfacing with the LCD module.
 #define LCD_CONTROL_PORT PORTD
 #define RS PD2
 #define E PD3
+#define LCD_DATA_PIN PIND
+
+// Define LCD_USE_RW when the LCD RW pin is connected to the pin below instead of ground
+#ifdef LCD_USE_RW
+#include "../pindefines.h"
+#ifndef LCD_RW_PORT
+#define LCD_RW_DDR DDRC
+#define LCD_RW_PORT PORTC
+#define RW PC5 // SCL, which only the I2C backpack uses, and it never reads the LCD
+#define LCD_RW_PIN PIN_C(RW)
+#endif
+#ifndef LCD_RW_PIN
+#error "Give the RW pin as LCD_RW_PIN too, e.g. PIN_C(RW), when setting LCD_RW_PORT"
+#endif
+PIN_ASSERT_FREE(PIN_GROUP(LCD_RW_PIN), PIN_GROUP(PIN_SPI_SS, PIN_SPI_MOSI, PIN_SPI_SCK), "LCD RW clashes with the SPI pins of hc595.c");
+#endif
+
+#define LCD_WAIT_FIXED 0 // Worst-case wait after every byte
+#define LCD_WAIT_TABLE 1 // Datasheet wait for each instruction
+#define LCD_WAIT_BUSY 2 // Poll the busy flag (needs LCD_USE_RW)
+
+#ifndef LCD_WAIT_MODE
+#ifdef LCD_USE_RW
+#define LCD_WAIT_MODE LCD_WAIT_BUSY
+#else
+#define LCD_WAIT_MODE LCD_WAIT_TABLE
+#endif
+#endif
+
+#if LCD_WAIT_MODE == LCD_WAIT_BUSY && !defined(LCD_USE_RW)
+#error "LCD_WAIT_BUSY needs the RW pin, define LCD_USE_RW"
+#endif
+
+#ifdef LCD_I2C
+#ifdef LCD_USE_RW
+#error "LCD_I2C does not read the LCD, leave LCD_USE_RW undefined"
+#endif
+#ifndef LCD_I2C_ADDRESS
+#define LCD_I2C_ADDRESS 0x27 // PCF8574 with A0-A2 high
+#endif
+#ifndef LCD_I2C_RS
+#define LCD_I2C_RS 0x01 // Expander pins of the usual backpack, D4-D7 on P4-P7
+#define LCD_I2C_RW 0x02
+#define LCD_I2C_E 0x04
+#define LCD_I2C_BACKLIGHT 0x08
+#endif
+#endif
+
+// The MCU pins the LCD takes, for PIN_ASSERT_FREE in pins.h (RW with LCD_USE_RW is on another port and not in the group)
+#ifdef LCD_I2C
+#define LCD_PINS PIN_GROUP(PIN_C(4), PIN_C(5)) // SDA and SCL
+#else
+#define LCD_PINS PIN_GROUP(PIN_D(RS), PIN_D(E), PIN_D(4), PIN_D(5), PIN_D(6), PIN_D(7))
+#endif
+
+#define LCD_BUSY_READ_US 4 // Delays in one busy flag read: 1 us on each edge of E, for two nibbles
+#ifndef LCD_BUSY_TIMEOUT
+#define LCD_BUSY_TIMEOUT 1000 // Busy flag reads before giving up; at least 4 ms (LCD_BUSY_READ_US each), over twice the 1.52 ms of a clear
+#endif
 
 #define LCD_DISP_ON 0x0C // Display on
 #define LCD_DISP_OFF 0x08 // Display off
@@ -57,6 +141,23 @@ low-level details of interfacing with the LCD module.
 
 #define LCD_LINE_1 0x80 // Start of line 1
 #define LCD_LINE_2 0xC0 // Start of line 2
+#define LCD_SET_CGRAM 0x40 // Set CGRAM address, slot n starts at 8 * n
+
+#define LCD_GLYPH_NONE '?' // lcd_fb_glyph result when all 8 slots are in use
+#define LCD_BAR_STEPS (LCD_COLS * 5) // One step per pixel column
+
+#ifndef LCD_QUEUE_SIZE
+#define LCD_QUEUE_SIZE 64 // Queued bytes for the async back end, a power of two no larger than 256
+#endif
+#if (LCD_QUEUE_SIZE & (LCD_QUEUE_SIZE - 1)) || LCD_QUEUE_SIZE > 256
+#error "LCD_QUEUE_SIZE must be a power of two no larger than 256"
+#endif
+#ifndef LCD_TICK_US
+#define LCD_TICK_US 40 // Async state machine step, about one short instruction time
+#endif
+
+#define LCD_ROWS 2 // Number of display rows
+#define LCD_COLS 16 // Number of characters per row
 
 void lcd_init(void);
 void lcd_command(unsigned char cmnd);
@@ -64,6 +165,43 @@ void lcd_data(unsigned char data);
 void lcd_puts(const char *s);
 void lcd_gotoxy(unsigned char x, unsigned char y);
 void lcd_clrscr(void);
+#ifdef LCD_USE_RW
+unsigned char lcd_read_address(void);
+#endif
+unsigned int lcd_busy_timeouts(void);
+
+void lcd_fb_clear(void);
+void lcd_fb_gotoxy(unsigned char x, unsigned char y);
+void lcd_fb_putc(char c);
+void lcd_fb_puts(const char *s);
+void lcd_fb_invalidate(void);
+void lcd_flush(void);
+void lcd_flush_async(void);
+unsigned long lcd_fb_cells_written(void);
+unsigned long lcd_fb_cells_skipped(void);
+void lcd_fb_clear_stats(void);
+char lcd_fb_glyph(const unsigned char *bitmap);
+unsigned char lcd_fb_glyph_uploads(void);
+unsigned long lcd_fb_glyphs_uploaded(void);
+
+void lcd_fb_bar(unsigned char x, unsigned char y, unsigned char cells, unsigned char steps);
+void lcd_fb_big_digit(unsigned char x, unsigned char digit);
+void lcd_fb_big_number(unsigned char x, unsigned int value, unsigned char digits);
+
+void lcd_async_init(void);
+void lcd_command_async(unsigned char cmnd);
+void lcd_data_async(unsigned char data);
+void lcd_puts_async(const char *s);
+void lcd_gotoxy_async(unsigned char x, unsigned char y);
+unsigned char lcd_idle(void);
+
+#ifdef LCD_I2C
+void lcd_i2c_init(void);
+void lcd_i2c_write(unsigned char rs, unsigned char value);
+void lcd_i2c_nibble(unsigned char rs, unsigned char value);
+unsigned char lcd_i2c_idle(void);
+void lcd_i2c_flush(void);
+#endif
 
 
 #endif /* LCD_H_ */
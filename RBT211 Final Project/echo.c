@@ -0,0 +1,143 @@
+/*
+The `echo.c` file contains the definitions of the functions declared in the `echo.h` file.
+
+1. **Triggering**: `echo_trigger()` sends the 10 us pulse on TRIG, arms the capture unit for a rising edge, and sets compare match B
+`ECHO_TIMEOUT_TICKS` ahead of the current timer value as a timeout.
+
+2. **Capture ISR**: `TIMER1_CAPT_vect` saves `ICR1` on the rising edge and switches `ICES1` to the falling edge. On the falling edge it
+subtracts the two timestamps. The subtraction is done in 16 bits, so it gives the right width even if the timer wrapped around in between.
+The noise canceler (`ICNC1`) delays both edges by the same 4 clocks, so it does not change the measured width.
+
+3. **Timeout ISR**: `TIMER1_COMPB_vect` fires if the falling edge never came, and reports `ECHO_TIMEOUT`.
+*/
+
+#ifndef F_CPU
+#define F_CPU 16000000UL
+#endif
+
+#include "echo.h"
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <util/atomic.h>
+#include <util/delay.h>
+
+static volatile uint8_t ready = 0;
+static volatile uint16_t width = ECHO_TIMEOUT;
+static void (*volatile done_callback)(uint16_t ticks) = 0;
+
+#ifndef ECHO_POLLED
+static uint16_t rise; // Timestamp of the rising edge, only used by the ISR
+#endif
+
+void echo_init(void) {
+	DDRB |= (1<<TRIG); // Sets the TRIG pin as Output
+	DDRB &= ~(1<<ECHO); // Sets the ECHO pin as Input
+	TCCR1A = 0; // Normal mode, the timer counts 0 to 0xFFFF and wraps
+	TCCR1B = (1 << ICNC1) | (1 << CS11); // Noise canceler on, prescaler of 8
+	TIMSK1 = 0;
+}
+
+void echo_set_callback(void (*callback)(uint16_t ticks)) {
+	done_callback = callback;
+}
+
+static void echo_done(uint16_t ticks) {
+	width = ticks;
+	ready = 1;
+	if (done_callback)
+	done_callback(ticks);
+}
+
+#ifndef ECHO_POLLED
+
+void echo_trigger(void) {
+	ready = 0;
+
+	PORTB |= (1<<TRIG);
+	_delay_us(10);
+	PORTB &= ~(1<<TRIG);
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		TCCR1B |= (1 << ICES1); // Capture the rising edge first
+		OCR1B = TCNT1 + ECHO_TIMEOUT_TICKS;
+		TIFR1 = (1 << ICF1) | (1 << OCF1B); // Clear stale flags
+		TIMSK1 |= (1 << ICIE1) | (1 << OCIE1B);
+	}
+}
+
+ISR(TIMER1_CAPT_vect) {
+	uint16_t now = ICR1;
+
+	if (TCCR1B & (1 << ICES1)) { // Rising edge, the echo has started
+		rise = now;
+		TCCR1B &= ~(1 << ICES1);
+		TIFR1 = (1 << ICF1); // Changing the edge can set ICF1
+	} else { // Falling edge, the echo has ended
+		TIMSK1 &= ~((1 << ICIE1) | (1 << OCIE1B));
+		echo_done(now - rise);
+	}
+}
+
+ISR(TIMER1_COMPB_vect) {
+	TIMSK1 &= ~((1 << ICIE1) | (1 << OCIE1B));
+	echo_done(ECHO_TIMEOUT);
+}
+
+#else
+
+// Returns nonzero once Timer1 has moved `ticks` past `start`
+static uint8_t echo_expired(uint16_t start, uint16_t ticks) {
+	return (uint16_t)(TCNT1 - start) >= ticks;
+}
+
+void echo_trigger(void) {
+	uint8_t mask = (1 << ECHO);
+	uint16_t start, rise_time;
+
+	ready = 0;
+
+	PORTB |= (1<<TRIG);
+	_delay_us(10);
+	PORTB &= ~(1<<TRIG);
+
+	start = TCNT1;
+	// Wait for the pulse to start
+	while (!(PINB & mask)) {
+		if (echo_expired(start, ECHO_TIMEOUT_TICKS)) {
+			echo_done(ECHO_TIMEOUT);
+			return;
+		}
+	}
+	rise_time = TCNT1;
+	// Then wait for the pulse to stop
+	while (PINB & mask) {
+		if (echo_expired(rise_time, ECHO_TIMEOUT_TICKS)) {
+			echo_done(ECHO_TIMEOUT);
+			return;
+		}
+	}
+	echo_done(TCNT1 - rise_time);
+}
+
+#endif
+
+uint8_t echo_ready(void) {
+	return ready;
+}
+
+uint16_t echo_ticks(void) {
+	uint16_t ticks;
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		ticks = width;
+	}
+	return ticks;
+}
+
+uint16_t echo_us(void) {
+	uint16_t ticks = echo_ticks();
+
+	if (ticks == ECHO_TIMEOUT)
+	return ECHO_TIMEOUT;
+	return ticks / ECHO_TICKS_PER_US;
+}
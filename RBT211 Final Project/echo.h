@@ -0,0 +1,51 @@
+/*
+The `echo.h` file declares the HC-SR04 echo timer used by the distance meter.
+
+1. **Input Capture Mode (default)**: Timer1 runs freely at F_CPU / 8, which is one tick every 0.5 us at 16 MHz; `ECHO_TICKS_PER_US` is
+worked out from `F_CPU`, which must be a multiple of 8 MHz. The ECHO pin is wired to ICP1 (PB0). The input capture unit copies the timer
+into `ICR1` on the rising edge of the echo, the ISR flips `ICES1` to catch the falling edge, and the difference between the two captures
+is the pulse width. The CPU does nothing while the echo is in flight.
+
+2. **Polled Mode**: Define `ECHO_POLLED` on boards where the echo must stay on PB2. `echo_trigger()` then waits for the pulse itself, but
+still times it with Timer1 instead of counting loop iterations.
+
+3. **Results**: `echo_ready()` returns 1 once a measurement has finished, and `echo_ticks()`/`echo_us()` return the width. If no echo
+ends within `ECHO_TIMEOUT_TICKS`, the result is `ECHO_TIMEOUT`. An optional callback set with `echo_set_callback()` is called from the
+ISR with the width in ticks.
+*/
+
+#ifndef ECHO_H_
+#define ECHO_H_
+
+#include <avr/io.h>
+#include <stdint.h>
+
+#define TRIG PB1 // Trigger output to the HC-SR04
+#ifdef ECHO_POLLED
+#define ECHO PB2 // Echo input, any PORTB pin
+#else
+#define ECHO PB0 // Echo input, must be ICP1
+#endif
+
+#ifndef F_CPU
+#define F_CPU 16000000UL
+#endif
+
+#define ECHO_TICKS_PER_US (F_CPU / 8 / 1000000UL) // Timer1 at F_CPU / 8, 2 at 16 MHz
+#if F_CPU % 8000000UL
+#error "Timer1 at F_CPU / 8 needs F_CPU to be a multiple of 8 MHz"
+#endif
+#define ECHO_TIMEOUT_TICKS ((uint16_t)(30000UL * ECHO_TICKS_PER_US)) // 30 ms, longer than the HC-SR04's 4 m range
+#if 30000UL * ECHO_TICKS_PER_US > 65535UL
+#error "The 30 ms echo timeout does not fit in 16 bits at this F_CPU"
+#endif
+#define ECHO_TIMEOUT 0xFFFF // Result when no echo was received
+
+void echo_init(void);
+void echo_trigger(void);
+uint8_t echo_ready(void);
+uint16_t echo_ticks(void);
+uint16_t echo_us(void);
+void echo_set_callback(void (*callback)(uint16_t ticks));
+
+#endif /* ECHO_H_ */
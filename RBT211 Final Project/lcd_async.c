@@ -0,0 +1,162 @@
+/*
+The `lcd_async.c` file contains a queued, interrupt-driven back end for the LCD driver in `lcd.c`.
+
+1. **Queue**: `lcd_command_async` and `lcd_data_async` put a byte in a ring buffer and return straight away. Bit 8 of each entry holds
+the RS value (0 = command, 1 = data). `lcd_puts_async` and `lcd_gotoxy_async` are built on top of them and work like `lcd_puts` and
+`lcd_gotoxy`.
+
+2. **State Machine**: Timer0 runs in CTC mode and its compare match ISR fires every `LCD_TICK_US` microseconds while the queue is busy.
+Each tick does one step: send the upper nibble, send the lower nibble, or count down the execution time of the last byte. The execution
+time comes from the same table as the blocking driver (`lcd_timing.h`). When the queue is empty the ISR turns its own interrupt off, so an
+idle display costs no CPU time at all.
+
+3. **Rules**: Call `lcd_init()` first, then `lcd_async_init()`. Do not call the blocking `lcd_*` functions while `lcd_idle()` returns 0,
+and do not change the upper nibble of `LCD_DATA_PORT` or the RS/E pins from the main loop while the queue is running. If the queue is full,
+the enqueue functions wait for the ISR to make room, so global interrupts must be enabled.
+
+4. **I2C**: With `LCD_I2C` the TWI master is already a queue driven by its own interrupt, so Timer0 is not used. The `*_async`
+functions hand each byte to `lcd_i2c.c` like the blocking ones do, and only a clear or home command waits until it has been executed.
+`lcd_idle()` returns 1 once the TWI queue is empty.
+*/
+
+#ifndef F_CPU
+#define F_CPU 16000000UL
+#endif
+
+#include "LCD_3.h"
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <util/atomic.h>
+#include "lcd_timing.h"
+
+#ifdef LCD_I2C
+
+void lcd_async_init(void) {
+}
+
+void lcd_command_async(unsigned char cmnd) {
+	lcd_command(cmnd);
+}
+
+void lcd_data_async(unsigned char data) {
+	lcd_data(data);
+}
+
+#else
+
+#define LCD_TICK_OCR (F_CPU / 64 / (1000000UL / LCD_TICK_US) - 1) // Timer0 compare value, prescaler 64
+#define LCD_TICKS(us) ((LCD_EXEC_WITH_MARGIN(us) + LCD_TICK_US - 1) / LCD_TICK_US) // Ticks needed to cover `us`
+
+#if LCD_TICK_OCR > 255
+#error "LCD_TICK_US is too long for Timer0"
+#endif
+
+#define LCDQ_MASK (LCD_QUEUE_SIZE - 1)
+#define LCDQ_RS 0x100 // Entry flag for data bytes
+
+static volatile uint16_t lcdq[LCD_QUEUE_SIZE];
+static volatile uint8_t lcdq_head = 0; // Next free slot, written by the enqueue functions
+static volatile uint8_t lcdq_tail = 0; // Next entry to send, written by the ISR
+
+static uint16_t current; // Entry being sent, only used by the ISR
+static uint8_t low_nibble_next = 0; // 1 when the upper nibble of `current` has been sent
+static uint8_t wait_ticks = 0; // Ticks left before the LCD can take the next byte
+
+void lcd_async_init(void) {
+	TCCR0A = (1 << WGM01); // CTC mode
+	TCCR0B = (1 << CS01) | (1 << CS00); // Prescaler of 64
+	OCR0A = LCD_TICK_OCR;
+	TIMSK0 &= ~(1 << OCIE0A); // Only runs while there is something to send
+}
+
+static void lcd_enqueue(uint16_t entry) {
+	uint8_t next = (lcdq_head + 1) & LCDQ_MASK;
+
+	while (next == lcdq_tail) {} // Queue full, wait for the ISR
+	lcdq[lcdq_head] = entry;
+	lcdq_head = next;
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		if (!(TIMSK0 & (1 << OCIE0A))) { // The ISR was stopped, start it again
+			TCNT0 = 0;
+			TIFR0 = (1 << OCF0A);
+			TIMSK0 |= (1 << OCIE0A);
+		}
+	}
+}
+
+void lcd_command_async(unsigned char cmnd) {
+	lcd_enqueue(cmnd);
+}
+
+void lcd_data_async(unsigned char data) {
+	lcd_enqueue(LCDQ_RS | data);
+}
+
+#endif
+
+void lcd_gotoxy_async(unsigned char x, unsigned char y) {
+	if (y == 1)
+	lcd_command_async(0x80 + x);
+	else if (y == 2)
+	lcd_command_async(0xC0 + x);
+}
+
+void lcd_puts_async(const char *s) {
+	while (*s)
+	lcd_data_async(*s++);
+}
+
+// Returns 1 when every queued byte has been sent and executed
+unsigned char lcd_idle(void) {
+#ifdef LCD_I2C
+	return lcd_i2c_idle();
+#else
+	return !(TIMSK0 & (1 << OCIE0A));
+#endif
+}
+
+#ifndef LCD_I2C
+
+// Pulses E once to latch the nibble already on the data pins
+static inline void lcd_strobe(void) {
+	LCD_CONTROL_PORT |= (1<<E);
+	__asm__ __volatile__ ("nop\n\tnop\n\tnop\n\tnop\n\tnop\n\tnop\n\tnop\n\tnop"); // E high for at least 450 ns
+	LCD_CONTROL_PORT &= ~(1<<E);
+}
+
+ISR(TIMER0_COMPA_vect) {
+	if (wait_ticks) {
+		wait_ticks--;
+		return;
+	}
+
+	if (low_nibble_next) {
+		LCD_DATA_PORT = (LCD_DATA_PORT & 0x0F) | ((uint8_t)current << 4); // send lower nibble
+		lcd_strobe();
+		low_nibble_next = 0;
+		if (lcd_exec_is_long(current >> 8, (uint8_t)current))
+		wait_ticks = LCD_TICKS(LCD_EXEC_LONG_US) - 1;
+		else
+		wait_ticks = LCD_TICKS(LCD_EXEC_DATA_US) - 1;
+		return;
+	}
+
+	if (lcdq_head == lcdq_tail) {
+		TIMSK0 &= ~(1 << OCIE0A); // Nothing left, stop ticking
+		return;
+	}
+
+	current = lcdq[lcdq_tail];
+	lcdq_tail = (lcdq_tail + 1) & LCDQ_MASK;
+
+	LCD_DATA_PORT = (LCD_DATA_PORT & 0x0F) | ((uint8_t)current & 0xF0); // send upper nibble
+	if (current & LCDQ_RS)
+	LCD_CONTROL_PORT |= (1<<RS); // RS=1, data reg.
+	else
+	LCD_CONTROL_PORT &= ~(1<<RS); // RS=0, command reg.
+	lcd_strobe();
+	low_nibble_next = 1;
+}
+
+#endif
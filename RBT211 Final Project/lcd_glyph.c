@@ -0,0 +1,107 @@
+/*
+The `lcd_glyph.c` file draws bar graphs and big digits into the LCD framebuffer, using the custom characters managed by `lcd_fb_glyph()` in `LCD_3.c`.
+
+1. **Bar Graph**: `lcd_fb_bar()` fills `cells` cells from (x, y) with a bar `steps` pixel columns long, 5 per cell. Whole cells use the
+full block of the LCD's character ROM (0xFF), so only the last, partly filled cell needs a custom character. There are 4 of those (1-4
+columns), and a bar that changes length from frame to frame settles with all of them in CGRAM.
+
+2. **Big Digits**: A digit is 3 cells wide and 2 rows high, built from the full block, spaces and 3 custom characters: a stripe along the
+top of the cell (`STRIPE_TOP`), one along the bottom (`STRIPE_BOTTOM`), and both. The bottom stripe of the top row is the middle bar of
+the digit. `big_digits` gives the 6 cells of each digit, top row first.
+*/
+
+#include "LCD_3.h"
+#include <avr/pgmspace.h>
+
+#define FULL_BLOCK 0xFF // In the HD44780 A00 character ROM
+
+// Cells of the big digits
+#define B_ 0 // Space
+#define BF 1 // Full block
+#define BT 2 // Top stripe
+#define BB 3 // Bottom stripe
+#define BX 4 // Top and bottom stripes
+
+#define STRIPE_TOP 0x03 // Pixel rows 0-1
+#define STRIPE_BOTTOM 0xC0 // Pixel rows 6-7
+
+static const unsigned char big_digits[10][6] PROGMEM = {
+	{BF, BT, BF, BF, BB, BF}, // 0
+	{BT, BF, B_, BB, BF, BB}, // 1
+	{BX, BX, BF, BF, BB, BB}, // 2
+	{BX, BX, BF, BB, BB, BF}, // 3
+	{BF, BB, BF, B_, B_, BF}, // 4
+	{BF, BX, BX, BB, BB, BF}, // 5
+	{BF, BX, BX, BF, BB, BF}, // 6
+	{BT, BT, BF, B_, B_, BF}, // 7
+	{BF, BX, BF, BF, BB, BF}, // 8
+	{BF, BX, BF, BB, BB, BF}, // 9
+};
+
+// Character code for a big digit cell
+static char big_cell(unsigned char cell) {
+	unsigned char bitmap[8], rows, i;
+
+	if (cell == B_)
+	return ' ';
+	if (cell == BF)
+	return (char)FULL_BLOCK;
+	rows = (cell == BT) ? STRIPE_TOP : (cell == BB) ? STRIPE_BOTTOM : STRIPE_TOP | STRIPE_BOTTOM;
+	for (i = 0; i < 8; i++)
+	bitmap[i] = (rows & (1 << i)) ? 0x1F : 0x00;
+	return lcd_fb_glyph(bitmap);
+}
+
+void lcd_fb_bar(unsigned char x, unsigned char y, unsigned char cells, unsigned char steps) {
+	unsigned char bitmap[8], i, r;
+	unsigned char full = steps / 5, part = steps % 5;
+
+	lcd_fb_gotoxy(x, y);
+	for (i = 0; i < cells; i++) {
+		if (i < full)
+		lcd_fb_putc((char)FULL_BLOCK);
+		else if (i == full && part) {
+			for (r = 0; r < 8; r++)
+			bitmap[r] = 0x1F & ~(0x1F >> part); // The left `part` pixel columns
+			lcd_fb_putc(lcd_fb_glyph(bitmap));
+		} else
+		lcd_fb_putc(' ');
+	}
+}
+
+// Draws one digit in columns x to x + 2 of both rows
+void lcd_fb_big_digit(unsigned char x, unsigned char digit) {
+	unsigned char i;
+
+	if (digit > 9)
+	return;
+	for (i = 0; i < 6; i++) {
+		if (i % 3 == 0)
+		lcd_fb_gotoxy(x, i / 3);
+		lcd_fb_putc(big_cell(pgm_read_byte(&big_digits[digit][i])));
+	}
+}
+
+// Draws `value` right aligned in `digits` big digits from column x, with a blank column after each digit. Leading zeros are blanked
+// and a value that does not fit shows all nines.
+void lcd_fb_big_number(unsigned char x, unsigned int value, unsigned char digits) {
+	unsigned char i, d;
+	unsigned int limit = 1;
+
+	for (i = 0; i < digits && limit <= 6553; i++)
+	limit *= 10;
+	if (i == digits && value >= limit)
+	value = limit - 1;
+	for (i = digits; i > 0; i--) {
+		d = value % 10;
+		if (value || i == digits)
+		lcd_fb_big_digit(x + 4 * (i - 1), d);
+		else {
+			lcd_fb_gotoxy(x + 4 * (i - 1), 0);
+			lcd_fb_puts("   ");
+			lcd_fb_gotoxy(x + 4 * (i - 1), 1);
+			lcd_fb_puts("   ");
+		}
+		value /= 10;
+	}
+}
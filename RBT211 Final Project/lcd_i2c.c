@@ -0,0 +1,71 @@
+/*
+The `lcd_i2c.c` file is the I2C transport of the LCD driver, used when `LCD_I2C` is defined (see `LCD_3.h`).
+
+1. **Nibbles**: The PCF8574 drives the LCD pins straight from each byte it receives, so a nibble is two expander bytes: the nibble with
+E high, then the same with E low, which latches it. A whole LCD byte is four expander bytes. When RS changes, one more byte sets it with E
+low first, so RS is stable before E rises.
+
+2. **Execution Time**: At 400 kHz every expander byte takes 22.5 us, and the next E pulse comes 2 bytes after the last one. When that is
+shorter than the execution time of a short instruction (`LCD_EXEC_DATA_US` with the margin), `LCD_I2C_PAD` extra copies of the last byte
+are sent, which change nothing on the pins but fill the time. The long instructions (clear and home) are waited for in `LCD_3.c`.
+
+3. **Batching**: Every LCD byte is handed to `twi_append()`, so the bytes sent while the TWI is busy are joined into one transaction and
+a burst of characters costs one address byte. The calls only wait when the TWI ring buffer is full.
+*/
+
+#include "LCD_3.h"
+#include "lcd_timing.h"
+#include "../twi.h"
+
+#ifdef LCD_I2C
+
+#define LCD_I2C_GAP ((LCD_EXEC_WITH_MARGIN(LCD_EXEC_DATA_US) * (TWI_FREQ / 1000) + 9000 - 1) / 9000) // Expander bytes per short instruction
+#define LCD_I2C_PAD (LCD_I2C_GAP > 2 ? LCD_I2C_GAP - 2 : 0)
+
+static unsigned char last = LCD_I2C_BACKLIGHT; // Last byte sent to the expander
+
+void lcd_i2c_init(void) {
+	twi_init();
+	last = LCD_I2C_BACKLIGHT; // Backlight on, E low
+	twi_write(LCD_I2C_ADDRESS, &last, 1);
+}
+
+// Sends the upper nibble of `value` (both nibbles if `both`), with RS = rs
+static void lcd_i2c_send(unsigned char rs, unsigned char value, unsigned char both) {
+	unsigned char bytes[6 + LCD_I2C_PAD];
+	unsigned char bits = LCD_I2C_BACKLIGHT | (rs ? LCD_I2C_RS : 0);
+	unsigned char n = 0, i;
+
+	if ((last & LCD_I2C_RS) != (bits & LCD_I2C_RS))
+	bytes[n++] = (last & 0xF0) | bits; // RS first, E low
+	bytes[n++] = (value & 0xF0) | bits | LCD_I2C_E;
+	bytes[n++] = (value & 0xF0) | bits;
+	if (both) {
+		bytes[n++] = (value << 4) | bits | LCD_I2C_E;
+		bytes[n++] = (value << 4) | bits;
+	}
+	for (i = 0; i < LCD_I2C_PAD; i++) {
+		bytes[n] = bytes[n - 1];
+		n++;
+	}
+	last = bytes[n - 1];
+	twi_append(LCD_I2C_ADDRESS, bytes, n);
+}
+
+void lcd_i2c_write(unsigned char rs, unsigned char value) {
+	lcd_i2c_send(rs, value, 1);
+}
+
+void lcd_i2c_nibble(unsigned char rs, unsigned char value) {
+	lcd_i2c_send(rs, value, 0);
+}
+
+unsigned char lcd_i2c_idle(void) {
+	return twi_idle();
+}
+
+void lcd_i2c_flush(void) {
+	twi_flush();
+}
+
+#endif
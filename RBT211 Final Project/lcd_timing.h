@@ -0,0 +1,61 @@
+/*
+The `lcd_timing.h` file holds the HD44780 execution times used by `LCD_3.c` when the RW pin is not wired and the busy flag cannot be read.
+
+1. **Timing Table**: Every HD44780 instruction is identified by its highest set bit, so `lcd_exec_us_table` is indexed by that bit number.
+Clear display (bit 0) and return home (bit 1) take 1.52 ms; every other instruction takes 37 us. Writing a character takes 37 us plus
+4 us for the address counter update. These are the datasheet values at the nominal 270 kHz oscillator.
+
+2. **Margin**: `LCD_EXEC_MARGIN_PCT` stretches every wait to cover modules whose oscillator runs slower than nominal.
+
+This header has no AVR dependencies. `test/test_lcd_timing.c` checks the table and `lcd_exec_us()` on a PC against the instructions as the
+virtual HD44780 of `test/hd44780.c` decodes them, and the waits of `LCD_3.c` against its execution times.
+*/
+
+#ifndef LCD_TIMING_H_
+#define LCD_TIMING_H_
+
+#include <stdint.h>
+
+#define LCD_EXEC_LONG_US 1520 // Clear display, return home
+#define LCD_EXEC_SHORT_US 37 // All other instructions
+#define LCD_EXEC_DATA_US 41 // Write data to CGRAM or DDRAM, including the address counter update
+
+#ifndef LCD_EXEC_MARGIN_PCT
+#define LCD_EXEC_MARGIN_PCT 25 // Extra time for slow module oscillators
+#endif
+
+#define LCD_EXEC_WITH_MARGIN(us) ((us) + ((us) * LCD_EXEC_MARGIN_PCT + 99) / 100)
+
+// Execution time in microseconds, indexed by the highest set bit of the instruction
+static const uint16_t lcd_exec_us_table[8] = {
+	LCD_EXEC_LONG_US, // 0x01 clear display
+	LCD_EXEC_LONG_US, // 0x02 return home
+	LCD_EXEC_SHORT_US, // 0x04 entry mode set
+	LCD_EXEC_SHORT_US, // 0x08 display on/off control
+	LCD_EXEC_SHORT_US, // 0x10 cursor or display shift
+	LCD_EXEC_SHORT_US, // 0x20 function set
+	LCD_EXEC_SHORT_US, // 0x40 set CGRAM address
+	LCD_EXEC_SHORT_US // 0x80 set DDRAM address
+};
+
+// Returns the datasheet execution time of a byte sent with RS = rs (0 = instruction, 1 = data)
+static inline uint16_t lcd_exec_us(uint8_t rs, uint8_t value) {
+	uint8_t bit = 7;
+
+	if (rs)
+	return LCD_EXEC_DATA_US;
+	if (value == 0)
+	return LCD_EXEC_LONG_US; // Not a valid instruction, so assume the worst
+	while (!(value & 0x80)) {
+		value <<= 1;
+		bit--;
+	}
+	return lcd_exec_us_table[bit];
+}
+
+// Nonzero when the byte needs the long wait. The AVR delay functions need a constant argument, so the driver picks between two waits.
+static inline uint8_t lcd_exec_is_long(uint8_t rs, uint8_t value) {
+	return lcd_exec_us(rs, value) > LCD_EXEC_DATA_US;
+}
+
+#endif /* LCD_TIMING_H_ */
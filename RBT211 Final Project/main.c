@@ -5,124 +5,189 @@ measure distance and communicates the measurement results to an LCD display and
 
 Here is a step-by-step narrative of the program"
 
-1. **Initialization**: The program starts by defining several macros for frequency (F_CPU), baud rate for serial communication (BAUD), and digital HIGH and LOW 
-values. The necessary libraries are then included. The trigger (TRIG) and echo (ECHO) pins for the HC-SR04 ultrasonic sensor are defined as PB1 and PB2 respectively.
-
-2. **UART Communication Setup**: The program defines functions for initializing UART communication (`uart_init`) and for sending strings (`uart_puts`) and integers 
-(`uart_puti`, `uart_putlni`) over UART. These functions are used for sending data to the serial monitor.
-
-3. **Pulse Reading**: The `pulseIn` function measures the duration of a HIGH or LOW pulse on a given pin. This function is used to measure the duration of the echo 
-pulse from the HC-SR04 sensor, which is proportional to the distance measured by the sensor.
-
-4. **Main Loop**: In the `main` function, the program first initializes UART communication and the LCD display. The TRIG pin is set as output and the ECHO pin as
-input. The program then enters an infinite loop, where it triggers a measurement by sending a pulse on the TRIG pin, measures the duration of the returned echo pulse, 
-calculates the distance in centimeters and inches, and displays the results on the LCD display and the serial monitor. The loop runs continuously with a delay of 
-500 milliseconds between each measurement.
+1. **Initialization**: The program starts by defining the frequency macro (F_CPU); the baud rate for serial communication (BAUD) is set in `uart.c`. The necessary libraries 
+are then included. The trigger (TRIG) and echo (ECHO) pins for the HC-SR04 ultrasonic sensor are defined in `echo.h` as PB1 and PB0 (ICP1). Build with 
+ECHO_POLLED to keep the echo on PB2.
+
+2. **UART Communication Setup**: The UART functions (`uart_init`, `uart_puts`, `uart_puti`, `uart_putlni`, `uart_putlnu`) live in `uart.c`. They queue text in a ring 
+buffer that is sent from the UART interrupt, so the measurement and LCD work are not held up while the serial monitor output goes out.
+Build with TELEMETRY defined to send each measurement as a 13 byte binary frame (see `telemetry.h`) instead of about 60 bytes of text. 
+The telemetry build measures every 60 ms, the fastest rate the HC-SR04 allows, and sends at BAUD (57600 by default, which `util/setbaud.h` 
+reaches with USE_2X); `tools/telemetry_decode.py` turns the frames back into CSV.
+
+3. **Pulse Reading**: `echo.c` measures the duration of the echo pulse from the HC-SR04 sensor, which is proportional to the distance measured by the sensor. 
+The Timer1 input capture unit timestamps both edges of the pulse in hardware with 0.5 us resolution.
+
+4. **Main Loop**: In the `main` function, the program first initializes UART communication, the LCD display and the echo timer. The work is then done by 
+tasks run by the scheduler in `sched.c`. `measure_task` runs every 500 milliseconds and triggers a measurement by sending a pulse on the TRIG pin. When the 
+echo has been timed, the Timer1 ISR wakes `report_task`, which calculates the distance in centimeters and inches, and displays the results on the LCD display 
+and the serial monitor. The main loop only calls `sched_run()` and `sched_sleep()`, so nothing waits in a delay loop, and the CPU idles 
+between interrupts until the next task is due.
+
+5. **Logging**: Every `LOG_PERIOD_MS` the distance in cm is also added to the EEPROM log in `eelog.c`, which keeps the last hour or so of
+readings while no serial monitor is attached. Sending `d` makes `command_task` dump the log, one block per line; `tools/eelog_decode.py` 
+turns the dump back into samples. Use the dump in the text build, since its lines would break up the frames of a TELEMETRY build.
+
+6. **Display**: `LCD_VIEW` picks what the LCD shows. `LCD_VIEW_BAR` (the default) puts the distance in cm and inches on the top row and 
+a bar graph of the distance up to `BAR_FULL_CM` on the bottom row. `LCD_VIEW_BIG` shows the distance in cm in big digits, and 
+`LCD_VIEW_TEXT` the original two lines of text. The bar and the digits are made of custom characters, which the driver only uploads 
+when a frame needs one that is not in CGRAM yet; the text build sends the number of uploads with every report, and it drops to 0 once 
+the bar has been through its four partial cells. Build with LCD_I2C (the `final_project_i2c` target) to drive the LCD through a PCF8574 
+backpack on PC4/PC5, which leaves PORTD free; Timer0 is then not used.
 */ 
 
+#ifndef F_CPU
 #define F_CPU 16000000UL
-#define BAUD 9600
-#define HIGH 1
-#define LOW 0
+#endif
 #include <avr/io.h>
-#include <util/delay.h>
 #include <stdlib.h>
-#include "lcd.h"
-#include <util/setbaud.h>
-
-#define TRIG PB1
-#define ECHO PB2
-
-// rest of your code...
-
-void uart_init() {
-	UBRR0H = UBRRH_VALUE;
-	UBRR0L = UBRRL_VALUE;
-	#if USE_2X
-	UCSR0A |= _BV(U2X0);
-	#else
-	UCSR0A &= ~(_BV(U2X0));
-	#endif
-	UCSR0C = _BV(UCSZ01) | _BV(UCSZ00); // 8-bit data
-	UCSR0B = _BV(RXEN0) | _BV(TXEN0); // Enable RX and TX
+#include <avr/interrupt.h>
+#include "LCD_3.h"
+#include "uart.h"
+#include "echo.h"
+#ifdef TELEMETRY
+#include "telemetry.h"
+#endif
+#include "../fixmath.h"
+#include "../sched.h"
+#include "../eelog.h"
+
+// The LCD must keep off the UART (PD0/PD1) and the HC-SR04 pins
+PIN_ASSERT_FREE(LCD_PINS, PIN_GROUP(PIN_D(0), PIN_D(1)), "The LCD pins clash with the UART");
+PIN_ASSERT_FREE(LCD_PINS, PIN_GROUP(PIN_B(TRIG), PIN_B(ECHO)), "The LCD pins clash with TRIG/ECHO");
+
+#ifdef TELEMETRY
+#define MEASURE_PERIOD_MS 60 // Time between measurements, the HC-SR04 needs at least 60 ms
+#else
+#define MEASURE_PERIOD_MS 500 // Time between measurements
+#endif
+
+#define LOG_PERIOD_MS 5000 // Time between samples in the EEPROM log
+#define LOG_EVERY (LOG_PERIOD_MS / MEASURE_PERIOD_MS)
+#define LOG_DISTANCE 0 // eelog channel of the distance in cm
+#define COMMAND_POLL_MS 20 // Time between checks for a serial command
+
+#define LCD_VIEW_TEXT 0 // Distance in cm and inches as text
+#define LCD_VIEW_BAR 1 // Text on the top row, bar graph on the bottom row
+#define LCD_VIEW_BIG 2 // Distance in cm in big digits
+#ifndef LCD_VIEW
+#define LCD_VIEW LCD_VIEW_BAR
+#endif
+#define BAR_FULL_CM 200 // Distance shown by a full bar
+
+static uint8_t report_id; // Scheduler id of report_task
+static uint8_t dump_block = EELOG_BLOCKS; // Next block the log dump sends, EELOG_BLOCKS when not dumping
+
+// Starts a measurement; Timer1 times the echo in hardware
+static void measure_task(void)
+{
+	echo_trigger();
 }
 
-void uart_puts(char *s) {
-	while (*s) {
-		while (!(UCSR0A & _BV(UDRE0))) {} // Wait for empty transmit buffer
-		UDR0 = *s;
-		s++;
-	}
+// Called from the Timer1 ISR when the echo has been timed
+static void echo_finished(uint16_t ticks)
+{
+	sched_wake(report_id);
 }
 
-void uart_puti(int n) {
+// Calculates the distance and sends it to the LCD and the serial monitor
+static void report_task(void)
+{
+	static uint8_t log_count = 0;
 	char buffer[10];
-	itoa(n, buffer, 10);
-	uart_puts(buffer);
-}
+	uint16_t duration;
+	int distanceCm, distanceInch;
+
+	// Read the echo pulse width and calculate distance
+	duration = echo_us();
+	distanceCm = fix_mul_q16(duration, FIX_Q16(0.034/2)); // Fixed point, no soft-float
+	distanceInch = fix_mul_q16(duration, FIX_Q16(0.0133/2));
+
+	// Send distance to LCD. Only the characters that changed since the last cycle are queued.
+	lcd_fb_clear();
+#if LCD_VIEW == LCD_VIEW_BIG
+	lcd_fb_big_number(0, distanceCm, 3);
+	lcd_fb_gotoxy(12,1);
+	lcd_fb_puts("cm");
+#else
+	lcd_fb_gotoxy(0,0);
+#if LCD_VIEW == LCD_VIEW_TEXT
+	lcd_fb_puts("Dist: ");
+#endif
+	lcd_fb_puts(itoa(distanceCm, buffer, 10)); // Convert integer to string before sending to LCD.
+	lcd_fb_puts(" cm");
+#if LCD_VIEW == LCD_VIEW_TEXT
+	lcd_fb_gotoxy(0,1);
+	lcd_fb_puts("Dist: ");
+#else
+	lcd_fb_puts("  ");
+#endif
+	lcd_fb_puts(itoa(distanceInch, buffer, 10));
+	lcd_fb_puts(" in");
+#if LCD_VIEW == LCD_VIEW_BAR
+	lcd_fb_bar(0, 1, LCD_COLS, distanceCm >= BAR_FULL_CM ? LCD_BAR_STEPS : (uint32_t)distanceCm * LCD_BAR_STEPS / BAR_FULL_CM);
+#endif
+#endif
+	lcd_flush_async(); // Returns right away, the Timer0 ISR does the sending
+
+	// Add every LOG_EVERY-th distance to the EEPROM log; the writing is done from the EE_READY interrupt
+	if (++log_count >= LOG_EVERY)
+	{
+		log_count = 0;
+		eelog_add(LOG_DISTANCE, distanceCm);
+	}
 
-void uart_putlni(int n) {
-	uart_puti(n);
-	uart_puts("\n");
+	// Send distance to serial
+#ifdef TELEMETRY
+	telemetry_send(sched_now(), echo_ticks()); // Raw width, the decoder does the maths
+#else
+	uart_puts("Duration: ");
+	uart_putlnu(duration); // 65535 on a timeout, which uart_putlni would print as -1
+	uart_puts("Distance cm: ");
+	uart_putlni(distanceCm);
+	uart_puts("Distance inch: ");
+	uart_putlni(distanceInch);
+	uart_puts("LCD glyph uploads: ");
+	uart_putlni(lcd_fb_glyph_uploads());
+#endif
 }
 
-unsigned long pulseIn(uint8_t pin, uint8_t state) {
-	uint8_t mask = (1 << pin);
-	unsigned long width = 0;
-	// Wait for any previous pulse to end
-	while ((PINB & mask) == state) {}
-	// Wait for the pulse to start
-	while ((PINB & mask) != state) {}
-	// Then wait for the pulse to stop
-	while ((PINB & mask) == state) {
-		width++;
-		_delay_us(1);
+// Handles serial commands and sends the log dump one block at a time, whenever the TX buffer has room for a line
+static void command_task(void)
+{
+	char line[EELOG_LINE_SIZE];
+
+	if (uart_getc() == 'd')
+	{
+		eelog_flush(); // Include the samples not written yet
+		dump_block = 0;
+	}
+	if (dump_block < EELOG_BLOCKS && !eelog_busy() && uart_tx_free() >= EELOG_LINE_SIZE - 1)
+	{
+		eelog_dump_line(dump_block++, line);
+		uart_puts(line);
 	}
-	return width;
 }
 
 int main(void)
 {
-	char buffer[10];
-	unsigned long duration;
-	int distanceCm, distanceInch;
-
 	uart_init();  // Initialize UART for serial communication
 	lcd_init();
-	
-	DDRB |= (1<<TRIG); // Sets the TRIG_PIN as Output
-	DDRB &= ~(1<<ECHO); // Sets the ECHO_PIN as Input
+	lcd_async_init(); // LCD output is sent from the Timer0 interrupt
+	echo_init(); // Sets up TRIG, ECHO and the Timer1 input capture
+	echo_set_callback(echo_finished);
+	eelog_init(); // Carries on after the newest block in the EEPROM
+
+	sched_init(); // Timer2 drives the task scheduler
+	report_id = sched_add(report_task, SCHED_ASLEEP, 0);
+	sched_add(measure_task, 0, MEASURE_PERIOD_MS);
+	sched_add(command_task, 0, COMMAND_POLL_MS);
+	sei(); // The UART, LCD, echo and EEPROM log drivers work from their interrupts
+
 	while(1)
 	{
-		// Code to send the trigger pulse
-		PORTB |= (1<<TRIG);
-		_delay_us(10);
-		PORTB &= ~(1<<TRIG);
-
-		// Code to read the echo pulse and calculate distance
-		duration = pulseIn(ECHO, HIGH);
-		distanceCm= duration*0.034/2;
-		distanceInch = duration*0.0133/2;
-
-		// Send distance to LCD
-		lcd_gotoxy(0,0);
-		lcd_puts("Dist: ");
-		lcd_puts(itoa(distanceCm, buffer, 10)); // Convert integer to string before sending to LCD.
-		lcd_puts(" cm");
-		lcd_gotoxy(0,1);
-		lcd_puts("Dist: ");
-		lcd_puts(itoa(distanceInch, buffer, 10));
-		lcd_puts(" in");
-
-		// Send distance to serial
-		uart_puts("Duration: ");
-		uart_putlni(duration);
-		uart_puts("Distance cm: ");
-		uart_putlni(distanceCm);
-		uart_puts("Distance inch: ");
-		uart_putlni(distanceInch);
-
-		_delay_ms(500);
+		sched_run();
+		sched_sleep(); // Idle until an interrupt, Timer2 wakes the CPU for the next deadline
 	}
 
 }
@@ -0,0 +1,220 @@
+/*
+The `sonar_array.c` file contains the definitions of the functions declared in the `sonar_array.h` file.
+
+1. **Sensor Table**: `sonars` lists the trigger pin, echo pin and slot of every sensor. The default wiring is four sensors with triggers
+on PC0-PC3 and echoes on PB2-PB5, fired as two pairs (front/back, then left/right). The masks used by the ISRs are worked out once in
+`sonar_init()`, among them `trig_mask`, the only `SONAR_TRIG_PORT` pins the driver ever drives, so the other pins of that port are left
+alone.
+
+2. **Slot Sequence**: `TIMER1_COMPA_vect` steps through `SONAR_TRIG_HIGH` (hold the trigger pins high for 10 us), `SONAR_LISTEN` (wait for
+the echoes, with a timeout) and `SONAR_GUARD` (quiet time before the next slot). The pin change ISRs end the listen phase early as soon as
+the last echo in the slot has ended. The timeout may have matched by then with its interrupt still pending, so `sonar_guard()` clears
+`OCF1A` along with moving `OCR1A`, or the guard time would be skipped.
+
+3. **Frames**: Widths are collected in `work` and copied to `frame` when the last slot is done, so `sonar_read()` never sees a mix of two
+rounds.
+*/
+
+#include "sonar_array.h"
+#include "../fixmath.h"
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <util/atomic.h>
+
+#define SONAR_IDLE 0
+#define SONAR_TRIG_HIGH 1
+#define SONAR_LISTEN 2
+#define SONAR_GUARD 3
+
+#define SONAR_TRIG_TICKS (10 * SONAR_TICKS_PER_US) // 10 us trigger pulse
+#define SONAR_TIMEOUT_TICKS ((uint16_t)(SONAR_TIMEOUT_US * SONAR_TICKS_PER_US))
+#define SONAR_GUARD_TICKS ((uint16_t)(SONAR_GUARD_US * SONAR_TICKS_PER_US))
+#define SONAR_MM_PER_TICK FIX_Q16(0.343 / 2 / SONAR_TICKS_PER_US) // Half the round trip at 343 m/s
+
+#if SONAR_COUNT > 8
+#error "SONAR_COUNT can be at most 8"
+#endif
+
+static const sonar_t sonars[SONAR_COUNT] = {
+	{ PC0, SONAR_ON_PORTB, PB2, 0 }, // Front
+	{ PC1, SONAR_ON_PORTB, PB3, 0 }, // Back
+	{ PC2, SONAR_ON_PORTB, PB4, 1 }, // Left
+	{ PC3, SONAR_ON_PORTB, PB5, 1 } // Right
+};
+
+static uint8_t slot_count = 0;
+static uint8_t trig_mask = 0; // Trigger pins of all the slots
+static uint8_t slot_trig[SONAR_COUNT]; // Trigger pins of each slot
+static uint8_t slot_sensors[SONAR_COUNT]; // Bit i set when sensor i is in the slot
+static uint8_t echo_mask[2]; // Echo pins on PORTB and PORTD
+static uint8_t last_pins[2]; // Echo pin levels seen by the last pin change ISR
+
+static volatile uint8_t state = SONAR_IDLE;
+static volatile uint8_t slot = 0;
+static volatile uint8_t pending = 0; // Sensors in the current slot still waiting for their echo to end
+static uint16_t rise[SONAR_COUNT]; // Rising edge timestamps
+static uint16_t work[SONAR_COUNT]; // Widths of the round in progress
+static uint16_t frame[SONAR_COUNT]; // Widths of the last complete round
+static volatile uint8_t frame_seq = 0;
+
+void sonar_init(void) {
+	uint8_t i;
+
+	slot_count = 0;
+	echo_mask[SONAR_ON_PORTB] = 0;
+	echo_mask[SONAR_ON_PORTD] = 0;
+	for (i = 0; i < SONAR_COUNT; i++) {
+		slot_trig[i] = 0;
+		slot_sensors[i] = 0;
+	}
+	for (i = 0; i < SONAR_COUNT; i++) {
+		slot_trig[sonars[i].slot] |= (1 << sonars[i].trig);
+		slot_sensors[sonars[i].slot] |= (1 << i);
+		echo_mask[sonars[i].echo_port] |= (1 << sonars[i].echo);
+		if (sonars[i].slot >= slot_count)
+		slot_count = sonars[i].slot + 1;
+		frame[i] = SONAR_TIMEOUT;
+	}
+
+	trig_mask = 0;
+	for (i = 0; i < slot_count; i++)
+	trig_mask |= slot_trig[i];
+	SONAR_TRIG_PORT &= ~trig_mask;
+	SONAR_TRIG_DDR |= trig_mask;
+	DDRB &= ~echo_mask[SONAR_ON_PORTB];
+	DDRD &= ~echo_mask[SONAR_ON_PORTD];
+
+	// Timer1 free running at F_CPU / 8, the same setup as echo_init()
+	TCCR1A = 0;
+	TCCR1B = (TCCR1B & (1 << ICNC1)) | (1 << CS11);
+
+	PCMSK0 = echo_mask[SONAR_ON_PORTB];
+	PCMSK2 = echo_mask[SONAR_ON_PORTD];
+	last_pins[SONAR_ON_PORTB] = PINB;
+	last_pins[SONAR_ON_PORTD] = PIND;
+	PCIFR = (1 << PCIF0) | (1 << PCIF2);
+	PCICR |= (echo_mask[SONAR_ON_PORTB] ? (1 << PCIE0) : 0) | (echo_mask[SONAR_ON_PORTD] ? (1 << PCIE2) : 0);
+}
+
+// Raises the trigger pins of `slot` and schedules the falling edge
+static void sonar_fire(void) {
+	SONAR_TRIG_PORT |= slot_trig[slot];
+	state = SONAR_TRIG_HIGH;
+	OCR1A = TCNT1 + SONAR_TRIG_TICKS;
+}
+
+void sonar_start(void) {
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		if (state == SONAR_IDLE) {
+			slot = 0;
+			sonar_fire();
+			TIFR1 = (1 << OCF1A);
+			TIMSK1 |= (1 << OCIE1A);
+		}
+	}
+}
+
+void sonar_stop(void) {
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		TIMSK1 &= ~(1 << OCIE1A);
+		SONAR_TRIG_PORT &= ~trig_mask;
+		pending = 0;
+		state = SONAR_IDLE;
+	}
+}
+
+uint8_t sonar_read(uint16_t ticks[SONAR_COUNT]) {
+	uint8_t i, seq;
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		for (i = 0; i < SONAR_COUNT; i++)
+		ticks[i] = frame[i];
+		seq = frame_seq;
+	}
+	return seq;
+}
+
+// Distances in mm of the newest frame, SONAR_TIMEOUT for no echo
+uint8_t sonar_read_mm(uint16_t mm[SONAR_COUNT]) {
+	uint8_t i, seq = sonar_read(mm);
+
+	for (i = 0; i < SONAR_COUNT; i++) {
+		if (mm[i] != SONAR_TIMEOUT)
+		mm[i] = fix_mul_q16(mm[i], SONAR_MM_PER_TICK);
+	}
+	return seq;
+}
+
+static void sonar_guard(uint16_t now) {
+	state = SONAR_GUARD;
+	OCR1A = now + SONAR_GUARD_TICKS;
+	TIFR1 = (1 << OCF1A); // A timeout that matched meanwhile must not end the guard time
+}
+
+ISR(TIMER1_COMPA_vect) {
+	uint16_t now = OCR1A; // Schedule from the compare time so ISR latency does not add up
+	uint8_t i;
+
+	switch (state) {
+		case SONAR_TRIG_HIGH:
+		SONAR_TRIG_PORT &= ~slot_trig[slot];
+		pending = slot_sensors[slot];
+		state = SONAR_LISTEN;
+		OCR1A = now + SONAR_TIMEOUT_TICKS;
+		break;
+
+		case SONAR_LISTEN: // Timeout, some echoes never ended
+		for (i = 0; i < SONAR_COUNT; i++) {
+			if (pending & (1 << i))
+			work[i] = SONAR_TIMEOUT;
+		}
+		pending = 0;
+		sonar_guard(now);
+		break;
+
+		case SONAR_GUARD:
+		if (++slot >= slot_count) {
+			for (i = 0; i < SONAR_COUNT; i++)
+			frame[i] = work[i];
+			frame_seq++;
+			slot = 0;
+		}
+		sonar_fire();
+		break;
+	}
+}
+
+// Handles the echo edges on one port. `now` is read first thing in the ISR to keep the timestamps tight.
+static inline void sonar_edges(uint8_t port, uint8_t pins, uint16_t now) {
+	uint8_t changed = (pins ^ last_pins[port]) & echo_mask[port];
+	uint8_t i, bit;
+
+	last_pins[port] = pins;
+	if (!changed)
+	return;
+
+	for (i = 0; i < SONAR_COUNT; i++) {
+		bit = (1 << sonars[i].echo);
+		if (sonars[i].echo_port != port || !(changed & bit))
+		continue;
+		if (pins & bit) {
+			rise[i] = now;
+		} else if (pending & (1 << i)) {
+			work[i] = now - rise[i];
+			pending &= ~(1 << i);
+		}
+	}
+
+	if (state == SONAR_LISTEN && !pending)
+	sonar_guard(now); // Every echo in the slot has ended, no need to wait for the timeout
+}
+
+ISR(PCINT0_vect) {
+	uint16_t now = TCNT1;
+	sonar_edges(SONAR_ON_PORTB, PINB, now);
+}
+
+ISR(PCINT2_vect) {
+	uint16_t now = TCNT1;
+	sonar_edges(SONAR_ON_PORTD, PIND, now);
+}
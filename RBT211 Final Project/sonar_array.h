@@ -0,0 +1,57 @@
+/*
+The `sonar_array.h` file declares the driver for several HC-SR04 sensors read as a group.
+
+1. **Sensors**: The sensors are listed in the `sonars` table in `sonar_array.c`. Each one has its own trigger pin on `SONAR_TRIG_PORT`
+and its echo on any PORTB pin (PCINT0-7) or PORTD pin (PCINT16-23). Each sensor also has a slot number. Sensors in the same slot are
+triggered together, so put sensors that face away from each other in the same slot and neighbours in different slots.
+
+2. **Timing**: Echo edges are timestamped in the `PCINT0_vect`/`PCINT2_vect` ISRs against Timer1, which runs freely at F_CPU / 8 like in
+`echo.c` (0.5 us per tick). Timer1 compare match A runs the slot sequence: trigger, listen until every echo in the slot has ended or timed
+out, wait `SONAR_GUARD_US` for stray echoes to die down, then move on to the next slot. A slot takes only as long as its farthest echo, so
+the frame rate goes up when obstacles are close.
+
+3. **Results**: When the last slot finishes, the widths of all sensors are published as one frame. `sonar_read()` copies the newest frame
+and returns its sequence number, which goes up by one per frame. `sonar_read_mm()` does the same with the distances in mm, worked out with
+`fix_mul_q16()` from `fixmath.h` at 343 m/s; a sensor with no echo stays `SONAR_TIMEOUT` in both.
+*/
+
+#ifndef SONAR_ARRAY_H_
+#define SONAR_ARRAY_H_
+
+#include <avr/io.h>
+#include <stdint.h>
+
+#define SONAR_COUNT 4 // Number of sensors in the `sonars` table, at most 8
+
+#define SONAR_TRIG_PORT PORTC
+#define SONAR_TRIG_DDR DDRC
+
+#define SONAR_ON_PORTB 0 // Echo on PORTB, handled by PCINT0_vect
+#define SONAR_ON_PORTD 1 // Echo on PORTD, handled by PCINT2_vect
+
+#ifndef F_CPU
+#define F_CPU 16000000UL
+#endif
+
+#define SONAR_TICKS_PER_US (F_CPU / 8 / 1000000UL) // Timer1 at F_CPU / 8
+#if F_CPU % 8000000UL
+#error "Timer1 at F_CPU / 8 needs F_CPU to be a multiple of 8 MHz"
+#endif
+#define SONAR_TIMEOUT_US 30000U // Longer than the 4 m range
+#define SONAR_GUARD_US 10000U // Quiet time between slots against crosstalk
+#define SONAR_TIMEOUT 0xFFFF // Width reported for a sensor with no echo
+
+typedef struct {
+	uint8_t trig; // Bit number on SONAR_TRIG_PORT
+	uint8_t echo_port; // SONAR_ON_PORTB or SONAR_ON_PORTD
+	uint8_t echo; // Bit number on the echo port
+	uint8_t slot; // Sensors with the same slot are triggered together
+} sonar_t;
+
+void sonar_init(void);
+void sonar_start(void);
+void sonar_stop(void);
+uint8_t sonar_read(uint16_t ticks[SONAR_COUNT]);
+uint8_t sonar_read_mm(uint16_t mm[SONAR_COUNT]);
+
+#endif /* SONAR_ARRAY_H_ */
@@ -0,0 +1,65 @@
+/*
+The `telemetry.c` file contains the definitions of the functions declared in the `telemetry.h` file.
+
+1. **CRC**: avr-libc's `_crc_xmodem_update()` is the MSB first 0x1021 CRC; started at 0xFFFF it gives CRC-16/CCITT-FALSE.
+
+2. **COBS**: The encoder copies the packet and writes, in front of each run of non-zero bytes, a code byte holding the distance to the
+next zero (which is left out). The packet is shorter than 254 bytes, so no run ever needs the 0xFF code.
+*/
+
+#include "telemetry.h"
+#include "uart.h"
+#include <util/crc16.h>
+
+static uint16_t sequence = 0;
+static uint16_t dropped = 0;
+
+// COBS encodes len bytes of in into out and returns the encoded length, at most len + 1
+static uint8_t cobs_encode(const uint8_t *in, uint8_t len, uint8_t *out) {
+	uint8_t code_at = 0, n = 1, i;
+
+	for (i = 0; i < len; i++) {
+		if (in[i] == 0) {
+			out[code_at] = n - code_at;
+			code_at = n++;
+		} else
+		out[n++] = in[i];
+	}
+	out[code_at] = n - code_at;
+	return n;
+}
+
+void telemetry_send(uint32_t time, uint16_t ticks) {
+	uint8_t packet[TELEMETRY_PACKET_SIZE];
+	uint8_t frame[TELEMETRY_FRAME_SIZE];
+	uint16_t crc = 0xFFFF;
+	uint8_t i, n;
+
+	packet[0] = TELEMETRY_VERSION;
+	packet[1] = sequence;
+	packet[2] = sequence >> 8;
+	packet[3] = time;
+	packet[4] = time >> 8;
+	packet[5] = time >> 16;
+	packet[6] = time >> 24;
+	packet[7] = ticks;
+	packet[8] = ticks >> 8;
+	for (i = 0; i < TELEMETRY_PACKET_SIZE - 2; i++)
+	crc = _crc_xmodem_update(crc, packet[i]);
+	packet[9] = crc;
+	packet[10] = crc >> 8;
+	sequence++;
+
+	n = cobs_encode(packet, TELEMETRY_PACKET_SIZE, frame);
+	frame[n++] = 0;
+	if (uart_tx_free() < n) {
+		dropped++;
+		return;
+	}
+	for (i = 0; i < n; i++)
+	uart_putc(frame[i]);
+}
+
+uint16_t telemetry_dropped(void) {
+	return dropped;
+}
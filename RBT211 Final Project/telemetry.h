@@ -0,0 +1,35 @@
+/*
+The `telemetry.h` file declares the binary telemetry output of the distance meter, an alternative to the text lines sent by `main.c`.
+
+1. **Packet**: Each measurement is sent as one 11 byte packet, all fields little-endian:
+
+	| Offset | Size | Field                                                        |
+	|--------|------|--------------------------------------------------------------|
+	| 0      | 1    | Packet version, `TELEMETRY_VERSION`                          |
+	| 1      | 2    | Sequence number, one higher for every packet                 |
+	| 3      | 4    | Time stamp in scheduler ticks (`sched_now()`, 64 us)         |
+	| 7      | 2    | Echo width in Timer1 ticks (0.5 us), 0xFFFF for a timeout    |
+	| 9      | 2    | CRC-16/CCITT (polynomial 0x1021, start 0xFFFF) of bytes 0-8  |
+
+2. **Framing**: The packet is COBS encoded (Consistent Overhead Byte Stuffing), which replaces every zero byte so that a single 0x00 can
+end the frame. A receiver that starts in the middle of the stream, or loses a byte, is back in step at the next zero. A frame is at most 13
+bytes on the wire, against about 60 for the text output.
+
+3. **Dropped Frames**: If the UART buffer does not have room for a whole frame, the frame is dropped instead of being sent in part. The
+sequence number is used up all the same, so the receiver sees the gap. `tools/telemetry_decode.py` turns the stream into CSV and counts
+gaps and bad frames.
+*/
+
+#ifndef TELEMETRY_H_
+#define TELEMETRY_H_
+
+#include <stdint.h>
+
+#define TELEMETRY_VERSION 1
+#define TELEMETRY_PACKET_SIZE 11 // Including the CRC
+#define TELEMETRY_FRAME_SIZE (TELEMETRY_PACKET_SIZE + 2) // COBS overhead byte and the 0x00 delimiter
+
+void telemetry_send(uint32_t time, uint16_t ticks);
+uint16_t telemetry_dropped(void);
+
+#endif /* TELEMETRY_H_ */
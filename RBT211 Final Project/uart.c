@@ -0,0 +1,195 @@
+/*
+The `uart.c` file contains the definitions of the functions declared in the `uart.h` file.
+
+1. **Transmit Path**: `uart_putc` copies a byte into the TX ring buffer and enables the Data Register Empty interrupt (`UDRIE0`). The
+`USART_UDRE_vect` ISR moves one byte into `UDR0` each time the hardware is ready and disables itself again once the buffer is empty. At
+9600 baud a byte takes about 1 ms on the wire, so the main loop no longer waits on the serial port unless the buffer fills up.
+
+2. **Receive Path**: `USART_RX_vect` stores each received byte in the RX ring buffer. `uart_getc` returns the oldest byte, or -1 if
+nothing has arrived.
+
+3. **Blocking With Interrupts Off**: If the blocking overflow policy is selected but global interrupts are disabled, the ISR can never
+run, so `uart_putc` drains a byte itself by polling `UDRE0` instead of waiting forever.
+*/
+
+#ifndef F_CPU
+#define F_CPU 16000000UL
+#endif
+#ifndef BAUD
+#ifdef TELEMETRY
+#define BAUD 57600 // Set with USE_2X at 16 MHz
+#else
+#define BAUD 9600
+#endif
+#endif
+
+#include "uart.h"
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <util/atomic.h>
+#include <util/setbaud.h>
+#include <stdlib.h>
+
+#define TX_MASK (UART_TX_BUFFER_SIZE - 1)
+#define RX_MASK (UART_RX_BUFFER_SIZE - 1)
+
+static volatile char tx_buffer[UART_TX_BUFFER_SIZE];
+static volatile uint8_t tx_head = 0; // Next free slot, written by uart_putc
+static volatile uint8_t tx_tail = 0; // Next byte to send, written by the ISR
+
+static volatile char rx_buffer[UART_RX_BUFFER_SIZE];
+static volatile uint8_t rx_head = 0; // Next free slot, written by the ISR
+static volatile uint8_t rx_tail = 0; // Next byte to read, written by uart_getc
+
+static uint8_t overflow_policy = UART_OVERFLOW_DEFAULT;
+static uint8_t tx_high_water = 0;
+static uint16_t tx_dropped = 0;
+static volatile uint16_t rx_dropped = 0;
+
+void uart_init(void) {
+	UBRR0H = UBRRH_VALUE;
+	UBRR0L = UBRRL_VALUE;
+	#if USE_2X
+	UCSR0A |= _BV(U2X0);
+	#else
+	UCSR0A &= ~(_BV(U2X0));
+	#endif
+	UCSR0C = _BV(UCSZ01) | _BV(UCSZ00); // 8-bit data
+	UCSR0B = _BV(RXCIE0) | _BV(RXEN0) | _BV(TXEN0); // Enable RX and TX, interrupt on receive
+}
+
+void uart_set_overflow_policy(uint8_t policy) {
+	overflow_policy = policy;
+}
+
+// Sends the oldest queued byte by polling; only used when the ISR cannot run
+static void uart_drain_one(void) {
+	while (!(UCSR0A & _BV(UDRE0))) {} // Wait for empty transmit buffer
+	UDR0 = tx_buffer[tx_tail];
+	tx_tail = (tx_tail + 1) & TX_MASK;
+}
+
+uint8_t uart_putc(char c) {
+	uint8_t next = (tx_head + 1) & TX_MASK;
+	uint8_t level;
+
+	while (next == tx_tail) { // Buffer full
+		if (overflow_policy == UART_OVERFLOW_DROP) {
+			tx_dropped++;
+			return 0;
+		}
+		if (!(SREG & _BV(SREG_I))) {
+			uart_drain_one();
+		}
+	}
+
+	tx_buffer[tx_head] = c;
+	tx_head = next;
+
+	level = (tx_head - tx_tail) & TX_MASK;
+	if (level > tx_high_water) {
+		tx_high_water = level;
+	}
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		UCSR0B |= _BV(UDRIE0); // The ISR clears this bit, so update it atomically
+	}
+	return 1;
+}
+
+void uart_puts(const char *s) {
+	while (*s) {
+		uart_putc(*s);
+		s++;
+	}
+}
+
+void uart_puti(int n) {
+	char buffer[10];
+	itoa(n, buffer, 10);
+	uart_puts(buffer);
+}
+
+void uart_putlni(int n) {
+	uart_puti(n);
+	uart_puts("\n");
+}
+
+// For values above 32767, which uart_puti would print as negative with the 16-bit int of the AVR
+void uart_putu(unsigned int n) {
+	char buffer[6];
+	utoa(n, buffer, 10);
+	uart_puts(buffer);
+}
+
+void uart_putlnu(unsigned int n) {
+	uart_putu(n);
+	uart_puts("\n");
+}
+
+// Waits until every queued byte has been handed to the hardware
+void uart_flush(void) {
+	while (tx_head != tx_tail) {
+		if (!(SREG & _BV(SREG_I))) {
+			uart_drain_one();
+		}
+	}
+}
+
+// Bytes that uart_putc can queue without waiting
+uint8_t uart_tx_free(void) {
+	return (tx_tail - tx_head - 1) & TX_MASK;
+}
+
+uint8_t uart_available(void) {
+	return (rx_head - rx_tail) & RX_MASK;
+}
+
+int uart_getc(void) {
+	char c;
+
+	if (rx_head == rx_tail) {
+		return -1;
+	}
+	c = rx_buffer[rx_tail];
+	rx_tail = (rx_tail + 1) & RX_MASK;
+	return (unsigned char)c;
+}
+
+uint8_t uart_tx_high_water(void) {
+	return tx_high_water;
+}
+
+uint16_t uart_tx_dropped(void) {
+	return tx_dropped;
+}
+
+uint16_t uart_rx_dropped(void) {
+	uint16_t count;
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		count = rx_dropped;
+	}
+	return count;
+}
+
+ISR(USART_UDRE_vect) {
+	if (tx_head != tx_tail) {
+		UDR0 = tx_buffer[tx_tail];
+		tx_tail = (tx_tail + 1) & TX_MASK;
+	} else {
+		UCSR0B &= ~_BV(UDRIE0); // Nothing left to send
+	}
+}
+
+ISR(USART_RX_vect) {
+	char c = UDR0; // Reading UDR0 clears RXC0 even if the byte is dropped
+	uint8_t next = (rx_head + 1) & RX_MASK;
+
+	if (next == rx_tail) {
+		rx_dropped++;
+		return;
+	}
+	rx_buffer[rx_head] = c;
+	rx_head = next;
+}
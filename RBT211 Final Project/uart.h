@@ -0,0 +1,62 @@
+/*
+The `uart.h` file declares the interrupt-driven serial port used by the distance meter.
+
+1. **Ring Buffers**: Outgoing bytes are queued in a TX ring buffer that the `USART_UDRE_vect` ISR drains one byte at a time, so `uart_puts`
+and friends return as soon as the text is copied into RAM. Incoming bytes are stored by `USART_RX_vect` in a matching RX ring buffer. Both
+buffer sizes must be powers of two (the index wraps with a mask instead of a divide).
+
+2. **Overflow Policy**: When the TX buffer is full, `UART_OVERFLOW_BLOCK` waits for the ISR to make room and `UART_OVERFLOW_DROP` throws
+the byte away and counts it. The policy can be changed at run time with `uart_set_overflow_policy()`.
+
+3. **Statistics**: `uart_tx_high_water()` returns the highest TX fill level seen so far, which tells you whether the buffer is sized right
+for the amount of text sent per measurement cycle. `uart_tx_free()` tells how many bytes fit without waiting, so a caller can drop a whole
+message instead of part of one. The dropped counters show how many bytes were lost in each direction.
+*/
+
+#ifndef UART_H_
+#define UART_H_
+
+#include <stdint.h>
+
+#ifndef UART_TX_BUFFER_SIZE
+#define UART_TX_BUFFER_SIZE 128 // Must be a power of two, at most 256
+#endif
+
+#ifndef UART_RX_BUFFER_SIZE
+#define UART_RX_BUFFER_SIZE 32 // Must be a power of two, at most 256
+#endif
+
+#define UART_OVERFLOW_DROP 0 // Discard bytes that do not fit
+#define UART_OVERFLOW_BLOCK 1 // Wait for the ISR to free a slot
+
+#ifndef UART_OVERFLOW_DEFAULT
+#define UART_OVERFLOW_DEFAULT UART_OVERFLOW_BLOCK
+#endif
+
+#if (UART_TX_BUFFER_SIZE & (UART_TX_BUFFER_SIZE - 1)) || UART_TX_BUFFER_SIZE > 256
+#error "UART_TX_BUFFER_SIZE must be a power of two no larger than 256"
+#endif
+#if (UART_RX_BUFFER_SIZE & (UART_RX_BUFFER_SIZE - 1)) || UART_RX_BUFFER_SIZE > 256
+#error "UART_RX_BUFFER_SIZE must be a power of two no larger than 256"
+#endif
+
+void uart_init(void);
+void uart_set_overflow_policy(uint8_t policy);
+
+uint8_t uart_putc(char c);
+void uart_puts(const char *s);
+void uart_puti(int n);
+void uart_putlni(int n);
+void uart_putu(unsigned int n);
+void uart_putlnu(unsigned int n);
+void uart_flush(void);
+uint8_t uart_tx_free(void);
+
+uint8_t uart_available(void);
+int uart_getc(void);
+
+uint8_t uart_tx_high_water(void);
+uint16_t uart_tx_dropped(void);
+uint16_t uart_rx_dropped(void);
+
+#endif /* UART_H_ */
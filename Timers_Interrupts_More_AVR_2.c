@@ -1,22 +1,25 @@
 /*
 Two external LEDs alternate blinking in the default state. When the ISR is triggered by the pushbutton, they are turned off and the onboard LED blinks 
-at the same rate. The blink rate of the LEDs can be adjusted by changing the value of the Output Compare Register A (OCR1A) for Timer1.
+at the same rate. The blink rate of the LEDs can be adjusted by changing BLINK_MS, the time between two Timer1 interrupts.
 
-To increase the blink rate (make the LEDs blink more frequently), decrease the value of OCR1A. To decrease the blink rate (make the LEDs blink less 
-frequently), increase the value of OCR1A. The actual blink rate can be calculated using the following formula:
+To increase the blink rate (make the LEDs blink more frequently), decrease BLINK_MS. To decrease the blink rate (make the LEDs blink less 
+frequently), increase BLINK_MS. timer_calc.h works out the prescaler and the Output Compare Register A (OCR1A) value from BLINK_MS and F_CPU
+when the sketch is built, using the formula:
 
-Blink rate (in seconds) = (OCR1A + 1) * Prescaler / F_CPU (current settings = (15624 + 1) * 1024 / 16,000,000 ≈ 1 second)
+Blink period (in seconds) = (OCR1A + 1) * Prescaler / F_CPU (current settings = (62499 + 1) * 256 / 16,000,000 = 1 second)
 
 - This uses Timer1 interrupt to alternate between the two external LEDs (PB6 and PB7)
-- The button press is be handled with an external interrupt
+- The button is sampled every 2 ms by the debouncer in `debounce.c` (Timer0), so one press is one event however much the contacts bounce
 - When the button is pressed, the external LEDs will turn OFF and the the on-board LED (PB5) starts blinking
 - When the button is pressed again, the circuit returns to the default state of PB^ & PB7 alternating blinking and onboard LED OFF
 
 This version maintains a global button_flag variable to keep track of whether the button is currently pressed. This flag determines which LED(s) to 
 toggle in the Timer1 compare match ISR.
 
-The INT0 ISR has been modified to check the button_flag. If the button was not previously pressed, it turns on both external LEDs and sets the flag. 
-If the button was previously pressed, it turns off both external LEDs and the on-board LED, and clears the flag.
+The main loop toggles the button_flag on every debounced press. When the flag is set it turns off both external LEDs, and when it is cleared it 
+turns off the on-board LED and restarts the alternating pattern. The INT0 interrupt is no longer used, because it fired on every bounce of the 
+contacts, so one press could toggle the flag several times. Between events the main loop sleeps with power_sleep() (see power.h), so the CPU only
+wakes for the debouncer's 2 ms tick and for Timer1.
 */
 
 #ifndef F_CPU			//Checks whether the clock is defined
@@ -25,50 +28,65 @@ If the button was previously pressed, it turns off both external LEDs and the on
 
 #include <avr/io.h>		//Enables AVR I/O
 #include <avr/interrupt.h>	//Enables use of interrupts
-
-#define LED0 PD6                //Assigns LED0 to Pin PD6
-#define LED1 PD7                //Assigns LED0 to Pin PD7
-#define ONBOARD_LED PB5         //Assigns the onboard LED to PB5 (this is not really necessary)
-#define BUTTON PD2              //Assigns te pushbutton to Pin PD2
+#include "debounce.h"		//Timer sampled button debouncer
+#include "power.h"		//Sleeps between interrupts
+#include "pins.h"		//Pin constants that compile to single sbi/cbi instructions
+#include "timer_calc.h"		//Timer settings worked out from F_CPU at compile time
+
+#define BLINK_MS 1000		//Time between blinks
+#if !TIMER_OK(1, TIMER_MS(BLINK_MS), 0)
+#error "Timer1 cannot make BLINK_MS exactly at this F_CPU"
+#endif
+
+#define LED0 PIN_D(6)           //Assigns LED0 to Pin PD6
+#define LED1 PIN_D(7)           //Assigns LED1 to Pin PD7
+#define LEDS PIN_GROUP(LED0, LED1)	//Both external LEDs, written together in one go
+#define ONBOARD_LED PIN_B(5)    //Assigns the onboard LED to PB5 (this is not really necessary)
+#define BUTTON PIN_D(2)         //Assigns te pushbutton to Pin PD2
 
 volatile uint8_t button_flag = 0;    	//declares a volatile variable as an unsigned 8 bit integer, names it button_flag and
 					//initializes it to 0
 
 int main(void)
 {
-	PORTD |= (1 << LED0);     		// Turns LED0 ON
-	PORTD &= ~(1 << LED1);    		// Turns LED1 OFF
-	DDRD |= (1 << LED0) | (1 << LED1);     	//sets LED0/PD6 and LED1/PD7 to output
-	DDRB |= (1 << ONBOARD_LED);            	//sets ONBOARD_LED/PB5 to output
-	DDRD &= ~(1 << BUTTON);                	//sets BUTTON/PD2 to a pullup resistor
-	PORTD |= (1 << BUTTON);
+	PIN_GROUP_WRITE(LEDS, PIN_MASK(LED0));	// Turns LED0 ON and LED1 OFF
+	PIN_GROUP_OUTPUT(LEDS);		     	//sets LED0/PD6 and LED1/PD7 to output
+	PIN_OUTPUT(ONBOARD_LED);            	//sets ONBOARD_LED/PB5 to output
+	debounce_init(PIN_MASK(BUTTON));	//sets BUTTON/PD2 to an input with a pullup resistor and starts sampling it
 
 	TCCR1A = 0;             //Sets the Timer/Counter Control Register A to 0, disables all features controlled by TCCR1A, leaves
 				//it in a simple counting mode. TCCR1A is in 15.11.1 in the datasheet.
 	
-	TCCR1B = (1 << WGM12) | (1 << CS12) | (1 << CS10);  	// Sets specific bits in the Timer/Counter Control Register B to control
+	TCCR1B = (1 << WGM12) | TIMER_CS(1, TIMER_MS(BLINK_MS));	// Sets specific bits in the Timer/Counter Control Register B to control
 								// the operation of Timer1. This sets bits for Clock Select, which  control
-								// the prescaler for Timer1. By setting CS12 and CS10 (and leaving CS11
-								// unset), it sets a prescaler of 1024. TCCR1B is in 15.11.2 in the datasheet.
+								// the prescaler for Timer1. TIMER_CS picks the smallest prescaler that can
+								// count to BLINK_MS, 256 at 16mHz. TCCR1B is in 15.11.2 in the datasheet.
 	
 	TIMSK1 = (1 << OCIE1A);         // Sets Output Compare Interrupt Enable 1 A bit (OCIE1A) in the Timer/Counter Interrupt Mask (TIMSK) Register
 					// This enables the Output Compare A Match interrupt for Timer1, which is triggered whenever the timer
 					// value matches the value stored in OCR1A (below).  TIMSK1 is in 15.11.8 in the datasheet.
 	
-	OCR1A = 15624;                  //Output Compare Register A (OCR1A) for Timer1 to 15624, which takes one second to hit at 16mHz
+	OCR1A = TIMER_TOP(1, TIMER_MS(BLINK_MS));	//Output Compare Register A (OCR1A) for Timer1 to 62499, which takes one second to hit at 16mHz
 					//OCR1A is in 1701104 in the datasheet.
 
-	EICRA = (1 << ISC01) | (1 << ISC00);     // Sets the ISC01 and ISC00 bits of the External Interrupt Control Register A to 1.
-						// This defines the trigger condition for INT0 (below) to its rising edge (LOW to HIGH)
-						//EICRA is in 12.2.1 in the datasheet.
-	
-	EIMSK = (1 << INT0);             // Sets  EIMSK register INT0 to 1, which enables external interrupts and triggers EICRA (above)
-					// when the defined condition (rising edge, defined in AICRA above) is met. EIMSK is in 12.2.2 in the datasheet.
-
+	power_init();			//Starts the Timer2 clock that counts the time spent asleep
 	sei();
 	
-	while (1)                        // Just an empty, endless loop. Kind of like life sometimes.
+	while (1)                        // Handles the button events from the debouncer
 	{
+		if (debounce_pressed(PIN_MASK(BUTTON))) {		// The button has just been pressed
+			if (button_flag == 0){				// Checks if the button_flag is equal to 0. This means the onboard LED is not blinking yet.
+				PIN_GROUP_LOW(LEDS);			// Turns OFF both external LEDs (LED0 and LED1).
+				button_flag = 1;			// Changes the button_flag to 1, so the Timer1 ISR blinks the onboard LED.
+			} else {                                	// If the button_flag is not 0, this means the onboard LED is blinking.
+				PIN_LOW(ONBOARD_LED);			// Turns OFF the onboard LED by clearing its bit in the PORTB register.
+
+				PIN_GROUP_WRITE(LEDS, PIN_MASK(LED0));	// Resumes the alternate blinking pattern: LED0 ON and LED1 OFF in one write to PORTD.
+				button_flag = 0;                        // Resets the button_flag to 0, so the Timer1 ISR blinks the external LEDs again.
+			}
+		}
+
+		power_sleep();					// Sleeps until the next interrupt, at most 2 ms
 	}
 
 	return(0);
@@ -79,35 +97,14 @@ ISR(TIMER1_COMPA_vect) {     		// Interrupt Service Routine for the Timer1 Compa
 
 	if (button_flag == 0) {         // Checks if the button_flag is equal to zero. Zero == the button is not pressed.
 
-		PORTD ^= (1 << LED0) | (1 << LED1);		// Toggles the state of the LED0 and LED1. The '^=' operation is a bitwise XOR that
-								// will flip the specific bits corresponding to the LED0 and LED1 pins in the PORTD register.
+		PIN_GROUP_TOGGLE(LEDS);				// Toggles the state of the LED0 and LED1. Writing their bits to PIND makes the chip
+								// flip the specific bits corresponding to the LED0 and LED1 pins in the PORTD register.
 								// As a result, if an LED was on it turns off, and if it was off it turns on. Since these LEDs
 								// were setup to blink alternately, this operation ensures that when one is on, the other is off.
 								// They swap states with each timer tick.
 
 		} else {                             		// If the button_flag is not zero, it means the button is currently being pressed.
 
-		PORTB ^= (1 << ONBOARD_LED);    // Toggles the state of the onboard LED. This makes the onboard LED blink when the button is pressed.
-	}
-}
-
-
-ISR(INT0_vect){						// ISR for the INT0 vector, . This ISR gets called the button is pressed or released
-	if (button_flag == 0){				// Checks if the button_flag is equal to 0. This means the button was not previously pressed.
-		PORTD &= ~((1 << LED0) | (1 << LED1));  // Turns OFF both external LEDs (LED0 and LED1). This is done by clearing the specific bits 
-							// in the PORTD register corresponding to the pins of LED0 and LED1.		
-		button_flag = 1;			// Changes the button_flag to 1, indicating that the button is now pressed.
-		
-		} else {                                // If the button_flag is not 0, this means the button was previously pressed.
-		PORTD &= ~((1 << LED0) | (1 << LED1));  // Turns OFF both external LEDs (LED0 and LED1) by clearing their bits in the PORTD register.
-		PORTB &= ~(1 << ONBOARD_LED);           // Turns OFF the onboard LED by clearing its bit in the PORTB register.
-		
-							// The next two lines resume the alternate blinking pattern.
-		PORTD |= (1 << LED0);                   // Turns ON LED0 by setting its bit in the PORTD register.
-		PORTD &= ~(1 << LED1);                  // Turns OFF LED1 by clearing its bit in the PORTD register.
-		button_flag = 0;                        // Resets the button_flag to 0, indicating that the button is now released.
+		PIN_TOGGLE(ONBOARD_LED);	// Toggles the state of the onboard LED. This makes the onboard LED blink when the button is pressed.
 	}
 }
-
-}
-
@@ -0,0 +1,115 @@
+/*
+The `USART.c` file contains the definitions of the functions declared in the `USART.h` file.
+*/
+
+#ifndef F_CPU
+#define F_CPU 16000000UL
+#endif
+
+#include "USART.h"
+#include <avr/io.h>
+#include <util/setbaud.h>
+
+void initUSART(void) {
+	UBRR0H = UBRRH_VALUE;
+	UBRR0L = UBRRL_VALUE;
+#if USE_2X
+	UCSR0A |= (1 << U2X0);
+#else
+	UCSR0A &= ~(1 << U2X0);
+#endif
+	UCSR0B = (1 << TXEN0) | (1 << RXEN0);
+	UCSR0C = (1 << UCSZ01) | (1 << UCSZ00); // 8 data bits, 1 stop bit
+}
+
+void transmitByte(uint8_t data) {
+	while (!(UCSR0A & (1 << UDRE0))) {} // Wait for empty transmit buffer
+	UDR0 = data;
+}
+
+uint8_t receiveByte(void) {
+	while (!(UCSR0A & (1 << RXC0))) {} // Wait for incoming data
+	return UDR0;
+}
+
+void printString(const char myString[]) {
+	uint8_t i = 0;
+
+	while (myString[i]) {
+		transmitByte(myString[i]);
+		i++;
+	}
+}
+
+// Reads characters into myString until a carriage return, echoing each one back
+void readString(char myString[], uint8_t maxLength) {
+	char response;
+	uint8_t i = 0;
+
+	while (i < (maxLength - 1)) {
+		response = receiveByte();
+		transmitByte(response);
+		if (response == '\r')
+		break;
+		myString[i] = response;
+		i++;
+	}
+	myString[i] = 0;
+}
+
+// Prints a byte as 3 decimal digits
+void printByte(uint8_t byte) {
+	transmitByte('0' + (byte / 100));
+	transmitByte('0' + ((byte / 10) % 10));
+	transmitByte('0' + (byte % 10));
+}
+
+// Prints a word as 5 decimal digits
+void printWord(uint16_t word) {
+	transmitByte('0' + (word / 10000));
+	transmitByte('0' + ((word / 1000) % 10));
+	transmitByte('0' + ((word / 100) % 10));
+	transmitByte('0' + ((word / 10) % 10));
+	transmitByte('0' + (word % 10));
+}
+
+// Prints a byte as 8 binary digits, most significant bit first, then a line break
+void printBinaryByte(uint8_t byte) {
+	uint8_t bit;
+
+	for (bit = 7; bit < 255; bit--) {
+		if (bit_is_set(byte, bit))
+		transmitByte('1');
+		else
+		transmitByte('0');
+	}
+	printString("\r\n");
+}
+
+char nibbleToHexCharacter(uint8_t nibble) {
+	if (nibble < 10)
+	return '0' + nibble;
+	return 'A' + nibble - 10;
+}
+
+void printHexByte(uint8_t byte) {
+	transmitByte(nibbleToHexCharacter(byte >> 4));
+	transmitByte(nibbleToHexCharacter(byte & 0x0F));
+}
+
+// Reads digits until a carriage return and returns the last three as a number
+uint8_t getNumber(void) {
+	char hundreds = '0';
+	char tens = '0';
+	char ones = '0';
+	char thisChar = '0';
+
+	do {
+		hundreds = tens;
+		tens = ones;
+		ones = thisChar;
+		thisChar = receiveByte();
+		transmitByte(thisChar);
+	} while (thisChar != '\r');
+	return (100 * (hundreds - '0') + 10 * (tens - '0') + ones - '0');
+}
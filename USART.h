@@ -0,0 +1,40 @@
+/*
+The `USART.h` file declares the small blocking serial library that `Wk3_LightMeter_GM.c` was written against (the same function names as
+the USART files from "Make: AVR Programming").
+
+1. **Setup**: `initUSART()` sets USART0 to 8 data bits, no parity and 1 stop bit at `BAUD` (9600 unless defined before), working out the
+divider with `util/setbaud.h` so it also works at the 1 MHz the light meter sketch runs at.
+
+2. **Output**: `transmitByte()` waits for the data register and sends one byte. The `print*` functions build on it: strings, a byte or
+word in decimal, a byte as 8 binary digits or as 2 hex digits.
+
+3. **Input**: `receiveByte()` waits for a byte. `readString()` reads a line into a buffer and echoes it back, and `getNumber()` reads a
+3-digit decimal number.
+
+Everything here polls, so a call takes as long as the bytes take to send. Use `uart.c` in the final project for interrupt-driven output.
+*/
+
+#ifndef USART_H_
+#define USART_H_
+
+#include <stdint.h>
+
+#ifndef BAUD
+#define BAUD 9600
+#endif
+
+void initUSART(void);
+void transmitByte(uint8_t data);
+uint8_t receiveByte(void);
+
+void printString(const char myString[]);
+void readString(char myString[], uint8_t maxLength);
+
+void printByte(uint8_t byte);
+void printWord(uint16_t word);
+void printBinaryByte(uint8_t byte);
+char nibbleToHexCharacter(uint8_t nibble);
+void printHexByte(uint8_t byte);
+uint8_t getNumber(void);
+
+#endif /* USART_H_ */
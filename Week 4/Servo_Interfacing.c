@@ -3,63 +3,91 @@
 #endif
 
 #include <avr/io.h>
-#include <util/delay.h>
 #include <avr/interrupt.h>
 
-// Pulse values defined as per the datasheet (page 102)
-#define PULSE_MIN 999U
-#define PULSE_MAX 4799U
-#define PULSE_MID 2899U
+#include "../servo_motion.h"
+#include "../sched.h"
 
-// Top value to achieve 50Hz frequency with 16MHz/8 = 2MHz timer clock
-#define TOP_VALUE 39999
+// Pulse values defined as per the datasheet (page 102)
+#define PULSE_MIN SERVO_MIN
+#define PULSE_MAX SERVO_MAX
+#define PULSE_MID TIMER_PULSE(1, SERVO_FRAME, TIMER_US(1450))
 
-// Loop increment/decrement step
-#define STEP 20
+// Sweep speed and acceleration, in timer ticks per second (and per second squared).
+// The old loop moved 20 ticks every 10 ms, which is 2000 ticks per second.
+#define SWEEP_SPEED 2000U
+#define SWEEP_ACCEL 8000U
 
-// Delay between each servo position update
-#define UPDATE_DELAY_MS 10
+// Faster moves between the fixed positions
+#define MOVE_SPEED 12000U
+#define MOVE_ACCEL 30000U
 
 // Delay between servo moves
 #define MOVE_DELAY_MS 500
 
-int main(void)
+// How often move_task checks whether the servo has arrived, one servo frame
+#define POLL_MS 20
+
+typedef struct
 {
-    ICR1 = TOP_VALUE;
-    
-    // Set timer/counter mode to fast PWM, with TOP defined by ICR1
-    TCCR1A |= (1 << WGM11);
-    TCCR1A |= (1 << COM1A1); // Set OC1A (PB1) as output compare pin
-    TCCR1B |= (1 << WGM12) | (1 << WGM13) | (1 << CS11); // Prescaler of 8
+    uint8_t profile;
+    uint16_t position;
+    uint16_t speed;
+    uint16_t accel;
+    uint16_t pause_ms; // Wait after the servo arrives
+} move_t;
 
-    DDRB |= (1 << PB1);
+static const move_t moves[] =
+{
+    // Sweep smoothly from minimum to maximum position and back
+    {SERVO_SCURVE, PULSE_MAX, SWEEP_SPEED, SWEEP_ACCEL, 0},
+    {SERVO_SCURVE, PULSE_MIN, SWEEP_SPEED, SWEEP_ACCEL, 0},
+    // Move servo to different positions with delay in between
+    {SERVO_TRAPEZOID, PULSE_MIN, MOVE_SPEED, MOVE_ACCEL, MOVE_DELAY_MS},
+    {SERVO_TRAPEZOID, PULSE_MID, MOVE_SPEED, MOVE_ACCEL, MOVE_DELAY_MS},
+    {SERVO_TRAPEZOID, PULSE_MAX, MOVE_SPEED, MOVE_ACCEL, MOVE_DELAY_MS},
+    {SERVO_TRAPEZOID, PULSE_MID, MOVE_SPEED, MOVE_ACCEL, MOVE_DELAY_MS},
+};
+
+#define MOVES (sizeof(moves) / sizeof(moves[0]))
+
+static uint8_t move_id;
+static uint8_t current = 0; // Index into moves
+static uint8_t moving = 0; // 1 while moves[current] is under way
+
+// Starts the next move, or checks on the one under way; the ISR in servo_motion.c does the moving
+static void move_task(void)
+{
+    const move_t *m = &moves[current];
 
-    OCR1A = PULSE_MIN;
+    if (!moving)
+    {
+        servo_profile(m->profile);
+        servo_move_to(m->position, m->speed, m->accel);
+        moving = 1;
+        sched_wake_in(move_id, POLL_MS);
+        return;
+    }
+    if (servo_busy())
+    {
+        sched_wake_in(move_id, POLL_MS);
+        return;
+    }
+    moving = 0;
+    current = (current + 1) % MOVES;
+    sched_wake_in(move_id, m->pause_ms); // The next move starts after the pause
+}
+
+int main(void)
+{
+    servo_init(PULSE_MIN); // Timer1 fast PWM at 50Hz on OC1A (PB1)
+    sched_init();
+    move_id = sched_add(move_task, 0, 0);
+    sei();
 
-    while (1) 
+    while (1)
     {
-        // Move servo from minimum to maximum position
-        for (uint16_t i = PULSE_MIN; i < PULSE_MAX; i += STEP)
-        {
-            OCR1A = i;
-            _delay_ms(UPDATE_DELAY_MS);
-        }
-        
-        // Move servo from maximum to minimum position
-        for (uint16_t i = PULSE_MAX; i > PULSE_MIN; i -= STEP)
-        {
-            OCR1A = i;
-            _delay_ms(UPDATE_DELAY_MS);
-        }
-        
-        // Move servo to different positions with delay in between
-        OCR1A = PULSE_MIN;
-        _delay_ms(MOVE_DELAY_MS);
-        OCR1A = PULSE_MID;
-        _delay_ms(MOVE_DELAY_MS);
-        OCR1A = PULSE_MAX;
-        _delay_ms(MOVE_DELAY_MS);
-        OCR1A = PULSE_MID;
-        _delay_ms(MOVE_DELAY_MS);
+        sched_run();
+        sched_sleep(); // Idle until the next interrupt instead of spinning on servo_busy()
     }
 }
@@ -1,14 +1,21 @@
 /*
 This code initializes the ADC and configures the button pin as an input with a pull-up resistor.
-It checks the button state in the main loop, and if the button is pressed, it toggles the isRunning
-variable. The servo movement code is only executed if isRunning is set.
-
-The ADC value read from the potentiometer is mapped to a range of 1ms to 100ms, and this value is
+The work is split into two tasks run by the scheduler in `sched.c` instead of `_delay_ms` loops, so
+the CPU is free between servo steps.
+
+- `button_task` checks for button events every 10 ms. The button itself is sampled and debounced by
+`debounce.c` on Timer0, which latches the events, so none is lost between checks. A press toggles the
+isRunning variable. Holding the button for 1 s (a long press) then stops the servo, parks it in the
+middle and makes the next press start the sweep over from the beginning.
+- `sweep_task` makes one servo step and then schedules itself again after the step delay. It stops
+scheduling itself when isRunning is cleared, and `button_task` wakes it up again.
+
+The potentiometer is sampled in the background by `adc_seq.c`, so reading it never waits on a conversion.
+The latest ADC value read from the potentiometer is mapped to a range of 1ms to 100ms, and this value is
 used as the delay between each servo position update.
-
-This code implements a simple button debounce by waiting for 50ms after a button press is
-detected. This might be sufficient, but in a more robust application, you might want to implement
-a more sophisticated button debounce algorithm.
+- `report_task` sends the pot reading, the oversampled rate from `adc_seq_rate()` and the noise floor from
+`adc_seq_noise()` to the serial monitor (9600 baud) every 2 s, through the interrupt-driven `uart.c` of the
+final project.
 */
 
 #ifndef F_CPU				// Set the clock
@@ -16,125 +23,161 @@ a more sophisticated button debounce algorithm.
 #endif
 
 #include <avr/io.h>			// Standard AVR IO library
-#include <util/delay.h>		// Delay library
-
-// Pulse values defined as per the datasheet (page 102)
-#define PULSE_MIN 999U		// Minimum pulse width of 1ms
-#define PULSE_MAX 4799U		// Maximum pulse width of 2.4ms
-#define PULSE_MID 2899U		// Mid pulse width of 1.45ms
-
-// Top value to achieve 50Hz frequency with 16MHz/8 = 2MHz timer clock
-#define TOP_VALUE 39999		// 2MHz / 50Hz = 40000
+#include <avr/interrupt.h>	// Interrupt library
+#include "../fixmath.h"		// Integer scaling, no soft-float
+#include "../adc_seq.h"		// Background ADC sampling
+#include "../sched.h"		// Cooperative task scheduler
+#include "../debounce.h"	// Timer sampled button debouncer
+#include "../timer_calc.h"	// Timer settings worked out from F_CPU at compile time
+#include "../RBT211 Final Project/uart.h"	// Interrupt-driven serial output
+#include <stdlib.h>
+
+// 50Hz frames; at 16MHz the timer runs at 16MHz/8 = 2MHz and TOP is 39999
+#define FRAME TIMER_HZ(50)
+#define TOP_VALUE TIMER_TOP(1, FRAME)
+
+// Pulse values defined as per the datasheet (page 102), in timer ticks
+#define PULSE_MIN TIMER_PULSE(1, FRAME, TIMER_US(500))	// Minimum pulse width of 0.5ms
+#define PULSE_MAX TIMER_PULSE(1, FRAME, TIMER_US(2400))	// Maximum pulse width of 2.4ms
+#define PULSE_MID TIMER_PULSE(1, FRAME, TIMER_US(1450))	// Mid pulse width of 1.45ms
+
+#if !TIMER_OK(1, FRAME, 1000)
+#error "Timer1 cannot make 50Hz frames at this F_CPU"
+#endif
 
 #define STEP 20				// Loop increment/decrement step
 
 
 #define BASE_UPDATE_DELAY_MS 1	// Base delay between each servo position update
 
-#define BUTTON_PIN PD2		// Button pin is PD2
+#define BUTTON PD2			// Button pin is PD2
+#define BUTTON_POLL_MS 10	// Time between button event checks
+#define REPORT_MS 2000		// Time between ADC reports on the serial monitor
 
 // ADC channel for potentiometer
 #define POT_CHANNEL 0
 
+// Sweep phases: up, down, then hold at each of the positions in hold_positions
+#define PHASE_UP 0
+#define PHASE_DOWN 1
+#define PHASE_HOLD 2
+
 // Variable to keep track of whether the servo should be moving
 volatile uint8_t isRunning = 0;
 
-// Function to initialize ADC
-void ADC_init()
+static const uint16_t hold_positions[] = { PULSE_MIN, PULSE_MID, PULSE_MAX, PULSE_MID };
+
+static uint8_t sweep_id;		// Scheduler id of sweep_task
+static uint8_t phase = PHASE_UP;	// Current sweep phase
+static uint16_t position = PULSE_MIN;	// Pulse width, or index into hold_positions while holding
+
+// Moves the servo one step and schedules the next step
+static void sweep_task(void)
+{
+	uint16_t delay;
+
+	if (!isRunning)
+	return;					// Stay asleep until button_task wakes us
+
+	switch (phase)
+	{
+		case PHASE_UP:				// Move servo from minimum to maximum position
+		OCR1A = position;
+		position += STEP;
+		if (position >= PULSE_MAX)
+		{
+			position = PULSE_MAX;
+			phase = PHASE_DOWN;
+		}
+		break;
+
+		case PHASE_DOWN:			// Move servo from maximum to minimum position
+		OCR1A = position;
+		position -= STEP;
+		if (position <= PULSE_MIN)
+		{
+			position = 0;
+			phase = PHASE_HOLD;
+		}
+		break;
+
+		default:				// Move servo to different positions with delay in between
+		OCR1A = hold_positions[position];
+		if (++position >= sizeof(hold_positions) / sizeof(hold_positions[0]))
+		{
+			position = PULSE_MIN;
+			phase = PHASE_UP;
+		}
+		break;
+	}
+
+	// Read ADC value and map to 1ms to 100ms
+	delay = fix_mul_q16(adc_seq_latest(POT_CHANNEL), FIX_Q16(100.0 / 4095)) + BASE_UPDATE_DELAY_MS;
+	sched_wake_in(sweep_id, delay);
+}
+
+// Toggles isRunning on each press, and parks the servo on a long press
+static void button_task(void)
 {
-	ADMUX |= (1 << REFS0);					// Reference voltage is AVCC
-	ADCSRA |= (1 << ADPS2) | (1 << ADPS1) | (1 << ADPS0);	// ADC clock prescaler /128
-	ADCSRA |= (1 << ADEN);					// Enable ADC
+	if (debounce_long(1 << BUTTON))
+	{
+		isRunning = 0;				// sweep_task goes back to sleep
+		phase = PHASE_UP;
+		position = PULSE_MIN;
+		OCR1A = PULSE_MID;
+	}
+	else if (debounce_pressed(1 << BUTTON))
+	{
+		isRunning ^= 1;				// Toggle isRunning
+		if (isRunning)
+		sched_wake(sweep_id);			// Carry on where the sweep stopped
+	}
 }
 
-// Function to read ADC value
-uint16_t ADC_read(uint8_t channel)
+// Sends the pot reading with the ADC rate and noise floor, e.g. "Pot: 2048/4095, 601 samples/s, noise 3 LSB"
+static void report_task(void)
 {
-	ADMUX = (ADMUX & 0xF8) | (channel & 0x07);		// Select ADC channel
-	ADCSRA |= (1 << ADSC);					// Start conversion
-	while (ADCSRA & (1 << ADSC));				// Wait for conversion to complete
-	return ADC;						// Return ADC value
+	char buffer[11];
+
+	uart_puts("Pot: ");
+	uart_puts(utoa(adc_seq_latest(POT_CHANNEL), buffer, 10));
+	uart_puts("/4095, ");
+	uart_puts(ultoa(adc_seq_rate(POT_CHANNEL), buffer, 10));
+	uart_puts(" samples/s, noise ");
+	uart_puts(utoa(adc_seq_noise(POT_CHANNEL), buffer, 10));
+	uart_puts(" LSB\n");
 }
 
 int main(void)
 {
-	// Initialize ADC
-	ADC_init();
+	uart_init();
+	// Initialize ADC. The pot is sampled in the background by the ADC interrupt.
+	adc_seq_init(ADC_SEQ_PRESCALE_128);			// ADC clock prescaler /128
+	adc_seq_enable(POT_CHANNEL, 1);				// Sample the pot on every pass
+	adc_seq_oversample(POT_CHANNEL, 2);			// 16x oversampling, 12-bit result (0 - 4095) with less noise
+	adc_seq_start();
 
 	ICR1 = TOP_VALUE;		// Set TOP value for timer/counter 1
 
 	TCCR1A |= (1 << WGM11);					// Fast PWM, TOP = ICR1
 	TCCR1A |= (1 << COM1A1);				// Set OC1A (PB1) as output compare pin
-	TCCR1B |= (1 << WGM12) | (1 << WGM13) | (1 << CS11);	// Prescaler of 8
+	TCCR1B |= (1 << WGM12) | (1 << WGM13) | TIMER_CS(1, FRAME);	// Prescaler of 8 at 16MHz
 
 	DDRB |= (1 << PB1);					// Configure OC1A (PB1) as output
 
-	// Configure button pin as input with pull-up
-	DDRD &= ~(1 << BUTTON_PIN);				// Configure button pin as input
-	PORTD |= (1 << BUTTON_PIN);				// Enable pull-up resistor		
+	debounce_init(1 << BUTTON);				// Button pin as input with pull-up, sampled on Timer0
 
 	OCR1A = PULSE_MIN;					// Set initial pulse width to minimum
 
+	sched_init();
+	sweep_id = sched_add(sweep_task, SCHED_ASLEEP, 0);	// Woken by button_task
+	sched_add(button_task, 0, BUTTON_POLL_MS);
+	sched_add(report_task, REPORT_MS, REPORT_MS);
+	sei();
+
 	while (1)
 	{
-		// If button is pressed, toggle isRunning
-		if (!(PIND & (1 << BUTTON_PIN)))
-		{
-			_delay_ms(50);				// Debounce delay
-			while (!(PIND & (1 << BUTTON_PIN)));	// Wait for button release
-			isRunning ^= 1;				// Toggle isRunning
-		}
-
-		// If isRunning is set, move the servo
-		if (isRunning)
-		{
-			// Read ADC value and map to 1ms to 100ms
-			uint16_t delay = ADC_read(POT_CHANNEL) / 1023.0 * 100 + BASE_UPDATE_DELAY_MS;	
-
-			// Move servo from minimum to maximum position
-			for (uint16_t i = PULSE_MIN; i < PULSE_MAX; i += STEP)
-			{
-				OCR1A = i;				// Set pulse width
-				for (uint16_t j = 0; j < delay; ++j)	// Delay
-				{
-					_delay_us(1000);		// 1 ms
-				}
-			}
-
-			// Move servo from maximum to minimum position
-			for (uint16_t i = PULSE_MAX; i > PULSE_MIN; i -= STEP)	// Decrement pulse width
-			{
-				OCR1A = i;					// Set pulse width	
-				for (uint16_t j = 0; j < delay; ++j)		// Delay
-				{
-					_delay_us(1000);			// 1 ms
-				}
-			}
-
-			// Move servo to different positions with delay in between
-			OCR1A = PULSE_MIN;				// Set pulse width to minimum
-			for (uint16_t j = 0; j < delay; ++j)		// Delay
-			{
-				_delay_us(1000);			// 1 ms	
-			}
-			OCR1A = PULSE_MID;				// Set pulse width to mid	
-			for (uint16_t j = 0; j < delay; ++j)		// Delay
-			{
-				_delay_us(1000);			// 1 ms
-			}
-			OCR1A = PULSE_MAX;				// Set pulse width to maximum
-			for (uint16_t j = 0; j < delay; ++j)		// Delay
-			{
-				_delay_us(1000);			// 1 ms
-			}
-			OCR1A = PULSE_MID;				// Set pulse width to mid
-			for (uint16_t j = 0; j < delay; ++j)		// Delay
-			{
-				_delay_us(1000);			// 1 ms
-			}
-			{
-				_delay_us(1000); 			// 1 ms
-			}
-		}
+		sched_run();
+		sched_sleep();				// Idle until an interrupt, Timer2 wakes the CPU for the next deadline
 	}
 }
@@ -3,6 +3,12 @@
 #include <avr/interrupt.h>  // Allows for use of interrupts
 #define F_CPU 16000000UL	// Set the CPU clock speed to 16MHz
 #include <util/delay.h>     // Allows for use of _delay_ms() function
+#include "timer_calc.h"     // Timer settings worked out from F_CPU at compile time
+
+#define BLINK_MS 1000       // Time between blink changes
+#if !TIMER_OK(1, TIMER_MS(BLINK_MS), 0)
+#error "Timer1 cannot make BLINK_MS exactly at this F_CPU"
+#endif
 
 // Define PWM values for fading LED
 #define HALF_PWM 127        // 50% of max brightness
@@ -26,9 +32,9 @@ void timer0_init()
 void timer1_init()
 {
     TCCR1A = 0;                                         // Set Timer1 to Normal Mode
-    TCCR1B = (1 << WGM12) | (1 << CS12) | (1 << CS10);  // Set Timer1 to CTC Mode and pre-scaling of 1024
+    TCCR1B = (1 << WGM12) | TIMER_CS(1, TIMER_MS(BLINK_MS));  // Set Timer1 to CTC Mode and the pre-scaling for BLINK_MS
     TIMSK1 = (1 << OCIE1A);                             // Enable interrupt when Timer1 matches OCR1A
-    OCR1A = 15624;                                      // Set output compare register to generate a 1s delay
+    OCR1A = TIMER_TOP(1, TIMER_MS(BLINK_MS));           // Set output compare register to generate a BLINK_MS delay
     sei();                                              // Enable global interrupts
 }
 
@@ -12,82 +12,74 @@
 #include <avr/io.h>				// this is always included in AVR programs
 #include "util/delay.h"
 
+#include <avr/interrupt.h>
 #include "USART.h" // This file requires the USART.c and USART.h files to run
+#include "adc_seq.h" // Background ADC sampling, needs adc_seq.c
+#include "eelog.h" // EEPROM sample log, needs eelog.c
+#include "hc595.h" // LED chain on the SPI pins, needs hc595.c
+
+#define LIGHT_CHANNEL 0 // PC0/ADC0
+
+/*
+Every LOG_EVERY passes of the main loop the light level is added to the EEPROM log as channel LOG_LIGHT. One pass prints 8 binary digits
+and a newline at 9600 baud, about 10 ms, so that is one sample every 2.5 s or so. Sending 'd' dumps the log in the format that
+tools/eelog_decode.py reads.
+*/
+#define LOG_EVERY 250
+#define LOG_LIGHT 1 // eelog channel of the light level
+
+/*
+The level is shown on the HC595_BYTES * 8 LEDs of a 74HC595 chain on PB2/PB3/PB5 (see hc595.h) instead of PORTD and PORTB, so the
+UART, the buttons and the LCD pins are left alone. Chip 0 shows the level in binary, the same 8 bits that used to go to PORTD, and the
+other chips a bar graph of it.
+*/
+#define BAR_LEDS ((HC595_BYTES - 1) * 8)
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 int main(void) {
 	
-	DDRD = 0xFF;				// set Port D pins for output
-	DDRB = 0b00000011; // Set the first two of pins of port D as output. This is because pins 0 and 1 have pull up resistors and not generally used as outputs.
+	hc595_init();				// LED chain, all off
 	
 	initUSART();
 	printString("USART Initiated\r\n");  
-    /*
-	ADMUX - ADC Multiplexer Selection Register
-	
-	bit          7           6          5         4        3         2          1          0
-	name       REFS1       REFS0      ADLAR       -       MUX3      MUX2       MUX1       MUX0
-	set to       0           1          1         0        0         1          0          1
-	
-	REFS1 = 0    use AVCC for reference voltage
-	REFS0 = 1
-	
-	ADLAR = 1    left justify ADC result in ADCH/ADCL
-	
-	bit 4 = 0
-	
-	MUX3 = 0     use PC0/ADC0 
-	MUX2 = 0
-	MUX1 = 0
-	MUX0 = 0
-	*/
-	ADMUX = 0b01100000;
-	
-	/*
-	ADCSRA - ADC Control and Status Register A
-	
-	bit          7           6            5          4          3            2           1           0
-	name        ADEN        ADSC        ADATE       ADIF       ADIE        ADPS2       ADPS1       ADPS0
-	set to       1           0            1          0          0            0           1           1
-	
-	ADEN = 1     enable ADC
-	ADSC = 0     don't start ADC yet
-	ADATE = 1    enable ADC auto trigger (i.e. use free running mode)
-	ADIF = 0     don't set ADC interrupt flag
-	ADIE = 0     don't set ADC interrupt enable
-	
-	ADPS2 = 1
-	ADPS1 = 0    0 MHz clock / 16 = 1Mhz ADC clock
-	ADPS0 = 0
-	*/
-	ADCSRA = 0b10100100;
-	
 	/*
-	ADCSRB - ADC Control and Status Register B
-	
-	bit         7           6           5           4           3         2           1           0
-	name        -          ACME         -           -           -       ADTS2       ADTS1       ADTS0
-	set to      0           0           0           0           0         0           0           0
-	
-	bit 7 = 0
-	ACME = 0     don't enable analog comparator multiplexer
-	bit 5 = 0
-	bit 4 = 0
-	bit 3 = 0
-	ADTS2 = 0
-	ADTS1 = 0    free running mode
-	ADTS0 = 0
+	The ADC is run by adc_seq.c: REFS0 = 1 uses AVCC as the reference, and the light sensor on PC0/ADC0 is converted over and over
+	from the ADC interrupt. The main loop reads the newest sample instead of polling ADCH.
+
+	ADC clock = 1 MHz / 16 = 62.5 kHz
 	*/
-	ADCSRB = 0b00000000;
+	adc_seq_init(ADC_SEQ_PRESCALE_16);
+	adc_seq_enable(LIGHT_CHANNEL, 1);
+	adc_seq_start();
+	eelog_init();				// Carries on after the newest block in the EEPROM
+	sei();
 	
-	ADCSRA |= (1 << ADSC);		// start ADC
+	uint8_t logCount = 0;
+	char line[EELOG_LINE_SIZE];
 	
 	while (1) {									// begin infinite loop
-		PORTD = ADCH;							// assign contents of ADC high register to Port D pins
-		PORTB = ADCH;
-		printBinaryByte(ADCH); // Will print the binary number
+		uint8_t level = adc_seq_latest(LIGHT_CHANNEL) >> 2;	// top 8 bits of the 10-bit sample, same as ADCH with ADLAR
+		uint8_t *leds = hc595_frame();			// assign the light level to the LEDs
+		leds[0] = level;
+		for (uint8_t i = 0; i < BAR_LEDS; i++)
+		hc595_set(8 + i, i < (uint16_t)level * BAR_LEDS / 255);
+		hc595_show();							// latched by the SPI interrupt a few bytes later
+		printBinaryByte(level); // Will print the binary number
 		//or
-		//printWord(ADCH); // Will print the Decimal number
+		//printWord(level); // Will print the Decimal number
+		
+		if (++logCount >= LOG_EVERY) {			// Log the level now and then, written in the background by the EE_READY interrupt
+			logCount = 0;
+			eelog_add(LOG_LIGHT, level);
+		}
+		if ((UCSR0A & (1 << RXC0)) && receiveByte() == 'd') {	// Dump command
+			eelog_flush();
+			while (eelog_busy()) {}
+			for (uint8_t block = 0; block < EELOG_BLOCKS; block++) {
+				eelog_dump_line(block, line);
+				printString(line);
+			}
+		}
 
 	}
 	return(0);					// should never get here, this is to prevent a compiler warning
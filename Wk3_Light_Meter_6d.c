@@ -11,51 +11,47 @@
 #endif
 
 #include <avr/io.h>				// allows use of I/O pins
-#include <util/delay.h>				// allows use of _delay_ms() function
+#include <avr/interrupt.h>			// allows use of sei()
+#include "fixmath.h"				// integer map with 32-bit intermediates
+#include "bcm.h"				// Binary Code Modulation LED dimming on Timer1
 
-volatile uint8_t pwm_value = 0;			// variable to store the PWM value
-volatile uint8_t pwm_counter = 0;		// variable to count the PWM value
+// the LEDs on PD2 - PD7, PB0 and PB1, dimmed in the background by bcm.c
+static const uint8_t led_pins[] = {
+	BCM_PD(2), BCM_PD(3), BCM_PD(4), BCM_PD(5), BCM_PD(6), BCM_PD(7), BCM_PB(0), BCM_PB(1)
+};
+
+uint8_t pwm_value = 0;				// variable to store the PWM value
 
 // Function to map range of input values to output values, basically takes the input values from the pot or photoresistor and
-// correlates them to PWM values for output ot the LEDs
+// correlates them to PWM values for output ot the LEDs. The math is done in 32 bits because (x - in_min) * (out_max - out_min)
+// overflows a 16-bit int with inverted ranges, and inputs outside the range are clamped so the result always fits in 8 bits.
 uint8_t map_value(uint8_t x, uint8_t in_min, uint8_t in_max, uint8_t out_min, uint8_t out_max) {
-	return (x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min;
+	return (uint8_t)fix_map_clamp(x, in_min, in_max, out_min, out_max);
 }
 
 int main(void) {
+	uint8_t last = 0;
 
-	DDRD = 0b11111100;		// sets PD2 - PD7 to ouput
-	DDRB = 0b00000011;		// sets PB0 and PB1 to output
+	bcm_init(led_pins, sizeof(led_pins));	// sets the LED pins to output and starts the refresh
 
-	ADMUX = 0b01100000;		// sets the ADC input to PD6
+	ADMUX = 0b01100000;		// sets the ADC input to ADC0, left adjusted so ADCH holds the top 8 bits
 
-	ADCSRA = 0b10100100;		// enables the ADC and sets the prescaler to 16
+	ADCSRA = 0b10100100;		// enables the ADC and auto triggering, and sets the prescaler to 16
 
 	ADCSRB = 0b00000000;		// sets the ADC to free running mode
 
-	// sets the PWM mode to fast PWM and sets the prescaler to 8
-	TCCR0A = TCCR2A = (1 << WGM20) | (1 << WGM21) | (1 << COM2A1) | (1 << COM2B1);	//
-	TCCR0B = TCCR2B = (1 << CS21);	
-
 	ADCSRA |= (1 << ADSC);	// starts the ADC
+	sei();			// the LED refresh runs from the Timer1 interrupt
 
 	while (1) {
 		// mapping the ADC value to the range of 0-255; these are nominal values that I made up (I have an O-scope but no idea how to use it yet)
 		pwm_value = map_value(ADCH, 200, 20, 255, 0);	// map the ADC value to the PWM value
 
-		OCR0A = OCR2A = pwm_value;	// set the PWM value
-
-		if (pwm_counter < pwm_value) {
-			PORTD |= (1 << PD2) | (1 << PD3) | (1 << PD4) | (1 << PD5) | (1 << PD6) | (1 << PD7);		// sets PD2 - PD7 high
-			PORTB |= (1 << PB0) | (1 << PB1);								// sets PB0 & PB1 high
+		if (pwm_value != last) {	// only rebuild the bit planes when the brightness changes
+			bcm_set_all(pwm_value);
+			bcm_update();
+			last = pwm_value;
 		}
-		else {
-			PORTD &= ~((1 << PD2) | (1 << PD3) | (1 << PD4) | (1 << PD5) | (1 << PD6) | (1 << PD7));	// sets PD2 - PD7 low
-			PORTB &= ~(1 << PB0) | (1 << PB1);								// sets PB0 & PB1 low
-		}
-
-		pwm_counter++;			// increment the counter
-		_delay_us(10);			// delay for 10 microseconds
 	}
 	return(0);				// should never get here, this is to prevent a compiler warning
 }
@@ -0,0 +1,219 @@
+/*
+The `adc_seq.c` file contains the definitions of the functions declared in the `adc_seq.h` file.
+
+1. **Conversions**: The ADC runs in single conversion mode with its interrupt enabled. `ADC_vect` stores the result, switches the mux to
+the next channel that is due and starts the next conversion straight away. Single conversions are used instead of free running mode
+because in free running mode a mux change only applies to the conversion after the one already under way.
+
+2. **Passes**: `due` holds the channels still to be converted in the current pass. When it runs empty, every enabled channel counts its
+divider down and the channels that reach zero make up the next pass.
+
+3. **Oversampling**: `sum` and `count` collect the conversions of a channel until there are enough for one result. The sum of 64
+10-bit conversions is at most 65472, so 16 bits are enough for up to 3 extra bits.
+
+4. **Buffers**: `head` is only written by the ISR and `tail` only by the reader, and both are single bytes, so reading and writing them
+is atomic.
+*/
+
+#ifndef F_CPU
+#define F_CPU 16000000UL
+#endif
+
+#include "adc_seq.h"
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <util/atomic.h>
+
+#define ADC_SEQ_MASK (ADC_SEQ_BUFFER_SIZE - 1)
+
+static volatile uint8_t enabled = 0; // Bit n set when ADCn is sampled
+static uint8_t divider[ADC_SEQ_CHANNELS];
+static uint8_t countdown[ADC_SEQ_CHANNELS];
+static uint8_t due = 0; // Channels left in this pass, only used by the ISR
+static uint8_t current = 0; // Channel being converted, only used by the ISR
+
+static volatile uint16_t buffer[ADC_SEQ_CHANNELS][ADC_SEQ_BUFFER_SIZE];
+static volatile uint8_t head[ADC_SEQ_CHANNELS]; // Next free slot, written by the ISR
+static volatile uint8_t tail[ADC_SEQ_CHANNELS]; // Next sample to read, written by the reader
+static volatile uint16_t latest[ADC_SEQ_CHANNELS];
+static volatile uint16_t overruns[ADC_SEQ_CHANNELS];
+
+static uint8_t prescale_bits = ADC_SEQ_PRESCALE_128;
+static uint8_t os_bits[ADC_SEQ_CHANNELS]; // Extra bits of resolution
+static uint16_t sum[ADC_SEQ_CHANNELS]; // Conversions added up so far
+static uint8_t count[ADC_SEQ_CHANNELS]; // Number of conversions in `sum`
+static uint16_t noise_min[ADC_SEQ_CHANNELS], noise_max[ADC_SEQ_CHANNELS];
+static uint8_t noise_count[ADC_SEQ_CHANNELS];
+static volatile uint16_t noise[ADC_SEQ_CHANNELS]; // Peak-to-peak of the last full window
+
+void adc_seq_init(uint8_t prescale) {
+	ADMUX = (1 << REFS0); // Reference voltage is AVCC, right adjusted 10-bit result
+	ADCSRB = 0; // No auto trigger source
+	ADCSRA = (1 << ADEN) | (prescale & 0x07); // Enable ADC, interrupt is enabled by adc_seq_start
+	prescale_bits = prescale & 0x07;
+}
+
+void adc_seq_enable(uint8_t channel, uint8_t divider_value) {
+	if (channel >= ADC_SEQ_CHANNELS || divider_value == 0)
+	return;
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		divider[channel] = divider_value;
+		countdown[channel] = 1; // Sample it in the next pass
+		enabled |= (1 << channel);
+	}
+	DIDR0 |= (1 << channel); // Digital input buffer off, saves power on an analog pin
+}
+
+void adc_seq_disable(uint8_t channel) {
+	if (channel >= ADC_SEQ_CHANNELS)
+	return;
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		enabled &= ~(1 << channel);
+		due &= ~(1 << channel);
+	}
+}
+
+void adc_seq_oversample(uint8_t channel, uint8_t bits) {
+	if (channel >= ADC_SEQ_CHANNELS || bits > ADC_SEQ_MAX_OVERSAMPLE)
+	return;
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		os_bits[channel] = bits;
+		sum[channel] = 0;
+		count[channel] = 0;
+		noise_count[channel] = 0;
+	}
+}
+
+// Picks the next channel to convert and starts a new pass when needed. `enabled` must not be 0.
+static uint8_t adc_seq_next(void) {
+	uint8_t ch, bit;
+
+	while (!due) {
+		for (ch = 0, bit = 1; ch < ADC_SEQ_CHANNELS; ch++, bit <<= 1) {
+			if ((enabled & bit) && --countdown[ch] == 0) {
+				countdown[ch] = divider[ch];
+				due |= bit;
+			}
+		}
+	}
+	for (ch = 0, bit = 1; !(due & bit); ch++, bit <<= 1) {}
+	due &= ~bit;
+	return ch;
+}
+
+static void adc_seq_convert(uint8_t channel) {
+	current = channel;
+	ADMUX = (ADMUX & 0xF0) | channel; // Select ADC channel
+	ADCSRA |= (1 << ADSC); // Start conversion
+}
+
+void adc_seq_start(void) {
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		if (enabled && !(ADCSRA & (1 << ADIE))) {
+			while (ADCSRA & (1 << ADSC)) {} // Let a conversion from before the stop finish
+			ADCSRA |= (1 << ADIF); // Clear a stale completion flag
+			ADCSRA |= (1 << ADIE);
+			adc_seq_convert(adc_seq_next());
+		}
+	}
+}
+
+void adc_seq_stop(void) {
+	ADCSRA &= ~(1 << ADIE); // The conversion under way finishes, but nothing new is started
+}
+
+uint16_t adc_seq_latest(uint8_t channel) {
+	uint16_t value;
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		value = latest[channel];
+	}
+	return value;
+}
+
+uint8_t adc_seq_available(uint8_t channel) {
+	return (head[channel] - tail[channel]) & ADC_SEQ_MASK;
+}
+
+uint8_t adc_seq_read(uint8_t channel, uint16_t *samples, uint8_t max) {
+	uint8_t n = 0;
+	uint8_t t = tail[channel];
+
+	while (n < max && t != head[channel]) {
+		samples[n++] = buffer[channel][t]; // The ISR never writes this slot until tail moves past it
+		t = (t + 1) & ADC_SEQ_MASK;
+	}
+	tail[channel] = t;
+	return n;
+}
+
+uint16_t adc_seq_overruns(uint8_t channel) {
+	uint16_t count;
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		count = overruns[channel];
+	}
+	return count;
+}
+
+// Results per second of `channel`, from the conversion rate and the channel's share of the passes
+uint32_t adc_seq_rate(uint8_t channel) {
+	uint32_t conversions = F_CPU / (1UL << prescale_bits) / 13; // A conversion takes 13 ADC clocks
+	uint32_t weight_sum = 0;
+	uint8_t ch, mask = enabled;
+
+	if (channel >= ADC_SEQ_CHANNELS || !(mask & (1 << channel)))
+	return 0;
+	for (ch = 0; ch < ADC_SEQ_CHANNELS; ch++) {
+		if (mask & (1 << ch))
+		weight_sum += 0x0FFFU / divider[ch]; // Conversions per pass, scaled by 4095
+	}
+	return conversions * (0x0FFFU / divider[channel]) / weight_sum >> (2 * os_bits[channel]);
+}
+
+uint16_t adc_seq_noise(uint8_t channel) {
+	uint16_t value;
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		value = noise[channel];
+	}
+	return value;
+}
+
+ISR(ADC_vect) {
+	uint16_t value = ADC;
+	uint8_t ch = current;
+	uint8_t next = (head[ch] + 1) & ADC_SEQ_MASK;
+	uint8_t bits = os_bits[ch];
+
+	if (enabled)
+	adc_seq_convert(adc_seq_next()); // Start the next conversion before doing the bookkeeping
+	else
+	ADCSRA &= ~(1 << ADIE); // Every channel was disabled, stop like adc_seq_stop
+
+	if (bits) {
+		sum[ch] += value;
+		if (++count[ch] < ADC_SEQ_OVERSAMPLE_COUNT(bits))
+		return; // Not enough conversions for a result yet
+		value = adc_seq_decimate(sum[ch], bits);
+		sum[ch] = 0;
+		count[ch] = 0;
+	}
+
+	if (noise_count[ch] == 0 || value < noise_min[ch])
+	noise_min[ch] = value;
+	if (noise_count[ch] == 0 || value > noise_max[ch])
+	noise_max[ch] = value;
+	if (++noise_count[ch] >= ADC_SEQ_NOISE_WINDOW) {
+		noise[ch] = noise_max[ch] - noise_min[ch];
+		noise_count[ch] = 0;
+	}
+
+	latest[ch] = value;
+	if (next == tail[ch]) {
+		overruns[ch]++;
+	} else {
+		buffer[ch][head[ch]] = value;
+		head[ch] = next;
+	}
+}
@@ -0,0 +1,74 @@
+/*
+The `adc_seq.h` file declares an interrupt-driven ADC sequencer that reads several analog channels in the background.
+
+1. **Round Robin**: Each enabled channel has a divider. The sequencer makes passes over the enabled channels, and a channel with divider
+`n` is converted on every n-th pass, so a fast signal (the piezo) can be sampled more often than a slow one (the light sensor). Each
+conversion is started from `ADC_vect` as soon as the previous one completes, so the main loop never waits for the ADC.
+
+2. **Buffers**: Every channel has its own ring buffer of `ADC_SEQ_BUFFER_SIZE` samples. The ISR only writes the head index and the reader
+only writes the tail index, so no locking is needed. `adc_seq_latest()` returns the newest sample, and `adc_seq_read()` takes a batch of
+samples in order. If the reader falls behind, the oldest samples are kept and new ones are counted in `adc_seq_overruns()`.
+
+3. **Oversampling**: `adc_seq_oversample(channel, bits)` adds 1 to 3 bits of resolution. The ISR adds up 4^bits conversions and shifts
+the sum right by `bits`, giving an 11, 12 or 13-bit result, at a quarter, a sixteenth or a sixty-fourth of the rate. This only works if the
+signal has about 1 LSB of noise on it, which a real sensor normally does. The accumulation happens in the ISR, so it costs the main loop
+nothing. `adc_seq_rate()` gives the resulting samples per second of a channel and `adc_seq_noise()` the peak-to-peak spread of the last
+`ADC_SEQ_NOISE_WINDOW` results, in LSBs of the channel's own resolution.
+
+4. **Channels**: The channel numbers are the ADC mux inputs. See `pindefines.h`: LIGHT_SENSOR is ADC0, CAP_SENSOR ADC1, PIEZO ADC2 and
+POT ADC3.
+*/
+
+#ifndef ADC_SEQ_H_
+#define ADC_SEQ_H_
+
+#include <stdint.h>
+
+#ifndef ADC_SEQ_CHANNELS
+#define ADC_SEQ_CHANNELS 4 // Channels ADC0 to ADC(n-1) can be used, at most 8
+#endif
+
+#ifndef ADC_SEQ_BUFFER_SIZE
+#define ADC_SEQ_BUFFER_SIZE 8 // Samples per channel, a power of two no larger than 128
+#endif
+
+#if (ADC_SEQ_BUFFER_SIZE & (ADC_SEQ_BUFFER_SIZE - 1)) || ADC_SEQ_BUFFER_SIZE > 128
+#error "ADC_SEQ_BUFFER_SIZE must be a power of two no larger than 128"
+#endif
+#if ADC_SEQ_CHANNELS > 8
+#error "ADC_SEQ_CHANNELS can be at most 8"
+#endif
+
+#ifndef ADC_SEQ_NOISE_WINDOW
+#define ADC_SEQ_NOISE_WINDOW 32 // Results per noise measurement
+#endif
+
+#define ADC_SEQ_MAX_OVERSAMPLE 3 // 13-bit; 4^3 10-bit samples still fit in 16 bits
+
+// Conversions added up for `bits` extra bits of resolution
+#define ADC_SEQ_OVERSAMPLE_COUNT(bits) (1U << (2 * (bits)))
+
+// Turns the sum of ADC_SEQ_OVERSAMPLE_COUNT(bits) conversions into one (10 + bits)-bit result
+static inline uint16_t adc_seq_decimate(uint16_t sum, uint8_t bits) {
+	return sum >> bits;
+}
+
+#define ADC_SEQ_PRESCALE_16 0b100 // 1 MHz ADC clock at 16 MHz, less accurate
+#define ADC_SEQ_PRESCALE_64 0b110
+#define ADC_SEQ_PRESCALE_128 0b111 // 125 kHz ADC clock at 16 MHz, full 10-bit accuracy
+
+void adc_seq_init(uint8_t prescale);
+void adc_seq_enable(uint8_t channel, uint8_t divider);
+void adc_seq_disable(uint8_t channel);
+void adc_seq_oversample(uint8_t channel, uint8_t bits);
+void adc_seq_start(void);
+void adc_seq_stop(void);
+
+uint16_t adc_seq_latest(uint8_t channel);
+uint8_t adc_seq_available(uint8_t channel);
+uint8_t adc_seq_read(uint8_t channel, uint16_t *samples, uint8_t max);
+uint16_t adc_seq_overruns(uint8_t channel);
+uint32_t adc_seq_rate(uint8_t channel);
+uint16_t adc_seq_noise(uint8_t channel);
+
+#endif /* ADC_SEQ_H_ */
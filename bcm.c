@@ -0,0 +1,110 @@
+/*
+The `bcm.c` file contains the definitions of the functions declared in the `bcm.h` file.
+
+1. **Masks**: `masks[buffer][plane]` holds the levels for ports B, C and D during one bit plane, and `own` the pins that belong to the
+driver on each port. The ISR shows one plane per interrupt, starting with plane 0.
+
+2. **Slot Length**: Timer1 runs in CTC mode with TOP = `OCR1A`, and the ISR sets `OCR1A` for the slot it has just started. Each slot is
+twice as long as the one before, so the whole refresh is 255 base slots.
+*/
+
+#include "bcm.h"
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+#define PORT_INDEX(pin) ((pin) >> 4) // 0 = B, 1 = C, 2 = D
+
+static uint8_t pin_list[BCM_MAX_CHANNELS];
+static uint8_t channels = 0;
+static uint8_t level[BCM_MAX_CHANNELS];
+static uint8_t own[3];
+
+static uint8_t masks[2][8][3];
+static volatile uint8_t cur = 0; // Buffer shown by the ISR
+static volatile uint8_t pending = 0; // The other buffer is ready
+static uint8_t plane = 0;
+
+void bcm_init(const uint8_t *pins, uint8_t count) {
+	uint8_t i;
+
+	if (count > BCM_MAX_CHANNELS)
+	count = BCM_MAX_CHANNELS;
+	channels = count;
+	own[0] = own[1] = own[2] = 0;
+	for (i = 0; i < count; i++) {
+		pin_list[i] = pins[i];
+		level[i] = 0;
+		own[PORT_INDEX(pins[i])] |= (1 << (pins[i] & 7));
+	}
+
+	PORTB &= ~own[0];
+	PORTC &= ~own[1];
+	PORTD &= ~own[2];
+	DDRB |= own[0];
+	DDRC |= own[1];
+	DDRD |= own[2];
+
+	bcm_update();
+	plane = 0;
+	TCCR1A = 0; // CTC mode, TOP = OCR1A
+	TCCR1B = (1 << WGM12) | (1 << CS11); // Prescaler of 8
+	TCNT1 = 0;
+	OCR1A = BCM_BASE_TICKS - 1;
+	TIFR1 = (1 << OCF1A);
+	TIMSK1 = (1 << OCIE1A);
+}
+
+void bcm_set(uint8_t channel, uint8_t brightness) {
+	if (channel < channels)
+	level[channel] = brightness;
+}
+
+void bcm_set_all(uint8_t brightness) {
+	uint8_t i;
+
+	for (i = 0; i < channels; i++)
+	level[i] = brightness;
+}
+
+// Builds the port masks for the current brightness values. They are shown from the start of the next refresh.
+void bcm_update(void) {
+	uint8_t (*next)[3];
+	uint8_t i, k, port, bit;
+
+	pending = 0; // Keeps the ISR off the spare buffer while it is being written
+	next = masks[cur ^ 1];
+	for (k = 0; k < 8; k++)
+	next[k][0] = next[k][1] = next[k][2] = 0;
+
+	for (i = 0; i < channels; i++) {
+		port = PORT_INDEX(pin_list[i]);
+		bit = 1 << (pin_list[i] & 7);
+		for (k = 0; k < 8; k++) {
+			if (level[i] & (1 << k))
+			next[k][port] |= bit;
+		}
+	}
+	pending = 1;
+}
+
+void bcm_stop(void) {
+	TIMSK1 &= ~(1 << OCIE1A);
+	PORTB &= ~own[0];
+	PORTC &= ~own[1];
+	PORTD &= ~own[2];
+}
+
+ISR(TIMER1_COMPA_vect) {
+	const uint8_t *m;
+
+	if (plane == 0 && pending) {
+		cur ^= 1;
+		pending = 0;
+	}
+	m = masks[cur][plane];
+	PORTB = (PORTB & ~own[0]) | m[0];
+	PORTC = (PORTC & ~own[1]) | m[1];
+	PORTD = (PORTD & ~own[2]) | m[2];
+	OCR1A = ((uint16_t)BCM_BASE_TICKS << plane) - 1; // This slot lasts 2^plane base slots
+	plane = (plane + 1) & 7;
+}
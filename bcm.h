@@ -0,0 +1,45 @@
+/*
+The `bcm.h` file declares a Binary Code Modulation (BCM) driver that dims up to 16 LEDs on ordinary GPIO pins.
+
+1. **Bit Planes**: An 8-bit brightness is made of 8 bits with weights 1, 2, 4 ... 128. BCM splits every refresh into 8 time slots with the
+same weights, and during slot k an LED is on if bit k of its brightness is set. Over a whole refresh the LED is on for exactly `brightness`
+out of 255 time units, the same as PWM, but it takes only 8 timer interrupts per refresh instead of one for every step of every channel.
+
+2. **Port Masks**: `bcm_update()` turns the brightness values into one mask per bit plane for each of ports B, C and D. The
+`TIMER1_COMPA_vect` ISR just writes those masks to the ports and sets the length of the next slot, so its run time does not depend on the
+number of channels.
+
+3. **Timing**: Timer1 counts at F_CPU / 8 (0.5 us). The shortest slot is `BCM_BASE_TICKS` long and the whole refresh 255 times that, so the
+default of 16 ticks gives a 2.04 ms refresh, about 490 Hz, with the ISR taking under 2% of the CPU. `BCM_BASE_TICKS` must stay longer than
+the ISR itself.
+
+4. **Updates**: `bcm_set()` only changes a brightness value. `bcm_update()` builds the masks in a spare buffer, and the ISR switches to it at
+the start of the next refresh, so a change never shows up half-way through one.
+
+The ISR does a read-modify-write on every port that has a BCM pin, so the main program should not change other pins on those ports with
+multi-bit writes while it is running (single-bit `|=` and `&=` on a constant are atomic `sbi`/`cbi` instructions and are fine).
+*/
+
+#ifndef BCM_H_
+#define BCM_H_
+
+#include <stdint.h>
+
+#ifndef BCM_BASE_TICKS
+#define BCM_BASE_TICKS 16 // Shortest slot, 8 us
+#endif
+
+#define BCM_MAX_CHANNELS 16
+
+// A pin is given as port and bit, e.g. BCM_PD(2) for PD2
+#define BCM_PB(bit) (0x00 | (bit))
+#define BCM_PC(bit) (0x10 | (bit))
+#define BCM_PD(bit) (0x20 | (bit))
+
+void bcm_init(const uint8_t *pins, uint8_t count);
+void bcm_set(uint8_t channel, uint8_t brightness);
+void bcm_set_all(uint8_t brightness);
+void bcm_update(void);
+void bcm_stop(void);
+
+#endif /* BCM_H_ */
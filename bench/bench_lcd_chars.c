@@ -0,0 +1,34 @@
+/*
+The `bench_lcd_chars.c` file is a benchmark image that writes both rows of the LCD over and over, so `tools/bench.sh` can work out how
+many characters per second each LCD transport gets through. It is built twice: `bench_lcd_parallel` drives the six PORTD pins and
+`bench_lcd_i2c` the PCF8574 backpack (`LCD_I2C`), which the runner answers with `--i2c-ack`.
+
+- `bench_pass()` writes 32 characters and 2 cursor moves, then waits until the LCD has them all, and is kept out of line so the runner
+can find it by name.
+- The characters go through the queued `*_async` functions, the way the final project drives the LCD.
+*/
+
+#ifndef F_CPU
+#define F_CPU 16000000UL
+#endif
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include "../RBT211 Final Project/LCD_3.h"
+
+__attribute__((noinline)) void bench_pass(void) {
+	lcd_gotoxy_async(0, 1);
+	lcd_puts_async("RBT211 benchmark");
+	lcd_gotoxy_async(0, 2);
+	lcd_puts_async("0123456789ABCDEF");
+	while (!lcd_idle()) {}
+}
+
+int main(void) {
+	lcd_init();
+	lcd_async_init();
+	sei();
+
+	while (1)
+	bench_pass();
+}
@@ -0,0 +1,34 @@
+/*
+The `bench_lcd_uart.c` file is a benchmark image, not a project sketch. The final project only drives the LCD through the framebuffer and
+the async queue, so this program calls the blocking LCD functions and the buffered UART over and over, where `tools/bench.sh` can time
+them.
+
+- `bench_pass()` is one pass of the main loop and is kept out of line so the runner can find it by name.
+- The LCD uses the default wait mode from `LCD_3.h`, so `lcd_data` and `lcd_puts` are timed with the waits the display needs.
+*/
+
+#ifndef F_CPU
+#define F_CPU 16000000UL
+#endif
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include "../RBT211 Final Project/LCD_3.h"
+#include "../RBT211 Final Project/uart.h"
+
+__attribute__((noinline)) void bench_pass(void) {
+	lcd_gotoxy(1, 1);
+	lcd_puts("RBT211 benchmark");
+	lcd_gotoxy(1, 2);
+	lcd_data('#');
+	uart_puts("The quick brown fox jumps over the lazy dog\n");
+}
+
+int main(void) {
+	uart_init();
+	lcd_init();
+	sei();
+
+	while (1)
+	bench_pass();
+}
@@ -0,0 +1,333 @@
+/*
+The `hcsr04.c` file runs the distance meter image (`final_project.elf`) under simavr with a virtual HC-SR04 wired to it, and checks what
+it prints.
+
+1. **Sensor Model**: The model watches TRIG (PB1). When TRIG falls after being high for at least 10 us, it waits `ECHO_DELAY_US` (the time
+the real module spends sending its 40 kHz burst) and then drives ECHO high for 58.3 us per cm of distance, the round trip time at
+343 m/s. ECHO is PB0 (ICP1) as in `echo.h`; use `--echo PB2` for an `ECHO_POLLED` build.
+
+2. **Distance Trace**: The distance comes from a trace file of `<ms> <cm>` lines, where the last line at or before the trigger applies.
+Instead of a distance, `drop` makes the sensor miss the echo (ECHO stays low) and `far` makes it report out of range (ECHO high for
+38 ms). Without `--trace` the built-in trace below is used.
+
+3. **Checks**: The UART output of `main.c` is split into lines and every "Duration/Distance cm/Distance inch" group is matched with the
+oldest measurement that has not been reported yet. The duration must be within 2 us of the pulse that was sent, or 65535 for a dropout or
+an out-of-range echo, and the cm and inch values within 1 of what the firmware's formulas give for that pulse. Any mismatch is printed and
+makes the program exit with status 1.
+
+4. **Timing**: The latency of a measurement runs from the falling edge of TRIG to the end of the "Distance inch" line. The report rate is
+the number of reports per second over the run, and the fastest possible rate is one over the worst latency. With `--csv` these are also
+printed as `final_project,metric,value` lines for `tools/bench.sh`.
+
+`test/test_hcsr04.c` runs the same sensor and checks against the host build of the firmware, and `ctest` runs it with `distance_trace.txt`.
+*/
+
+#include <simavr/sim_avr.h>
+#include <simavr/sim_elf.h>
+#include <simavr/sim_io.h>
+#include <simavr/sim_cycle_timers.h>
+#include <simavr/avr_ioport.h>
+#include <simavr/avr_uart.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#define TRIG_MIN_US 10 // Shortest trigger pulse the module reacts to
+#define ECHO_DELAY_US 250 // From the end of the trigger to the rising edge of the echo
+#define US_PER_CM 58.3 // Round trip at 343 m/s
+#define FAR_US 38000 // Echo width when nothing is in range
+#define TIMEOUT_DURATION 65535 // What main.c prints for ECHO_TIMEOUT
+#define MAX_STEPS 64
+#define MAX_PENDING 16
+
+enum { STEP_DISTANCE, STEP_DROP, STEP_FAR };
+
+typedef struct {
+	uint32_t ms;
+	uint8_t kind;
+	double cm;
+} step_t;
+
+typedef struct {
+	uint64_t trig; // Cycle of the falling edge of TRIG
+	uint8_t kind;
+	uint32_t width_us;
+} measurement_t;
+
+static const step_t default_trace[] = {
+	{0, STEP_DISTANCE, 20},
+	{1200, STEP_DISTANCE, 57.5},
+	{2200, STEP_DROP, 0},
+	{2700, STEP_DISTANCE, 150},
+	{3700, STEP_FAR, 0},
+	{4200, STEP_DISTANCE, 400},
+	{5200, STEP_DISTANCE, 3},
+};
+
+static step_t trace[MAX_STEPS];
+static int trace_len = 0;
+
+static avr_t *avr;
+static avr_irq_t *echo_irq;
+static uint64_t trig_rise = 0;
+static uint8_t trig_level = 0;
+
+static measurement_t pending[MAX_PENDING];
+static int pending_count = 0;
+
+static char line[64];
+static int line_len = 0;
+static long duration = -1, cm = -1;
+
+static FILE *out; // Human readable results, stderr when the CSV goes to stdout
+static int reports = 0, failures = 0, triggers = 0;
+static uint64_t latency_total = 0, latency_max = 0, first_report = 0, last_report = 0;
+
+static double cycles_to_us(uint64_t cycles) {
+	return cycles * 1e6 / avr->frequency;
+}
+
+static const step_t *step_at(uint64_t cycle) {
+	uint32_t ms = cycle * 1000 / avr->frequency;
+	int i;
+
+	for (i = trace_len - 1; i > 0; i--) {
+		if (trace[i].ms <= ms)
+		break;
+	}
+	return &trace[i];
+}
+
+// ---- Sensor ----
+
+static avr_cycle_count_t echo_fall(avr_t *a, avr_cycle_count_t when, void *param) {
+	(void)a;
+	(void)when;
+	(void)param;
+	avr_raise_irq(echo_irq, 0);
+	return 0;
+}
+
+static avr_cycle_count_t echo_rise(avr_t *a, avr_cycle_count_t when, void *param) {
+	uint32_t width = (uint32_t)(uintptr_t)param;
+
+	(void)when;
+	avr_raise_irq(echo_irq, 1);
+	avr_cycle_timer_register_usec(a, width, echo_fall, NULL);
+	return 0;
+}
+
+static void trig_changed(struct avr_irq_t *irq, uint32_t value, void *param) {
+	const step_t *s;
+	measurement_t *m;
+
+	(void)irq;
+	(void)param;
+	if (value && !trig_level)
+	trig_rise = avr->cycle;
+	if (!value && trig_level && cycles_to_us(avr->cycle - trig_rise) >= TRIG_MIN_US) {
+		s = step_at(avr->cycle);
+		triggers++;
+		if (pending_count == MAX_PENDING) {
+			fprintf(stderr, "hcsr04: too many measurements without a report\n");
+			failures++;
+		} else {
+			m = &pending[pending_count++];
+			m->trig = avr->cycle;
+			m->kind = s->kind;
+			m->width_us = s->kind == STEP_FAR ? FAR_US : (uint32_t)(s->cm * US_PER_CM + 0.5);
+			if (s->kind != STEP_DROP)
+			avr_cycle_timer_register_usec(avr, ECHO_DELAY_US, echo_rise, (void *)(uintptr_t)m->width_us);
+		}
+	}
+	trig_level = value != 0;
+}
+
+// ---- UART output ----
+
+static void check_report(long inch) {
+	measurement_t m;
+	long want_duration, want_cm, want_inch;
+	uint64_t latency;
+	int ok = 1;
+
+	if (!pending_count) {
+		fprintf(out, "FAIL report without a measurement\n");
+		failures++;
+		return;
+	}
+	m = pending[0];
+	memmove(pending, pending + 1, --pending_count * sizeof(pending[0]));
+
+	if (m.kind == STEP_DISTANCE) {
+		want_duration = m.width_us;
+		ok = labs(duration - want_duration) <= 2;
+	} else {
+		want_duration = TIMEOUT_DURATION;
+		ok = duration == TIMEOUT_DURATION;
+	}
+	// Same formulas as report_task: duration * 0.034 / 2 and duration * 0.0133 / 2
+	want_cm = (long)(want_duration * 0.017);
+	want_inch = (long)(want_duration * 0.00665);
+	ok = ok && labs(cm - want_cm) <= 1 && labs(inch - want_inch) <= 1;
+
+	latency = avr->cycle - m.trig;
+	latency_total += latency;
+	if (latency > latency_max)
+	latency_max = latency;
+	if (!reports)
+	first_report = avr->cycle;
+	last_report = avr->cycle;
+	reports++;
+
+	fprintf(out, "%s t=%8.1f ms  sent %-9s got %5ld us %4ld cm %3ld in  (want %5ld us %4ld cm %3ld in)  latency %.0f us\n", ok ? "ok  " : "FAIL",
+		cycles_to_us(m.trig) / 1000, m.kind == STEP_DROP ? "dropout" : m.kind == STEP_FAR ? "far" : "distance", duration, cm, inch,
+		want_duration, want_cm, want_inch, cycles_to_us(latency));
+	if (!ok)
+	failures++;
+}
+
+static void uart_out(struct avr_irq_t *irq, uint32_t value, void *param) {
+	(void)irq;
+	(void)param;
+	if (value == '\r')
+	return;
+	if (value != '\n') {
+		if (line_len < (int)sizeof(line) - 1)
+		line[line_len++] = value;
+		return;
+	}
+	line[line_len] = 0;
+	line_len = 0;
+
+	if (!strncmp(line, "Duration: ", 10))
+	duration = atol(line + 10);
+	else if (!strncmp(line, "Distance cm: ", 13))
+	cm = atol(line + 13);
+	else if (!strncmp(line, "Distance inch: ", 15)) {
+		check_report(atol(line + 15));
+		duration = cm = -1;
+	}
+}
+
+// ---- Setup ----
+
+static void load_trace(const char *path) {
+	FILE *f = fopen(path, "r");
+	char buf[128], what[32];
+	unsigned ms;
+
+	if (!f) {
+		fprintf(stderr, "hcsr04: cannot open %s\n", path);
+		exit(2);
+	}
+	while (fgets(buf, sizeof(buf), f) && trace_len < MAX_STEPS) {
+		if (buf[0] == '#' || sscanf(buf, "%u %31s", &ms, what) != 2)
+		continue;
+		trace[trace_len].ms = ms;
+		if (!strcmp(what, "drop"))
+		trace[trace_len].kind = STEP_DROP;
+		else if (!strcmp(what, "far"))
+		trace[trace_len].kind = STEP_FAR;
+		else {
+			trace[trace_len].kind = STEP_DISTANCE;
+			trace[trace_len].cm = atof(what);
+		}
+		trace_len++;
+	}
+	fclose(f);
+	if (!trace_len) {
+		fprintf(stderr, "hcsr04: %s has no steps\n", path);
+		exit(2);
+	}
+}
+
+static void usage(void) {
+	fprintf(stderr, "usage: hcsr04 --elf final_project.elf [--trace FILE] [--ms MS] [--echo PB0|PB2] [--csv]\n");
+	exit(2);
+}
+
+int main(int argc, char *argv[]) {
+	const char *elf_path = 0;
+	uint32_t ms = 0, flags = 0;
+	int echo_bit = 0, csv = 0, a, state;
+	uint64_t end;
+	elf_firmware_t firmware;
+
+	for (a = 1; a < argc; a++) {
+		if (!strcmp(argv[a], "--elf") && a + 1 < argc)
+		elf_path = argv[++a];
+		else if (!strcmp(argv[a], "--trace") && a + 1 < argc)
+		load_trace(argv[++a]);
+		else if (!strcmp(argv[a], "--ms") && a + 1 < argc)
+		ms = strtoul(argv[++a], 0, 10);
+		else if (!strcmp(argv[a], "--echo") && a + 1 < argc && !strncmp(argv[a + 1], "PB", 2))
+		echo_bit = argv[++a][2] - '0';
+		else if (!strcmp(argv[a], "--csv"))
+		csv = 1;
+		else
+		usage();
+	}
+	if (!elf_path)
+	usage();
+	out = csv ? stderr : stdout;
+	if (!trace_len) {
+		memcpy(trace, default_trace, sizeof(default_trace));
+		trace_len = sizeof(default_trace) / sizeof(default_trace[0]);
+	}
+	if (!ms)
+	ms = trace[trace_len - 1].ms + 1000;
+
+	memset(&firmware, 0, sizeof(firmware));
+	if (elf_read_firmware(elf_path, &firmware)) {
+		fprintf(stderr, "hcsr04: cannot read %s\n", elf_path);
+		return 2;
+	}
+	avr = avr_make_mcu_by_name("atmega328p");
+	if (!avr)
+	return 2;
+	avr_init(avr);
+	avr->frequency = 16000000;
+	avr_load_firmware(avr, &firmware);
+
+	if (avr_ioctl(avr, AVR_IOCTL_UART_GET_FLAGS('0'), &flags) == 0) {
+		flags &= ~AVR_UART_FLAG_STDIO;
+		avr_ioctl(avr, AVR_IOCTL_UART_SET_FLAGS('0'), &flags);
+	}
+	avr_irq_register_notify(avr_io_getirq(avr, AVR_IOCTL_UART_GETIRQ('0'), UART_IRQ_OUTPUT), uart_out, NULL);
+	avr_irq_register_notify(avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ('B'), 1), trig_changed, NULL);
+	echo_irq = avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ('B'), echo_bit);
+	avr_raise_irq(echo_irq, 0);
+
+	end = (uint64_t)ms * avr->frequency / 1000;
+	do {
+		state = avr_run(avr);
+	} while (avr->cycle < end && state != cpu_Done && state != cpu_Crashed);
+
+	if (state == cpu_Crashed) {
+		fprintf(out, "FAIL firmware crashed at pc 0x%04x\n", avr->pc);
+		failures++;
+	}
+	if (!reports) {
+		fprintf(out, "FAIL no reports in %u ms\n", ms);
+		failures++;
+	}
+	if (pending_count > 1) { // The last trigger may still be waiting for its report
+		fprintf(out, "FAIL %d measurements were never reported\n", pending_count);
+		failures++;
+	}
+
+	fprintf(out, "%d triggers, %d reports, %d failures\n", triggers, reports, failures);
+	if (reports) {
+		double rate = reports > 1 ? (reports - 1) * (double)avr->frequency / (last_report - first_report) : 0;
+		double avg_us = cycles_to_us(latency_total / reports), max_us = cycles_to_us(latency_max);
+		fprintf(out, "latency avg %.0f us, max %.0f us; %.2f reports/s, at most %.1f/s\n", avg_us, max_us, rate, 1e6 / max_us);
+		if (csv) {
+			printf("final_project,sonar.latency_us_avg,%.0f\n", avg_us);
+			printf("final_project,sonar.latency_us_max,%.0f\n", max_us);
+			printf("final_project,sonar.reports_per_ks,%.0f\n", rate * 1000);
+		}
+	}
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,408 @@
+/*
+The `runner.c` file is the benchmark runner. It loads one ATmega328P image into simavr, runs it for a fixed stretch of virtual time one
+instruction at a time, and prints what it measured as CSV lines of `sketch,metric,value`.
+
+1. **Interrupts**: Every instruction the runner looks at the interrupt flags. The cycle a flag goes from 0 to 1 is when the interrupt was
+raised, and the cycle simavr jumps to its slot in the vector table is when it was taken; the difference is the entry latency. The ISR is
+finished when the I flag comes back on with `reti`, which gives its duration. Level interrupts (USART data register empty) have no raise
+time, so only their duration is reported.
+
+2. **Functions**: For each `--func name`, the address comes from the ELF symbol table. A call starts when the program counter reaches the
+function and ends when the stack pointer rises above where it was at the start, which is the `ret`. Interrupts taken inside the call are
+counted, as they are on the chip.
+
+3. **Main Loop**: `--loop name` names a function that the main loop calls once per pass (`sched_run` in the scheduler sketches). The time
+between two calls is one pass.
+
+4. **UART**: Bytes sent on USART0 are counted from simavr's UART output IRQ, and the rate is taken between the first and the last byte.
+
+5. **Inputs**: `--toggle PD2:20` flips an input pin every 20 ms, so that a button interrupt such as `INT0_vect` has something to measure.
+`--i2c-ack 0x27` puts a slave on the TWI bus that acknowledges every write to that 7-bit address, like the PCF8574 of an LCD backpack.
+
+6. **Rates**: `--rate chars:32` says that one pass of the `--loop` function handles 32 characters, and adds a `loop.chars_per_s` line.
+
+All times are in CPU cycles, which simavr counts exactly for each instruction.
+*/
+
+#include <simavr/sim_avr.h>
+#include <simavr/sim_elf.h>
+#include <simavr/sim_io.h>
+#include <simavr/avr_ioport.h>
+#include <simavr/avr_uart.h>
+#include <simavr/avr_twi.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#define MAX_FUNCS 8
+#define MAX_TOGGLES 4
+
+typedef struct {
+	const char *name;
+	uint8_t vector;
+	uint8_t address; // Flag register, 0 for a level interrupt
+	uint8_t bit;
+} irq_def_t;
+
+// ATmega328P vectors with their flags, as in the datasheet
+static const irq_def_t irqs[] = {
+	{"INT0_vect", 1, 0x3C, 0},
+	{"INT1_vect", 2, 0x3C, 1},
+	{"PCINT0_vect", 3, 0x3B, 0},
+	{"PCINT1_vect", 4, 0x3B, 1},
+	{"PCINT2_vect", 5, 0x3B, 2},
+	{"TIMER2_COMPA_vect", 7, 0x37, 1},
+	{"TIMER2_COMPB_vect", 8, 0x37, 2},
+	{"TIMER2_OVF_vect", 9, 0x37, 0},
+	{"TIMER1_CAPT_vect", 10, 0x36, 5},
+	{"TIMER1_COMPA_vect", 11, 0x36, 1},
+	{"TIMER1_COMPB_vect", 12, 0x36, 2},
+	{"TIMER1_OVF_vect", 13, 0x36, 0},
+	{"TIMER0_COMPA_vect", 14, 0x35, 1},
+	{"TIMER0_COMPB_vect", 15, 0x35, 2},
+	{"TIMER0_OVF_vect", 16, 0x35, 0},
+	{"SPI_STC_vect", 17, 0x4D, 7},
+	{"USART_RX_vect", 18, 0xC0, 7},
+	{"USART_UDRE_vect", 19, 0, 0},
+	{"USART_TX_vect", 20, 0xC0, 6},
+	{"ADC_vect", 21, 0x7A, 4},
+	{"EE_READY_vect", 22, 0, 0},
+	{"TWI_vect", 24, 0, 0},
+};
+#define IRQ_COUNT (sizeof(irqs) / sizeof(irqs[0]))
+
+typedef struct {
+	uint64_t count;
+	uint64_t total;
+	uint64_t min;
+	uint64_t max;
+} stat_t;
+
+typedef struct {
+	const char *name;
+	uint32_t address;
+	uint8_t active;
+	uint16_t sp;
+	uint64_t start;
+	stat_t cycles;
+} func_t;
+
+typedef struct {
+	char port;
+	uint8_t bit;
+	uint32_t ms;
+	uint8_t level;
+	avr_irq_t *irq;
+	uint64_t next;
+} toggle_t;
+
+static uint64_t raised_at[IRQ_COUNT];
+static uint8_t was_set[IRQ_COUNT];
+static stat_t latency[IRQ_COUNT];
+static stat_t duration[IRQ_COUNT];
+
+static func_t funcs[MAX_FUNCS];
+static int func_count = 0;
+static func_t loop_func;
+static toggle_t toggles[MAX_TOGGLES];
+static int toggle_count = 0;
+
+static uint64_t uart_bytes = 0, uart_first = 0, uart_last = 0;
+static avr_t *avr;
+
+static int i2c_address = -1;
+static uint8_t i2c_selected = 0;
+static avr_irq_t *i2c_irq;
+static const char *i2c_names[2] = {[TWI_IRQ_INPUT] = "8>ack.out", [TWI_IRQ_OUTPUT] = "32<ack.in"};
+
+static void stat_add(stat_t *s, uint64_t value) {
+	if (!s->count || value < s->min)
+	s->min = value;
+	if (value > s->max)
+	s->max = value;
+	s->total += value;
+	s->count++;
+}
+
+// ---- ELF symbols (32-bit little-endian, which is what avr-gcc writes) ----
+
+static uint32_t rd32(const uint8_t *p) {
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint16_t rd16(const uint8_t *p) {
+	return p[0] | (p[1] << 8);
+}
+
+// Returns the flash address of a function symbol, or 0xFFFFFFFF if there is none
+static uint32_t elf_symbol(const char *path, const char *name) {
+	FILE *f = fopen(path, "rb");
+	uint8_t *elf, *sh, *sym, *str;
+	long size;
+	uint32_t shoff, i, j, result = 0xFFFFFFFF;
+	uint16_t shentsize, shnum;
+
+	if (!f)
+	return result;
+	fseek(f, 0, SEEK_END);
+	size = ftell(f);
+	fseek(f, 0, SEEK_SET);
+	elf = malloc(size);
+	if (!elf || fread(elf, 1, size, f) != (size_t)size || size < 52 || memcmp(elf, "\177ELF\001\001", 6)) {
+		fclose(f);
+		free(elf);
+		return result;
+	}
+	fclose(f);
+
+	shoff = rd32(elf + 32);
+	shentsize = rd16(elf + 46);
+	shnum = rd16(elf + 48);
+	for (i = 0; i < shnum; i++) {
+		sh = elf + shoff + i * shentsize;
+		if (rd32(sh + 4) != 2) // SHT_SYMTAB
+		continue;
+		sym = elf + rd32(sh + 16);
+		str = elf + rd32(elf + shoff + rd32(sh + 24) * shentsize + 16); // Linked string table
+		for (j = 0; j < rd32(sh + 20) / 16; j++) {
+			if (strcmp((char *)str + rd32(sym + j * 16), name) == 0 && (sym[j * 16 + 12] & 0x0F) == 2) { // STT_FUNC
+				result = rd32(sym + j * 16 + 4);
+				break;
+			}
+		}
+	}
+	free(elf);
+	return result;
+}
+
+// ---- simavr hooks ----
+
+static void uart_out(struct avr_irq_t *irq, uint32_t value, void *param) {
+	(void)irq;
+	(void)value;
+	(void)param;
+	if (!uart_bytes)
+	uart_first = avr->cycle;
+	uart_last = avr->cycle;
+	uart_bytes++;
+}
+
+// The --i2c-ack slave: acknowledges its address and every byte written to it
+static void i2c_in(struct avr_irq_t *irq, uint32_t value, void *param) {
+	avr_twi_msg_irq_t msg;
+
+	(void)irq;
+	(void)param;
+	msg.u.v = value;
+	if (msg.u.twi.msg & TWI_COND_STOP)
+	i2c_selected = 0;
+	if (msg.u.twi.msg & TWI_COND_START) {
+		i2c_selected = (msg.u.twi.addr >> 1) == i2c_address && !(msg.u.twi.addr & 1);
+		if (i2c_selected)
+		avr_raise_irq(i2c_irq + TWI_IRQ_INPUT, avr_twi_irq_msg(TWI_COND_ACK, msg.u.twi.addr, 1));
+	}
+	if (i2c_selected && (msg.u.twi.msg & TWI_COND_WRITE))
+	avr_raise_irq(i2c_irq + TWI_IRQ_INPUT, avr_twi_irq_msg(TWI_COND_ACK, msg.u.twi.addr, 1));
+}
+
+static uint16_t stack_pointer(void) {
+	return avr->data[0x5D] | (avr->data[0x5E] << 8);
+}
+
+static void follow_func(func_t *fn) {
+	if (fn->address == 0xFFFFFFFF)
+	return;
+	if (!fn->active && avr->pc == fn->address) {
+		fn->active = 1;
+		fn->start = avr->cycle;
+		fn->sp = stack_pointer();
+	} else if (fn->active && stack_pointer() > fn->sp) { // The return address was popped
+		fn->active = 0;
+		stat_add(&fn->cycles, avr->cycle - fn->start);
+	}
+}
+
+static void follow_loop(void) {
+	if (loop_func.address == 0xFFFFFFFF || avr->pc != loop_func.address)
+	return;
+	if (loop_func.start)
+	stat_add(&loop_func.cycles, avr->cycle - loop_func.start);
+	loop_func.start = avr->cycle;
+}
+
+static int in_isr = -1; // Index of the ISR being timed
+static uint64_t isr_start;
+
+static void follow_irqs(void) {
+	unsigned i;
+	uint8_t set;
+
+	for (i = 0; i < IRQ_COUNT; i++) {
+		if (!irqs[i].address)
+		continue;
+		set = (avr->data[irqs[i].address] >> irqs[i].bit) & 1;
+		if (set && !was_set[i])
+		raised_at[i] = avr->cycle;
+		was_set[i] = set;
+	}
+
+	if (in_isr >= 0 && avr->sreg[S_I]) { // reti
+		stat_add(&duration[in_isr], avr->cycle - isr_start);
+		in_isr = -1;
+	}
+	if (avr->pc && (avr->pc % 4) == 0 && avr->pc / 4 <= 25 && !avr->sreg[S_I]) {
+		for (i = 0; i < IRQ_COUNT; i++) {
+			if (avr->pc / 4 != irqs[i].vector)
+			continue;
+			if (irqs[i].address && raised_at[i])
+			stat_add(&latency[i], avr->cycle - raised_at[i]);
+			raised_at[i] = 0;
+			was_set[i] = 0; // The flag was cleared on entry
+			in_isr = i;
+			isr_start = avr->cycle;
+		}
+	}
+}
+
+static void follow_toggles(void) {
+	int i;
+
+	for (i = 0; i < toggle_count; i++) {
+		if (avr->cycle < toggles[i].next)
+		continue;
+		toggles[i].level ^= 1;
+		avr_raise_irq(toggles[i].irq, toggles[i].level);
+		toggles[i].next += (uint64_t)toggles[i].ms * avr->frequency / 1000;
+	}
+}
+
+// ---- Output ----
+
+static void print_stat(const char *sketch, const char *name, const char *what, const stat_t *s) {
+	if (!s->count)
+	return;
+	printf("%s,%s.%s_avg,%llu\n", sketch, name, what, (unsigned long long)(s->total / s->count));
+	printf("%s,%s.%s_max,%llu\n", sketch, name, what, (unsigned long long)s->max);
+}
+
+static void usage(void) {
+	fprintf(stderr, "usage: runner --elf FILE --name SKETCH [--freq HZ] [--ms MS] [--func NAME]... [--loop NAME] [--rate WHAT:N] [--toggle PD2:MS]...\n"
+		"       [--i2c-ack ADDRESS]\n");
+	exit(2);
+}
+
+int main(int argc, char *argv[]) {
+	const char *elf_path = 0, *sketch = 0, *loop_name = 0, *rate_name = 0;
+	unsigned long rate_count = 0;
+	uint32_t freq = 16000000, ms = 2000;
+	uint64_t end;
+	elf_firmware_t firmware;
+	uint32_t flags = 0;
+	unsigned i;
+	int state, a;
+
+	for (a = 1; a < argc; a++) {
+		if (!strcmp(argv[a], "--elf") && a + 1 < argc)
+		elf_path = argv[++a];
+		else if (!strcmp(argv[a], "--name") && a + 1 < argc)
+		sketch = argv[++a];
+		else if (!strcmp(argv[a], "--freq") && a + 1 < argc)
+		freq = strtoul(argv[++a], 0, 10);
+		else if (!strcmp(argv[a], "--ms") && a + 1 < argc)
+		ms = strtoul(argv[++a], 0, 10);
+		else if (!strcmp(argv[a], "--func") && a + 1 < argc && func_count < MAX_FUNCS)
+		funcs[func_count++].name = argv[++a];
+		else if (!strcmp(argv[a], "--loop") && a + 1 < argc)
+		loop_name = argv[++a];
+		else if (!strcmp(argv[a], "--rate") && a + 1 < argc) {
+			char *colon = strchr(argv[++a], ':'); // <what>:<count per pass>
+			if (!colon)
+			usage();
+			*colon = 0;
+			rate_name = argv[a];
+			rate_count = strtoul(colon + 1, 0, 10);
+		} else if (!strcmp(argv[a], "--i2c-ack") && a + 1 < argc)
+		i2c_address = strtol(argv[++a], 0, 0) & 0x7F;
+		else if (!strcmp(argv[a], "--toggle") && a + 1 < argc && toggle_count < MAX_TOGGLES) {
+			const char *t = argv[++a]; // P<port><bit>:<ms>
+			if (strlen(t) < 5 || t[0] != 'P' || t[3] != ':')
+			usage();
+			toggles[toggle_count].port = t[1];
+			toggles[toggle_count].bit = t[2] - '0';
+			toggles[toggle_count].ms = strtoul(t + 4, 0, 10);
+			toggles[toggle_count].level = 1;
+			toggle_count++;
+		} else
+		usage();
+	}
+	if (!elf_path || !sketch)
+	usage();
+
+	memset(&firmware, 0, sizeof(firmware));
+	if (elf_read_firmware(elf_path, &firmware)) {
+		fprintf(stderr, "runner: cannot read %s\n", elf_path);
+		return 1;
+	}
+	avr = avr_make_mcu_by_name("atmega328p");
+	if (!avr) {
+		fprintf(stderr, "runner: simavr has no atmega328p\n");
+		return 1;
+	}
+	avr_init(avr);
+	avr->frequency = freq;
+	avr_load_firmware(avr, &firmware);
+
+	if (avr_ioctl(avr, AVR_IOCTL_UART_GET_FLAGS('0'), &flags) == 0) { // Keep the sketch's output off the CSV
+		flags &= ~AVR_UART_FLAG_STDIO;
+		avr_ioctl(avr, AVR_IOCTL_UART_SET_FLAGS('0'), &flags);
+	}
+	avr_irq_register_notify(avr_io_getirq(avr, AVR_IOCTL_UART_GETIRQ('0'), UART_IRQ_OUTPUT), uart_out, NULL);
+
+	if (i2c_address >= 0) {
+		i2c_irq = avr_alloc_irq(&avr->irq_pool, 0, 2, i2c_names);
+		avr_irq_register_notify(i2c_irq + TWI_IRQ_OUTPUT, i2c_in, NULL);
+		avr_connect_irq(i2c_irq + TWI_IRQ_INPUT, avr_io_getirq(avr, AVR_IOCTL_TWI_GETIRQ(0), TWI_IRQ_INPUT));
+		avr_connect_irq(avr_io_getirq(avr, AVR_IOCTL_TWI_GETIRQ(0), TWI_IRQ_OUTPUT), i2c_irq + TWI_IRQ_OUTPUT);
+	}
+
+	for (a = 0; a < func_count; a++)
+	funcs[a].address = elf_symbol(elf_path, funcs[a].name);
+	loop_func.name = loop_name;
+	loop_func.address = loop_name ? elf_symbol(elf_path, loop_name) : 0xFFFFFFFF;
+	for (a = 0; a < toggle_count; a++) {
+		toggles[a].irq = avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ(toggles[a].port), toggles[a].bit);
+		avr_raise_irq(toggles[a].irq, 1); // Released button, pulled up
+		toggles[a].next = (uint64_t)toggles[a].ms * freq / 1000;
+	}
+
+	end = (uint64_t)ms * freq / 1000;
+	do {
+		state = avr_run(avr);
+		follow_irqs();
+		for (a = 0; a < func_count; a++)
+		follow_func(&funcs[a]);
+		follow_loop();
+		follow_toggles();
+	} while (avr->cycle < end && state != cpu_Done && state != cpu_Crashed);
+
+	if (state == cpu_Crashed) {
+		fprintf(stderr, "runner: %s crashed at pc 0x%04x\n", sketch, avr->pc);
+		return 1;
+	}
+
+	for (a = 0; a < func_count; a++)
+	print_stat(sketch, funcs[a].name, "cycles", &funcs[a].cycles);
+	if (loop_name)
+	print_stat(sketch, "loop", "cycles", &loop_func.cycles);
+	if (rate_name && loop_func.cycles.count)
+	printf("%s,loop.%s_per_s,%llu\n", sketch, rate_name,
+		(unsigned long long)((uint64_t)rate_count * freq * loop_func.cycles.count / loop_func.cycles.total));
+	for (i = 0; i < IRQ_COUNT; i++) {
+		print_stat(sketch, irqs[i].name, "latency", &latency[i]);
+		print_stat(sketch, irqs[i].name, "duration", &duration[i]);
+	}
+	if (uart_bytes > 1)
+	printf("%s,uart.bytes_per_s,%llu\n", sketch, (unsigned long long)((uart_bytes - 1) * freq / (uart_last - uart_first)));
+	return 0;
+}
@@ -0,0 +1,31 @@
+# Toolchain file for building the sketches for the ATmega328P.
+# Use: cmake -S . -B build-avr -DCMAKE_TOOLCHAIN_FILE=cmake/avr-gcc.cmake
+
+set(CMAKE_SYSTEM_NAME Generic)
+set(CMAKE_SYSTEM_PROCESSOR avr)
+
+find_program(AVR_GCC avr-gcc)
+find_program(AVR_OBJCOPY avr-objcopy)
+find_program(AVR_SIZE avr-size)
+find_program(AVR_NM avr-nm)
+find_program(AVR_OBJDUMP avr-objdump)
+
+# find_program(... REQUIRED) needs CMake 3.18
+foreach(tool AVR_GCC AVR_OBJCOPY AVR_SIZE AVR_NM AVR_OBJDUMP)
+	if(NOT ${tool})
+		message(FATAL_ERROR "${tool} not found, install avr-gcc and avr-binutils")
+	endif()
+endforeach()
+
+set(CMAKE_C_COMPILER ${AVR_GCC})
+set(CMAKE_ASM_COMPILER ${AVR_GCC})
+set(CMAKE_TRY_COMPILE_TARGET_TYPE STATIC_LIBRARY)
+
+set(AVR_MCU atmega328p CACHE STRING "Target MCU")
+set(CMAKE_C_FLAGS_INIT "-mmcu=${AVR_MCU} -Os -ffunction-sections -fdata-sections")
+set(CMAKE_EXE_LINKER_FLAGS_INIT "-mmcu=${AVR_MCU} -Wl,--gc-sections")
+set(CMAKE_EXECUTABLE_SUFFIX .elf)
+
+set(CMAKE_FIND_ROOT_PATH_MODE_PROGRAM NEVER)
+set(CMAKE_FIND_ROOT_PATH_MODE_LIBRARY ONLY)
+set(CMAKE_FIND_ROOT_PATH_MODE_INCLUDE ONLY)
@@ -0,0 +1,92 @@
+/*
+The `debounce.c` file contains the definitions of the functions declared in the `debounce.h` file.
+
+1. **Timer0**: Timer0 runs in CTC mode and `TIMER0_COMPA_vect` fires every `DEBOUNCE_TICK_MS`; `timer_calc.h` picks the prescaler and
+TOP from F_CPU. At 16 MHz a 2 ms tick is 125 timer counts at F_CPU / 256.
+
+2. **Counter Update**: `changed` holds the pins whose input differs from `state`. For those pins the counter `cnt1:cnt0` counts down from 3
+and wraps at the fourth sample, which is when `state` is flipped; for every other pin it is reset to 3. The new presses and releases are
+the flipped bits that are now set or clear.
+*/
+
+#include "debounce.h"
+#include "pindefines.h"
+#include "timer_calc.h"
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <util/atomic.h>
+
+#if DEBOUNCE_BUTTONS != ((1 << BUTTON) | (1 << BUTTON2) | (1 << BUTTON3))
+#error "DEBOUNCE_BUTTONS does not match pindefines.h"
+#endif
+
+#define TICK TIMER_MS(DEBOUNCE_TICK_MS)
+#define LONG_TICKS (DEBOUNCE_LONG_MS / DEBOUNCE_TICK_MS)
+
+#if !TIMER_OK(0, TICK, 10000) // Within 1 %
+#error "DEBOUNCE_TICK_MS does not fit Timer0 at this F_CPU"
+#endif
+
+static uint8_t pins = 0; // Pins that are debounced
+static volatile uint8_t state = 0; // Debounced state, 1 = pressed
+static uint8_t cnt0 = 0xFF, cnt1 = 0xFF; // Vertical counters
+static uint16_t hold = 0; // Ticks since the state last changed
+static volatile uint8_t ev_press = 0, ev_release = 0, ev_long = 0;
+
+void debounce_init(uint8_t mask) {
+	pins = mask;
+	BUTTON_DDR &= ~mask;
+	BUTTON_PORT |= mask; // Pull-ups
+	state = 0;
+	cnt0 = cnt1 = 0xFF;
+	ev_press = ev_release = ev_long = 0;
+
+	TCCR0A = (1 << WGM01); // CTC mode, TOP = OCR0A
+	TCCR0B = TIMER_CS(0, TICK);
+	OCR0A = TIMER_TOP(0, TICK);
+	TCNT0 = 0;
+	TIFR0 = (1 << OCF0A);
+	TIMSK0 = (1 << OCIE0A);
+}
+
+uint8_t debounce_state(void) {
+	return state;
+}
+
+// Returns the latched events in mask and clears them
+static uint8_t take(volatile uint8_t *events, uint8_t mask) {
+	uint8_t e;
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		e = *events & mask;
+		*events &= ~e;
+	}
+	return e;
+}
+
+uint8_t debounce_pressed(uint8_t mask) {
+	return take(&ev_press, mask);
+}
+
+uint8_t debounce_released(uint8_t mask) {
+	return take(&ev_release, mask);
+}
+
+uint8_t debounce_long(uint8_t mask) {
+	return take(&ev_long, mask);
+}
+
+ISR(TIMER0_COMPA_vect) {
+	uint8_t changed = (~BUTTON_PIN & pins) ^ state;
+
+	cnt0 = ~(cnt0 & changed);
+	cnt1 = cnt0 ^ (cnt1 & changed);
+	changed &= cnt0 & cnt1; // Pins whose counter wrapped
+	if (changed) {
+		state ^= changed;
+		ev_press |= state & changed;
+		ev_release |= ~state & changed;
+		hold = 0;
+	} else if (hold < LONG_TICKS && state && ++hold == LONG_TICKS)
+	ev_long |= state;
+}
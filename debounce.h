@@ -0,0 +1,42 @@
+/*
+The `debounce.h` file declares a debouncer for the push buttons in `pindefines.h` (BUTTON, BUTTON2 and BUTTON3 on PD2 - PD4).
+
+1. **Sampling**: Timer0 interrupts every `DEBOUNCE_TICK_MS` milliseconds and the ISR reads all the button pins at once from PIND. Nothing
+ever waits for a button to settle, and the INT0/INT1 interrupts are not used, so contact bounce cannot cause a burst of interrupts.
+
+2. **Vertical Counters**: Every button has a 2-bit counter, but the counters are stored "vertically": bit n of `cnt0` and `cnt1` together
+make the counter of pin n. One pass of a few AND/XOR instructions updates the counters of all 8 pins at the same time. A counter runs
+while its pin differs from the debounced state and restarts when it agrees again, so a button only changes state after 4 samples in a
+row (8 ms) have agreed.
+
+3. **Events**: Every change of the debounced state latches a press or release event for that pin, and a button that is held for
+`DEBOUNCE_LONG_MS` while no other button changes latches a long-press event as well. `debounce_pressed()`, `debounce_released()` and
+`debounce_long()` return the events for the pins in their mask and clear them, so each event is seen once however seldom the main
+program checks.
+
+Masks use the PIND bit positions, e.g. `(1 << BUTTON)`. A pressed button reads low (the pins use the internal pull-ups), and the driver
+takes care of the inversion: a set bit always means pressed.
+*/
+
+#ifndef DEBOUNCE_H_
+#define DEBOUNCE_H_
+
+#include <stdint.h>
+
+#ifndef DEBOUNCE_TICK_MS
+#define DEBOUNCE_TICK_MS 2 // Time between samples
+#endif
+
+#ifndef DEBOUNCE_LONG_MS
+#define DEBOUNCE_LONG_MS 1000 // Hold time for a long press
+#endif
+
+#define DEBOUNCE_BUTTONS 0x1C // BUTTON, BUTTON2 and BUTTON3 from pindefines.h
+
+void debounce_init(uint8_t mask);
+uint8_t debounce_state(void);
+uint8_t debounce_pressed(uint8_t mask);
+uint8_t debounce_released(uint8_t mask);
+uint8_t debounce_long(uint8_t mask);
+
+#endif /* DEBOUNCE_H_ */
@@ -0,0 +1,223 @@
+/*
+The `eelog.c` file contains the definitions of the functions declared in the `eelog.h` file.
+
+1. **Channel Blocks**: `blocks[c]` is the block channel c is filling, with its write position in `pos[c]` and the last sample in `last[c]`.
+When it is full it is marked `ready` and left alone until the writer takes it.
+
+2. **Writer**: The writer has its own copy of the block in `out`, so a channel can start filling its next block straight away. `start()`
+takes the next ready block, gives it a sequence number, its CRC and the next place in the ring, and enables `EERIE`. The ISR then runs
+once for every byte: it reads the old value, works out which EEPROM operation the new value needs, if any, and starts it. When the block
+is done it starts the next ready block, or turns `EERIE` off.
+
+3. **Direct Reads**: `ee_read()` is used outside the ISR. It runs with interrupts off, so the ISR cannot change `EEAR` in between, and
+waits for a write in progress to finish first, since `EERE` is ignored while `EEPE` is set.
+*/
+
+#include "eelog.h"
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <util/atomic.h>
+#include <util/crc16.h>
+
+#define HEADER 6 // Sequence, channel, count and the first sample
+#define CRC_AT (EELOG_BLOCK_SIZE - 1)
+#define MAX_SAMPLES (1 + CRC_AT - HEADER)
+#define ESCAPE 0x80 // Followed by a whole 16-bit sample
+
+static uint8_t blocks[EELOG_CHANNELS][EELOG_BLOCK_SIZE];
+static uint8_t pos[EELOG_CHANNELS]; // 0 for an empty block
+static uint16_t last[EELOG_CHANNELS];
+static volatile uint8_t ready = 0; // Bit c is set when channel c's block waits for the writer
+
+static uint8_t out[EELOG_BLOCK_SIZE];
+static volatile uint8_t out_pos = EELOG_BLOCK_SIZE; // Next byte the ISR writes, EELOG_BLOCK_SIZE when idle
+static uint16_t out_address;
+static uint8_t next_block = 0;
+static uint16_t next_sequence = 0;
+static uint16_t dropped = 0;
+
+static uint8_t ee_read(uint16_t address) {
+	uint8_t data;
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		while (EECR & (1 << EEPE)) {}
+		EEAR = address;
+		EECR |= (1 << EERE);
+		data = EEDR;
+	}
+	return data;
+}
+
+static uint8_t block_crc(const uint8_t *block) {
+	uint8_t crc = 0, i;
+
+	for (i = 0; i < CRC_AT; i++)
+	crc = _crc_ibutton_update(crc, block[i]);
+	return crc;
+}
+
+// Hands the next ready block to the ISR; called with interrupts off
+static void start(void) {
+	uint8_t c, i;
+
+	for (c = 0; c < EELOG_CHANNELS; c++) {
+		if (!(ready & (1 << c)))
+		continue;
+		for (; pos[c] < CRC_AT; pos[c]++)
+		blocks[c][pos[c]] = 0xFF;
+		blocks[c][0] = next_sequence;
+		blocks[c][1] = next_sequence >> 8;
+		blocks[c][CRC_AT] = block_crc(blocks[c]);
+		for (i = 0; i < EELOG_BLOCK_SIZE; i++)
+		out[i] = blocks[c][i];
+		pos[c] = 0;
+		ready &= ~(1 << c);
+
+		next_sequence++;
+		out_address = (uint16_t)next_block * EELOG_BLOCK_SIZE;
+		next_block = (next_block + 1) % EELOG_BLOCKS;
+		out_pos = 0;
+		EECR |= (1 << EERIE);
+		return;
+	}
+}
+
+// Finds the newest valid block and carries on after it. Returns the number of valid blocks.
+uint8_t eelog_init(void) {
+	uint8_t block[EELOG_BLOCK_SIZE];
+	uint8_t b, i, valid = 0, found = 0;
+	uint16_t sequence, newest = 0;
+
+	for (b = 0; b < EELOG_BLOCKS; b++) {
+		for (i = 0; i < EELOG_BLOCK_SIZE; i++)
+		block[i] = ee_read((uint16_t)b * EELOG_BLOCK_SIZE + i);
+		if (block[3] == 0 || block[3] > MAX_SAMPLES || block_crc(block) != block[CRC_AT])
+		continue;
+		valid++;
+		sequence = block[0] | (block[1] << 8);
+		if (!found || (int16_t)(sequence - newest) > 0) {
+			newest = sequence;
+			next_block = (b + 1) % EELOG_BLOCKS;
+			found = 1;
+		}
+	}
+	next_sequence = found ? newest + 1 : 0;
+	for (i = 0; i < EELOG_CHANNELS; i++)
+	pos[i] = 0;
+	ready = 0;
+	dropped = 0;
+	return valid;
+}
+
+// Closes a channel's block and hands it to the writer if it is idle
+static void close_block(uint8_t c) {
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		ready |= (1 << c);
+		if (out_pos == EELOG_BLOCK_SIZE)
+		start();
+	}
+}
+
+// Adds a sample; returns 0 if it was dropped because the channel's block still waits to be written
+uint8_t eelog_add(uint8_t channel, uint16_t value) {
+	uint8_t *block;
+	int16_t delta;
+	uint8_t small;
+
+	if (channel >= EELOG_CHANNELS)
+	return 0;
+	block = blocks[channel];
+	delta = value - last[channel];
+	small = delta >= -127 && delta <= 127;
+	if (pos[channel] && !small && pos[channel] > CRC_AT - 3)
+	close_block(channel); // No room for an escaped sample, it starts the next block
+	if (ready & (1 << channel)) {
+		dropped++;
+		return 0;
+	}
+
+	if (pos[channel] == 0) {
+		block[2] = channel;
+		block[3] = 1;
+		block[4] = value;
+		block[5] = value >> 8;
+		pos[channel] = HEADER;
+	} else {
+		if (small)
+		block[pos[channel]++] = (int8_t)delta;
+		else {
+			block[pos[channel]++] = ESCAPE;
+			block[pos[channel]++] = value;
+			block[pos[channel]++] = value >> 8;
+		}
+		block[3]++;
+	}
+	last[channel] = value;
+	if (pos[channel] == CRC_AT)
+	close_block(channel);
+	return 1;
+}
+
+// Queues every block that holds samples, so they are in the EEPROM once eelog_busy() returns 0
+void eelog_flush(void) {
+	uint8_t c;
+
+	for (c = 0; c < EELOG_CHANNELS; c++) {
+		if (pos[c] && !(ready & (1 << c)))
+		close_block(c);
+	}
+}
+
+uint8_t eelog_busy(void) {
+	return ready || out_pos != EELOG_BLOCK_SIZE;
+}
+
+uint16_t eelog_dropped(void) {
+	return dropped;
+}
+
+// Formats a block as "EE <address> <64 hex digits>\n"
+void eelog_dump_line(uint8_t block, char *line) {
+	static const char hex[] = "0123456789ABCDEF";
+	uint16_t address = (uint16_t)block * EELOG_BLOCK_SIZE;
+	uint8_t i, data;
+
+	*line++ = 'E';
+	*line++ = 'E';
+	*line++ = ' ';
+	for (i = 0; i < 4; i++)
+	*line++ = hex[(address >> (12 - 4 * i)) & 0x0F];
+	*line++ = ' ';
+	for (i = 0; i < EELOG_BLOCK_SIZE; i++) {
+		data = ee_read(address + i);
+		*line++ = hex[data >> 4];
+		*line++ = hex[data & 0x0F];
+	}
+	*line++ = '\n';
+	*line = 0;
+}
+
+ISR(EE_READY_vect) {
+	uint8_t old, data, mode;
+
+	while (out_pos < EELOG_BLOCK_SIZE) {
+		EEAR = out_address + out_pos;
+		data = out[out_pos++];
+		EECR |= (1 << EERE);
+		old = EEDR;
+		if (old == data)
+		continue; // Already there, saves 3.4 ms
+		if ((old & data) == data)
+		mode = (1 << EEPM1); // Only clears bits: write only, 1.8 ms
+		else if (data == 0xFF)
+		mode = (1 << EEPM0); // Erase only, 1.8 ms
+		else
+		mode = 0; // Erase and write, 3.4 ms
+		EEDR = data;
+		EECR = mode | (1 << EERIE) | (1 << EEMPE);
+		EECR |= (1 << EEPE);
+		return;
+	}
+	EECR &= ~(1 << EERIE);
+	start();
+}
@@ -0,0 +1,56 @@
+/*
+The `eelog.h` file declares a sample logger that keeps readings in the ATmega328P's 1 KB EEPROM, so a device can record while no serial
+host is attached and be read out later.
+
+1. **Blocks**: The EEPROM is split into `EELOG_BLOCKS` blocks of 32 bytes, used as a ring. Each block holds samples of one channel (for
+example 0 for distance, 1 for light):
+
+	| Offset | Size | Field                                                      |
+	|--------|------|------------------------------------------------------------|
+	| 0      | 2    | Sequence number, one higher for every block written        |
+	| 2      | 1    | Channel                                                    |
+	| 3      | 1    | Number of samples in the block                             |
+	| 4      | 2    | First sample                                               |
+	| 6      | 25   | The other samples, delta encoded, padded with 0xFF         |
+	| 31     | 1    | CRC-8 (Dallas/Maxim) of bytes 0-30                         |
+
+All fields are little-endian. A sample is stored as its difference from the one before in one signed byte, or, if that does not fit in
+-127 ... 127, as the escape byte 0x80 and the whole value in 2 bytes. Slowly changing readings take 1 byte each, so a block holds up to 26
+samples and the EEPROM up to 832 (26 per 32 bytes), against 512 as plain 16-bit values.
+
+2. **Wear Leveling**: Blocks are written in turn all the way round the ring, and there is no fixed header or pointer that is rewritten
+every time, so every byte wears at the same rate: one erase/write per trip round the ring, 32 blocks. At the rated 100,000 cycles that is
+3.2 million blocks. `eelog_init()` finds where to carry on by looking for the valid block with the highest sequence number. A block cut
+short by a power loss fails its CRC and is skipped.
+
+3. **Batching**: `eelog_add()` only appends to a block in RAM, one per channel. A full block (or one closed by `eelog_flush()`) is
+written byte by byte from the `EE_READY_vect` interrupt, so the sampling code never waits the 3.4 ms each EEPROM byte takes. Bytes that
+already hold the right value are skipped, and a byte that only needs bits cleared (or only set) uses the 1.8 ms write-only (erase-only)
+operation. A whole block takes at most 109 ms, which is about 290 bytes/s, or 240 delta encoded samples/s. While another block is still
+being written, a channel whose block is full drops new samples and counts them.
+
+4. **Reading**: `eelog_dump_line()` formats one block as a text line, `EE <address> <64 hex digits>`, which the sketches send over the
+UART when asked; `tools/eelog_decode.py` turns the lines (or a raw EEPROM image) back into samples.
+*/
+
+#ifndef EELOG_H_
+#define EELOG_H_
+
+#include <stdint.h>
+
+#ifndef EELOG_CHANNELS
+#define EELOG_CHANNELS 2
+#endif
+
+#define EELOG_BLOCK_SIZE 32
+#define EELOG_BLOCKS 32 // The whole 1 KB EEPROM
+#define EELOG_LINE_SIZE 74 // eelog_dump_line text with the newline and the terminating 0
+
+uint8_t eelog_init(void);
+uint8_t eelog_add(uint8_t channel, uint16_t value);
+void eelog_flush(void);
+uint8_t eelog_busy(void);
+uint16_t eelog_dropped(void);
+void eelog_dump_line(uint8_t block, char *line);
+
+#endif /* EELOG_H_ */
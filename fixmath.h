@@ -0,0 +1,70 @@
+/*
+The `fixmath.h` file is a small integer math library shared by the sketches, so none of them needs the AVR soft-float routines.
+
+1. **Q16 Constants**: `FIX_Q16(c)` turns a constant such as `0.034/2` into a 16.16 fixed point multiplier. The conversion happens while
+compiling, so only the integer ends up in flash. `fix_mul_q16(x, FIX_Q16(c))` then computes `x * c` with one 32-bit multiply and a shift.
+Keep `x * FIX_Q16(c)` below 2^32.
+
+2. **Division by Constants**: `FIX_DIV16(x, d)` divides a 16-bit `x` by the constant `d` with a multiply and shifts instead of a ~200
+cycle division, and the quotient is exact for every `x`. The multiplier is m = ceil(2^(16 + k) / d) with k = ceil(log2(d)), which always
+lies between 2^16 and 2^17, so `FIX_RECIP16(d)` keeps only its low 16 bits and `fix_div_recip16()` adds the missing `x * 2^16` back
+before the shift by k (`FIX_RECIP16_SHIFT(d)`); the sum stays below 2^17. Since m * d exceeds 2^(16 + k) by less than d <= 2^k, the
+error never reaches the next integer (Granlund and Montgomery, 1994).
+
+3. **Scaling and Mapping**: `fix_scale_u16()` computes `x * num / den` with a 32-bit intermediate, so it can't overflow. `fix_map()` is the
+Arduino style map with 32-bit intermediates and works with inverted ranges (in_min > in_max or out_min > out_max). `fix_map_clamp()` also
+limits the result to the output range.
+
+4. **Tables**: The lookup tables in `fixmath_tables.h` are generated by `tools/gen_tables.py`.
+
+5. **Float Check**: `tools/check_nofloat.sh` fails if a firmware image links `__mulsf3` or `__divsf3`.
+*/
+
+#ifndef FIXMATH_H_
+#define FIXMATH_H_
+
+#include <stdint.h>
+#include "fixmath_tables.h"
+
+#define FIX_Q16(c) ((uint32_t)((c) * 65536.0 + 0.5)) // Constant c as 16.16, folded by the compiler
+// ceil(log2(d)) for a constant d from 1 to 65535
+#define FIX_RECIP16_SHIFT(d) \
+	((d) > 32768 ? 16 : (d) > 16384 ? 15 : (d) > 8192 ? 14 : (d) > 4096 ? 13 : (d) > 2048 ? 12 : (d) > 1024 ? 11 : (d) > 512 ? 10 : \
+	(d) > 256 ? 9 : (d) > 128 ? 8 : (d) > 64 ? 7 : (d) > 32 ? 6 : (d) > 16 ? 5 : (d) > 8 ? 4 : (d) > 4 ? 3 : (d) > 2 ? 2 : (d) > 1 ? 1 : 0)
+// ceil(2^(16 + k) / d) - 2^16, the multiplier without its top bit
+#define FIX_RECIP16(d) ((uint16_t)((((uint64_t)1 << (16 + FIX_RECIP16_SHIFT(d))) + (d) - 1) / (d) - 65536UL))
+#define FIX_DIV16(x, d) fix_div_recip16((x), FIX_RECIP16(d), FIX_RECIP16_SHIFT(d))
+
+// x * q / 2^16, for a multiplier made with FIX_Q16
+static inline uint16_t fix_mul_q16(uint16_t x, uint32_t q) {
+	return (uint16_t)(((uint32_t)x * q) >> 16);
+}
+
+// x / d for a constant d, with the multiplier and shift from FIX_RECIP16(d) and FIX_RECIP16_SHIFT(d)
+static inline uint16_t fix_div_recip16(uint16_t x, uint16_t recip, uint8_t shift) {
+	return (uint16_t)((x + (((uint32_t)x * recip) >> 16)) >> shift);
+}
+
+// x * num / den without overflowing the intermediate product
+static inline uint16_t fix_scale_u16(uint16_t x, uint16_t num, uint16_t den) {
+	return (uint16_t)(((uint32_t)x * num) / den);
+}
+
+// Maps x from [in_min, in_max] to [out_min, out_max]; either range may be inverted
+static inline int16_t fix_map(int16_t x, int16_t in_min, int16_t in_max, int16_t out_min, int16_t out_max) {
+	return (int16_t)(((int32_t)x - in_min) * ((int32_t)out_max - out_min) / ((int32_t)in_max - in_min) + out_min);
+}
+
+// fix_map, limited to the output range
+static inline int16_t fix_map_clamp(int16_t x, int16_t in_min, int16_t in_max, int16_t out_min, int16_t out_max) {
+	int16_t lo = in_min < in_max ? in_min : in_max;
+	int16_t hi = in_min < in_max ? in_max : in_min;
+
+	if (x < lo)
+	x = lo;
+	else if (x > hi)
+	x = hi;
+	return fix_map(x, in_min, in_max, out_min, out_max);
+}
+
+#endif /* FIXMATH_H_ */
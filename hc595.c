@@ -0,0 +1,105 @@
+/*
+The `hc595.c` file contains the definitions of the functions declared in the `hc595.h` file.
+
+1. **Order**: The first byte shifted in ends up in the last chip of the chain, so a frame is sent from its last byte to its first. MSB
+first (`DORD` = 0) puts bit 7 on QH.
+
+2. **Chaining**: `hc595_show()` writes the first byte to `SPDR` and every `SPI_STC_vect` writes the next one; `left` counts the bytes
+still to go. The interrupt after the last byte raises and drops RCLK to latch the frame and clears `busy`.
+
+3. **Waiting**: With interrupts off the ISR cannot run, so `hc595_wait()` does its work when `SPIF` is set, the way `twi_wait()` does in
+`twi.c`. Reading `SPDR` clears `SPIF`, which the hardware otherwise does when it takes the interrupt.
+*/
+
+#include "hc595.h"
+#include "pindefines.h"
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+static uint8_t frames[2][HC595_BYTES];
+static uint8_t back = 0; // Buffer being built by the program
+static const uint8_t *volatile sending; // Buffer being shifted out
+static volatile uint8_t left = 0;
+static volatile uint8_t busy = 0;
+
+// Sends the next byte, or latches the frame after the last one
+static void hc595_step(void) {
+	if (left) {
+		left--;
+		SPDR = sending[left];
+	} else {
+		SPI_SS_PORT |= (1 << SPI_SS); // Rising edge of RCLK
+		SPI_SS_PORT &= ~(1 << SPI_SS);
+		busy = 0;
+	}
+}
+
+// Lets the transfer move on while the caller waits
+static void hc595_wait(void) {
+	if (!(SREG & (1 << SREG_I)) && (SPSR & (1 << SPIF))) {
+		(void)SPDR;
+		hc595_step();
+	}
+}
+
+void hc595_init(void) {
+	SPI_SS_PORT &= ~(1 << SPI_SS);
+	SPI_SS_DDR |= (1 << SPI_SS);
+	SPI_MOSI_DDR |= (1 << SPI_MOSI);
+	SPI_SCK_DDR |= (1 << SPI_SCK);
+	SPCR = (1 << SPIE) | (1 << SPE) | (1 << MSTR); // Mode 0, MSB first
+	SPSR = (1 << SPI2X); // F_CPU / 2
+	busy = 0;
+	hc595_clear();
+	hc595_show(); // The outputs come up random at power on
+}
+
+uint8_t *hc595_frame(void) {
+	return frames[back];
+}
+
+// Sets output `output` (8 * chip + bit) of the frame being built
+void hc595_set(uint8_t output, uint8_t on) {
+	if (output / 8 >= HC595_BYTES)
+	return;
+	if (on)
+	frames[back][output / 8] |= (1 << (output & 7));
+	else
+	frames[back][output / 8] &= ~(1 << (output & 7));
+}
+
+void hc595_clear(void) {
+	uint8_t i;
+
+	for (i = 0; i < HC595_BYTES; i++)
+	frames[back][i] = 0;
+}
+
+// Starts sending the frame being built and carries on in a copy of it
+void hc595_show(void) {
+	uint8_t i;
+
+	hc595_flush();
+	sending = frames[back];
+	left = HC595_BYTES - 1;
+	busy = 1;
+	SPDR = sending[left];
+	back ^= 1;
+	for (i = 0; i < HC595_BYTES; i++)
+	frames[back][i] = sending[i];
+}
+
+// Returns 1 while a frame is being sent
+uint8_t hc595_busy(void) {
+	return busy;
+}
+
+// Waits until the last frame has been latched
+void hc595_flush(void) {
+	while (busy)
+	hc595_wait();
+}
+
+ISR(SPI_STC_vect) {
+	hc595_step();
+}
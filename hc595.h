@@ -0,0 +1,42 @@
+/*
+The `hc595.h` file declares a driver for a daisy chain of 74HC595 shift registers on the hardware SPI pins in `pindefines.h`, which gives
+8 outputs per chip for LEDs while using only three pins: MOSI (PB3) to SER of the first chip, SCK (PB5) to SRCLK of every chip, and SS
+(PB2) to RCLK of every chip. QH' of each chip goes to SER of the next one, OE is tied low and SRCLR high.
+
+1. **Frames**: A frame is `HC595_BYTES` bytes, one per chip, and byte i bit b is output Qb of chip i, counting chip 0 as the one wired to
+MOSI. The default of 4 chips gives 32 outputs.
+
+2. **Double Buffering**: `hc595_frame()` gives the frame being built and `hc595_show()` sends it. The bytes are shifted out by
+`SPI_STC_vect`, one per interrupt, while the program builds the next frame in the other buffer, which starts as a copy of the frame just
+shown so single outputs can be changed with `hc595_set()`. When the last byte is out the ISR pulses RCLK, so all the outputs change at the
+same moment and a half sent frame never shows. `hc595_show()` only waits if the previous frame is still going out.
+
+3. **Speed**: SCK runs at F_CPU / 2, the fastest the SPI can go, which the 74HC595 handles easily. A byte then takes 16 CPU cycles on the
+bus and one short interrupt of CPU time, so a 32-output update costs a few microseconds at 16 MHz, compared with a whole GPIO port for
+every 8 LEDs.
+
+The SPI is taken over by the driver, and SS must stay an output for the SPI to stay in master mode, which it does as RCLK.
+*/
+
+#ifndef HC595_H_
+#define HC595_H_
+
+#include <stdint.h>
+
+#ifndef HC595_BYTES
+#define HC595_BYTES 4 // Chips in the chain
+#endif
+
+#if HC595_BYTES < 1 || HC595_BYTES > 255
+#error "HC595_BYTES must be between 1 and 255"
+#endif
+
+void hc595_init(void);
+uint8_t *hc595_frame(void);
+void hc595_set(uint8_t output, uint8_t on);
+void hc595_clear(void);
+void hc595_show(void);
+uint8_t hc595_busy(void);
+void hc595_flush(void);
+
+#endif /* HC595_H_ */
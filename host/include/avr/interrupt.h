@@ -0,0 +1,22 @@
+/*
+The host `avr/interrupt.h` turns `ISR()` into a plain function named after its vector, which `host/sim.c` calls when the interrupt is
+taken. After `sei()` a pending interrupt runs at the next register access or function call, the way the chip runs one more instruction
+first, so `sei(); sleep_cpu();` sleeps until that interrupt instead of missing it.
+*/
+
+#ifndef HOST_AVR_INTERRUPT_H_
+#define HOST_AVR_INTERRUPT_H_
+
+#include <avr/io.h>
+
+#define sei() sim_sei()
+#define cli() sim_cli()
+
+#define ISR_BLOCK
+#define ISR_NOBLOCK
+#define ISR_NAKED
+#define ISR(vector, ...) void vector(void); void vector(void)
+#define EMPTY_INTERRUPT(vector) void vector(void); void vector(void) {}
+#define reti() return
+
+#endif /* HOST_AVR_INTERRUPT_H_ */
@@ -0,0 +1,25 @@
+/*
+The host `avr/sleep.h` has the avr-libc sleep macros. `sleep_cpu()` lets the model run until an interrupt has been taken, so the time a
+sketch spends asleep passes in a single call. The model does not stop any clocks in the deeper modes.
+*/
+
+#ifndef HOST_AVR_SLEEP_H_
+#define HOST_AVR_SLEEP_H_
+
+#include <avr/io.h>
+
+#define SLEEP_MODE_IDLE (0 << 1)
+#define SLEEP_MODE_ADC (1 << 1)
+#define SLEEP_MODE_PWR_DOWN (2 << 1)
+#define SLEEP_MODE_PWR_SAVE (3 << 1)
+#define SLEEP_MODE_STANDBY (6 << 1)
+#define SLEEP_MODE_EXT_STANDBY (7 << 1)
+
+#define set_sleep_mode(mode) (SMCR = (SMCR & ~((1 << SM0) | (1 << SM1) | (1 << SM2))) | (mode))
+#define sleep_enable() (SMCR |= (1 << SE))
+#define sleep_disable() (SMCR &= ~(1 << SE))
+#define sleep_cpu() sim_sleep()
+#define sleep_mode() do { sleep_enable(); sleep_cpu(); sleep_disable(); } while (0)
+#define sleep_bod_disable() do { } while (0)
+
+#endif /* HOST_AVR_SLEEP_H_ */
@@ -0,0 +1,15 @@
+/*
+The host `stdlib.h` adds the avr-libc number to string functions that glibc does not have. They are defined in `host/libc.c`.
+*/
+
+#ifndef HOST_STDLIB_H_
+#define HOST_STDLIB_H_
+
+#include_next <stdlib.h>
+
+char *itoa(int value, char *s, int radix);
+char *utoa(unsigned int value, char *s, int radix);
+char *ltoa(long value, char *s, int radix);
+char *ultoa(unsigned long value, char *s, int radix);
+
+#endif /* HOST_STDLIB_H_ */
@@ -0,0 +1,47 @@
+/*
+The host `util/atomic.h` works like the avr-libc one: the block runs with interrupts off and SREG is put back when it is left, however it
+is left. Putting back the I flag lets a pending interrupt run at once.
+*/
+
+#ifndef HOST_UTIL_ATOMIC_H_
+#define HOST_UTIL_ATOMIC_H_
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+static inline uint8_t __iCliRetVal(void) {
+	cli();
+	return 1;
+}
+
+static inline uint8_t __iSeiRetVal(void) {
+	sei();
+	return 1;
+}
+
+static inline void __iRestore(const uint8_t *sreg) {
+	if (*sreg & (1 << SREG_I))
+	sei();
+	else
+	cli();
+}
+
+static inline void __iSeiParam(const uint8_t *unused) {
+	(void)unused;
+	sei();
+}
+
+static inline void __iCliParam(const uint8_t *unused) {
+	(void)unused;
+	cli();
+}
+
+#define ATOMIC_BLOCK(type) for (type, __ToDo = __iCliRetVal(); __ToDo; __ToDo = 0)
+#define NONATOMIC_BLOCK(type) for (type, __ToDo = __iSeiRetVal(); __ToDo; __ToDo = 0)
+
+#define ATOMIC_RESTORESTATE uint8_t sreg_save __attribute__((__cleanup__(__iRestore))) = SREG
+#define ATOMIC_FORCEON uint8_t sreg_save __attribute__((__cleanup__(__iSeiParam))) = 0
+#define NONATOMIC_RESTORESTATE uint8_t sreg_save __attribute__((__cleanup__(__iRestore))) = SREG
+#define NONATOMIC_FORCEOFF uint8_t sreg_save __attribute__((__cleanup__(__iCliParam))) = 0
+
+#endif /* HOST_UTIL_ATOMIC_H_ */
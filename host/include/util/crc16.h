@@ -0,0 +1,48 @@
+/*
+The host `util/crc16.h` has the same CRC update functions as the avr-libc header, written in C instead of inline assembly. They give the
+same results, so a checksum computed by a sketch on the host matches the one the chip sends.
+*/
+
+#ifndef HOST_UTIL_CRC16_H_
+#define HOST_UTIL_CRC16_H_
+
+#include <stdint.h>
+
+// CRC-16 (IBM), polynomial 0xA001 (reflected 0x8005)
+static inline uint16_t _crc16_update(uint16_t crc, uint8_t data) {
+	uint8_t i;
+
+	crc ^= data;
+	for (i = 0; i < 8; i++)
+	crc = (crc & 1) ? (crc >> 1) ^ 0xA001 : crc >> 1;
+	return crc;
+}
+
+// CRC-XMODEM, polynomial 0x1021, most significant bit first
+static inline uint16_t _crc_xmodem_update(uint16_t crc, uint8_t data) {
+	uint8_t i;
+
+	crc ^= (uint16_t)data << 8;
+	for (i = 0; i < 8; i++)
+	crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+	return crc;
+}
+
+// CRC-CCITT as used by PPP and IrDA, polynomial 0x8408 (reflected 0x1021)
+static inline uint16_t _crc_ccitt_update(uint16_t crc, uint8_t data) {
+	data ^= crc & 0xFF;
+	data ^= data << 4;
+	return ((((uint16_t)data << 8) | (crc >> 8)) ^ (uint8_t)(data >> 4) ^ ((uint16_t)data << 3));
+}
+
+// Dallas/Maxim 1-Wire CRC-8, polynomial 0x8C (reflected 0x31)
+static inline uint8_t _crc_ibutton_update(uint8_t crc, uint8_t data) {
+	uint8_t i;
+
+	crc ^= data;
+	for (i = 0; i < 8; i++)
+	crc = (crc & 1) ? (crc >> 1) ^ 0x8C : crc >> 1;
+	return crc;
+}
+
+#endif /* HOST_UTIL_CRC16_H_ */
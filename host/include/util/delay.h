@@ -0,0 +1,25 @@
+/*
+The host `util/delay.h` moves the virtual clock forward by the length of the delay instead of spinning, so timers and ISRs run while a
+sketch waits.
+*/
+
+#ifndef HOST_UTIL_DELAY_H_
+#define HOST_UTIL_DELAY_H_
+
+#include <stdint.h>
+#include "../../sim.h"
+
+#ifndef F_CPU
+#warning "F_CPU not defined for <util/delay.h>"
+#define F_CPU 1000000UL
+#endif
+
+static inline void _delay_us(double us) {
+	sim_delay_cycles((uint64_t)(us * (F_CPU / 1e6) + 0.5));
+}
+
+static inline void _delay_ms(double ms) {
+	sim_delay_cycles((uint64_t)(ms * (F_CPU / 1e3) + 0.5));
+}
+
+#endif /* HOST_UTIL_DELAY_H_ */
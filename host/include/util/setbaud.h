@@ -0,0 +1,37 @@
+/*
+The host `util/setbaud.h` works out `UBRR_VALUE` and `USE_2X` from F_CPU and BAUD the same way as the avr-libc header, so the UART timing
+in the model matches the chip.
+*/
+
+#ifndef F_CPU
+#error "setbaud.h requires F_CPU to be defined"
+#endif
+#ifndef BAUD
+#error "setbaud.h requires BAUD to be defined"
+#endif
+#ifndef BAUD_TOL
+#define BAUD_TOL 2
+#endif
+
+#undef USE_2X
+#undef UBRR_VALUE
+#undef UBRRL_VALUE
+#undef UBRRH_VALUE
+
+#define UBRR_VALUE (((F_CPU) + 8UL * (BAUD)) / (16UL * (BAUD)) - 1UL)
+
+#if 100 * (F_CPU) > (16 * ((UBRR_VALUE) + 1)) * (100 * (BAUD) + (BAUD) * (BAUD_TOL))
+#define USE_2X 1
+#elif 100 * (F_CPU) < (16 * ((UBRR_VALUE) + 1)) * (100 * (BAUD) - (BAUD) * (BAUD_TOL))
+#define USE_2X 1
+#else
+#define USE_2X 0
+#endif
+
+#if USE_2X
+#undef UBRR_VALUE
+#define UBRR_VALUE (((F_CPU) + 4UL * (BAUD)) / (8UL * (BAUD)) - 1UL)
+#endif
+
+#define UBRRL_VALUE (UBRR_VALUE & 0xff)
+#define UBRRH_VALUE (UBRR_VALUE >> 8)
@@ -0,0 +1,40 @@
+/*
+The `libc.c` file has the avr-libc functions that the sketches use but glibc does not provide.
+*/
+
+#include <stdlib.h>
+
+char *ultoa(unsigned long value, char *s, int radix) {
+	char *p = s, *q, t;
+
+	do {
+		*p++ = "0123456789abcdefghijklmnopqrstuvwxyz"[value % radix];
+		value /= radix;
+	} while (value);
+	*p = 0;
+	for (q = s, p--; q < p; q++, p--) { // The digits came out backwards
+		t = *q;
+		*q = *p;
+		*p = t;
+	}
+	return s;
+}
+
+char *ltoa(long value, char *s, int radix) {
+	if (value < 0 && radix == 10) {
+		*s = '-';
+		ultoa(-(unsigned long)value, s + 1, radix);
+		return s;
+	}
+	return ultoa((unsigned long)value, s, radix);
+}
+
+char *utoa(unsigned int value, char *s, int radix) {
+	return ultoa(value, s, radix);
+}
+
+char *itoa(int value, char *s, int radix) {
+	if (radix != 10)
+	return ultoa((unsigned int)value, s, radix);
+	return ltoa(value, s, radix);
+}
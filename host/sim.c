@@ -0,0 +1,941 @@
+/*
+The `sim.c` file contains the definitions of the functions declared in the `sim.h` file.
+
+1. **Register Access**: `io` is the I/O space and `strobe` holds the strobe registers (see `include/avr/io.h`). Every access first
+settles the previous one with `commit()`, which compares the register with the copy taken when it was handed out and runs the side effects
+of a write. Only then does the clock move, so a write is never lost under a change made by the model.
+
+2. **Ticks**: `tick()` is one CPU cycle. The timers count on cycles that are a multiple of their prescaler, which is how the shared
+prescaler of the chip behaves too. After the peripherals, `dispatch()` takes the highest priority pending interrupt if I is set.
+
+3. **Vectors**: The `__vector_N` functions are weak, so a vector that no sketch file defines is a null pointer. Taking one stops the
+program, the way the default handler would reset the chip.
+*/
+
+#include "sim.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef F_CPU
+#define F_CPU 16000000UL
+#endif
+
+// Data addresses of the registers the model works with
+enum {
+	A_PINB = 0x23, A_DDRB = 0x24, A_PORTB = 0x25,
+	A_TIFR0 = 0x35, A_TIFR1 = 0x36, A_TIFR2 = 0x37, A_PCIFR = 0x3B, A_EIFR = 0x3C, A_EIMSK = 0x3D,
+	A_EECR = 0x3F, A_EEDR = 0x40, A_EEAR = 0x41,
+	A_TCCR0A = 0x44, A_TCCR0B = 0x45, A_TCNT0 = 0x46, A_OCR0A = 0x47, A_OCR0B = 0x48,
+	A_SPCR = 0x4C, A_SPSR = 0x4D, A_SPDR = 0x4E, A_ACSR = 0x50, A_SREG = 0x5F, A_WDTCSR = 0x60,
+	A_PCICR = 0x68, A_EICRA = 0x69, A_PCMSK0 = 0x6B, A_TIMSK0 = 0x6E, A_TIMSK1 = 0x6F, A_TIMSK2 = 0x70,
+	A_ADCL = 0x78, A_ADCH = 0x79, A_ADCSRA = 0x7A, A_ADCSRB = 0x7B, A_ADMUX = 0x7C,
+	A_TCCR1A = 0x80, A_TCCR1B = 0x81, A_TCNT1 = 0x84, A_ICR1 = 0x86, A_OCR1A = 0x88, A_OCR1B = 0x8A,
+	A_TCCR2A = 0xB0, A_TCCR2B = 0xB1, A_TCNT2 = 0xB2, A_OCR2A = 0xB3, A_OCR2B = 0xB4,
+	A_TWBR = 0xB8, A_TWSR = 0xB9, A_TWDR = 0xBB, A_TWCR = 0xBC, A_UCSR0A = 0xC0, A_UCSR0B = 0xC1, A_UBRR0 = 0xC4, A_UDR0 = 0xC6
+};
+
+#define STROBE_IDLE 0x100 // High byte of an unwritten strobe slot; any write from the sketch changes it
+#define SREG_I 0x80
+#define VECTORS 26
+#define ISR_CYCLES 4 // Cycles to enter or leave an ISR
+#define CALL_CYCLES 4 // Cycles charged for each function call
+#define RX_QUEUE 64
+#define EEPROM_SIZE 1024
+#define EEMPE_CYCLES 4 // EEPE must be set this soon after EEMPE
+#define TX_CAPTURE 4096
+#define EVENTS 16
+
+volatile uint64_t sim_cycles = 0;
+
+static uint8_t io[SIM_IO_SIZE] __attribute__((aligned(2)));
+static uint16_t strobe[SIM_IO_SIZE];
+
+static uint16_t pending_address = 0; // Register handed out by the last access, 0 for none
+static uint8_t pending_kind = 0;
+static uint16_t pending_before;
+enum { KIND_NONE, KIND_8, KIND_16, KIND_STROBE };
+
+static uint64_t limit = 0;
+static const char *bench = 0; // SIM_BENCH: sketch name of the statistics printed at the end
+static uint32_t isr_count = 0; // Interrupts taken, so sim_sleep can tell when one woke it
+static uint64_t slept = 0;
+static uint8_t trace = 0;
+static uint32_t forced = 0;
+
+static uint8_t pins[3];
+static uint8_t driven[3];
+static uint8_t level[3];
+static void (*watcher)(uint8_t port, uint8_t before, uint8_t after) = 0;
+
+static uint16_t adc_value[8];
+static uint16_t (*adc_source)(uint8_t channel) = 0;
+static uint32_t adc_left = 0;
+
+static uint8_t uart_echo = 1;
+static uint8_t tx_shift, tx_next, tx_next_full = 0;
+static uint32_t tx_left = 0;
+static uint8_t tx_capture[TX_CAPTURE];
+static size_t tx_count = 0;
+static uint8_t rx_queue[RX_QUEUE];
+static uint8_t rx_head = 0, rx_tail = 0;
+static uint32_t rx_left = 0;
+
+static uint8_t eeprom[EEPROM_SIZE];
+static uint8_t eempe_left = 0;
+static uint32_t ee_left = 0; // Cycles until the EEPROM write in progress ends
+static uint16_t ee_address;
+static uint8_t ee_data, ee_mode;
+static const char *ee_file = 0;
+
+static uint8_t (*twi_device)(uint8_t event, uint8_t data) = 0;
+static uint32_t twi_left = 0; // Cycles until the TWI action in progress ends
+static uint8_t twi_action; // TWCR value that started it
+static uint8_t twi_owned = 0; // 1 between a START and a STOP
+static uint8_t twi_address_next = 0; // 1 when the next byte is SLA+R/W
+static uint8_t twi_reading = 0; // 1 after SLA+R was acknowledged
+
+static uint8_t (*spi_device)(uint8_t data) = 0;
+static uint32_t spi_left = 0; // Cycles until the SPI byte in progress is shifted out
+static uint8_t spi_out;
+
+static struct {
+	uint32_t count;
+	uint64_t total, max;
+} isr_stats[VECTORS]; // Cycles from taking each vector to its reti
+static uint32_t tx_bytes = 0;
+static uint64_t tx_first, tx_last; // Cycles of the first and the last byte written to UDR0
+
+static const char *const vector_names[VECTORS] = {
+	0, "INT0", "INT1", "PCINT0", "PCINT1", "PCINT2", "WDT", "TIMER2_COMPA", "TIMER2_COMPB", "TIMER2_OVF", "TIMER1_CAPT", "TIMER1_COMPA",
+	"TIMER1_COMPB", "TIMER1_OVF", "TIMER0_COMPA", "TIMER0_COMPB", "TIMER0_OVF", "SPI_STC", "USART_RX", "USART_UDRE", "USART_TX", "ADC",
+	"EE_READY", "ANALOG_COMP", "TWI", "SPM_READY"
+};
+
+static struct {
+	uint64_t cycle;
+	void (*fn)(void *arg);
+	void *arg;
+} events[EVENTS];
+static uint8_t event_count = 0;
+static uint8_t in_device = 0; // 1 while a watcher or an event runs, which must not move the clock
+
+// Weak vectors, defined by the sketch with ISR()
+#define VECTOR(n) void __vector_##n(void) __attribute__((weak));
+VECTOR(1) VECTOR(2) VECTOR(3) VECTOR(4) VECTOR(5) VECTOR(6) VECTOR(7) VECTOR(8) VECTOR(9) VECTOR(10) VECTOR(11) VECTOR(12)
+VECTOR(13) VECTOR(14) VECTOR(15) VECTOR(16) VECTOR(17) VECTOR(18) VECTOR(19) VECTOR(20) VECTOR(21) VECTOR(22) VECTOR(23)
+VECTOR(24) VECTOR(25)
+
+static void (*const vectors[VECTORS])(void) = {
+	0, __vector_1, __vector_2, __vector_3, __vector_4, __vector_5, __vector_6, __vector_7, __vector_8, __vector_9, __vector_10,
+	__vector_11, __vector_12, __vector_13, __vector_14, __vector_15, __vector_16, __vector_17, __vector_18, __vector_19,
+	__vector_20, __vector_21, __vector_22, __vector_23, __vector_24, __vector_25
+};
+
+static void step(uint64_t cycles);
+
+static uint16_t rd16(uint16_t address) {
+	return io[address] | (io[address + 1] << 8);
+}
+
+static void wr16(uint16_t address, uint16_t value) {
+	io[address] = value;
+	io[address + 1] = value >> 8;
+}
+
+#define FLAGS(address) ((uint8_t)strobe[address])
+#define SET_FLAG(address, bit) (strobe[address] |= (1 << (bit)))
+#define CLEAR_FLAG(address, bit) (strobe[address] &= ~(1 << (bit)))
+
+// ---- Register access ----
+
+static void uart_write(uint8_t byte) {
+	uint16_t bit_cycles = ((io[A_UCSR0A] & (1 << 1)) ? 8 : 16) * (rd16(A_UBRR0) + 1);
+
+	if (!(io[A_UCSR0B] & (1 << 3))) // TXEN0
+	return;
+	if (!tx_bytes++)
+	tx_first = sim_cycles;
+	tx_last = sim_cycles;
+	if (!tx_left) {
+		tx_shift = byte;
+		tx_left = 10UL * bit_cycles;
+		io[A_UCSR0A] &= ~(1 << 6); // TXC0
+	} else if (!tx_next_full) {
+		tx_next = byte;
+		tx_next_full = 1;
+		io[A_UCSR0A] &= ~(1 << 5); // UDRE0
+	}
+}
+
+// SCK of F_CPU / 4, 16, 64 or 128, twice as fast with SPI2X; a byte is 8 SCK periods
+static void spi_write(uint8_t byte) {
+	static const uint8_t div[4] = {4, 16, 64, 128};
+
+	io[A_SPSR] &= ~(1 << 7); // Writing SPDR clears SPIF
+	if ((io[A_SPCR] & 0x50) != 0x50) // SPE and MSTR; only the master is modeled
+	return;
+	if (spi_left) {
+		io[A_SPSR] |= (1 << 6); // WCOL, the byte is lost
+		return;
+	}
+	spi_out = byte;
+	spi_left = 8UL * div[io[A_SPCR] & 3] / ((io[A_SPSR] & 1) ? 2 : 1);
+}
+
+static void adc_start(uint8_t first) {
+	uint8_t div = 1 << (io[A_ADCSRA] & 7);
+
+	if (div == 1)
+	div = 2;
+	adc_left = (first ? 25UL : 13UL) * div;
+}
+
+static void eeprom_control(uint8_t before, uint8_t after) {
+	if (ee_left) // Writing 0 to EEPE does not stop a write
+	io[A_EECR] |= (1 << 1);
+	if (after & (1 << 0)) { // EERE reads at once, unless a write is in progress
+		io[A_EECR] &= ~(1 << 0);
+		if (!ee_left)
+		io[A_EEDR] = eeprom[rd16(A_EEAR) & (EEPROM_SIZE - 1)];
+	}
+	if ((after & (1 << 2)) && !(before & (1 << 2)))
+	eempe_left = EEMPE_CYCLES;
+	if ((after & (1 << 1)) && !(before & (1 << 1))) {
+		if (!eempe_left || ee_left) { // EEPE without EEMPE does nothing
+			io[A_EECR] &= ~(1 << 1);
+			return;
+		}
+		ee_address = rd16(A_EEAR) & (EEPROM_SIZE - 1);
+		ee_data = io[A_EEDR];
+		ee_mode = (after >> 4) & 3;
+		ee_left = (ee_mode ? 18UL : 34UL) * (F_CPU / 10000); // 3.4 ms to erase and write, 1.8 ms for one of them
+		io[A_EECR] &= ~(1 << 2);
+		eempe_left = 0;
+	}
+}
+
+// SCL periods of 16 + 2 * TWBR * 4^TWPS cycles
+static uint32_t twi_period(void) {
+	return 16 + 2UL * io[A_TWBR] * (1 << (2 * (io[A_TWSR] & 3)));
+}
+
+static void twi_control(uint8_t value) {
+	twi_action = value;
+	if (value & (1 << 4)) // A STOP (and a START after it) takes about two SCL periods
+	twi_left = 2 * twi_period();
+	else if (value & (1 << 5))
+	twi_left = twi_period();
+	else
+	twi_left = 9 * twi_period(); // 8 data bits and the acknowledge
+}
+
+static void write8(uint16_t address, uint8_t before, uint8_t after) {
+	switch (address) {
+		case A_EECR:
+		eeprom_control(before, after);
+		break;
+		case A_ADCSRA:
+		if (after & (1 << 4)) // Writing 1 to ADIF clears it
+		io[A_ADCSRA] &= ~(1 << 4);
+		if (!(after & (1 << 7))) { // ADEN off stops the ADC
+			adc_left = 0;
+			io[A_ADCSRA] &= ~(1 << 6);
+		} else if ((after & (1 << 6)) && !(before & (1 << 6)) && !adc_left)
+		adc_start(!(before & (1 << 7)));
+		break;
+	}
+}
+
+static void write_strobe(uint16_t address, uint8_t before, uint8_t value) {
+	switch (address) {
+		case A_TIFR0:
+		case A_TIFR1:
+		case A_TIFR2:
+		case A_PCIFR:
+		case A_EIFR:
+		strobe[address] = STROBE_IDLE | (before & ~value); // Writing 1 clears a flag
+		break;
+		case A_UDR0:
+		strobe[address] = STROBE_IDLE | before; // Keeps the received byte for the next read
+		uart_write(value);
+		break;
+		case A_PINB:
+		case A_PINB + 3:
+		case A_PINB + 6:
+		strobe[address] = STROBE_IDLE | before; // Writing 1 to a PINx bit toggles PORTx
+		io[address + 2] ^= value;
+		break;
+		case A_SPDR:
+		strobe[address] = STROBE_IDLE | before; // Reads give the byte received last
+		spi_write(value);
+		break;
+		case A_TWCR:
+		strobe[address] = STROBE_IDLE | (value & 0x7F) | (before & ~value & 0x80); // Writing 1 to TWINT clears it
+		if ((value & 0x80) && (value & 0x04)) // TWINT and TWEN start the next action
+		twi_control(value);
+		break;
+		default:
+		strobe[address] = STROBE_IDLE | value;
+		break;
+	}
+}
+
+static void read_strobe(uint16_t address) {
+	if (address == A_SPDR)
+	io[A_SPSR] &= ~(1 << 7); // Reading SPDR clears SPIF
+	if (address == A_UDR0 && (io[A_UCSR0A] & (1 << 7))) {
+		io[A_UCSR0A] &= ~(1 << 7); // Reading UDR0 clears RXC0
+		if (rx_head != rx_tail && !rx_left)
+		rx_left = 10UL * 16 * (rd16(A_UBRR0) + 1);
+	}
+}
+
+// Settles the last access: runs the side effects if the sketch wrote the register
+static void commit(void) {
+	uint16_t address = pending_address;
+	uint8_t kind = pending_kind;
+
+	if (kind == KIND_NONE)
+	return;
+	pending_kind = KIND_NONE;
+	if (kind == KIND_8) {
+		if (io[address] != pending_before)
+		write8(address, pending_before, io[address]);
+	} else if (kind == KIND_STROBE) {
+		if ((strobe[address] & 0xFF00) != STROBE_IDLE) // A negative char written to UDR0 sets the high byte to 0xFF
+		write_strobe(address, pending_before, strobe[address]);
+		else
+		read_strobe(address);
+	}
+}
+
+volatile uint8_t *sim_io8(uint16_t address) {
+	step(1);
+	pending_address = address;
+	pending_kind = KIND_8;
+	pending_before = io[address];
+	return &io[address];
+}
+
+volatile uint16_t *sim_io16(uint16_t address) {
+	step(1);
+	pending_address = address;
+	pending_kind = KIND_16;
+	pending_before = rd16(address);
+	return (volatile uint16_t *)&io[address];
+}
+
+volatile uint16_t *sim_strobe(uint16_t address) {
+	step(1);
+	pending_address = address;
+	pending_kind = KIND_STROBE;
+	pending_before = (uint8_t)strobe[address];
+	return &strobe[address];
+}
+
+// ---- Peripherals ----
+
+static void timer8(uint8_t tccra, uint8_t tccrb, uint8_t tcnt, uint8_t ocra, uint8_t ocrb, uint8_t tifr, const uint16_t *prescale) {
+	uint16_t div = prescale[io[tccrb] & 7];
+	uint8_t wgm = (io[tccra] & 3) | ((io[tccrb] >> 1) & 4);
+	uint8_t top, count;
+
+	if (!div || (sim_cycles & (div - 1)))
+	return;
+	top = (wgm == 2 || wgm == 5 || wgm == 7) ? io[ocra] : 0xFF;
+	count = io[tcnt];
+	// A compare flag is set on the timer clock after the match, the one that clears the counter in CTC mode (datasheet 15.9)
+	if (count == io[ocra])
+	SET_FLAG(tifr, 1);
+	if (count == io[ocrb])
+	SET_FLAG(tifr, 2);
+	if (count == top) {
+		count = 0;
+		if (wgm != 2 || top == 0xFF)
+		SET_FLAG(tifr, 0);
+	} else
+	count++;
+	io[tcnt] = count;
+}
+
+static void timer1(void) {
+	static const uint16_t prescale[8] = {0, 1, 8, 64, 256, 1024, 0, 0};
+	static const uint16_t fixed_top[16] = {0xFFFF, 0xFF, 0x1FF, 0x3FF, 0, 0xFF, 0x1FF, 0x3FF, 0, 0, 0, 0, 0, 0, 0, 0};
+	uint16_t div = prescale[io[A_TCCR1B] & 7];
+	uint8_t wgm = (io[A_TCCR1A] & 3) | ((io[A_TCCR1B] >> 1) & 0x0C);
+	uint16_t top, count;
+	uint8_t icr_top = (wgm == 8 || wgm == 10 || wgm == 12 || wgm == 14);
+
+	if (!div || (sim_cycles & (div - 1)))
+	return;
+	if (icr_top)
+	top = rd16(A_ICR1);
+	else if (wgm == 4 || wgm == 9 || wgm == 11 || wgm == 15)
+	top = rd16(A_OCR1A);
+	else
+	top = fixed_top[wgm];
+
+	count = rd16(A_TCNT1);
+	if (count == rd16(A_OCR1A)) // On the timer clock after the match, as for the 8-bit timers
+	SET_FLAG(A_TIFR1, 1);
+	if (count == rd16(A_OCR1B))
+	SET_FLAG(A_TIFR1, 2);
+	if (count == top) {
+		count = 0;
+		if ((wgm != 4 && wgm != 12) || top == 0xFFFF)
+		SET_FLAG(A_TIFR1, 0);
+		if (icr_top)
+		SET_FLAG(A_TIFR1, 5);
+	} else
+	count++;
+	wr16(A_TCNT1, count);
+}
+
+static void adc(void) {
+	uint8_t channel;
+	uint16_t value;
+
+	if (!adc_left || --adc_left)
+	return;
+	channel = io[A_ADMUX] & 0x0F;
+	if (channel < 8 && adc_source)
+	value = adc_source(channel) & 0x3FF;
+	else
+	value = channel < 8 ? adc_value[channel] : (channel == 14 ? 225 : 0); // ADC14 is the 1.1 V bandgap
+	if (io[A_ADMUX] & (1 << 5)) // ADLAR
+	value <<= 6;
+	wr16(A_ADCL, value);
+	io[A_ADCSRA] |= (1 << 4); // ADIF
+	if ((io[A_ADCSRA] & (1 << 5)) && (io[A_ADCSRB] & 7) == 0) // Free running
+	adc_start(0);
+	else
+	io[A_ADCSRA] &= ~(1 << 6);
+}
+
+static void eeprom_tick(void) {
+	if (eempe_left && !--eempe_left)
+	io[A_EECR] &= ~(1 << 2); // EEMPE clears itself
+	if (!ee_left || --ee_left)
+	return;
+	if (ee_mode == 0)
+	eeprom[ee_address] = ee_data;
+	else if (ee_mode == 1) // Erase only
+	eeprom[ee_address] = 0xFF;
+	else if (ee_mode == 2) // Write only, can only clear bits
+	eeprom[ee_address] &= ee_data;
+	io[A_EECR] &= ~(1 << 1);
+}
+
+// Ends the TWI action started by the last TWCR write, asking the device on the bus for its answer
+static void twi(void) {
+	uint8_t status, ack, byte;
+
+	if (!twi_left || --twi_left)
+	return;
+	if (twi_action & (1 << 4)) {
+		if (twi_owned && twi_device)
+		twi_device(SIM_TWI_STOP, 0);
+		twi_owned = 0;
+		strobe[A_TWCR] &= ~(1 << 4); // TWSTO clears itself
+		if (!(twi_action & (1 << 5)))
+		return;
+	}
+	if (twi_action & (1 << 5)) {
+		status = twi_owned ? 0x10 : 0x08;
+		twi_owned = 1;
+		twi_address_next = 1;
+		twi_reading = 0;
+		if (twi_device)
+		twi_device(SIM_TWI_START, 0);
+	} else if (twi_address_next) {
+		byte = io[A_TWDR];
+		ack = twi_device ? twi_device(SIM_TWI_WRITE, byte) : 0; // Nobody on the bus: NACK
+		twi_address_next = 0;
+		twi_reading = (byte & 1) && ack;
+		status = (byte & 1) ? (ack ? 0x40 : 0x48) : (ack ? 0x18 : 0x20);
+	} else if (twi_reading) {
+		ack = (twi_action >> 6) & 1; // TWEA
+		io[A_TWDR] = twi_device ? twi_device(SIM_TWI_READ, ack) : 0xFF;
+		status = ack ? 0x50 : 0x58;
+	} else {
+		ack = twi_device ? twi_device(SIM_TWI_WRITE, io[A_TWDR]) : 0;
+		status = ack ? 0x28 : 0x30;
+	}
+	io[A_TWSR] = status | (io[A_TWSR] & 3);
+	strobe[A_TWCR] |= 0x80; // TWINT
+}
+
+// Ends the SPI byte in progress; the device on the bus answers with the byte it shifts back on MISO
+static void spi(void) {
+	if (!spi_left || --spi_left)
+	return;
+	strobe[A_SPDR] = STROBE_IDLE | (spi_device ? spi_device(spi_out) : 0xFF);
+	io[A_SPSR] = (io[A_SPSR] & ~(1 << 6)) | (1 << 7); // SPIF
+}
+
+static void uart(void) {
+	if (tx_left && !--tx_left) {
+		if (uart_echo) {
+			putchar(tx_shift);
+			fflush(stdout);
+		}
+		if (tx_count < TX_CAPTURE)
+		tx_capture[tx_count++] = tx_shift;
+		if (tx_next_full) {
+			tx_next_full = 0;
+			io[A_UCSR0A] |= (1 << 5);
+			tx_shift = tx_next;
+			tx_left = 10UL * ((io[A_UCSR0A] & (1 << 1)) ? 8 : 16) * (rd16(A_UBRR0) + 1);
+		} else
+		io[A_UCSR0A] |= (1 << 6); // TXC0
+	}
+	if (rx_left && !--rx_left && rx_head != rx_tail && !(io[A_UCSR0A] & (1 << 7))) {
+		strobe[A_UDR0] = STROBE_IDLE | rx_queue[rx_tail];
+		rx_tail = (rx_tail + 1) % RX_QUEUE;
+		io[A_UCSR0A] |= (1 << 7); // RXC0
+	}
+}
+
+static void pin_edges(uint8_t port, uint8_t before, uint8_t after) {
+	uint8_t changed = before ^ after;
+	uint8_t bit, mode;
+
+	if (io[A_PCICR] & (1 << port) && (changed & io[A_PCMSK0 + port]))
+	SET_FLAG(A_PCIFR, port);
+
+	if (port == SIM_PORTD) {
+		for (bit = 0; bit < 2; bit++) { // INT0 on PD2, INT1 on PD3
+			if (!(changed & (4 << bit)))
+			continue;
+			mode = (io[A_EICRA] >> (2 * bit)) & 3;
+			if (mode == 1 || (mode == 2 && !(after & (4 << bit))) || (mode == 3 && (after & (4 << bit))))
+			SET_FLAG(A_EIFR, bit);
+		}
+	}
+
+	if (port == SIM_PORTB && (changed & 1)) { // ICP1 on PB0
+		uint8_t wgm = (io[A_TCCR1A] & 3) | ((io[A_TCCR1B] >> 1) & 0x0C);
+		uint8_t rising = (io[A_TCCR1B] >> 6) & 1;
+		if (!(wgm == 8 || wgm == 10 || wgm == 12 || wgm == 14) && (after & 1) == rising) {
+			wr16(A_ICR1, rd16(A_TCNT1));
+			SET_FLAG(A_TIFR1, 5);
+		}
+	}
+}
+
+static void update_pins(void) {
+	uint8_t port, ddr, out, now, before;
+
+	for (port = 0; port < 3; port++) {
+		ddr = io[A_DDRB + 3 * port];
+		out = io[A_PORTB + 3 * port];
+		now = (out & ddr) | (~ddr & ((driven[port] & level[port]) | (~driven[port] & out))); // Undriven inputs read the pull-up
+		before = pins[port];
+		strobe[A_PINB + 3 * port] = STROBE_IDLE | now;
+		if (now == before)
+		continue;
+		pins[port] = now;
+		pin_edges(port, before, now);
+		if (watcher) {
+			in_device = 1;
+			watcher(port, before, now);
+			in_device = 0;
+		}
+		if (trace && ((now ^ before) & ddr))
+		printf("[%10.3f ms] PORT%c = 0x%02x\n", sim_cycles * 1000.0 / F_CPU, 'B' + port, now & ddr);
+	}
+}
+
+// Runs the events that are due, in the order they were added
+static void run_events(void) {
+	void (*fn)(void *arg);
+	void *arg;
+	uint8_t i = 0;
+
+	while (i < event_count) {
+		if (events[i].cycle > sim_cycles) {
+			i++;
+			continue;
+		}
+		fn = events[i].fn;
+		arg = events[i].arg;
+		event_count--;
+		memmove(&events[i], &events[i + 1], (event_count - i) * sizeof(events[0]));
+		in_device = 1;
+		fn(arg);
+		in_device = 0;
+		i = 0; // An event may have added another one that is due now
+	}
+}
+
+// ---- Interrupts ----
+
+static uint8_t pending_vector(void) {
+	uint8_t v;
+
+	if (forced) {
+		for (v = 1; v < VECTORS; v++) {
+			if (forced & (1UL << v))
+			return v;
+		}
+	}
+	if ((FLAGS(A_EIFR) & io[A_EIMSK]) & 1)
+	return 1;
+	if ((FLAGS(A_EIFR) & io[A_EIMSK]) & 2)
+	return 2;
+	for (v = 0; v < 3; v++) {
+		if (FLAGS(A_PCIFR) & io[A_PCICR] & (1 << v))
+		return 3 + v;
+	}
+	if ((io[A_WDTCSR] & 0xC0) == 0xC0)
+	return 6;
+	if (FLAGS(A_TIFR2) & io[A_TIMSK2] & 2)
+	return 7;
+	if (FLAGS(A_TIFR2) & io[A_TIMSK2] & 4)
+	return 8;
+	if (FLAGS(A_TIFR2) & io[A_TIMSK2] & 1)
+	return 9;
+	if (FLAGS(A_TIFR1) & io[A_TIMSK1] & (1 << 5))
+	return 10;
+	if (FLAGS(A_TIFR1) & io[A_TIMSK1] & 2)
+	return 11;
+	if (FLAGS(A_TIFR1) & io[A_TIMSK1] & 4)
+	return 12;
+	if (FLAGS(A_TIFR1) & io[A_TIMSK1] & 1)
+	return 13;
+	if (FLAGS(A_TIFR0) & io[A_TIMSK0] & 2)
+	return 14;
+	if (FLAGS(A_TIFR0) & io[A_TIMSK0] & 4)
+	return 15;
+	if (FLAGS(A_TIFR0) & io[A_TIMSK0] & 1)
+	return 16;
+	if ((io[A_SPSR] & 0x80) && (io[A_SPCR] & 0x80))
+	return 17;
+	if ((io[A_UCSR0A] & 0x80) && (io[A_UCSR0B] & 0x80))
+	return 18;
+	if ((io[A_UCSR0A] & 0x20) && (io[A_UCSR0B] & 0x20))
+	return 19;
+	if ((io[A_UCSR0A] & 0x40) && (io[A_UCSR0B] & 0x40))
+	return 20;
+	if ((io[A_ADCSRA] & 0x18) == 0x18)
+	return 21;
+	if ((io[A_EECR] & 0x0A) == 0x08) // EERIE with no write in progress
+	return 22;
+	if ((io[A_ACSR] & 0x18) == 0x18)
+	return 23;
+	if ((FLAGS(A_TWCR) & 0x81) == 0x81)
+	return 24;
+	return 0;
+}
+
+// Clears the flag of an interrupt that the hardware clears when it is taken
+static void acknowledge(uint8_t v) {
+	forced &= ~(1UL << v);
+	switch (v) {
+		case 1: case 2: CLEAR_FLAG(A_EIFR, v - 1); break;
+		case 3: case 4: case 5: CLEAR_FLAG(A_PCIFR, v - 3); break;
+		case 6: io[A_WDTCSR] &= ~0x80; break;
+		case 7: CLEAR_FLAG(A_TIFR2, 1); break;
+		case 8: CLEAR_FLAG(A_TIFR2, 2); break;
+		case 9: CLEAR_FLAG(A_TIFR2, 0); break;
+		case 10: CLEAR_FLAG(A_TIFR1, 5); break;
+		case 11: CLEAR_FLAG(A_TIFR1, 1); break;
+		case 12: CLEAR_FLAG(A_TIFR1, 2); break;
+		case 13: CLEAR_FLAG(A_TIFR1, 0); break;
+		case 14: CLEAR_FLAG(A_TIFR0, 1); break;
+		case 15: CLEAR_FLAG(A_TIFR0, 2); break;
+		case 16: CLEAR_FLAG(A_TIFR0, 0); break;
+		case 17: io[A_SPSR] &= ~0x80; break;
+		case 20: io[A_UCSR0A] &= ~0x40; break;
+		case 21: io[A_ADCSRA] &= ~0x10; break;
+		case 23: io[A_ACSR] &= ~0x10; break;
+	}
+}
+
+static void dispatch(void) {
+	uint64_t start, cycles;
+	uint8_t v;
+
+	while ((io[A_SREG] & SREG_I) && (v = pending_vector())) {
+		if (!vectors[v]) {
+			fprintf(stderr, "sim: interrupt %u has no ISR, the chip would reset\n", v);
+			exit(1);
+		}
+		acknowledge(v);
+		isr_count++;
+		start = sim_cycles;
+		io[A_SREG] &= ~SREG_I;
+		step(ISR_CYCLES);
+		vectors[v]();
+		commit();
+		step(ISR_CYCLES);
+		io[A_SREG] |= SREG_I; // reti
+		cycles = sim_cycles - start;
+		isr_stats[v].count++;
+		isr_stats[v].total += cycles;
+		if (cycles > isr_stats[v].max)
+		isr_stats[v].max = cycles;
+	}
+}
+
+// ---- Clock ----
+
+static void tick(void) {
+	static const uint16_t prescale0[8] = {0, 1, 8, 64, 256, 1024, 0, 0};
+	static const uint16_t prescale2[8] = {0, 1, 8, 32, 64, 128, 256, 1024};
+
+	sim_cycles++;
+	if (limit && sim_cycles >= limit) {
+		fflush(stdout);
+		fprintf(stderr, "sim: stopped after %llu cycles\n", (unsigned long long)sim_cycles);
+		exit(0);
+	}
+	timer8(A_TCCR0A, A_TCCR0B, A_TCNT0, A_OCR0A, A_OCR0B, A_TIFR0, prescale0);
+	timer1();
+	timer8(A_TCCR2A, A_TCCR2B, A_TCNT2, A_OCR2A, A_OCR2B, A_TIFR2, prescale2);
+	adc();
+	eeprom_tick();
+	twi();
+	spi();
+	uart();
+	if (event_count)
+	run_events();
+	update_pins();
+	dispatch();
+}
+
+static void step(uint64_t cycles) {
+	commit();
+	while (cycles--)
+	tick();
+}
+
+void sim_run(uint64_t cycles) {
+	step(cycles);
+}
+
+void sim_delay_cycles(uint64_t cycles) {
+	step(cycles);
+}
+
+// Does not move the clock, so a pending interrupt waits for the next access, as it waits for the next instruction on the chip
+void sim_sei(void) {
+	commit();
+	io[A_SREG] |= SREG_I;
+}
+
+void sim_cli(void) {
+	commit();
+	io[A_SREG] &= ~SREG_I;
+	step(1);
+}
+
+// The sleep instruction: with SE set in SMCR, the clock runs until an interrupt has been taken. All clocks keep running whatever the sleep
+// mode, so a sketch has to pick a mode that keeps its wake-up source running, as on the chip.
+void sim_sleep(void) {
+	uint32_t taken = isr_count;
+
+	commit();
+	if (!(io[0x53] & 1)) // SMCR.SE
+	return;
+	while (isr_count == taken) {
+		tick();
+		slept++;
+	}
+}
+
+// Cycles spent in sim_sleep
+uint64_t sim_slept(void) {
+	return slept;
+}
+
+// Charges every function call of the sketch a few cycles (the host build uses -finstrument-functions)
+void __cyg_profile_func_enter(void *fn, void *site) __attribute__((no_instrument_function));
+void __cyg_profile_func_exit(void *fn, void *site) __attribute__((no_instrument_function));
+
+void __cyg_profile_func_enter(void *fn, void *site) {
+	(void)fn;
+	(void)site;
+	step(CALL_CYCLES);
+}
+
+void __cyg_profile_func_exit(void *fn, void *site) {
+	(void)fn;
+	(void)site;
+}
+
+// ---- Test and harness interface ----
+
+void sim_reset(void) {
+	uint16_t i;
+
+	memset(io, 0, sizeof(io));
+	for (i = 0; i < SIM_IO_SIZE; i++)
+	strobe[i] = STROBE_IDLE;
+	io[A_UCSR0A] = (1 << 5); // UDRE0
+	io[0xC2] = 0x06; // UCSR0C, 8N1
+	pending_kind = KIND_NONE;
+	forced = 0;
+	memset(pins, 0, sizeof(pins));
+	memset(driven, 0, sizeof(driven));
+	memset(adc_value, 0, sizeof(adc_value));
+	adc_left = tx_left = rx_left = 0;
+	tx_next_full = 0;
+	tx_count = 0;
+	rx_head = rx_tail = 0;
+	eempe_left = 0;
+	ee_left = 0;
+	twi_left = 0;
+	twi_owned = twi_address_next = twi_reading = 0;
+	spi_left = 0;
+	event_count = 0;
+	slept = 0;
+	sim_cycles = 0;
+}
+
+void sim_irq(uint8_t vector) {
+	if (vector && vector < VECTORS)
+	forced |= 1UL << vector;
+	step(0);
+	dispatch();
+}
+
+void sim_pin(uint8_t port, uint8_t bit, uint8_t value) {
+	if (port > SIM_PORTD)
+	return;
+	driven[port] |= (1 << bit);
+	if (value)
+	level[port] |= (1 << bit);
+	else
+	level[port] &= ~(1 << bit);
+	if (!in_device)
+	step(1);
+}
+
+uint8_t sim_output(uint8_t port) {
+	return port > SIM_PORTD ? 0 : io[A_PORTB + 3 * port] & io[A_DDRB + 3 * port];
+}
+
+void sim_adc(uint8_t channel, uint16_t value) {
+	if (channel < 8)
+	adc_value[channel] = value & 0x3FF;
+}
+
+// Gives every ADC0-7 conversion the value of source(channel) when it ends, or the sim_adc() values again with 0
+void sim_adc_source(uint16_t (*source)(uint8_t channel)) {
+	adc_source = source;
+}
+
+void sim_uart_rx(uint8_t byte) {
+	uint8_t next = (rx_head + 1) % RX_QUEUE;
+
+	if (next == rx_tail)
+	return;
+	rx_queue[rx_head] = byte;
+	rx_head = next;
+	if (!rx_left)
+	rx_left = 10UL * 16 * (rd16(A_UBRR0) + 1);
+}
+
+void sim_uart_echo(uint8_t on) {
+	uart_echo = on;
+}
+
+// Takes the bytes sent on USART0 since the last call
+size_t sim_uart_tx(uint8_t *buffer, size_t max) {
+	size_t n = tx_count < max ? tx_count : max;
+
+	memcpy(buffer, tx_capture, n);
+	memmove(tx_capture, tx_capture + n, tx_count - n);
+	tx_count -= n;
+	return n;
+}
+
+void sim_watch(void (*fn)(uint8_t port, uint8_t before, uint8_t after)) {
+	watcher = fn;
+}
+
+// Connects a device to the TWI bus. It is called for every START and STOP, with every byte the master sends (the first after a START
+// is SLA+R/W), returning 1 to acknowledge it, and for every byte the master reads, with 1 if the master will acknowledge it.
+void sim_twi(uint8_t (*device)(uint8_t event, uint8_t data)) {
+	twi_device = device;
+}
+
+void sim_spi(uint8_t (*device)(uint8_t data)) {
+	spi_device = device;
+}
+
+// Calls fn(arg) at `cycle`, or in the next cycle if that has passed, after the peripherals have moved and before the pins are updated
+void sim_at(uint64_t cycle, void (*fn)(void *arg), void *arg) {
+	if (event_count == EVENTS) {
+		fprintf(stderr, "sim: more than %d events waiting\n", EVENTS);
+		exit(1);
+	}
+	events[event_count].cycle = cycle;
+	events[event_count].fn = fn;
+	events[event_count].arg = arg;
+	event_count++;
+}
+
+// The EEPROM contents, EEPROM_SIZE bytes; erased bytes read 0xFF
+uint8_t *sim_eeprom(void) {
+	return eeprom;
+}
+
+static void eeprom_save(void) {
+	FILE *f = fopen(ee_file, "wb");
+
+	if (!f || fwrite(eeprom, 1, sizeof(eeprom), f) != sizeof(eeprom))
+	fprintf(stderr, "sim: cannot write %s\n", ee_file);
+	if (f)
+	fclose(f);
+}
+
+// The same CSV lines as bench/runner.c, for the metrics the model can measure: ISR durations, the UART rate and the share of the time
+// the CPU was awake
+static void bench_report(void) {
+	uint8_t v;
+
+	for (v = 1; v < VECTORS; v++) {
+		if (!isr_stats[v].count)
+		continue;
+		printf("%s,%s_vect.duration_avg,%llu\n", bench, vector_names[v], (unsigned long long)(isr_stats[v].total / isr_stats[v].count));
+		printf("%s,%s_vect.duration_max,%llu\n", bench, vector_names[v], (unsigned long long)isr_stats[v].max);
+	}
+	if (tx_bytes > 1 && tx_last > tx_first)
+	printf("%s,uart.bytes_per_s,%llu\n", bench, (unsigned long long)((tx_bytes - 1) * F_CPU / (tx_last - tx_first)));
+	if (sim_cycles)
+	printf("%s,cpu.awake_permille,%llu\n", bench, (unsigned long long)((sim_cycles - slept) * 1000 / sim_cycles));
+	fflush(stdout);
+}
+
+// Runs before the constructors of a harness linked into the sketch, which can then set up devices and events
+__attribute__((constructor(101))) static void sim_start(void) {
+	const char *ms = getenv("SIM_MS");
+	const char *t = getenv("SIM_TRACE");
+	const char *rx = getenv("SIM_RX");
+	FILE *f;
+
+	sim_reset();
+	if (ms)
+	limit = (uint64_t)strtoull(ms, 0, 10) * (F_CPU / 1000);
+	trace = t && *t == '1';
+
+	memset(eeprom, 0xFF, sizeof(eeprom));
+	ee_file = getenv("SIM_EEPROM");
+	if (ee_file) {
+		f = fopen(ee_file, "rb");
+		if (f) {
+			if (fread(eeprom, 1, sizeof(eeprom), f) != sizeof(eeprom))
+			fprintf(stderr, "sim: %s is shorter than the EEPROM\n", ee_file);
+			fclose(f);
+		}
+		atexit(eeprom_save);
+	}
+	while (rx && *rx)
+	sim_uart_rx(*rx++);
+	bench = getenv("SIM_BENCH");
+	if (bench && *bench)
+	atexit(bench_report);
+}
@@ -0,0 +1,77 @@
+/*
+The `sim.h` file declares the ATmega328P model that the host build links every sketch against, so the firmware logic can run on Linux.
+
+1. **Virtual Clock**: `sim_cycles` counts CPU cycles. It moves forward by one cycle on every register access, by the exact length of every
+`_delay_us()`/`_delay_ms()`, by a few cycles on every function call, by whatever `sim_run()` is asked for, and across a `sleep_cpu()` up to
+the interrupt that wakes the CPU (`sim_slept()` adds those cycles up). A loop that spins on a plain variable without calling a function
+never moves it, the same way it would never finish on the chip if no interrupt were enabled.
+
+2. **Peripherals**: Each cycle the model steps Timer0/1/2 (normal, CTC and fast PWM modes; phase correct modes count up only), the input
+capture on ICP1 (PB0), INT0/INT1 and the pin change interrupts, the ADC (13 ADC clocks per conversion, free running or single), USART0
+(one frame per 10 bit times) and the EEPROM. Interrupts are taken in vector order whenever the I flag is set, and an ISR clears I until it returns, as on
+the chip. Output compare pins and PWM waveforms are not modeled; only the flags and interrupts are.
+
+3. **Driving the Model**: A test or a harness sets input pins with `sim_pin()`, ADC inputs with `sim_adc()` and serial input with
+`sim_uart_rx()`. For a signal that changes from one conversion to the next, `sim_adc_source()` sets a function that gives the value at
+the end of every conversion instead. `sim_irq()` forces an interrupt, as if its flag had been set. `sim_watch()` reports every change on the port pins, which is
+how a virtual device (an LCD, a sensor) can follow the outputs. `sim_at()` calls a function at a given cycle, so a device can answer after
+a delay; from there and from a watcher `sim_pin()` takes effect in the same cycle instead of moving the clock. Bytes sent on USART0 are printed on stdout unless `sim_uart_echo(0)`.
+`sim_eeprom()` gives direct access to the 1 KB EEPROM, which is written through `EECR`/`EEDR`/`EEAR` with the chip's timing (3.4 ms per
+byte, 1.8 ms for an erase-only or write-only operation) and raises `EE_READY_vect` while `EERIE` is set and no write is in progress.
+The TWI master sends START, STOP and bytes at the SCL rate set by `TWBR`/`TWSR` and sets `TWINT` with the datasheet status codes when each
+one is done; `sim_twi()` puts a device on the bus to acknowledge and answer them, and without one every address is NACKed.
+The SPI master shifts a byte written to `SPDR` out in 8 SCK periods and then sets `SPIF`; `sim_spi()` puts a device on the bus that is
+handed each byte and answers with the byte for MISO (0xFF without one). The slave mode and the `SS` input are not modeled.
+
+4. **Environment**: When a sketch is run as a host program, `SIM_MS` stops it after that many milliseconds of virtual time and `SIM_TRACE=1`
+prints every output pin change with its time stamp. `SIM_EEPROM=<file>` loads the EEPROM from that file at the start and saves it there at
+the end, so the contents last from one run to the next, and `SIM_RX=<text>` sends the text to USART0 as if typed at the start.
+`SIM_BENCH=<name>` prints `name,metric,value` lines at the end, like `bench/runner.c` does under simavr: the average and longest duration of
+each ISR taken, the UART rate and how much of the time the CPU was awake, all in virtual cycles (see `tools/bench.sh --host`).
+*/
+
+#ifndef HOST_SIM_H_
+#define HOST_SIM_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define SIM_IO_SIZE 0x100
+#define SIM_PORTB 0
+#define SIM_PORTC 1
+#define SIM_PORTD 2
+
+#define SIM_TWI_START 0
+#define SIM_TWI_STOP 1
+#define SIM_TWI_WRITE 2
+#define SIM_TWI_READ 3
+
+extern volatile uint64_t sim_cycles;
+
+volatile uint8_t *sim_io8(uint16_t address);
+volatile uint16_t *sim_io16(uint16_t address);
+volatile uint16_t *sim_strobe(uint16_t address);
+
+void sim_reset(void);
+void sim_run(uint64_t cycles);
+void sim_delay_cycles(uint64_t cycles);
+void sim_sei(void);
+void sim_cli(void);
+void sim_sleep(void);
+uint64_t sim_slept(void);
+
+void sim_irq(uint8_t vector);
+void sim_pin(uint8_t port, uint8_t bit, uint8_t level);
+uint8_t sim_output(uint8_t port);
+void sim_adc(uint8_t channel, uint16_t value);
+void sim_adc_source(uint16_t (*source)(uint8_t channel));
+void sim_uart_rx(uint8_t byte);
+void sim_uart_echo(uint8_t on);
+size_t sim_uart_tx(uint8_t *buffer, size_t max);
+void sim_watch(void (*fn)(uint8_t port, uint8_t before, uint8_t after));
+uint8_t *sim_eeprom(void);
+void sim_twi(uint8_t (*device)(uint8_t event, uint8_t data));
+void sim_spi(uint8_t (*device)(uint8_t data));
+void sim_at(uint64_t cycle, void (*fn)(void *arg), void *arg);
+
+#endif /* HOST_SIM_H_ */
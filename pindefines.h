@@ -89,3 +89,30 @@
 #define I2C_SCL_PORT                PORTC
 #define I2C_SCL_PIN                 PINC
 #define I2C_SCL_DDR                 DDRC
+
+//  The same pins as single constants for pins.h
+
+#define PIN_LED0                PIN_B(LED0)
+#define PIN_LED1                PIN_B(LED1)
+#define PIN_LED2                PIN_B(LED2)
+#define PIN_LED3                PIN_B(LED3)
+#define PIN_LED4                PIN_B(LED4)
+#define PIN_LED5                PIN_B(LED5)
+#define PIN_LED6                PIN_B(LED6)
+#define PIN_LED7                PIN_B(LED7)
+#define PIN_BUTTON              PIN_D(BUTTON)
+#define PIN_BUTTON2             PIN_D(BUTTON2)
+#define PIN_BUTTON3             PIN_D(BUTTON3)
+#define PIN_SPEAKER             PIN_D(SPEAKER)
+#define PIN_ANTENNA             PIN_D(ANTENNA)
+#define PIN_MODULATION          PIN_D(MODULATION)
+#define PIN_LIGHT_SENSOR        PIN_C(LIGHT_SENSOR)
+#define PIN_CAP_SENSOR          PIN_C(CAP_SENSOR)
+#define PIN_PIEZO               PIN_C(PIEZO)
+#define PIN_POT                 PIN_C(POT)
+#define PIN_SPI_SS              PIN_B(SPI_SS)
+#define PIN_SPI_MOSI            PIN_B(SPI_MOSI)
+#define PIN_SPI_MISO            PIN_B(SPI_MISO)
+#define PIN_SPI_SCK             PIN_B(SPI_SCK)
+#define PIN_I2C_SDA             PIN_C(I2C_SDA)
+#define PIN_I2C_SCL             PIN_C(I2C_SCL)
@@ -0,0 +1,88 @@
+/*
+The `pins.h` file turns a pin into one constant, so that setting, clearing or testing it compiles to a single `sbi`, `cbi` or
+`sbis`/`sbic` instruction, and so that pins that clash are caught by the compiler instead of on the bench.
+
+1. **Pins**: A pin is a number with the port in the high nibble and the bit in the low one, the same code `bcm.h` uses: `PIN_D(6)` is
+PD6. `pindefines.h` gives each of its pins as such a constant too, e.g. `PIN_BUTTON` for `BUTTON`. The registers of ports B, C and D are
+all in the lowest 32 I/O addresses, so when the pin is a constant the compiler picks the register and the mask at build time and
+`PIN_HIGH()`, `PIN_LOW()`, `PIN_OUTPUT()` and `PIN_INPUT()` are one instruction each. `PIN_TOGGLE()` writes the pin's mask to `PINx`,
+which flips that bit of `PORTx` with an `ldi` and an `out`, atomic and without the read and `eor` of `PORTD ^= mask`. `PIN_IS_HIGH()` and
+`PIN_IS_LOW()` used as a condition become a skip instruction.
+
+2. **Groups**: `PIN_GROUP(a, b, ...)` joins up to 8 pins of one port into a group constant, the port in the high byte and the pin mask in
+the low one. `PIN_GROUP_WRITE(group, value)` sets every pin of the group to its bit of `value` (in port bit positions) with one
+read-modify-write of the port, and `PIN_GROUP_HIGH()`, `PIN_GROUP_LOW()`, `PIN_GROUP_OUTPUT()` and `PIN_GROUP_TOGGLE()` work on all of them
+at once. A group with pins on two ports, or the same pin twice, does not compile. A write to several pins is not atomic: an ISR that changes
+another pin of the same port in between can have its change undone, the same as with `PORTD |= mask`.
+
+3. **Conflicts**: `PIN_ASSERT_FREE(a, b, message)` is a `_Static_assert` that groups (or single pins through `PIN_GROUP()`) `a` and `b`
+have no pin in common. A driver gives its pins as a group, e.g. `LCD_PINS` in `LCD_3.h`, and a sketch that uses it with other pins asserts
+that they are free, so putting the button on the LCD's PD2 stops the build with the message.
+
+The pins have to be constants; with a variable the macros still work but the compiler cannot pick the register at build time, and
+`PIN_GROUP()` does not compile.
+*/
+
+#ifndef PINS_H_
+#define PINS_H_
+
+#include <avr/io.h>
+
+#define PIN_B(bit) (0x00 | (bit))
+#define PIN_C(bit) (0x10 | (bit))
+#define PIN_D(bit) (0x20 | (bit))
+#define PIN_NONE 0xFF // Fills the unused places of PIN_GROUP
+
+#define PIN_PORT_INDEX(pin) ((pin) >> 4) // 0 = B, 1 = C, 2 = D
+#define PIN_BIT(pin) ((pin) & 7)
+#define PIN_MASK(pin) ((pin) == PIN_NONE ? 0 : 1 << PIN_BIT(pin))
+
+// The register of a port, chosen at compile time for a constant port index
+#define PIN_REG(port, B, C, D) (*((port) == 0 ? &(B) : (port) == 1 ? &(C) : &(D)))
+#define PIN_PORT(port) PIN_REG(port, PORTB, PORTC, PORTD)
+#define PIN_DDR(port) PIN_REG(port, DDRB, DDRC, DDRD)
+#define PIN_IN(port) PIN_REG(port, PINB, PINC, PIND)
+
+// Single pins
+#define PIN_HIGH(pin) (PIN_PORT(PIN_PORT_INDEX(pin)) |= PIN_MASK(pin))
+#define PIN_LOW(pin) (PIN_PORT(PIN_PORT_INDEX(pin)) &= ~PIN_MASK(pin))
+#define PIN_TOGGLE(pin) (PIN_IN(PIN_PORT_INDEX(pin)) = PIN_MASK(pin))
+#define PIN_IS_HIGH(pin) ((PIN_IN(PIN_PORT_INDEX(pin)) & PIN_MASK(pin)) != 0)
+#define PIN_IS_LOW(pin) ((PIN_IN(PIN_PORT_INDEX(pin)) & PIN_MASK(pin)) == 0)
+#define PIN_OUTPUT(pin) (PIN_DDR(PIN_PORT_INDEX(pin)) |= PIN_MASK(pin))
+#define PIN_INPUT(pin) (PIN_DDR(PIN_PORT_INDEX(pin)) &= ~PIN_MASK(pin))
+#define PIN_PULLUP(pin) (PIN_INPUT(pin), PIN_HIGH(pin))
+
+// A compile-time check that can stand in an expression, where _Static_assert on its own cannot
+#define PIN_CHECK(cond, message) (0 * sizeof(struct { _Static_assert(cond, message); char c; }))
+
+// Pins a to h, where the unused ones are PIN_NONE
+#define PIN_SAME_PORT(a, p) ((p) == PIN_NONE || PIN_PORT_INDEX(p) == PIN_PORT_INDEX(a))
+#define PIN_MASK_OR(a, b, c, d, e, f, g, h) \
+	(PIN_MASK(a) | PIN_MASK(b) | PIN_MASK(c) | PIN_MASK(d) | PIN_MASK(e) | PIN_MASK(f) | PIN_MASK(g) | PIN_MASK(h))
+#define PIN_MASK_SUM(a, b, c, d, e, f, g, h) \
+	(PIN_MASK(a) + PIN_MASK(b) + PIN_MASK(c) + PIN_MASK(d) + PIN_MASK(e) + PIN_MASK(f) + PIN_MASK(g) + PIN_MASK(h))
+#define PIN_GROUP_OF(a, b, c, d, e, f, g, h, ...) \
+	(PIN_CHECK(PIN_SAME_PORT(a, b) && PIN_SAME_PORT(a, c) && PIN_SAME_PORT(a, d) && PIN_SAME_PORT(a, e) && PIN_SAME_PORT(a, f) && \
+		PIN_SAME_PORT(a, g) && PIN_SAME_PORT(a, h), "PIN_GROUP pins must be on one port") + \
+	PIN_CHECK(PIN_MASK_OR(a, b, c, d, e, f, g, h) == PIN_MASK_SUM(a, b, c, d, e, f, g, h), "PIN_GROUP has a pin twice") + \
+	((PIN_PORT_INDEX(a) << 8) | PIN_MASK_OR(a, b, c, d, e, f, g, h)))
+
+// Groups of 1 to 8 pins on one port
+#define PIN_GROUP(...) PIN_GROUP_OF(__VA_ARGS__, PIN_NONE, PIN_NONE, PIN_NONE, PIN_NONE, PIN_NONE, PIN_NONE, PIN_NONE)
+#define PIN_GROUP_PORT(group) ((group) >> 8)
+#define PIN_GROUP_MASK(group) ((group) & 0xFF)
+
+#define PIN_GROUP_HIGH(group) (PIN_PORT(PIN_GROUP_PORT(group)) |= PIN_GROUP_MASK(group))
+#define PIN_GROUP_LOW(group) (PIN_PORT(PIN_GROUP_PORT(group)) &= ~PIN_GROUP_MASK(group))
+#define PIN_GROUP_TOGGLE(group) (PIN_IN(PIN_GROUP_PORT(group)) = PIN_GROUP_MASK(group))
+#define PIN_GROUP_OUTPUT(group) (PIN_DDR(PIN_GROUP_PORT(group)) |= PIN_GROUP_MASK(group))
+#define PIN_GROUP_READ(group) (PIN_IN(PIN_GROUP_PORT(group)) & PIN_GROUP_MASK(group))
+#define PIN_GROUP_WRITE(group, value) \
+	(PIN_PORT(PIN_GROUP_PORT(group)) = (PIN_PORT(PIN_GROUP_PORT(group)) & ~PIN_GROUP_MASK(group)) | ((value) & PIN_GROUP_MASK(group)))
+
+// Fails the build if the two groups share a pin
+#define PIN_ASSERT_FREE(a, b, message) \
+	_Static_assert(PIN_GROUP_PORT(a) != PIN_GROUP_PORT(b) || !(PIN_GROUP_MASK(a) & PIN_GROUP_MASK(b)), message)
+
+#endif /* PINS_H_ */
@@ -0,0 +1,150 @@
+/*
+The `power.c` file contains the definitions of the functions declared in the `power.h` file.
+
+1. **Clock**: Timer2 runs in normal mode and `TIMER2_OVF_vect` counts the overflows, which gives a 32-bit tick count with `TCNT2` as the
+low byte. `now()` reads both with interrupts off and allows for an overflow that is pending but not yet counted. From the watch crystal,
+`TCNT2` is only copied to the I/O clock on a rising TOSC1 edge, so right after a wake-up from power-save it still reads as before the
+sleep. `now()` first writes `OCR2B`, which Timer2 does not use, and waits for `OCR2BUB` to clear, which takes one edge (up to 31 us),
+as the datasheet asks (section 18.9). That wait also gives the one TOSC1 cycle needed before power-save is entered again.
+
+2. **Going to Sleep**: `power_sleep()` is entered with interrupts on. It turns them off while it reads the clock and sets the mode, then
+turns them on again right before the `sleep` instruction. The instruction after `sei` always runs first, so an interrupt that comes in
+between wakes the CPU straight away instead of being missed until the next one.
+*/
+
+#include "power.h"
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/sleep.h>
+#include <util/atomic.h>
+
+static const uint8_t sleep_modes[POWER_MODES] = {
+	SLEEP_MODE_IDLE, SLEEP_MODE_ADC, SLEEP_MODE_PWR_SAVE, SLEEP_MODE_PWR_DOWN
+};
+
+static volatile uint32_t overflows = 0;
+static uint32_t started;
+static uint32_t asleep[POWER_MODES];
+static uint32_t wakeups[POWER_MODES];
+
+// Ticks since power_init; call with interrupts off
+static uint32_t now(void) {
+	uint8_t low;
+	uint32_t high;
+
+	#ifdef POWER_ASYNC_CLOCK
+	OCR2B = 0;
+	while (ASSR & (1 << OCR2BUB)) {} // Until a TOSC1 edge has updated TCNT2
+	#endif
+	low = TCNT2;
+	high = overflows;
+
+	if ((TIFR2 & (1 << TOV2)) && low < 0x80) // Wrapped after the last overflow ISR
+	high++;
+	return (high << 8) | low;
+}
+
+void power_init(void) {
+	uint8_t i;
+
+	TIMSK2 = 0;
+	#ifdef POWER_ASYNC_CLOCK
+	ASSR = (1 << AS2); // Timer2 from the watch crystal
+	TCCR2A = 0;
+	TCCR2B = (1 << CS21); // Prescaler of 8
+	while (ASSR & ((1 << TCN2UB) | (1 << TCR2AUB) | (1 << TCR2BUB))) {} // Wait for the asynchronous registers to update
+	#else
+	ASSR = 0;
+	TCCR2A = 0;
+	TCCR2B = (1 << CS22) | (1 << CS21); // Prescaler of 256
+	#endif
+	TCNT2 = 0;
+	TIFR2 = (1 << TOV2);
+	TIMSK2 = (1 << TOIE2);
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		overflows = 0;
+		started = now();
+	}
+	for (i = 0; i < POWER_MODES; i++)
+	asleep[i] = wakeups[i] = 0;
+}
+
+// The deepest sleep mode that keeps every peripheral in use running
+uint8_t power_mode(void) {
+	uint8_t ext = EIMSK & ((1 << INT0) | (1 << INT1));
+
+	if ((TCCR0B & 7) || (TCCR1B & 7) || ((TCCR2B & 7) && !(ASSR & (1 << AS2))))
+	return POWER_IDLE; // Timers that run from the I/O clock
+	if ((UCSR0B & ((1 << RXEN0) | (1 << TXEN0))) || (SPCR & (1 << SPE)) || (TWCR & (1 << TWEN)) || (ACSR & (1 << ACIE)))
+	return POWER_IDLE;
+	if (((ext & (1 << INT0)) && (EICRA & 3)) || ((ext & (1 << INT1)) && (EICRA & (3 << 2))))
+	return POWER_IDLE; // Edge detection needs the I/O clock
+	if (((ADCSRA & (1 << ADEN)) && (ADCSRA & (1 << ADIE))) || (EECR & (1 << EERIE)))
+	return POWER_ADC_NOISE;
+	if ((TCCR2B & 7) && (ASSR & (1 << AS2)))
+	return POWER_SAVE;
+	return POWER_DOWN;
+}
+
+// Sleeps until the next interrupt, in the deepest mode the peripherals allow
+void power_sleep(void) {
+	uint8_t mode;
+	uint32_t start;
+
+	cli();
+	mode = power_mode();
+	set_sleep_mode(sleep_modes[mode]);
+	start = now();
+	sleep_enable();
+	sei();
+	sleep_cpu();
+	sleep_disable();
+	cli();
+	asleep[mode] += now() - start;
+	wakeups[mode]++;
+	sei();
+}
+
+void power_stats(power_stats_t *stats) {
+	uint8_t i;
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		stats->awake = now() - started;
+		stats->wakeups = 0;
+		for (i = 0; i < POWER_MODES; i++) {
+			stats->asleep[i] = asleep[i];
+			stats->awake -= asleep[i];
+			stats->wakeups += wakeups[i];
+		}
+	}
+}
+
+// Average supply current since power_init, in uA
+uint32_t power_average_ua(void) {
+	static const uint32_t sleep_ua[POWER_MODES] = {POWER_IDLE_UA, POWER_ADC_NOISE_UA, POWER_SAVE_UA, POWER_DOWN_UA};
+	power_stats_t s;
+	uint32_t count[POWER_MODES];
+	uint64_t total, wake, charge;
+	uint8_t i;
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		power_stats(&s);
+		for (i = 0; i < POWER_MODES; i++)
+		count[i] = wakeups[i];
+	}
+	total = s.awake;
+	charge = (uint64_t)s.awake * POWER_ACTIVE_UA;
+	for (i = 0; i < POWER_MODES; i++) {
+		// The ISRs that ended the sleeps were counted as sleep time; move them to the awake time
+		wake = (uint64_t)count[i] * POWER_WAKE_CYCLES * POWER_TICKS_PER_SEC / F_CPU;
+		if (wake > s.asleep[i])
+		wake = s.asleep[i];
+		charge += (s.asleep[i] - wake) * sleep_ua[i] + wake * POWER_ACTIVE_UA;
+		total += s.asleep[i];
+	}
+	return total ? charge / total : POWER_ACTIVE_UA;
+}
+
+ISR(TIMER2_OVF_vect) {
+	overflows++;
+}
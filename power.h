@@ -0,0 +1,83 @@
+/*
+The `power.h` file declares a small power manager for sketches whose work is all done in interrupts. The main loop calls `power_sleep()`
+instead of spinning, and the CPU sleeps until the next interrupt.
+
+1. **Sleep Mode**: `power_mode()` looks at the peripherals that are switched on and picks the deepest mode that keeps all of them
+working, following the clock domain table in the datasheet (section 10.1):
+
+	| Mode             | Still running                       | Chosen when                                                      |
+	|------------------|-------------------------------------|------------------------------------------------------------------|
+	| Idle             | Everything but the CPU              | Timer0/1, synchronous Timer2, USART, SPI, TWI, the analog        |
+	|                  |                                     | comparator or an edge triggered INT0/INT1 is in use              |
+	| ADC noise reduc. | ADC, EEPROM, asynchronous Timer2    | The ADC interrupt or the EEPROM ready interrupt is on            |
+	| Power-save       | Asynchronous Timer2                 | Timer2 runs from a 32.768 kHz crystal on TOSC1/TOSC2             |
+	| Power-down       | Level INT0/INT1, pin change, WDT    | Nothing else is on                                               |
+
+2. **Accounting**: Timer2 runs as a free clock, and `power_sleep()` adds the time between going to sleep and coming back to the sleep
+time of the mode it used. Everything else is awake time. By default Timer2 counts the CPU clock / 256 (16 us at 16 MHz), which only runs
+in idle mode, so this keeps the sleep mode at idle; define `POWER_ASYNC_CLOCK` on a board with a watch crystal on TOSC1/TOSC2 to count it
+/ 8 (244 us) instead, which also runs in power-save. The overflow interrupt that extends the count wakes the CPU every 256 ticks (4 ms, or
+62.5 ms from the crystal), and times are only as fine as one tick. Timer2 belongs to the power manager, so it cannot be used with `sched.c`.
+
+3. **Wake-ups**: The interrupt that ends a sleep runs before `power_sleep()` reads the clock again, so its run time lands in the sleep
+time. `power_stats()` counts the wake-ups, and `power_average_ua()` moves `POWER_WAKE_CYCLES` per wake-up back to the awake time.
+
+4. **Energy**: `power_average_ua()` weights each state by its supply current and returns the average current in uA; the energy per hour
+is that times the supply voltage. The `POWER_*_UA` currents are rough typical figures for an ATmega328P at 5 V and 16 MHz (the chip
+alone, without the rest of the board), and should be replaced by measured ones.
+*/
+
+#ifndef POWER_H_
+#define POWER_H_
+
+#include <stdint.h>
+
+#ifndef F_CPU
+#define F_CPU 16000000UL
+#endif
+
+#define POWER_IDLE 0
+#define POWER_ADC_NOISE 1
+#define POWER_SAVE 2
+#define POWER_DOWN 3
+#define POWER_MODES 4
+
+#ifdef POWER_ASYNC_CLOCK
+#define POWER_TICKS_PER_SEC (32768UL / 8)
+#else
+#define POWER_TICKS_PER_SEC (F_CPU / 256)
+#endif
+
+#ifndef POWER_WAKE_CYCLES
+#define POWER_WAKE_CYCLES 60 // Wake-up, ISR entry and exit, and a short ISR body
+#endif
+
+#ifndef POWER_ACTIVE_UA
+#define POWER_ACTIVE_UA 9000UL
+#endif
+#ifndef POWER_IDLE_UA
+#define POWER_IDLE_UA 2500UL
+#endif
+#ifndef POWER_ADC_NOISE_UA
+#define POWER_ADC_NOISE_UA 800UL
+#endif
+#ifndef POWER_SAVE_UA
+#define POWER_SAVE_UA 2UL
+#endif
+#ifndef POWER_DOWN_UA
+#define POWER_DOWN_UA 1UL
+#endif
+
+typedef struct {
+	uint32_t awake; // Clock ticks
+	uint32_t asleep[POWER_MODES]; // Clock ticks in each sleep mode
+	uint32_t wakeups;
+} power_stats_t;
+
+void power_init(void);
+uint8_t power_mode(void);
+void power_sleep(void);
+void power_stats(power_stats_t *stats);
+uint32_t power_average_ua(void);
+
+#endif /* POWER_H_ */
@@ -0,0 +1,211 @@
+/*
+The `sched.c` file contains the definitions of the functions declared in the `sched.h` file.
+
+1. **Clock**: `base` is the tick count at the last Timer2 compare match and `interval` the number of ticks until the next one, so the
+current time is `base + TCNT2`. Timer2 runs in CTC mode, so it restarts from 0 at each match and `OCR2A` can be moved without the
+clock drifting.
+
+2. **Tickless Wakeups**: The ISR only advances `base` and programs the next match, either at `wake_at` (the earliest deadline, set by
+`sched_idle()`) or `SCHED_MAX_STEP` ticks ahead, whichever comes first. Deadlines are compared with signed differences, so the 32-bit tick
+counter can wrap (after about 76 hours at 16 MHz) without upsetting the order of tasks.
+
+3. **Running Tasks**: `sched_run()` checks every task against the current time. Tasks run in the main loop, never inside the ISR.
+
+4. **Sleeping**: `sched_sleep()` checks with interrupts off, so an ISR that wakes a task after the check cannot be missed: `sei` lets one
+more instruction run before any interrupt, and that instruction is the `sleep`, which the interrupt then ends.
+*/
+
+#include "sched.h"
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/sleep.h>
+#include <util/atomic.h>
+
+#define SCHED_MAX_STEP 255 // Longest time between compare matches, in ticks
+#define SCHED_MIN_STEP 2 // Shortest step, so OCR2A is never set behind TCNT2
+
+static sched_task_t tasks[SCHED_MAX_TASKS];
+static volatile uint32_t base = 0;
+static volatile uint8_t interval = SCHED_MAX_STEP;
+static volatile uint32_t wake_at = 0;
+
+void sched_init(void) {
+	uint8_t i;
+
+	for (i = 0; i < SCHED_MAX_TASKS; i++)
+	tasks[i].fn = 0;
+	base = 0;
+	interval = SCHED_MAX_STEP;
+	TCCR2A = (1 << WGM21); // CTC mode, TOP = OCR2A
+	TCCR2B = (1 << CS22) | (1 << CS21) | (1 << CS20); // Prescaler of 1024
+	TCNT2 = 0;
+	OCR2A = SCHED_MAX_STEP - 1;
+	TIFR2 = (1 << OCF2A);
+	TIMSK2 = (1 << OCIE2A);
+}
+
+uint32_t sched_now(void) {
+	uint32_t now;
+	uint8_t count;
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		count = TCNT2;
+		now = base;
+		if (TIFR2 & (1 << OCF2A)) { // The match happened but its ISR has not run yet
+			count = TCNT2;
+			now += interval;
+		}
+		now += count;
+	}
+	return now;
+}
+
+uint8_t sched_add(sched_fn fn, uint32_t delay_ms, uint32_t period_ms) {
+	uint8_t i;
+
+	for (i = 0; i < SCHED_MAX_TASKS; i++) {
+		if (!tasks[i].fn)
+		break;
+	}
+	if (i == SCHED_MAX_TASKS)
+	return SCHED_NONE;
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		tasks[i].next = sched_now() + (delay_ms == SCHED_ASLEEP ? 0 : SCHED_MS(delay_ms));
+		tasks[i].period = SCHED_MS(period_ms);
+		tasks[i].asleep = (delay_ms == SCHED_ASLEEP);
+		tasks[i].runs = 0;
+		tasks[i].missed = 0;
+		tasks[i].max_ticks = 0;
+		tasks[i].fn = fn;
+	}
+	return i;
+}
+
+void sched_remove(uint8_t id) {
+	if (id < SCHED_MAX_TASKS)
+	tasks[id].fn = 0;
+}
+
+// Makes a task due `delay_ms` from now. Safe to call from an ISR.
+void sched_wake_in(uint8_t id, uint32_t delay_ms) {
+	if (id >= SCHED_MAX_TASKS)
+	return;
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		tasks[id].next = sched_now() + SCHED_MS(delay_ms);
+		tasks[id].asleep = 0;
+	}
+}
+
+void sched_wake(uint8_t id) {
+	sched_wake_in(id, 0);
+}
+
+void sched_run(void) {
+	uint8_t i, asleep;
+	uint32_t now, start, next, ticks;
+	sched_task_t *t;
+
+	for (i = 0; i < SCHED_MAX_TASKS; i++) {
+		t = &tasks[i];
+		if (!t->fn)
+		continue;
+
+		ATOMIC_BLOCK(ATOMIC_RESTORESTATE) { // sched_wake may change these from an ISR
+			asleep = t->asleep;
+			next = t->next;
+		}
+		start = sched_now();
+		if (asleep || (int32_t)(start - next) < 0)
+		continue;
+
+		if (t->period) {
+			next += t->period;
+			if ((int32_t)(start - next) >= 0) { // Fell a whole period behind, skip ahead
+				t->missed++;
+				next = start + t->period;
+			}
+		}
+		ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+			t->next = next;
+			if (!t->period)
+			t->asleep = 1; // One-shot, set before running so the task can wake itself again
+		}
+
+		t->fn();
+
+		now = sched_now();
+		ticks = now - start;
+		if (ticks > t->max_ticks)
+		t->max_ticks = ticks > 0xFFFF ? 0xFFFF : ticks;
+		t->runs++;
+	}
+}
+
+// Returns 1 if no task is due, after setting the Timer2 wakeup for the earliest deadline
+uint8_t sched_idle(void) {
+	uint8_t i, asleep;
+	uint32_t now = sched_now(), next, until, soonest;
+	uint32_t earliest = now + SCHED_MAX_STEP;
+
+	for (i = 0; i < SCHED_MAX_TASKS; i++) {
+		if (!tasks[i].fn)
+		continue;
+		ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+			asleep = tasks[i].asleep;
+			next = tasks[i].next;
+		}
+		if (asleep)
+		continue;
+		if ((int32_t)(now - next) >= 0)
+		return 0; // Something is due already
+		if ((int32_t)(next - earliest) < 0)
+		earliest = next;
+	}
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		wake_at = earliest;
+		until = wake_at - base;
+		soonest = (uint32_t)TCNT2 + SCHED_MIN_STEP; // OCR2A must stay ahead of TCNT2
+		if (until < soonest)
+		until = soonest;
+		if (until < interval) { // The deadline comes before the next match, bring the match forward
+			interval = until;
+			OCR2A = until - 1;
+		}
+	}
+	return 1;
+}
+
+// Sleeps until the next interrupt if no task is due. Call it with interrupts on, it returns with them on.
+void sched_sleep(void) {
+	cli();
+	if (sched_idle()) {
+		set_sleep_mode(SLEEP_MODE_IDLE);
+		sleep_enable();
+		sei();
+		sleep_cpu();
+		sleep_disable();
+	}
+	sei();
+}
+
+const sched_task_t *sched_stats(uint8_t id) {
+	return id < SCHED_MAX_TASKS ? &tasks[id] : 0;
+}
+
+ISR(TIMER2_COMPA_vect) {
+	int32_t until;
+	uint8_t step;
+
+	base += interval;
+	until = (int32_t)(wake_at - base);
+	if (until <= 0 || until > SCHED_MAX_STEP)
+	step = SCHED_MAX_STEP; // Already due or far away, just keep the clock going
+	else if (until < SCHED_MIN_STEP)
+	step = SCHED_MIN_STEP;
+	else
+	step = until;
+	interval = step;
+	OCR2A = step - 1;
+}
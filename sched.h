@@ -0,0 +1,66 @@
+/*
+The `sched.h` file declares a small cooperative task scheduler that replaces `_delay_ms` loops.
+
+1. **Tasks**: A task is a plain `void f(void)` function that does a short piece of work and returns. `sched_add()` registers it with a
+first delay and a period; a period of 0 makes it a one-shot task that runs once and then stays asleep until `sched_wake()` is called.
+A first delay of `SCHED_ASLEEP` adds the task asleep, which is handy for work that an ISR kicks off with `sched_wake()`. A one-shot task
+can call `sched_wake_in()` on itself to run again after a delay that changes from run to run.
+Tasks never interrupt each other, so they don't need locks to share variables with each other (only with ISRs).
+
+2. **Time Base**: Timer2 counts at F_CPU / 1024, which is one tick every 64 us at 16 MHz. Times are given in milliseconds and converted
+with `SCHED_MS()`. The timer is tickless: instead of interrupting every millisecond, its compare match is set to the next deadline (at
+most 255 ticks, 16 ms, ahead), so an idle system gets very few interrupts.
+
+3. **Main Loop**: Call `sched_run()` and then `sched_sleep()` over and over from the main loop. `sched_run()` runs every task that is due
+and returns. `sched_sleep()` puts the CPU in idle mode until the next interrupt if nothing is due, after moving the Timer2 match to the
+earliest deadline, so the CPU wakes up in time for it. Idle is the deepest mode in which the synchronous Timer2 keeps counting.
+`sched_idle()` is the check on its own, for a caller that sleeps some other way.
+
+4. **Statistics**: Each task keeps its run count, its longest run time (in ticks) and the number of deadlines it missed because an
+earlier task ran too long. A periodic task that falls behind skips the missed runs instead of running several times in a row.
+*/
+
+#ifndef SCHED_H_
+#define SCHED_H_
+
+#include <stdint.h>
+
+#ifndef F_CPU
+#define F_CPU 16000000UL
+#endif
+
+#ifndef SCHED_MAX_TASKS
+#define SCHED_MAX_TASKS 8
+#endif
+
+#define SCHED_TICKS_PER_SEC (F_CPU / 1024) // Timer2 clock with a 1024 prescaler
+#define SCHED_MS(ms) ((uint32_t)(ms) * SCHED_TICKS_PER_SEC / 1000) // Milliseconds to scheduler ticks
+#define SCHED_TICK_US (1000000UL / SCHED_TICKS_PER_SEC) // Tick length, 64 us at 16 MHz
+
+#define SCHED_ASLEEP 0xFFFFFFFFUL // sched_add delay for a task that waits for sched_wake
+#define SCHED_NONE 0xFF // Returned by sched_add when the task table is full
+
+typedef void (*sched_fn)(void);
+
+typedef struct {
+	sched_fn fn; // 0 for a free slot
+	uint32_t next; // Deadline in ticks
+	uint32_t period; // Ticks between runs, 0 for a one-shot task
+	uint8_t asleep; // 1 for a one-shot task that has run and waits for sched_wake
+	uint16_t runs; // Times the task has run
+	uint16_t missed; // Deadlines missed because the scheduler was busy
+	uint16_t max_ticks; // Longest run time
+} sched_task_t;
+
+void sched_init(void);
+uint8_t sched_add(sched_fn fn, uint32_t delay_ms, uint32_t period_ms);
+void sched_remove(uint8_t id);
+void sched_wake(uint8_t id);
+void sched_wake_in(uint8_t id, uint32_t delay_ms);
+void sched_run(void);
+uint8_t sched_idle(void);
+void sched_sleep(void);
+uint32_t sched_now(void);
+const sched_task_t *sched_stats(uint8_t id);
+
+#endif /* SCHED_H_ */
@@ -0,0 +1,192 @@
+/*
+The `servo_motion.c` file contains the definitions of the functions declared in the `servo_motion.h` file.
+
+1. **Trapezoid**: Every frame the ISR picks the fastest speed, up to `vmax` and within `amax` of the last one, from which braking by `amax`
+every frame still stops at the target. It speeds up if it can, holds its speed if it must, and slows down otherwise, so it never passes the
+target. If the target is moved behind the servo, it first brakes to a stop.
+
+2. **S-Curve**: The cycloidal move over T frames is p(t) = p0 + D * (u - sin(2 pi u) / 2 pi) with u = t / T. Its peak speed is 2D / T and
+its peak acceleration 2 pi D / T^2, so `servo_move_to` picks the larger of the two T values that respect `vmax` and `amax`. The sine
+comes from the quarter wave table in `fixmath_tables.h`, with u in 1/256 steps.
+
+3. **Sharing**: `servo_move_to` fills in the move while the Timer1 overflow interrupt is held off, so the ISR never sees half a move.
+*/
+
+#ifndef F_CPU
+#define F_CPU 16000000UL
+#endif
+
+#include "servo_motion.h"
+#include "fixmath.h"
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+#include <util/atomic.h>
+
+#define Q8(x) ((int32_t)(x) << 8)
+
+static uint8_t profile = SERVO_TRAPEZOID;
+static volatile uint8_t busy = 0;
+
+static int32_t pos; // Current position, Q8 ticks
+static int32_t target; // Target position, Q8 ticks
+static int32_t vel; // Signed speed, Q8 ticks per frame
+static int32_t vmax_frame; // Q8 ticks per frame
+static int32_t amax_frame; // Q8 ticks per frame per frame, at least 1
+
+static int32_t start; // S-curve start position, Q8 ticks
+static int32_t distance; // S-curve signed distance, whole ticks
+static uint32_t frames; // S-curve length T in frames, more than 16 bits when vmax is small
+static uint32_t frame; // S-curve frames done so far
+
+void servo_init(uint16_t position) {
+	ICR1 = SERVO_TOP; // Set TOP value for timer/counter 1
+
+	TCCR1A = (1 << WGM11) | (1 << COM1A1); // Fast PWM, TOP = ICR1, OC1A (PB1) output
+	TCCR1B = (1 << WGM12) | (1 << WGM13) | SERVO_CS; // Prescaler of 8 at 16 MHz
+	DDRB |= (1 << PB1); // Configure OC1A (PB1) as output
+
+	OCR1A = position;
+	pos = target = Q8(position);
+	vel = 0;
+	busy = 0;
+	TIMSK1 |= (1 << TOIE1); // Once per frame
+}
+
+void servo_profile(uint8_t new_profile) {
+	profile = new_profile;
+}
+
+// Integer square root, rounded down
+static uint16_t isqrt32(uint32_t x) {
+	uint16_t r = 0, bit;
+
+	for (bit = 0x8000; bit; bit >>= 1) {
+		if ((uint32_t)(r | bit) * (r | bit) <= x)
+		r |= bit;
+	}
+	return r;
+}
+
+void servo_move_to(uint16_t position, uint16_t vmax, uint16_t amax) {
+	uint32_t dist, t_vel, t_acc;
+
+	if (position < SERVO_MIN)
+	position = SERVO_MIN;
+	else if (position > SERVO_MAX)
+	position = SERVO_MAX;
+	if (vmax == 0 || amax == 0)
+	return;
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		target = Q8(position);
+		vmax_frame = ((int32_t)vmax << 8) / SERVO_FRAME_HZ;
+		if (vmax_frame > 0x7FFF)
+		vmax_frame = 0x7FFF; // Keeps the stopping distance math inside 32 bits
+		amax_frame = ((int32_t)amax << 8) / ((int32_t)SERVO_FRAME_HZ * SERVO_FRAME_HZ);
+		if (amax_frame < 1)
+		amax_frame = 1;
+
+		if (profile == SERVO_SCURVE) {
+			start = pos;
+			distance = (int32_t)position - (pos >> 8);
+			dist = distance < 0 ? -distance : distance;
+			// T >= 2D / v and T >= sqrt(2 pi D / a), all in frames
+			t_vel = ((dist << 9) + vmax_frame - 1) / vmax_frame;
+			t_acc = isqrt32(((dist << 8) * 201 / 32 + amax_frame - 1) / amax_frame) + 1; // 201 / 32 = 2 pi
+			frames = t_vel > t_acc ? t_vel : t_acc;
+			if (frames == 0)
+			frames = 1;
+			frame = 0;
+			vel = 0;
+		}
+		busy = (target != pos);
+	}
+}
+
+uint8_t servo_busy(void) {
+	return busy;
+}
+
+uint16_t servo_position(void) {
+	uint16_t p;
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		p = pos >> 8;
+	}
+	return p;
+}
+
+// sin(2 pi u / 256) in Q15, for u = 0 to 256
+static int16_t sin_turn(uint8_t quadrant, uint8_t i) {
+	switch (quadrant & 3) {
+		case 0: return pgm_read_word(&fix_sine_q15[i]);
+		case 1: return pgm_read_word(&fix_sine_q15[FIX_SINE_STEPS - i]);
+		case 2: return -(int16_t)pgm_read_word(&fix_sine_q15[i]);
+		default: return -(int16_t)pgm_read_word(&fix_sine_q15[FIX_SINE_STEPS - i]);
+	}
+}
+
+static void scurve_step(void) {
+	uint16_t u;
+	int32_t offset;
+
+	if (++frame >= frames) {
+		pos = target;
+		busy = 0;
+		return;
+	}
+	u = (uint32_t)frame * 256 / frames; // 0 to 255
+	offset = distance * u; // D * u / 256 ticks, which is D * u in Q8
+	// D * sin(2 pi u) / 2 pi in Q8. The sine is Q15 and 1 / 2 pi = 10430 / 65536, so this is D * sin * 10430 / 2^23, split to fit 32 bits.
+	offset -= ((distance * sin_turn(u >> 6, u & 63)) >> 10) * 10430 >> 13;
+	pos = start + offset;
+}
+
+// Distance covered braking from `speed` by amax every frame: (speed - a) + (speed - 2a) + ... until it would be 0
+static uint32_t braking(uint32_t speed) {
+	uint32_t n = speed / amax_frame;
+
+	return n * speed - (uint32_t)amax_frame * n * (n + 1) / 2;
+}
+
+static void trapezoid_step(void) {
+	int32_t d = target - pos;
+	int32_t dir = d >= 0 ? 1 : -1;
+	uint32_t dist = d >= 0 ? d : -d;
+	uint32_t speed = vel >= 0 ? vel : -vel;
+	uint32_t next;
+
+	if (vel * dir < 0) { // Moving away from the target, brake first
+		vel += dir * amax_frame;
+		if (vel * dir > 0)
+		vel = 0;
+	} else {
+		if (speed < (uint32_t)vmax_frame) // Speed up
+		next = speed + amax_frame < (uint32_t)vmax_frame ? speed + amax_frame : (uint32_t)vmax_frame;
+		else // Cruise, or slow down to a lower vmax
+		next = speed > (uint32_t)(vmax_frame + amax_frame) ? speed - amax_frame : (uint32_t)vmax_frame;
+		if (next > speed && next + braking(next) > dist)
+		next = speed;
+		if (next + braking(next) > dist) // Could not stop in time from there, slow down now
+		next = speed > (uint32_t)amax_frame ? speed - amax_frame : (amax_frame < (int32_t)dist ? amax_frame : dist); // Creep the last bit
+		vel = dir * (int32_t)next;
+	}
+
+	pos += vel;
+	if ((target - pos) * dir <= 0 && speed <= (uint32_t)amax_frame) { // Arrived, or passed it at a crawl
+		pos = target;
+		vel = 0;
+		busy = 0;
+	}
+}
+
+ISR(TIMER1_OVF_vect) {
+	if (!busy)
+	return;
+	if (profile == SERVO_SCURVE)
+	scurve_step();
+	else
+	trapezoid_step();
+	OCR1A = pos >> 8; // Used from the start of the next frame
+}
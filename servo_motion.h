@@ -0,0 +1,47 @@
+/*
+The `servo_motion.h` file declares a non-blocking motion engine for a hobby servo on OC1A (PB1).
+
+1. **Frames**: Timer1 makes the 50 Hz servo signal in fast PWM mode with TOP = ICR1, like `Week 4/Servo_Interfacing.c`. The
+`TIMER1_OVF_vect` ISR runs once at the end of every 20 ms frame and works out the pulse width for the next frame, so the speed of a move
+no longer depends on how long the main loop takes. `OCR1A` is double-buffered by the hardware in this mode, so a new value never cuts a
+pulse short.
+
+2. **Moves**: `servo_move_to(pos, vmax, amax)` starts a move to `pos` and returns at once. Positions are `OCR1A` values (0.5 us ticks at
+16 MHz; `SERVO_TOP`, `SERVO_MIN` and `SERVO_MAX` come from `timer_calc.h`, so they follow `F_CPU`),
+`vmax` is in ticks per second and `amax` in ticks per second squared. `servo_busy()` returns 1 until the servo has reached `pos`.
+
+3. **Profiles**: `SERVO_TRAPEZOID` speeds up at `amax`, cruises at `vmax` and slows down at `amax`, and can retarget a move in progress.
+`SERVO_SCURVE` follows a cycloidal curve, where the acceleration itself ramps up and down smoothly so the arm does not jerk at the start
+and end of a move. Its duration is picked so neither `vmax` nor `amax` is exceeded. An S-curve move always starts from the current position
+at rest.
+
+All of the math is done in integers; positions and speeds are kept in 1/256 tick units (Q8).
+*/
+
+#ifndef SERVO_MOTION_H_
+#define SERVO_MOTION_H_
+
+#include <stdint.h>
+#include "timer_calc.h"
+
+#define SERVO_FRAME_HZ 50 // PWM frames per second
+#define SERVO_FRAME TIMER_HZ(SERVO_FRAME_HZ)
+#define SERVO_CS TIMER_CS(1, SERVO_FRAME) // Prescaler of 8 at 16 MHz
+#define SERVO_TOP TIMER_TOP(1, SERVO_FRAME) // 39999 at 16 MHz: 2MHz / 50Hz = 40000
+#define SERVO_MIN TIMER_PULSE(1, SERVO_FRAME, TIMER_US(500)) // Minimum pulse width of 0.5ms
+#define SERVO_MAX TIMER_PULSE(1, SERVO_FRAME, TIMER_US(2400)) // Maximum pulse width of 2.4ms
+
+#if !TIMER_OK(1, SERVO_FRAME, 1000)
+#error "Timer1 cannot make the servo frame rate at this F_CPU"
+#endif
+
+#define SERVO_TRAPEZOID 0
+#define SERVO_SCURVE 1
+
+void servo_init(uint16_t position);
+void servo_profile(uint8_t profile);
+void servo_move_to(uint16_t position, uint16_t vmax, uint16_t amax);
+uint8_t servo_busy(void);
+uint16_t servo_position(void);
+
+#endif /* SERVO_MOTION_H_ */
@@ -0,0 +1,177 @@
+/*
+The `servo_mux.c` file contains the definitions of the functions declared in the `servo_mux.h` file.
+
+1. **Buffers**: `working` is only touched by the main program. `servo_mux_commit()` copies it to `shadow` with interrupts off and sets
+`pending`. The ISR builds the edge list from `shadow`, so neither side ever sees the other half-way through an update.
+
+2. **Edge List**: `edge_at` holds the distinct pulse widths in rising order and `edge_mask` the pins that drop at each one. The compare
+values are offset by `rise`, the `TCNT1` value just after the pins went high, so the fixed delay of entering the frame ISR is taken off
+every pulse.
+
+3. **Measuring**: A rising edge is late by `rise` ticks. A falling edge should come `width` ticks after the rise, and the difference is
+its error. Only the worst values are kept.
+*/
+
+#include "servo_mux.h"
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <util/atomic.h>
+
+static uint8_t pins_allowed = 0;
+static uint16_t working[SERVO_MUX_CHANNELS]; // Main program copy
+static uint16_t shadow[SERVO_MUX_CHANNELS]; // Committed copy, read by the ISR
+static volatile uint8_t pending = 0;
+
+static uint16_t edge_at[SERVO_MUX_CHANNELS];
+static uint8_t edge_mask[SERVO_MUX_CHANNELS];
+static uint8_t edge_count = 0;
+static uint8_t edge_next = 0;
+static uint8_t active = 0; // Pins raised at the frame start
+static uint16_t rise = 0;
+
+static volatile uint8_t measure = 0;
+static volatile servo_mux_jitter_t jitter;
+
+void servo_mux_init(uint8_t pins) {
+	uint8_t i;
+
+	pins_allowed = pins;
+	for (i = 0; i < SERVO_MUX_CHANNELS; i++)
+	working[i] = shadow[i] = 0;
+	edge_count = 0;
+	active = 0;
+	pending = 0;
+
+	SERVO_MUX_PORT &= ~pins;
+	SERVO_MUX_DDR |= pins;
+
+	OCR1A = SERVO_MUX_TOP; // Set TOP value for timer/counter 1
+	TCCR1A = 0; // CTC mode, TOP = OCR1A, output pins not used
+	TCCR1B = (1 << WGM12) | SERVO_MUX_CS; // Prescaler of 8 at 16 MHz
+	TCNT1 = 0;
+	TIFR1 = (1 << OCF1A) | (1 << OCF1B);
+	TIMSK1 = (1 << OCIE1A);
+}
+
+// A width of 0 turns the channel off, others are clamped to SERVO_MUX_MIN..SERVO_MUX_MAX. Takes effect at servo_mux_commit().
+void servo_mux_set(uint8_t channel, uint16_t width) {
+	if (channel >= SERVO_MUX_CHANNELS || !(pins_allowed & (1 << channel)))
+	return;
+	if (width && width < SERVO_MUX_MIN)
+	width = SERVO_MUX_MIN;
+	else if (width > SERVO_MUX_MAX)
+	width = SERVO_MUX_MAX;
+	working[channel] = width;
+}
+
+void servo_mux_commit(void) {
+	uint8_t i;
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		for (i = 0; i < SERVO_MUX_CHANNELS; i++)
+		shadow[i] = working[i];
+		pending = 1;
+	}
+}
+
+// Returns 1 while a commit has not reached the output yet
+uint8_t servo_mux_pending(void) {
+	return pending;
+}
+
+void servo_mux_measure(uint8_t on) {
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		jitter.rise_max = 0;
+		jitter.width_max = 0;
+		jitter.frames = 0;
+		measure = on;
+	}
+}
+
+void servo_mux_jitter(servo_mux_jitter_t *out) {
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		out->rise_max = jitter.rise_max;
+		out->width_max = jitter.width_max;
+		out->frames = jitter.frames;
+	}
+}
+
+// Sorts the committed widths into the edge list, merging equal widths. Runs in an ISR between frames.
+static void build_edges(void) {
+	uint8_t ch, i, j;
+	uint16_t width;
+
+	edge_count = 0;
+	active = 0;
+	for (ch = 0; ch < SERVO_MUX_CHANNELS; ch++) {
+		width = shadow[ch];
+		if (!width)
+		continue;
+		active |= (1 << ch);
+
+		for (i = 0; i < edge_count && edge_at[i] < width; i++);
+		if (i < edge_count && edge_at[i] == width) {
+			edge_mask[i] |= (1 << ch);
+			continue;
+		}
+		for (j = edge_count; j > i; j--) { // Insertion sort, at most 8 entries
+			edge_at[j] = edge_at[j - 1];
+			edge_mask[j] = edge_mask[j - 1];
+		}
+		edge_at[i] = width;
+		edge_mask[i] = (1 << ch);
+		edge_count++;
+	}
+	pending = 0;
+}
+
+ISR(TIMER1_COMPA_vect) {
+	if (pending)
+	build_edges(); // Committed after the last edge of the frame before, or with no pins active
+	if (!active)
+	return;
+
+	SERVO_MUX_PORT |= active;
+	rise = TCNT1;
+	edge_next = 0;
+	OCR1B = edge_at[0] + rise;
+	TIFR1 = (1 << OCF1B);
+	TIMSK1 |= (1 << OCIE1B);
+
+	if (measure) {
+		if (rise > jitter.rise_max)
+		jitter.rise_max = rise;
+		jitter.frames++;
+	}
+}
+
+ISR(TIMER1_COMPB_vect) {
+	uint16_t at, now;
+	int16_t error;
+
+	for (;;) {
+		SERVO_MUX_PORT &= ~edge_mask[edge_next];
+		if (measure) {
+			error = (int16_t)(TCNT1 - rise - edge_at[edge_next]);
+			if (error < 0)
+			error = -error;
+			if ((uint16_t)error > jitter.width_max)
+			jitter.width_max = error;
+		}
+
+		if (++edge_next >= edge_count) { // Last edge of the frame
+			TIMSK1 &= ~(1 << OCIE1B);
+			if (pending)
+			build_edges(); // Ready before the next frame starts
+			return;
+		}
+
+		at = edge_at[edge_next] + rise;
+		now = TCNT1;
+		if ((int16_t)(at - now) > SERVO_MUX_GUARD) {
+			OCR1B = at;
+			return;
+		}
+		while ((int16_t)(TCNT1 - at) < 0); // Too close for another interrupt, wait here
+	}
+}
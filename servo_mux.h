@@ -0,0 +1,60 @@
+/*
+The `servo_mux.h` file declares a driver that runs up to 8 servos from Timer1, one output pin each.
+
+1. **Frames**: Timer1 runs in CTC mode with TOP = `OCR1A` = 39999 and a prescaler of 8 at 16 MHz, so a frame is 20 ms, as in
+`Week 4/Servo_Interfacing.c`. At the start of every frame `TIMER1_COMPA_vect` sets all active servo pins high at once. The servo pins are
+plain port pins (bit n of `SERVO_MUX_PORT` is channel n) rather than OC1A/OC1B, so any number of them can share the timer.
+
+2. **Sorted Edges**: The pulse widths are sorted from shortest to longest, and channels with the same width are merged into one edge.
+`TIMER1_COMPB_vect` clears the pins of one edge and moves `OCR1B` on to the next, so there is one compare interrupt per distinct width.
+When two edges are closer than `SERVO_MUX_GUARD` ticks, there is no time to leave and enter the ISR again, so it waits for the second edge
+in a loop instead.
+
+3. **Double Buffering**: `servo_mux_set()` only changes a working copy. `servo_mux_commit()` hands the whole set over at once, and the ISR
+sorts it after the last edge of the current frame, or at the start of the next one if that edge has passed, so the next frame starts with
+all of the new widths. A pulse is never cut short or
+stretched by an update made halfway through a frame.
+
+4. **Jitter**: With `servo_mux_measure(1)`, the ISRs read `TCNT1` at every edge. `servo_mux_jitter()` then reports how late the rising
+edge came after the start of the frame and how far each pulse was from its set width, both as worst cases in timer ticks (0.5 us).
+
+Timer1 is used for the whole frame, so this driver cannot be linked with `servo_motion.c` or `echo.c`.
+*/
+
+#ifndef SERVO_MUX_H_
+#define SERVO_MUX_H_
+
+#include <stdint.h>
+#include "timer_calc.h"
+
+#ifndef SERVO_MUX_PORT
+#define SERVO_MUX_PORT PORTD // PD0 and PD1 are the UART pins, leave them out of the mask when the UART is used
+#define SERVO_MUX_DDR DDRD
+#endif
+
+#define SERVO_MUX_CHANNELS 8
+#define SERVO_MUX_FRAME TIMER_HZ(50)
+#define SERVO_MUX_CS TIMER_CS(1, SERVO_MUX_FRAME) // Prescaler of 8 at 16 MHz
+#define SERVO_MUX_TOP TIMER_TOP(1, SERVO_MUX_FRAME) // 39999 at 16 MHz: 2MHz / 50Hz = 40000
+#define SERVO_MUX_MIN TIMER_PULSE(1, SERVO_MUX_FRAME, TIMER_US(500)) // Minimum pulse width of 0.5ms
+#define SERVO_MUX_MAX TIMER_PULSE(1, SERVO_MUX_FRAME, TIMER_US(2400)) // Maximum pulse width of 2.4ms
+#define SERVO_MUX_GUARD 12 // Edges closer than this (6 us) are handled in one ISR
+
+#if !TIMER_OK(1, SERVO_MUX_FRAME, 1000)
+#error "Timer1 cannot make the servo frame rate at this F_CPU"
+#endif
+
+typedef struct {
+	uint16_t rise_max; // Latest rising edge after the frame start, in ticks
+	uint16_t width_max; // Largest error of a pulse width, in ticks
+	uint16_t frames; // Frames measured
+} servo_mux_jitter_t;
+
+void servo_mux_init(uint8_t pins);
+void servo_mux_set(uint8_t channel, uint16_t width);
+void servo_mux_commit(void);
+uint8_t servo_mux_pending(void);
+void servo_mux_measure(uint8_t on);
+void servo_mux_jitter(servo_mux_jitter_t *out);
+
+#endif /* SERVO_MUX_H_ */
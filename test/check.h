@@ -0,0 +1,30 @@
+/*
+The `check.h` file has the two macros the host tests in `test/` are written with. `CHECK(cond, format, ...)` prints the file, the line
+and the message when `cond` is false and counts the failure, and `check_done()` prints the total and gives the exit status for `main()`.
+*/
+
+#ifndef TEST_CHECK_H_
+#define TEST_CHECK_H_
+
+#include <stdio.h>
+
+static int check_failures = 0;
+static int check_count = 0;
+
+#define CHECK(cond, ...) \
+	do { \
+		check_count++; \
+		if (!(cond)) { \
+			check_failures++; \
+			printf("%s:%d: FAIL ", __FILE__, __LINE__); \
+			printf(__VA_ARGS__); \
+			printf("\n"); \
+		} \
+	} while (0)
+
+static inline int check_done(void) {
+	printf("%d checks, %d failures\n", check_count, check_failures);
+	return check_failures ? 1 : 0;
+}
+
+#endif /* TEST_CHECK_H_ */
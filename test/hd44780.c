@@ -0,0 +1,203 @@
+/*
+The `hd44780.c` file contains the definitions of the functions declared in the `hd44780.h` file.
+
+1. **Decoding**: `byte()` runs one instruction or data byte. Instructions that only change the look of the display (display control,
+cursor shift) are accepted and ignored. A nibble that arrives while the controller is in 4-bit mode with RS different from the first
+nibble of its byte counts as an error, since the two halves of a byte are then out of step.
+
+2. **Timing**: `hd44780_exec_us()` decodes the instruction itself rather than using `lcd_timing.h`, so a test can hold the driver's table
+against it. `busy_until` is the cycle the last byte finishes, at the oscillator frequency `osc_khz`.
+
+3. **PCF8574**: The expander drives its pins straight from every byte written to it, so `pcf8574()` watches E in those bytes the way
+`portd_changed()` watches PD3.
+*/
+
+#include "hd44780.h"
+#include "sim.h"
+#include <string.h>
+
+#define DDRAM_SIZE 0x80
+#define CGRAM_SIZE 64
+#define CYCLES_PER_US (F_CPU / 1000000)
+#define NOMINAL_KHZ 270
+
+// Expander pins of the backpack
+#define PCF_RS 0x01
+#define PCF_E 0x04
+
+static uint8_t ddram[DDRAM_SIZE];
+static uint8_t cgram[CGRAM_SIZE];
+static uint8_t address = 0; // Address counter
+static uint8_t in_cgram = 0; // 1 when the address counter points into CGRAM
+static uint8_t four_bit = 0;
+static uint8_t half = 0; // 1 after the first nibble of a byte in 4-bit mode
+static uint8_t half_rs, half_nibble;
+static uint32_t bytes = 0, cgram_bytes = 0, errors = 0, late = 0;
+static uint64_t busy_until = 0;
+static uint16_t osc_khz = NOMINAL_KHZ;
+
+static uint8_t pcf_address;
+static uint8_t pcf_selected = 0; // 1 while a write to the expander is on the bus
+static uint8_t pcf_first = 0; // 1 when the next byte is SLA+R/W
+static uint8_t pcf_pins = 0;
+
+void hd44780_reset(void) {
+	memset(ddram, ' ', sizeof(ddram));
+	memset(cgram, 0, sizeof(cgram));
+	address = 0;
+	in_cgram = 0;
+	four_bit = 0;
+	half = 0;
+	bytes = cgram_bytes = errors = late = 0;
+	busy_until = 0;
+}
+
+// Stretches the execution times to those of an oscillator at `khz`
+void hd44780_oscillator(uint16_t khz) {
+	osc_khz = khz;
+}
+
+// Datasheet execution time of a byte
+uint16_t hd44780_exec_us(uint8_t rs, uint8_t value) {
+	if (rs)
+	return 41;
+	if (value == 0x01 || (value & 0xFE) == 0x02)
+	return 1520;
+	return 37;
+}
+
+static void byte(uint8_t rs, uint8_t value) {
+	bytes++;
+	busy_until = sim_cycles + (uint64_t)hd44780_exec_us(rs, value) * CYCLES_PER_US * NOMINAL_KHZ / osc_khz;
+	if (rs) {
+		if (in_cgram) {
+			cgram[address & (CGRAM_SIZE - 1)] = value & 0x1F;
+			address = (address + 1) & (CGRAM_SIZE - 1);
+			cgram_bytes++;
+		} else {
+			ddram[address & (DDRAM_SIZE - 1)] = value;
+			address = (address + 1) & (DDRAM_SIZE - 1);
+		}
+	} else if (value & 0x80) { // Set DDRAM address
+		address = value & 0x7F;
+		in_cgram = 0;
+	} else if (value & 0x40) { // Set CGRAM address
+		address = value & 0x3F;
+		in_cgram = 1;
+	} else if (value & 0x20) // Function set
+	four_bit = !(value & 0x10);
+	else if (value == 0x01) { // Clear
+		memset(ddram, ' ', sizeof(ddram));
+		address = 0;
+		in_cgram = 0;
+	} else if ((value & 0xFE) == 0x02) { // Home
+		address = 0;
+		in_cgram = 0;
+	}
+}
+
+void hd44780_nibble(uint8_t rs, uint8_t nibble) {
+	nibble &= 0x0F;
+	if (sim_cycles < busy_until)
+	late++;
+	if (!four_bit) {
+		byte(rs, nibble << 4);
+		return;
+	}
+	if (!half) {
+		half_rs = rs;
+		half_nibble = nibble;
+		half = 1;
+		return;
+	}
+	half = 0;
+	if (rs != half_rs)
+	errors++;
+	byte(rs, (half_nibble << 4) | nibble);
+}
+
+static void portd_changed(uint8_t port, uint8_t before, uint8_t after) {
+	if (port == SIM_PORTD && (before & (1 << 3)) && !(after & (1 << 3))) // E falls
+	hd44780_nibble((after >> 2) & 1, after >> 4);
+}
+
+void hd44780_watch_portd(void) {
+	hd44780_reset();
+	sim_watch(portd_changed);
+}
+
+static uint8_t pcf8574(uint8_t event, uint8_t data) {
+	if (event == SIM_TWI_START) {
+		pcf_first = 1;
+		pcf_selected = 0;
+		return 1;
+	}
+	if (event == SIM_TWI_STOP) {
+		pcf_selected = 0;
+		return 1;
+	}
+	if (event == SIM_TWI_READ)
+	return pcf_pins;
+	if (pcf_first) {
+		pcf_first = 0;
+		pcf_selected = data == (pcf_address << 1); // SLA+W
+		return pcf_selected;
+	}
+	if (!pcf_selected)
+	return 0;
+	if (!(pcf_pins & PCF_E) && (data & PCF_E) && ((pcf_pins ^ data) & PCF_RS))
+	errors++; // RS not set up before E rose
+	if ((pcf_pins & PCF_E) && !(data & PCF_E))
+	hd44780_nibble(data & PCF_RS, data >> 4);
+	pcf_pins = data;
+	return 1;
+}
+
+void hd44780_watch_pcf8574(uint8_t address) {
+	hd44780_reset();
+	pcf_address = address;
+	pcf_pins = 0;
+	sim_twi(pcf8574);
+}
+
+// Character code in DDRAM at a cell of the 2x16 display
+uint8_t hd44780_char(uint8_t row, uint8_t col) {
+	return ddram[(row ? 0x40 : 0) + col];
+}
+
+const uint8_t *hd44780_cgram(uint8_t slot) {
+	return cgram + 8 * (slot & 7);
+}
+
+// Pixel (x, y) of a cell, x = 0 at the left, or -1 for a ROM character other than the space and the full block
+int hd44780_pixel(uint8_t row, uint8_t col, uint8_t y, uint8_t x) {
+	uint8_t c = hd44780_char(row, col);
+
+	if (c < 16)
+	return (cgram[8 * (c & 7) + y] >> (4 - x)) & 1;
+	if (c == 0xFF)
+	return 1;
+	if (c == ' ')
+	return 0;
+	return -1;
+}
+
+// Bytes received, instructions and data
+uint32_t hd44780_bytes(void) {
+	return bytes;
+}
+
+// Data bytes written into CGRAM
+uint32_t hd44780_cgram_bytes(void) {
+	return cgram_bytes;
+}
+
+// Bytes whose two nibbles had a different RS, and on the PCF8574 nibbles whose RS changed as E rose
+uint32_t hd44780_errors(void) {
+	return errors;
+}
+
+// Nibbles that came before the last byte had been executed
+uint32_t hd44780_late(void) {
+	return late;
+}
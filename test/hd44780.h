@@ -0,0 +1,45 @@
+/*
+The `hd44780.h` file declares a virtual HD44780 LCD controller for the host tests, which follows what the LCD drivers send it and keeps
+the display and character memories, so a test can check what a real LCD would show.
+
+1. **Bus**: `hd44780_nibble(rs, nibble)` is one falling edge of E with `nibble` on D7-D4. The controller starts in 8-bit mode, as after
+power on, where every nibble is a whole instruction with D3-D0 low; a function set with DL = 0 switches it to 4-bit mode, where two
+nibbles make one byte. `hd44780_watch_portd()` connects it to the PORTD wiring of `LCD_3.h` (RS on PD2, E on PD3, D4-D7 on PD4-PD7)
+through `sim_watch()`, and `hd44780_watch_pcf8574(address)` to a PCF8574 I2C backpack at that 7-bit address through `sim_twi()`, with
+the usual wiring (RS on P0, RW on P1, E on P2, the backlight on P3, D4-D7 on P4-P7).
+
+2. **Memory**: DDRAM has two rows of 40 characters (the second from address 0x40) and CGRAM 8 characters of 8 pixel rows. Clear fills
+DDRAM with spaces. The address counter moves on by one after every data byte; the driver always uses the increment entry mode.
+
+3. **Execution Time**: Each byte keeps the controller busy for its datasheet time at the nominal 270 kHz oscillator, counted from the
+falling edge of E that completes it: 1.52 ms for clear and home, 37 us for the other instructions and 41 us for a data byte.
+`hd44780_oscillator(khz)` stretches these times the way a slower oscillator would. `hd44780_late()` counts the nibbles that arrived while
+it was still busy, which a real LCD could have lost.
+
+RS must also be set before E rises: on the PCF8574 a byte that raises E and changes RS at once counts in `hd44780_errors()`.
+
+4. **Pixels**: `hd44780_pixel()` gives one pixel of what a cell shows: a CGRAM character (codes 0-7 and their copies at 8-15), the full
+block (0xFF) or a space; any other ROM character gives -1.
+*/
+
+#ifndef TEST_HD44780_H_
+#define TEST_HD44780_H_
+
+#include <stdint.h>
+
+void hd44780_reset(void);
+void hd44780_nibble(uint8_t rs, uint8_t nibble);
+void hd44780_watch_portd(void);
+void hd44780_watch_pcf8574(uint8_t address);
+void hd44780_oscillator(uint16_t khz);
+
+uint8_t hd44780_char(uint8_t row, uint8_t col);
+const uint8_t *hd44780_cgram(uint8_t slot);
+int hd44780_pixel(uint8_t row, uint8_t col, uint8_t y, uint8_t x);
+uint32_t hd44780_bytes(void);
+uint32_t hd44780_cgram_bytes(void);
+uint32_t hd44780_errors(void);
+uint32_t hd44780_late(void);
+uint16_t hd44780_exec_us(uint8_t rs, uint8_t value);
+
+#endif /* TEST_HD44780_H_ */
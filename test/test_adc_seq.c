@@ -0,0 +1,148 @@
+/*
+The `test_adc_seq.c` file checks the oversampling of `adc_seq.c` on the register model, with a synthetic signal fed to every conversion
+through `sim_adc_source()`.
+
+1. **Decimation**: The signal is `base` plus 1 LSB on `k` of every 4^bits conversions, so every group of 4^bits conversions adds up to
+4^bits * base + k whatever its phase, and each result must be exactly that sum shifted right by `bits`.
+
+2. **Noise**: A signal whose results take two known values gives a known peak-to-peak spread, which `adc_seq_noise()` must report in LSBs
+of the oversampled resolution.
+
+3. **Rate**: `adc_seq_rate()` is checked against the datasheet formula, including the 76923 samples/s of one channel at F_CPU / 16, which
+does not fit in 16 bits, and against the number of results the ISR actually delivers in 200 ms of virtual time.
+*/
+
+#include "check.h"
+#include "adc_seq.h"
+#include "sim.h"
+#include <avr/interrupt.h>
+
+#define CYCLES_PER_MS (F_CPU / 1000)
+
+static uint16_t base;
+static uint16_t k;
+static uint8_t period_shift; // Pattern period of 2^period_shift conversions
+static uint8_t alternate; // 1: every other group has k extra LSBs, else every group
+static uint32_t conversions = 0;
+
+static uint16_t signal(uint8_t channel) {
+	uint32_t i = conversions++;
+	uint32_t period = 1UL << period_shift;
+
+	(void)channel;
+	if (alternate && ((i >> period_shift) & 1))
+	return base;
+	return base + ((i & (period - 1)) < k);
+}
+
+static void setup(uint8_t prescale, uint8_t bits, uint16_t b, uint16_t extra, uint8_t alt) {
+	uint16_t stale;
+
+	adc_seq_stop();
+	sim_run(30 * 128); // Let a conversion under way finish
+	base = b;
+	k = extra;
+	period_shift = 2 * bits;
+	alternate = alt;
+	conversions = 0;
+	adc_seq_init(prescale);
+	adc_seq_enable(0, 1);
+	adc_seq_oversample(0, bits);
+	while (adc_seq_available(0)) // Results from the previous setup
+	adc_seq_read(0, &stale, 1);
+	adc_seq_start();
+}
+
+// Takes `n` results of channel 0, running the model until they are there
+static uint8_t take(uint16_t *results, uint8_t n) {
+	uint8_t got = 0;
+	uint32_t waited = 0;
+
+	while (got < n && waited < 1000) {
+		got += adc_seq_read(0, results + got, n - got);
+		sim_run(CYCLES_PER_MS);
+		waited++;
+	}
+	return got;
+}
+
+static void check_decimation(void) {
+	static const uint16_t bases[] = {0, 511, 1022}; // 1022 + 1 LSB is full scale, where the sum is largest
+	uint16_t results[4], want, n, b, extra;
+	uint8_t bits, i, j;
+
+	for (bits = 1; bits <= ADC_SEQ_MAX_OVERSAMPLE; bits++) {
+		n = ADC_SEQ_OVERSAMPLE_COUNT(bits);
+		for (j = 0; j < sizeof(bases) / sizeof(bases[0]) * 4; j++) {
+			b = bases[j / 4];
+			extra = (uint16_t[]){0, 1, n / 2, n - 1}[j % 4];
+			setup(ADC_SEQ_PRESCALE_16, bits, b, extra, 0);
+			want = ((uint32_t)n * b + extra) >> bits;
+			CHECK(take(results, 4) == 4, "bits %u: no results", bits);
+			for (i = 0; i < 4; i++)
+			CHECK(results[i] == want, "bits %u base %u + %u/%u: got %u, want %u", bits, b, extra, n, results[i], want);
+			CHECK(adc_seq_decimate(n * b + extra, bits) == want, "adc_seq_decimate bits %u", bits);
+		}
+	}
+
+	// Full scale at 13 bits: 64 * 1023 = 65472 must not wrap the 16-bit sum
+	setup(ADC_SEQ_PRESCALE_16, 3, 1023, 0, 0);
+	CHECK(take(results, 2) == 2 && results[1] == 8184, "full scale 13-bit: got %u, want 8184", results[1]);
+}
+
+static void check_noise(void) {
+	uint16_t results[ADC_SEQ_NOISE_WINDOW * 2];
+
+	// No oversampling: 500 and 501 on alternate conversions
+	setup(ADC_SEQ_PRESCALE_16, 0, 500, 1, 1);
+	take(results, ADC_SEQ_NOISE_WINDOW * 2);
+	CHECK(adc_seq_noise(0) == 1, "10-bit noise: got %u, want 1", adc_seq_noise(0));
+
+	// 12-bit: every other group of 16 has 8 extra LSBs, so the results are 2000 and 2002
+	setup(ADC_SEQ_PRESCALE_16, 2, 500, 8, 1);
+	take(results, ADC_SEQ_NOISE_WINDOW * 2);
+	CHECK(results[0] == 2000 || results[0] == 2002, "12-bit alternating: got %u", results[0]);
+	CHECK(adc_seq_noise(0) == 2, "12-bit noise: got %u, want 2", adc_seq_noise(0));
+
+	// A steady dithered signal decimates to a constant
+	setup(ADC_SEQ_PRESCALE_16, 2, 500, 5, 0);
+	take(results, ADC_SEQ_NOISE_WINDOW * 2);
+	CHECK(adc_seq_noise(0) == 0, "12-bit steady noise: got %u, want 0", adc_seq_noise(0));
+}
+
+static void check_rate(void) {
+	uint16_t sample;
+	uint32_t got = 0, want;
+	uint64_t end;
+
+	setup(ADC_SEQ_PRESCALE_16, 0, 300, 0, 0);
+	CHECK(adc_seq_rate(0) == 76923, "rate at F_CPU / 16: got %lu, want 76923", (unsigned long)adc_seq_rate(0));
+	CHECK(adc_seq_rate(1) == 0, "rate of a disabled channel: got %lu", (unsigned long)adc_seq_rate(1));
+
+	adc_seq_enable(1, 3); // Channel 1 on every third pass: 3 of 4 conversions are channel 0
+	CHECK(adc_seq_rate(0) == 57692, "rate of channel 0 with 1:3: got %lu, want 57692", (unsigned long)adc_seq_rate(0));
+	CHECK(adc_seq_rate(1) == 19230, "rate of channel 1 with 1:3: got %lu, want 19230", (unsigned long)adc_seq_rate(1));
+	adc_seq_oversample(0, 2);
+	CHECK(adc_seq_rate(0) == 57692 / 16, "12-bit rate of channel 0: got %lu, want %u", (unsigned long)adc_seq_rate(0), 57692 / 16);
+	adc_seq_disable(1);
+
+	// Results delivered at F_CPU / 128 with 4x oversampling, within 5 % of what adc_seq_rate says
+	setup(ADC_SEQ_PRESCALE_128, 1, 300, 0, 0);
+	want = adc_seq_rate(0) / 5; // 200 ms
+	end = sim_cycles + 200 * CYCLES_PER_MS;
+	while (sim_cycles < end) {
+		got += adc_seq_read(0, &sample, 1);
+		sim_run(100);
+	}
+	CHECK(got * 100 >= want * 95 && got * 100 <= want * 105, "results in 200 ms: got %lu, want %lu", (unsigned long)got,
+		(unsigned long)want);
+}
+
+int main(void) {
+	sim_adc_source(signal);
+	sei();
+	check_decimation();
+	check_noise();
+	check_rate();
+	return check_done();
+}
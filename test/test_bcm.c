@@ -0,0 +1,189 @@
+/*
+The `test_bcm.c` file runs `bcm.c` on the register model with all 16 channels, spread over ports B, C and D, and follows the pins with a
+watcher.
+
+1. **Slots**: Stepping the clock in `STEP` cycles, every new `OCR1A` value is one `TIMER1_COMPA_vect`. The values must go through
+`(BCM_BASE_TICKS << plane) - 1` for planes 0 to 7 in order, so exactly 8 interrupts per refresh, and each slot must last as long as its
+value says. After every interrupt each port must show the bit plane of that slot for the driver's pins, and a pin that is not the
+driver's (PC5) must keep its level.
+
+2. **On-Time**: Over 10 refreshes, from one plane 0 to another, every pin must be on for `brightness` / 255 of the time, within a few
+cycles per refresh.
+
+3. **Updates**: New brightness values passed to `bcm_update()` halfway through a refresh must not show before the next plane 0, and must
+all show from there on.
+*/
+
+#include "check.h"
+#include "bcm.h"
+#include "sim.h"
+#include <avr/interrupt.h>
+#include <stdint.h>
+
+#define CYCLES_PER_TICK 8 // Timer1 at F_CPU / 8
+#define REFRESH_CYCLES (255UL * BCM_BASE_TICKS * CYCLES_PER_TICK)
+#define STEP 16 // Cycles between looks at OCR1A, well under the shortest slot
+#define SLACK 24 // Cycles an edge or a slot may be off by, the ISR latency on the register model
+
+static const uint8_t pins[BCM_MAX_CHANNELS] = {BCM_PB(0), BCM_PB(1), BCM_PB(2), BCM_PB(3), BCM_PB(4), BCM_PB(5), BCM_PC(0), BCM_PC(1),
+	BCM_PC(2), BCM_PC(3), BCM_PD(2), BCM_PD(3), BCM_PD(4), BCM_PD(5), BCM_PD(6), BCM_PD(7)};
+static const uint8_t levels_a[BCM_MAX_CHANNELS] = {0, 1, 2, 3, 127, 128, 254, 255, 85, 170, 15, 240, 100, 200, 7, 64};
+static const uint8_t levels_b[BCM_MAX_CHANNELS] = {255, 254, 128, 127, 3, 2, 1, 0, 170, 85, 240, 15, 200, 100, 64, 7};
+
+static uint64_t high_since[3][8], on[3][8];
+static uint8_t high[3];
+
+static void pins_changed(uint8_t port, uint8_t before, uint8_t after) {
+	uint8_t bit;
+
+	for (bit = 0; bit < 8; bit++) {
+		if (!(before & (1 << bit)) && (after & (1 << bit)))
+		high_since[port][bit] = sim_cycles;
+		if ((before & (1 << bit)) && !(after & (1 << bit)))
+		on[port][bit] += sim_cycles - high_since[port][bit];
+	}
+	high[port] = after;
+}
+
+// Cycles the pin has been on since the start
+static uint64_t on_cycles(uint8_t pin) {
+	uint8_t port = pin >> 4, bit = pin & 7;
+
+	return on[port][bit] + ((high[port] & (1 << bit)) ? sim_cycles - high_since[port][bit] : 0);
+}
+
+static void set_all(const uint8_t *levels) {
+	uint8_t i;
+
+	for (i = 0; i < BCM_MAX_CHANNELS; i++)
+	bcm_set(i, levels[i]);
+	bcm_update();
+}
+
+// Runs until the next interrupt writes OCR1A; returns the plane it started, or 8 if OCR1A holds no slot length
+static uint8_t next_slot(uint64_t *at) {
+	uint16_t before = OCR1A;
+	uint32_t cycles;
+	uint8_t plane;
+
+	for (cycles = 0; OCR1A == before && cycles < 2 * REFRESH_CYCLES; cycles += STEP)
+	sim_run(STEP);
+	*at = sim_cycles;
+	for (plane = 0; plane < 8 && OCR1A != ((uint16_t)BCM_BASE_TICKS << plane) - 1; plane++);
+	return plane;
+}
+
+// Checks the ports against bit `plane` of `levels`
+static uint8_t shows_plane(const uint8_t *levels, uint8_t plane) {
+	uint8_t want[3] = {0, 0, 0}, mask[3] = {0, 0, 0}, i, port;
+
+	for (i = 0; i < BCM_MAX_CHANNELS; i++) {
+		port = pins[i] >> 4;
+		mask[port] |= 1 << (pins[i] & 7);
+		if (levels[i] & (1 << plane))
+		want[port] |= 1 << (pins[i] & 7);
+	}
+	for (port = 0; port < 3; port++) {
+		if ((sim_output(port) & mask[port]) != want[port])
+		return 0;
+	}
+	return 1;
+}
+
+// Runs to the start of the next slot of `plane`; returns 0 if it never comes
+static uint8_t to_plane(uint8_t plane) {
+	uint64_t at;
+	uint8_t slots;
+
+	for (slots = 0; slots < 16; slots++) {
+		if (next_slot(&at) == plane)
+		return 1;
+	}
+	CHECK(0, "no slot of plane %u in two refreshes", plane);
+	return 0;
+}
+
+static void check_slots(void) {
+	uint64_t at, last, length;
+	uint8_t plane, want, got, refresh, wrong = 0, late = 0;
+
+	if (!to_plane(0))
+	return;
+	last = sim_cycles;
+	want = 1;
+	for (refresh = 0; refresh < 4; refresh++) {
+		for (plane = 0; plane < 8; plane++) {
+			got = next_slot(&at);
+			length = ((uint64_t)BCM_BASE_TICKS << ((want + 7) & 7)) * CYCLES_PER_TICK; // The slot that just ended
+			CHECK(got == want, "refresh %u: plane %u started where plane %u should", refresh, got, want);
+			if (got != want)
+			return;
+			if (at - last > length + SLACK || at - last + SLACK < length)
+			late++;
+			if (!shows_plane(levels_a, got))
+			wrong++;
+			last = at;
+			want = (want + 1) & 7;
+		}
+	}
+	CHECK(!late, "%u slots off their length", late);
+	CHECK(!wrong, "%u slots showed the wrong bit plane", wrong);
+	CHECK(sim_output(SIM_PORTC) & (1 << PC5), "PC5, not a BCM pin, was cleared");
+}
+
+static void check_on_time(void) {
+	uint64_t start[BCM_MAX_CHANNELS], from, to, cycles, want;
+	uint8_t i, slots;
+
+	if (!to_plane(0))
+	return;
+	next_slot(&from);
+	for (i = 0; i < BCM_MAX_CHANNELS; i++)
+	start[i] = on_cycles(pins[i]);
+	for (slots = 0; slots < 10 * 8; slots++)
+	next_slot(&to);
+	CHECK(to - from + 10 * SLACK >= 10 * REFRESH_CYCLES && to - from <= 10 * REFRESH_CYCLES + 10 * SLACK, "10 refreshes took %llu cycles",
+		(unsigned long long)(to - from));
+	for (i = 0; i < BCM_MAX_CHANNELS; i++) {
+		cycles = on_cycles(pins[i]) - start[i];
+		want = (to - from) * levels_a[i] / 255;
+		CHECK(cycles + 10 * SLACK >= want && cycles <= want + 10 * SLACK, "channel %u at %u: on for %llu cycles in 10 refreshes, want %llu",
+			i, levels_a[i], (unsigned long long)cycles, (unsigned long long)want);
+	}
+}
+
+static void check_update(void) {
+	uint64_t at;
+	uint8_t plane, mid, early = 0, stale = 0;
+
+	for (mid = 1; mid < 8; mid++) {
+		if (!to_plane(mid))
+		return;
+		set_all(levels_b);
+		for (plane = mid + 1; plane < 8; plane++) {
+			if (next_slot(&at) != plane || !shows_plane(levels_a, plane))
+			early++;
+		}
+		for (plane = 0; plane < 8; plane++) {
+			if (next_slot(&at) != plane || !shows_plane(levels_b, plane))
+			stale++;
+		}
+		set_all(levels_a);
+	}
+	CHECK(!early, "%u slots showed the new values before the next refresh", early);
+	CHECK(!stale, "%u slots of the next refresh did not show the new values", stale);
+}
+
+int main(void) {
+	DDRC |= (1 << PC5);
+	PORTC |= (1 << PC5);
+	sim_watch(pins_changed);
+	bcm_init(pins, BCM_MAX_CHANNELS);
+	set_all(levels_a);
+	sei();
+
+	check_slots();
+	check_on_time();
+	check_update();
+	return check_done();
+}
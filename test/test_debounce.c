@@ -0,0 +1,147 @@
+/*
+The `test_debounce.c` file runs `debounce.c` on the register model with bouncing buttons on PD2 - PD4.
+
+1. **Bounce**: Each press and release starts with 3 ms of contact bounce, the pin flipping at random every 50 - 500 us. Each must give
+exactly one event, within 4 samples (plus one for the phase of the tick) of the contacts settling.
+
+2. **Glitches**: A pulse shorter than 3 samples must give no event at all, however it lines up with the ticks.
+
+3. **Long Press**: A button held for 1.5 s must give one long-press event, `DEBOUNCE_LONG_MS` after its press, and no more.
+
+4. **Latching**: Events that are not read stay latched and are read once, and the buttons do not disturb each other.
+*/
+
+#include "check.h"
+#include "debounce.h"
+#include "pindefines.h"
+#include "sim.h"
+#include <avr/interrupt.h>
+
+#define CYCLES_PER_US (F_CPU / 1000000)
+#define CYCLES_PER_MS (F_CPU / 1000)
+#define BOUNCE_US 3000
+#define TICK_US (DEBOUNCE_TICK_MS * 1000UL)
+#define SETTLE_US (5 * TICK_US) // 4 agreeing samples, plus up to one tick until the first of them
+
+static uint32_t seed = 12345;
+
+static uint32_t next_random(void) {
+	seed ^= seed << 13;
+	seed ^= seed >> 17;
+	seed ^= seed << 5;
+	return seed;
+}
+
+static void run_us(uint32_t us) {
+	sim_run((uint64_t)us * CYCLES_PER_US);
+}
+
+// Moves `bit` to `level` (0 = pressed) through BOUNCE_US of bounce
+static void bounce(uint8_t bit, uint8_t level) {
+	uint32_t t = 0, step;
+	uint8_t now = !level;
+
+	while (t < BOUNCE_US) {
+		step = 50 + next_random() % 451;
+		now = !now;
+		sim_pin(SIM_PORTD, bit, now);
+		run_us(step);
+		t += step;
+	}
+	sim_pin(SIM_PORTD, bit, level);
+}
+
+// Runs until `mask` has an event in `take`, for up to `us`; returns the time it took in us, or -1
+static long wait_event(uint8_t (*take)(uint8_t mask), uint8_t mask, uint32_t us) {
+	uint64_t start = sim_cycles;
+
+	while (sim_cycles - start <= (uint64_t)us * CYCLES_PER_US) {
+		if (take(mask))
+		return (sim_cycles - start) / CYCLES_PER_US;
+		run_us(100);
+	}
+	return -1;
+}
+
+static void check_bounce(uint8_t bit, uint8_t cycles) {
+	uint8_t mask = 1 << bit, i;
+	long t;
+
+	for (i = 0; i < cycles; i++) {
+		bounce(bit, 0);
+		t = wait_event(debounce_pressed, mask, SETTLE_US);
+		CHECK(t >= 0, "PD%u press %u: no event within %lu us of settling", bit, i, (unsigned long)SETTLE_US);
+		run_us(50000);
+		CHECK(!debounce_pressed(0xFF) && !debounce_released(0xFF), "PD%u press %u: more than one event", bit, i);
+		CHECK(debounce_state() == mask, "PD%u press %u: state 0x%02x", bit, i, debounce_state());
+
+		bounce(bit, 1);
+		t = wait_event(debounce_released, mask, SETTLE_US);
+		CHECK(t >= 0, "PD%u release %u: no event within %lu us of settling", bit, i, (unsigned long)SETTLE_US);
+		run_us(50000);
+		CHECK(!debounce_pressed(0xFF) && !debounce_released(0xFF), "PD%u release %u: more than one event", bit, i);
+		CHECK(debounce_state() == 0, "PD%u release %u: state 0x%02x", bit, i, debounce_state());
+	}
+}
+
+static void check_glitches(void) {
+	uint32_t offset;
+	uint8_t events = 0;
+
+	// A 5 ms pulse spans at most 3 samples, at every phase of the tick
+	for (offset = 0; offset < TICK_US; offset += 250) {
+		run_us(offset);
+		sim_pin(SIM_PORTD, BUTTON2, 0);
+		run_us(5000);
+		sim_pin(SIM_PORTD, BUTTON2, 1);
+		run_us(20000);
+		events |= debounce_pressed(0xFF) | debounce_released(0xFF);
+	}
+	CHECK(!events && !debounce_state(), "a 5 ms glitch gave events 0x%02x", events);
+}
+
+static void check_long(void) {
+	uint8_t mask = 1 << BUTTON3;
+	long t;
+
+	bounce(BUTTON3, 0);
+	CHECK(wait_event(debounce_pressed, mask, SETTLE_US) >= 0, "long press: no press event");
+	t = wait_event(debounce_long, mask, DEBOUNCE_LONG_MS * 1000UL + 2 * TICK_US);
+	CHECK(t >= (DEBOUNCE_LONG_MS - DEBOUNCE_TICK_MS) * 1000L, "long press after %ld us, want %lu ms", t, (unsigned long)DEBOUNCE_LONG_MS);
+	run_us(500000);
+	CHECK(!debounce_long(0xFF), "long press: a second long event");
+	bounce(BUTTON3, 1);
+	CHECK(wait_event(debounce_released, mask, SETTLE_US) >= 0, "long press: no release event");
+	CHECK(!debounce_long(0xFF), "long press: a long event on release");
+}
+
+static void check_latching(void) {
+	uint8_t both = (1 << BUTTON) | (1 << BUTTON3);
+
+	bounce(BUTTON, 0);
+	bounce(BUTTON3, 0);
+	run_us(100000);
+	bounce(BUTTON, 1);
+	run_us(100000);
+	CHECK(debounce_state() == (1 << BUTTON3), "two buttons: state 0x%02x", debounce_state());
+	CHECK(debounce_pressed(0xFF) == both, "two buttons: presses not latched");
+	CHECK(debounce_released(0xFF) == (1 << BUTTON), "two buttons: release not latched");
+	CHECK(!debounce_pressed(0xFF) && !debounce_released(0xFF), "two buttons: events read twice");
+	bounce(BUTTON3, 1);
+	run_us(100000);
+	debounce_released(0xFF);
+}
+
+int main(void) {
+	debounce_init(DEBOUNCE_BUTTONS);
+	sei();
+	run_us(10000);
+	CHECK(debounce_state() == 0, "released buttons read 0x%02x", debounce_state());
+
+	check_bounce(BUTTON, 20);
+	check_bounce(BUTTON2, 20);
+	check_glitches();
+	check_long();
+	check_latching();
+	return check_done();
+}
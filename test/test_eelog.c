@@ -0,0 +1,150 @@
+/*
+The `test_eelog.c` file round-trips samples through `eelog.c`, the EEPROM of the register model and `tools/eelog_decode.py`.
+
+1. **Logging**: 2000 samples on two channels, one every 2 ms: a random walk with a jump every 37 samples, so some deltas need the escape,
+and a slow ramp. A sample that `eelog_add()` drops because the writer is behind is offered again 1 ms later, so none is lost. That is
+far more than the 1 KB holds, so the ring goes round about three times.
+
+2. **Dump**: After `eelog_flush()` the 32 blocks are written out with `eelog_dump_line()` and decoded by `tools/eelog_decode.py`
+(`EELOG_DECODER`, set by CMake). All 32 blocks must pass their CRC, and the samples of each channel must be the newest ones logged, in
+order, with none missing.
+
+3. **Restart**: A block cut short by a power loss must be skipped by `eelog_init()`, which must carry on after the newest block, so the
+samples logged after the restart come out last.
+*/
+
+#include "check.h"
+#include "eelog.h"
+#include "sim.h"
+#include <avr/interrupt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CYCLES_PER_MS (F_CPU / 1000)
+#define SAMPLES 2000
+#define RESTART_SAMPLES 60
+#define MAX_LOGGED (SAMPLES + RESTART_SAMPLES)
+#define DUMP_FILE "eelog_dump.txt"
+
+static uint16_t logged[EELOG_CHANNELS][MAX_LOGGED];
+static uint16_t logged_count[EELOG_CHANNELS];
+static uint16_t decoded[EELOG_CHANNELS][MAX_LOGGED];
+static uint16_t decoded_count[EELOG_CHANNELS];
+static uint32_t seed = 2024;
+
+static uint32_t next_random(void) {
+	seed ^= seed << 13;
+	seed ^= seed >> 17;
+	seed ^= seed << 5;
+	return seed;
+}
+
+static void log_sample(uint8_t channel, uint16_t value) {
+	while (!eelog_add(channel, value))
+	sim_run(CYCLES_PER_MS);
+	logged[channel][logged_count[channel]++] = value;
+}
+
+static void log_samples(uint16_t n) {
+	static uint16_t walk = 3000, ramp = 0;
+	uint16_t i;
+
+	for (i = 0; i < n; i++) {
+		if (i % 2 == 0) {
+			walk += (next_random() % 201) - 100;
+			if (i % 74 == 0)
+			walk ^= 0x0400; // Too far for one delta byte
+			log_sample(0, walk);
+		} else
+		log_sample(1, ramp++ / 3);
+		sim_run(2 * CYCLES_PER_MS);
+	}
+	eelog_flush();
+	while (eelog_busy())
+	sim_run(CYCLES_PER_MS);
+}
+
+// Dumps the EEPROM and decodes it; returns the number of blocks the decoder kept
+static int decode(void) {
+	char line[EELOG_LINE_SIZE], command[512], stats[128] = "";
+	FILE *f = fopen(DUMP_FILE, "w");
+	unsigned block, channel, index, value;
+	int blocks = -1, samples, bad = -1;
+	uint8_t b;
+
+	for (b = 0; b < EELOG_BLOCKS; b++) {
+		eelog_dump_line(b, line);
+		fputs(line, f);
+	}
+	fclose(f);
+
+	memset(decoded_count, 0, sizeof(decoded_count));
+	snprintf(command, sizeof(command), "python3 '%s' %s 2>eelog_stats.txt", EELOG_DECODER, DUMP_FILE);
+	f = popen(command, "r");
+	while (fgets(command, sizeof(command), f)) {
+		if (sscanf(command, "%u,%u,%u,%u", &block, &channel, &index, &value) != 4 || channel >= EELOG_CHANNELS)
+		continue;
+		decoded[channel][decoded_count[channel]++] = value;
+	}
+	CHECK(pclose(f) == 0, "the decoder failed");
+
+	f = fopen("eelog_stats.txt", "r");
+	if (f) {
+		if (fgets(stats, sizeof(stats), f))
+		sscanf(stats, "%d blocks, %d samples, %d bad blocks", &blocks, &samples, &bad);
+		fclose(f);
+	}
+	CHECK(bad == 0, "decoder: %s", stats);
+	return blocks;
+}
+
+// The decoded samples of each channel must be the newest ones logged, in order
+static void check_tail(const char *when) {
+	uint8_t c;
+	uint16_t skip;
+
+	for (c = 0; c < EELOG_CHANNELS; c++) {
+		CHECK(decoded_count[c] > 0 && decoded_count[c] <= logged_count[c], "%s: channel %u decoded %u samples", when, c,
+			decoded_count[c]);
+		if (!decoded_count[c] || decoded_count[c] > logged_count[c])
+		continue;
+		skip = logged_count[c] - decoded_count[c];
+		CHECK(!memcmp(decoded[c], logged[c] + skip, decoded_count[c] * sizeof(uint16_t)), "%s: channel %u differs from what was logged",
+			when, c);
+	}
+}
+
+int main(void) {
+	uint8_t *ee = sim_eeprom();
+	uint16_t oldest = 0, sequence, lowest = 0xFFFF;
+	uint8_t b, valid;
+
+	sei();
+
+	CHECK(eelog_init() == 0, "an erased EEPROM has valid blocks");
+	log_samples(SAMPLES);
+	CHECK(decode() == EELOG_BLOCKS, "not all %u blocks decoded", EELOG_BLOCKS);
+	CHECK(decoded_count[0] + decoded_count[1] >= 26 * (EELOG_BLOCKS - 8), "only %u samples in %u blocks",
+		decoded_count[0] + decoded_count[1], EELOG_BLOCKS);
+	check_tail("after 2000 samples");
+	printf("%u samples logged, %u dropped and offered again, %u in the EEPROM\n", SAMPLES, eelog_dropped(),
+		decoded_count[0] + decoded_count[1]);
+
+	// Power lost in the middle of the oldest block: its CRC no longer matches
+	for (b = 0; b < EELOG_BLOCKS; b++) {
+		sequence = ee[b * EELOG_BLOCK_SIZE] | (ee[b * EELOG_BLOCK_SIZE + 1] << 8);
+		if (sequence < lowest) {
+			lowest = sequence;
+			oldest = b;
+		}
+	}
+	ee[oldest * EELOG_BLOCK_SIZE + 20] ^= 0x5A;
+	valid = eelog_init();
+	CHECK(valid == EELOG_BLOCKS - 1, "eelog_init found %u valid blocks, want %u", valid, EELOG_BLOCKS - 1);
+
+	log_samples(RESTART_SAMPLES);
+	CHECK(decode() == EELOG_BLOCKS, "after the restart not all blocks decoded");
+	check_tail("after the restart");
+	return check_done();
+}
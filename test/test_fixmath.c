@@ -0,0 +1,67 @@
+/*
+The `test_fixmath.c` file checks the division by constants in `fixmath.h` against the C division.
+
+1. **Full Sweeps**: For a set of divisors (small ones, powers of two and their neighbours, the 641 that ceil(2^16 / d) got wrong, and the
+largest), `FIX_DIV16(x, d)` must equal x / d for every x from 0 to 65535. The divisors are constants, as in the firmware.
+
+2. **Every Divisor**: For every d from 1 to 65535, `fix_div_recip16()` must be exact where an error would show first: around each
+multiple of d near the top of the range, and at 65535.
+*/
+
+#include "check.h"
+#include "fixmath.h"
+
+#define SWEEP(d) sweep(d, FIX_RECIP16(d), FIX_RECIP16_SHIFT(d), FIX_DIV16(65535U, d))
+
+static void sweep(uint16_t d, uint16_t recip, uint8_t shift, uint16_t top) {
+	uint32_t x, wrong = 0;
+
+	for (x = 0; x < 65536; x++) {
+		if (fix_div_recip16(x, recip, shift) != x / d)
+		wrong++;
+	}
+	CHECK(!wrong && top == 65535U / d, "d = %u: %lu quotients wrong", d, (unsigned long)wrong);
+}
+
+static void check_every_divisor(void) {
+	uint32_t d, q, x, wrong = 0;
+	uint16_t recip;
+	uint8_t shift;
+
+	for (d = 1; d < 65536; d++) {
+		shift = 0;
+		while ((1UL << shift) < d)
+		shift++;
+		recip = (uint16_t)((((uint64_t)1 << (16 + shift)) + d - 1) / d - 65536);
+		CHECK(shift == FIX_RECIP16_SHIFT(d) && recip == FIX_RECIP16(d), "d = %lu: the macros give another multiplier", (unsigned long)d);
+		for (q = 65535 / d; q + 2 > 65535 / d && q > 0; q--) {
+			for (x = q * d - 1; x <= q * d + 1 && x < 65536; x++) {
+				if (fix_div_recip16(x, recip, shift) != x / d)
+				wrong++;
+			}
+		}
+		if (fix_div_recip16(65535, recip, shift) != 65535 / d)
+		wrong++;
+	}
+	CHECK(!wrong, "%lu quotients wrong over all divisors", (unsigned long)wrong);
+}
+
+int main(void) {
+	SWEEP(1);
+	SWEEP(3);
+	SWEEP(7);
+	SWEEP(10);
+	SWEEP(58);
+	SWEEP(100);
+	SWEEP(255);
+	SWEEP(256);
+	SWEEP(257);
+	SWEEP(641);
+	SWEEP(1000);
+	SWEEP(12345);
+	SWEEP(32768);
+	SWEEP(32769);
+	SWEEP(65535);
+	check_every_divisor();
+	return check_done();
+}
@@ -0,0 +1,158 @@
+/*
+The `test_hc595.c` file runs `hc595.c` against a virtual chain of `HC595_BYTES` 74HC595s on the SPI of the register model: every byte
+on MOSI shifts the chain along by one chip, and a rising edge on SS (RCLK) copies the shift registers to the outputs.
+
+1. **Frames**: Every frame shown must come out on the outputs of the right chips, latched once, after exactly `HC595_BYTES` bytes.
+
+2. **Double Buffering**: Frames shown back to back, while the one before is still going out, must each be latched in order, and changes
+made to the next frame during a transfer must not reach the one being sent. The next frame starts as a copy of the one shown.
+
+3. **Interrupts Off**: With global interrupts off, `hc595_flush()` must still get the frame out.
+
+4. **Speed**: A full frame must be latched within `MAX_LATCH_US` of `hc595_show()`.
+*/
+
+#include "check.h"
+#include "hc595.h"
+#include "pindefines.h"
+#include "sim.h"
+#include <avr/interrupt.h>
+#include <stdio.h>
+#include <string.h>
+
+#define CYCLES_PER_US (F_CPU / 1000000)
+#define MAX_LATCH_US 20
+#define HISTORY 16
+
+static uint8_t shift[HC595_BYTES]; // Shift registers, chip 0 first
+static uint8_t outputs[HC595_BYTES]; // Storage registers
+static uint8_t history[HISTORY][HC595_BYTES]; // The last frames latched, oldest first
+static uint8_t shifted = 0; // Bytes since the last latch
+static uint32_t latches = 0, short_latches = 0;
+static uint64_t latched_at;
+static uint32_t seed = 595;
+
+static uint32_t next_random(void) {
+	seed ^= seed << 13;
+	seed ^= seed >> 17;
+	seed ^= seed << 5;
+	return seed;
+}
+
+// A byte on MOSI: chip 0 takes it, every chip passes its old byte to the next, and the last one's comes back on QH'
+static uint8_t chain(uint8_t data) {
+	uint8_t out = shift[HC595_BYTES - 1];
+
+	memmove(shift + 1, shift, HC595_BYTES - 1);
+	shift[0] = data;
+	shifted++;
+	return out;
+}
+
+static void rclk(uint8_t port, uint8_t before, uint8_t after) {
+	if (port != SIM_PORTB || (before & (1 << SPI_SS)) || !(after & (1 << SPI_SS)))
+	return;
+	if (shifted != HC595_BYTES)
+	short_latches++;
+	shifted = 0;
+	memcpy(outputs, shift, HC595_BYTES);
+	memmove(history, history + 1, (HISTORY - 1) * HC595_BYTES);
+	memcpy(history[HISTORY - 1], outputs, HC595_BYTES);
+	latches++;
+	latched_at = sim_cycles;
+}
+
+static void random_frame(uint8_t *frame) {
+	uint8_t i;
+
+	for (i = 0; i < HC595_BYTES; i++)
+	frame[i] = next_random();
+}
+
+static void check_frames(void) {
+	uint8_t want[HC595_BYTES], i;
+	uint32_t before;
+
+	for (i = 0; i < 50; i++) {
+		random_frame(want);
+		memcpy(hc595_frame(), want, HC595_BYTES);
+		before = latches;
+		hc595_show();
+		hc595_flush();
+		CHECK(latches == before + 1, "frame %u latched %lu times", i, (unsigned long)(latches - before));
+		CHECK(!memcmp(outputs, want, HC595_BYTES), "frame %u shows the wrong outputs", i);
+		CHECK(!memcmp(hc595_frame(), want, HC595_BYTES), "frame %u: the next frame is not a copy of it", i);
+	}
+
+	hc595_clear();
+	hc595_set(0, 1);
+	hc595_set(8 * HC595_BYTES - 1, 1);
+	hc595_set(8 * HC595_BYTES, 1); // Past the end of the chain, ignored
+	hc595_show();
+	hc595_flush();
+	CHECK(outputs[0] == 0x01 && outputs[HC595_BYTES - 1] == (HC595_BYTES > 1 ? 0x80 : 0x81), "hc595_set: outputs 0x%02x ... 0x%02x",
+		outputs[0], outputs[HC595_BYTES - 1]);
+}
+
+static void check_double_buffering(void) {
+	uint8_t want[HISTORY][HC595_BYTES], i;
+	uint32_t before = latches;
+
+	for (i = 0; i < HISTORY; i++) {
+		random_frame(want[i]);
+		memcpy(hc595_frame(), want[i], HC595_BYTES);
+		hc595_show();
+		CHECK(hc595_busy() || latches == before + i + 1, "frame %u: not busy and not latched", i);
+		memset(hc595_frame(), 0xA5, HC595_BYTES); // Overwritten with the next frame while this one goes out
+	}
+	hc595_flush();
+	CHECK(latches == before + HISTORY, "%u frames back to back latched %lu times", HISTORY, (unsigned long)(latches - before));
+	CHECK(!memcmp(history, want, sizeof(want)), "frames back to back latched out of order or changed");
+}
+
+static void check_interrupts_off(void) {
+	uint8_t want[HC595_BYTES];
+	uint32_t before = latches;
+
+	cli();
+	random_frame(want);
+	memcpy(hc595_frame(), want, HC595_BYTES);
+	hc595_show();
+	hc595_flush();
+	sei();
+	CHECK(latches == before + 1 && !memcmp(outputs, want, HC595_BYTES), "with interrupts off the frame did not come out");
+}
+
+static void check_speed(void) {
+	uint64_t start;
+	unsigned long us;
+
+	random_frame(hc595_frame());
+	start = sim_cycles;
+	hc595_show();
+	hc595_flush();
+	us = (latched_at - start) / CYCLES_PER_US;
+	CHECK(us <= MAX_LATCH_US, "a %u-byte frame took %lu us to latch", HC595_BYTES, us);
+	printf("%u-byte frame latched %lu cycles after hc595_show()\n", HC595_BYTES, (unsigned long)(latched_at - start));
+}
+
+int main(void) {
+	uint8_t zero[HC595_BYTES];
+
+	memset(shift, 0x5A, sizeof(shift)); // Random at power on
+	memset(outputs, 0x5A, sizeof(outputs));
+	memset(zero, 0, sizeof(zero));
+	sim_spi(chain);
+	sim_watch(rclk);
+	sei();
+	hc595_init();
+	hc595_flush();
+	CHECK(latches == 1 && !memcmp(outputs, zero, HC595_BYTES), "hc595_init did not clear the outputs");
+
+	check_frames();
+	check_double_buffering();
+	check_interrupts_off();
+	check_speed();
+	CHECK(short_latches == 0, "%lu latches came before the whole frame was shifted in", (unsigned long)short_latches);
+	return check_done();
+}
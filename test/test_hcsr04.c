@@ -0,0 +1,264 @@
+/*
+The `test_hcsr04.c` file is the host version of `bench/hcsr04.c`. It is linked into the distance meter (`main.c` and its drivers) built
+against the register model in `host/`, so the whole measurement pipeline runs on Linux with a virtual HC-SR04 and no simavr.
+
+1. **Sensor Model**: A pin watcher follows TRIG (PB1). When TRIG falls after being high for at least 10 us, `sim_at()` raises ECHO (PB0)
+`ECHO_DELAY_US` later and drops it again after 58.3 us per cm, the same as the simavr harness. `drop` leaves ECHO low and `far` holds it
+high for 38 ms.
+
+2. **Distance Trace**: `HCSR04_TRACE=<file>` reads a trace of `<ms> <cm|drop|far>` lines, the format of `bench/distance_trace.txt`;
+without it the same steps are built in.
+
+3. **Checks**: The UART output is taken from the model every `POLL_US` and split into lines, and every report is matched with the oldest
+measurement not reported yet, with the tolerances of the simavr harness. The run ends at `SIM_MS`; the summary is printed then and the exit
+status is 1 if anything failed.
+*/
+
+#include "sim.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define TRIG_BIT 1
+#define ECHO_BIT 0
+#define TRIG_MIN_US 10 // Shortest trigger pulse the module reacts to
+#define ECHO_DELAY_US 250 // From the end of the trigger to the rising edge of the echo
+#define US_PER_CM 58.3 // Round trip at 343 m/s
+#define FAR_US 38000 // Echo width when nothing is in range
+#define TIMEOUT_DURATION 65535 // What main.c prints for ECHO_TIMEOUT
+#define POLL_US 100 // How often the UART output is read
+#define MAX_STEPS 64
+#define MAX_PENDING 16
+
+#define US(us) ((uint64_t)(us) * (F_CPU / 1000000))
+
+enum { STEP_DISTANCE, STEP_DROP, STEP_FAR };
+
+typedef struct {
+	uint32_t ms;
+	uint8_t kind;
+	double cm;
+} step_t;
+
+typedef struct {
+	uint64_t trig; // Cycle of the falling edge of TRIG
+	uint8_t kind;
+	uint32_t width_us;
+} measurement_t;
+
+static const step_t default_trace[] = {
+	{0, STEP_DISTANCE, 20},
+	{1200, STEP_DISTANCE, 57.5},
+	{2200, STEP_DROP, 0},
+	{2700, STEP_DISTANCE, 150},
+	{3700, STEP_FAR, 0},
+	{4200, STEP_DISTANCE, 400},
+	{5200, STEP_DISTANCE, 3},
+};
+
+static step_t trace[MAX_STEPS];
+static int trace_len = 0;
+
+static uint64_t trig_rise = 0;
+
+static measurement_t pending[MAX_PENDING];
+static int pending_count = 0;
+
+static char line[64];
+static int line_len = 0;
+static long duration = -1, cm = -1;
+
+static int reports = 0, failures = 0, triggers = 0;
+static uint64_t latency_total = 0, latency_max = 0;
+
+static double cycles_to_ms(uint64_t cycles) {
+	return cycles * 1000.0 / F_CPU;
+}
+
+static const step_t *step_at(uint64_t cycle) {
+	uint32_t ms = cycle * 1000 / F_CPU;
+	int i;
+
+	for (i = trace_len - 1; i > 0; i--) {
+		if (trace[i].ms <= ms)
+		break;
+	}
+	return &trace[i];
+}
+
+// ---- Sensor ----
+
+static void echo_fall(void *arg) {
+	(void)arg;
+	sim_pin(SIM_PORTB, ECHO_BIT, 0);
+}
+
+static void echo_rise(void *arg) {
+	uint32_t width = (uint32_t)(uintptr_t)arg;
+
+	sim_pin(SIM_PORTB, ECHO_BIT, 1);
+	sim_at(sim_cycles + US(width), echo_fall, 0);
+}
+
+static void pins_changed(uint8_t port, uint8_t before, uint8_t after) {
+	const step_t *s;
+	measurement_t *m;
+
+	if (port != SIM_PORTB || !((before ^ after) & (1 << TRIG_BIT)))
+	return;
+	if (after & (1 << TRIG_BIT)) {
+		trig_rise = sim_cycles;
+		return;
+	}
+	if (sim_cycles - trig_rise < US(TRIG_MIN_US))
+	return;
+	s = step_at(sim_cycles);
+	triggers++;
+	if (pending_count == MAX_PENDING) {
+		printf("FAIL too many measurements without a report\n");
+		failures++;
+		return;
+	}
+	m = &pending[pending_count++];
+	m->trig = sim_cycles;
+	m->kind = s->kind;
+	m->width_us = s->kind == STEP_FAR ? FAR_US : (uint32_t)(s->cm * US_PER_CM + 0.5);
+	if (s->kind != STEP_DROP)
+	sim_at(sim_cycles + US(ECHO_DELAY_US), echo_rise, (void *)(uintptr_t)m->width_us);
+}
+
+// ---- UART output ----
+
+static void check_report(long inch) {
+	measurement_t m;
+	long want_duration, want_cm, want_inch;
+	uint64_t latency;
+	int ok;
+
+	if (!pending_count) {
+		printf("FAIL report without a measurement\n");
+		failures++;
+		return;
+	}
+	m = pending[0];
+	memmove(pending, pending + 1, --pending_count * sizeof(pending[0]));
+
+	if (m.kind == STEP_DISTANCE) {
+		want_duration = m.width_us;
+		ok = labs(duration - want_duration) <= 2;
+	} else {
+		want_duration = TIMEOUT_DURATION;
+		ok = duration == TIMEOUT_DURATION;
+	}
+	// Same formulas as report_task: duration * 0.034 / 2 and duration * 0.0133 / 2
+	want_cm = (long)(want_duration * 0.017);
+	want_inch = (long)(want_duration * 0.00665);
+	ok = ok && labs(cm - want_cm) <= 1 && labs(inch - want_inch) <= 1;
+
+	latency = sim_cycles - m.trig;
+	latency_total += latency;
+	if (latency > latency_max)
+	latency_max = latency;
+	reports++;
+
+	printf("%s t=%8.1f ms  sent %-9s got %5ld us %4ld cm %3ld in  (want %5ld us %4ld cm %3ld in)  latency %.1f ms\n", ok ? "ok  " : "FAIL",
+		cycles_to_ms(m.trig), m.kind == STEP_DROP ? "dropout" : m.kind == STEP_FAR ? "far" : "distance", duration, cm, inch,
+		want_duration, want_cm, want_inch, cycles_to_ms(latency));
+	if (!ok)
+	failures++;
+}
+
+static void uart_line(void) {
+	line[line_len] = 0;
+	line_len = 0;
+
+	if (!strncmp(line, "Duration: ", 10))
+	duration = atol(line + 10);
+	else if (!strncmp(line, "Distance cm: ", 13))
+	cm = atol(line + 13);
+	else if (!strncmp(line, "Distance inch: ", 15)) {
+		check_report(atol(line + 15));
+		duration = cm = -1;
+	}
+}
+
+static void uart_poll(void *arg) {
+	uint8_t bytes[64];
+	size_t n, i;
+
+	(void)arg;
+	while ((n = sim_uart_tx(bytes, sizeof(bytes)))) {
+		for (i = 0; i < n; i++) {
+			if (bytes[i] == '\n')
+			uart_line();
+			else if (bytes[i] != '\r' && line_len < (int)sizeof(line) - 1)
+			line[line_len++] = bytes[i];
+		}
+	}
+	sim_at(sim_cycles + US(POLL_US), uart_poll, 0);
+}
+
+// ---- Setup ----
+
+static void load_trace(const char *path) {
+	FILE *f = fopen(path, "r");
+	char buf[128], what[32];
+	unsigned ms;
+
+	if (!f) {
+		fprintf(stderr, "hcsr04: cannot open %s\n", path);
+		exit(2);
+	}
+	while (fgets(buf, sizeof(buf), f) && trace_len < MAX_STEPS) {
+		if (buf[0] == '#' || sscanf(buf, "%u %31s", &ms, what) != 2)
+		continue;
+		trace[trace_len].ms = ms;
+		if (!strcmp(what, "drop"))
+		trace[trace_len].kind = STEP_DROP;
+		else if (!strcmp(what, "far"))
+		trace[trace_len].kind = STEP_FAR;
+		else {
+			trace[trace_len].kind = STEP_DISTANCE;
+			trace[trace_len].cm = atof(what);
+		}
+		trace_len++;
+	}
+	fclose(f);
+	if (!trace_len) {
+		fprintf(stderr, "hcsr04: %s has no steps\n", path);
+		exit(2);
+	}
+}
+
+// Runs when SIM_MS stops the sketch
+static void summary(void) {
+	if (!reports) {
+		printf("FAIL no reports\n");
+		failures++;
+	}
+	if (pending_count > 1) { // The last trigger may still be waiting for its report
+		printf("FAIL %d measurements were never reported\n", pending_count);
+		failures++;
+	}
+	printf("%d triggers, %d reports, %d failures\n", triggers, reports, failures);
+	if (reports)
+	printf("latency avg %.1f ms, max %.1f ms\n", cycles_to_ms(latency_total / reports), cycles_to_ms(latency_max));
+	fflush(stdout);
+	_exit(failures ? 1 : 0);
+}
+
+__attribute__((constructor)) static void hcsr04_start(void) {
+	const char *path = getenv("HCSR04_TRACE");
+
+	if (path)
+	load_trace(path);
+	else {
+		memcpy(trace, default_trace, sizeof(default_trace));
+		trace_len = sizeof(default_trace) / sizeof(default_trace[0]);
+	}
+	sim_uart_echo(0);
+	sim_watch(pins_changed);
+	sim_at(US(POLL_US), uart_poll, 0);
+	atexit(summary);
+}
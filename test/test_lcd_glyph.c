@@ -0,0 +1,220 @@
+/*
+The `test_lcd_glyph.c` file draws frames with the bar graph and the big digits of `lcd_glyph.c` through `LCD_3.c` into the virtual
+HD44780 of `hd44780.c`, and checks what the LCD shows and what each frame uploaded to CGRAM.
+
+1. **Bars**: Every length from 0 to 80 must show exactly that many lit pixel columns on every pixel row. A frame must upload a glyph
+only the first time its partly filled cell is needed, so once the 4 partial glyphs are in CGRAM the bar frames upload nothing.
+
+2. **Big Digits**: Each digit must look the same wherever and whenever it is drawn, and the 10 digits must all look different. The 3
+stripe glyphs are uploaded once.
+
+3. **Steady State**: Bars and big digits need 7 slots together, so frames that switch between them upload nothing at all, and a frame
+that is drawn again unchanged sends no bytes to the LCD.
+
+4. **Eviction**: With all 8 slots on screen a ninth bitmap gets `LCD_GLYPH_NONE`. Once the screen is cleared it replaces a slot, and
+the cell shows the new bitmap.
+
+`lcd_fb_glyph_uploads()` is also checked against the CGRAM bytes the LCD actually received.
+*/
+
+#include "check.h"
+#include "hd44780.h"
+#include "RBT211 Final Project/LCD_3.h"
+#include "sim.h"
+#include <stdio.h>
+#include <string.h>
+
+#define BAR_ROW 1
+#define DIGITS 3
+
+static unsigned long uploads = 0; // Sum of lcd_fb_glyph_uploads() over all frames
+
+static unsigned char flush(void) {
+	unsigned char n;
+
+	lcd_flush();
+	n = lcd_fb_glyph_uploads();
+	uploads += n;
+	CHECK(hd44780_cgram_bytes() == 8 * uploads, "%lu CGRAM bytes received for %lu uploads", (unsigned long)hd44780_cgram_bytes(),
+		uploads);
+	return n;
+}
+
+static void draw_bar(unsigned char steps) {
+	char text[LCD_COLS + 1];
+
+	lcd_fb_clear();
+	snprintf(text, sizeof(text), "%3u cm", steps * 5 / 2);
+	lcd_fb_puts(text);
+	lcd_fb_bar(0, BAR_ROW, LCD_COLS, steps);
+}
+
+// Lit pixel columns of the bar row, or -1 if the pixel rows disagree or a cell is not a bar cell
+static int bar_length(void) {
+	int y, x, col, lit, length = -1;
+
+	for (y = 0; y < 8; y++) {
+		lit = 0;
+		for (col = 0; col < LCD_COLS; col++) {
+			for (x = 0; x < 5; x++) {
+				if (hd44780_pixel(BAR_ROW, col, y, x) < 0)
+				return -1;
+				lit += hd44780_pixel(BAR_ROW, col, y, x);
+			}
+		}
+		if (length >= 0 && lit != length)
+		return -1;
+		length = lit;
+	}
+	return length;
+}
+
+static void check_bars(void) {
+	unsigned char seen = 0, steps, part, n;
+	unsigned int i;
+
+	for (i = 0; i < 81; i++) {
+		steps = (i * 13) % 81; // Every length once, in a jumbled order
+		part = steps % 5;
+		draw_bar(steps);
+		n = flush();
+		CHECK(bar_length() == steps, "bar of %u shows %d columns", steps, bar_length());
+		CHECK(n == (part && !(seen & (1 << part))), "bar of %u uploaded %u glyphs", steps, n);
+		seen |= (1 << part);
+	}
+	CHECK(uploads == 4, "bars uploaded %lu glyphs, want 4", uploads);
+}
+
+// The pixels of the big digit in columns col to col + 2, 15 x 16
+static void digit_image(unsigned char col, unsigned char image[16][15]) {
+	int row, c, y, x;
+
+	for (row = 0; row < 2; row++) {
+		for (c = 0; c < 3; c++) {
+			for (y = 0; y < 8; y++) {
+				for (x = 0; x < 5; x++)
+				image[8 * row + y][5 * c + x] = hd44780_pixel(row, col + c, y, x);
+			}
+		}
+	}
+}
+
+static void check_big_digits(void) {
+	static const unsigned int values[] = {258, 147, 369, 0, 5, 999, 680, 71, 123, 456, 789, 802, 13};
+	static unsigned char images[10][16][15];
+	unsigned char image[16][15], blank[16][15];
+	unsigned long before = uploads;
+	unsigned int i, value, d, known = 0;
+	unsigned char pos;
+
+	memset(blank, 0, sizeof(blank));
+	for (i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+		lcd_fb_clear();
+		lcd_fb_big_number(0, values[i], DIGITS);
+		flush();
+		value = values[i];
+		for (pos = DIGITS; pos > 0; pos--) {
+			digit_image(4 * (pos - 1), image);
+			if (!value && pos != DIGITS) { // Leading zero
+				CHECK(!memcmp(image, blank, sizeof(image)), "leading zero of %u is not blank", values[i]);
+				continue;
+			}
+			d = value % 10;
+			value /= 10;
+			CHECK(!memchr(image, 0xFF, sizeof(image)), "digit %u of %u has a ROM character in it", d, values[i]);
+			if (known & (1 << d))
+			CHECK(!memcmp(images[d], image, sizeof(image)), "digit %u of %u looks different", d, values[i]);
+			else {
+				memcpy(images[d], image, sizeof(image));
+				known |= (1 << d);
+			}
+		}
+	}
+	CHECK(known == 0x3FF, "digits drawn: 0x%03x", known);
+	for (d = 0; d < 10; d++) {
+		for (i = 0; i < d; i++)
+		CHECK(memcmp(images[d], images[i], sizeof(images[d])), "digits %u and %u look the same", i, d);
+	}
+	CHECK(uploads - before == 3, "big digits uploaded %lu glyphs, want 3", uploads - before);
+}
+
+static void check_steady(void) {
+	unsigned long before = uploads;
+	uint32_t bytes;
+	unsigned int i;
+
+	for (i = 0; i < 40; i++) {
+		if (i % 2) {
+			lcd_fb_clear();
+			lcd_fb_big_number(0, i * 37 % 1000, DIGITS);
+		} else
+		draw_bar(i * 2 % 81);
+		flush();
+	}
+	CHECK(uploads == before, "switching between bars and big digits uploaded %lu glyphs", uploads - before);
+
+	bytes = hd44780_bytes();
+	flush();
+	CHECK(hd44780_bytes() == bytes && lcd_fb_glyph_uploads() == 0, "an unchanged frame sent %lu bytes",
+		(unsigned long)(hd44780_bytes() - bytes));
+}
+
+// A bitmap that differs for every n: row n % 8 lit and column n / 8 lit
+static void pattern(unsigned char n, unsigned char bitmap[8]) {
+	unsigned char y;
+
+	for (y = 0; y < 8; y++)
+	bitmap[y] = (y == n % 8 ? 0x1F : 0) | (0x10 >> (n / 8));
+}
+
+static int shows(unsigned char col, const unsigned char bitmap[8]) {
+	unsigned char y, x;
+
+	for (y = 0; y < 8; y++) {
+		for (x = 0; x < 5; x++) {
+			if (hd44780_pixel(0, col, y, x) != ((bitmap[y] >> (4 - x)) & 1))
+			return 0;
+		}
+	}
+	return 1;
+}
+
+static void check_eviction(void) {
+	unsigned char bitmaps[9][8], n;
+	char c;
+
+	for (n = 0; n < 9; n++)
+	pattern(n + 16, bitmaps[n]); // None of them is a bar or stripe glyph
+	lcd_fb_clear();
+	flush();
+	lcd_fb_gotoxy(0, 0);
+	for (n = 0; n < 8; n++)
+	lcd_fb_putc(lcd_fb_glyph(bitmaps[n]));
+	c = lcd_fb_glyph(bitmaps[8]);
+	CHECK(c == LCD_GLYPH_NONE, "a ninth glyph with all 8 slots on screen got slot %d", c);
+	flush();
+	for (n = 0; n < 8; n++)
+	CHECK(shows(n, bitmaps[n]), "cell %u does not show its glyph", n);
+
+	lcd_fb_clear();
+	lcd_fb_gotoxy(10, 0);
+	c = lcd_fb_glyph(bitmaps[8]);
+	CHECK(c >= 0 && c < 8, "the ninth glyph got no slot once the screen was cleared");
+	lcd_fb_putc(c);
+	flush();
+	CHECK(shows(10, bitmaps[8]), "the ninth glyph does not show");
+}
+
+int main(void) {
+	hd44780_watch_portd();
+	lcd_init();
+	CHECK(hd44780_errors() == 0, "lcd_init left the nibbles out of step");
+
+	check_bars();
+	check_big_digits();
+	check_steady();
+	check_eviction();
+	CHECK(hd44780_errors() == 0, "%lu bytes with the nibbles out of step", (unsigned long)hd44780_errors());
+	printf("%lu glyph uploads in all\n", uploads);
+	return check_done();
+}
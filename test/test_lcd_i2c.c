@@ -0,0 +1,103 @@
+/*
+The `test_lcd_i2c.c` file drives the LCD through `lcd_i2c.c` and the TWI master of `twi.c` (`LCD_I2C`, set by CMake) into a virtual
+PCF8574 backpack and HD44780 from `hd44780.c`, and checks what the LCD shows.
+
+1. **Text**: Rows written with the blocking functions, the `*_async` ones and the frame buffer (with a bar, so glyphs go into CGRAM) must
+arrive intact, with the two nibbles of every byte in step.
+
+2. **Timing**: No nibble may reach the LCD before it has executed the byte before it, even with the oscillator `LCD_EXEC_MARGIN_PCT`
+slower than nominal, which is what the padding bytes of `lcd_i2c.c` and the waits for clear and home are for. RS must be set before each
+E pulse, and the TWI must not report a NACK.
+
+3. **Rate**: A burst of 32 characters and 2 cursor moves through the `*_async` functions, as in `bench/bench_lcd_chars.c`, must reach
+`MIN_CHARS_PER_S`.
+*/
+
+#include "check.h"
+#include "hd44780.h"
+#include "RBT211 Final Project/LCD_3.h"
+#include "RBT211 Final Project/lcd_timing.h"
+#include "sim.h"
+#include "twi.h"
+#include <avr/interrupt.h>
+#include <stdio.h>
+#include <string.h>
+
+#define MIN_CHARS_PER_S 7000 // About 7600 on the register model at 400 kHz
+
+// 1 if row `row` of the LCD starts with `text`
+static int shows(uint8_t row, const char *text) {
+	uint8_t col;
+
+	for (col = 0; text[col]; col++) {
+		if (hd44780_char(row, col) != (uint8_t)text[col])
+		return 0;
+	}
+	return 1;
+}
+
+static void check_blocking(void) {
+	lcd_clrscr();
+	lcd_gotoxy(0, 1);
+	lcd_puts("Blocking I2C");
+	lcd_gotoxy(4, 2);
+	lcd_puts("row two");
+	lcd_i2c_flush();
+	CHECK(shows(0, "Blocking I2C    "), "blocking: row 1 is wrong");
+	CHECK(shows(1, "    row two     "), "blocking: row 2 is wrong");
+}
+
+static void check_async(void) {
+	uint64_t start;
+	unsigned long rate;
+
+	lcd_async_init();
+	start = sim_cycles;
+	lcd_gotoxy_async(0, 1);
+	lcd_puts_async("RBT211 benchmark");
+	lcd_gotoxy_async(0, 2);
+	lcd_puts_async("0123456789ABCDEF");
+	while (!lcd_idle())
+	sim_run(100);
+	rate = 32 * F_CPU / (sim_cycles - start);
+	CHECK(shows(0, "RBT211 benchmark") && shows(1, "0123456789ABCDEF"), "async: the burst did not arrive intact");
+	CHECK(rate >= MIN_CHARS_PER_S, "async: %lu chars/s, want %u", rate, MIN_CHARS_PER_S);
+	printf("%lu chars/s through the PCF8574\n", rate);
+}
+
+static void check_frame_buffer(void) {
+	uint8_t col, x;
+	int lit = 0;
+
+	lcd_fb_invalidate(); // The rows above were written directly
+	lcd_fb_clear();
+	lcd_fb_puts("Distance 123 cm");
+	lcd_fb_bar(0, 1, LCD_COLS, 33);
+	lcd_flush();
+	lcd_i2c_flush();
+	CHECK(shows(0, "Distance 123 cm"), "frame buffer: row 1 is wrong");
+	for (col = 0; col < LCD_COLS; col++) {
+		for (x = 0; x < 5; x++)
+		lit += hd44780_pixel(1, col, 7, x);
+	}
+	CHECK(lit == 33, "frame buffer: the bar of 33 shows %d columns", lit);
+	CHECK(hd44780_cgram_bytes() == 8 * lcd_fb_glyphs_uploaded(), "frame buffer: %lu CGRAM bytes for %lu glyphs",
+		(unsigned long)hd44780_cgram_bytes(), lcd_fb_glyphs_uploaded());
+}
+
+int main(void) {
+	hd44780_watch_pcf8574(LCD_I2C_ADDRESS);
+	hd44780_oscillator(270 * 100 / (100 + LCD_EXEC_MARGIN_PCT)); // As slow as the margin allows
+	sei();
+	lcd_init();
+	lcd_i2c_flush();
+	CHECK(hd44780_bytes() > 0, "lcd_init sent nothing to the backpack");
+
+	check_blocking();
+	check_async();
+	check_frame_buffer();
+	CHECK(hd44780_errors() == 0, "%lu bytes with the nibbles out of step", (unsigned long)hd44780_errors());
+	CHECK(hd44780_late() == 0, "%lu nibbles came while the LCD was busy", (unsigned long)hd44780_late());
+	CHECK(twi_errors() == 0, "%u NACKs", twi_errors());
+	return check_done();
+}
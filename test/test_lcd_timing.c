@@ -0,0 +1,76 @@
+/*
+The `test_lcd_timing.c` file checks the execution time table of `lcd_timing.h` and the waits `LCD_3.c` builds on it.
+
+1. **Table**: For every byte, instruction and data, `lcd_exec_us()` must give the datasheet time that the virtual HD44780 of `hd44780.c`
+decodes for it, except the 0x00 byte, which is no instruction and must get the long wait. `lcd_exec_is_long()` must pick the long wait
+exactly for clear and home, and the short wait `LCD_3.c` uses for everything else must cover every short instruction.
+
+2. **Waits**: The PORTD driver with `LCD_WAIT_TABLE`, blocking and queued, must never send a nibble while the LCD is still executing,
+with the oscillator `LCD_EXEC_MARGIN_PCT` slower than nominal, and the text must arrive intact.
+*/
+
+#include "check.h"
+#include "hd44780.h"
+#include "RBT211 Final Project/LCD_3.h"
+#include "RBT211 Final Project/lcd_timing.h"
+#include "sim.h"
+#include <avr/interrupt.h>
+
+static void check_table(void) {
+	uint16_t value, want;
+	uint8_t rs;
+
+	for (rs = 0; rs < 2; rs++) {
+		for (value = 0; value < 256; value++) {
+			want = rs || value ? hd44780_exec_us(rs, value) : LCD_EXEC_LONG_US;
+			CHECK(lcd_exec_us(rs, value) == want, "RS %u byte 0x%02x: %u us, want %u", rs, value, lcd_exec_us(rs, value), want);
+			CHECK(!lcd_exec_is_long(rs, value) == (want < LCD_EXEC_LONG_US), "RS %u byte 0x%02x: wrong wait picked", rs, value);
+			if (!lcd_exec_is_long(rs, value))
+			CHECK(lcd_exec_us(rs, value) <= LCD_EXEC_DATA_US, "RS %u byte 0x%02x is longer than the short wait", rs, value);
+		}
+	}
+}
+
+// 1 if row `row` of the LCD starts with `text`
+static int shows(uint8_t row, const char *text) {
+	uint8_t col;
+
+	for (col = 0; text[col]; col++) {
+		if (hd44780_char(row, col) != (uint8_t)text[col])
+		return 0;
+	}
+	return 1;
+}
+
+static void check_waits(void) {
+	hd44780_watch_portd();
+	hd44780_oscillator(270 * 100 / (100 + LCD_EXEC_MARGIN_PCT)); // As slow as the margin allows
+	lcd_init();
+	lcd_gotoxy(0, 1);
+	lcd_puts("Table waits");
+	lcd_command(LCD_HOME);
+	lcd_puts("T");
+	lcd_gotoxy(2, 2);
+	lcd_puts("after home");
+	CHECK(shows(0, "Table waits") && shows(1, "  after home"), "blocking: the text did not arrive intact");
+
+	lcd_async_init();
+	sei();
+	lcd_command_async(LCD_CLEAR);
+	lcd_gotoxy_async(0, 1);
+	lcd_puts_async("Queued bytes");
+	lcd_gotoxy_async(0, 2);
+	lcd_puts_async("0123456789ABCDEF");
+	while (!lcd_idle())
+	sim_run(100);
+	CHECK(shows(0, "Queued bytes    ") && shows(1, "0123456789ABCDEF"), "queued: the text did not arrive intact");
+
+	CHECK(hd44780_errors() == 0, "%lu bytes with the nibbles out of step", (unsigned long)hd44780_errors());
+	CHECK(hd44780_late() == 0, "%lu nibbles came while the LCD was busy", (unsigned long)hd44780_late());
+}
+
+int main(void) {
+	check_table();
+	check_waits();
+	return check_done();
+}
@@ -0,0 +1,146 @@
+/*
+The `test_power.c` file runs `power.c` under a loop like the one in the Week 2 sketches: Timer1 interrupts every millisecond and does
+`ISR_US` of work, the main program does `MAIN_US` of work every tenth wake-up, and otherwise the main loop only calls `power_sleep()`.
+
+1. **Accounting**: After `RUN_MS` of virtual time, awake and asleep time from `power_stats()` must add up to the time that has passed,
+within a tick. All the sleep must be in idle mode, as Timer1 runs from the I/O clock. It must be no less than the time the model spent
+asleep, and no more than that plus the ISR work and a quarter tick (ISR entry and exit) per wake-up. There must be a wake-up for every
+Timer1 interrupt, and at most one more for each Timer2 overflow (those that come while awake wake nothing).
+
+2. **Average Current**: `power_average_ua()` must lie between `POWER_IDLE_UA` and `POWER_ACTIVE_UA`, and close to the figure from the time
+the model really slept plus the ISR work, which `power.h` counts as sleep.
+
+3. **Idle Loop**: With Timer1 stopped, only the Timer2 overflows wake the CPU, and the average current must come close to `POWER_IDLE_UA`.
+
+4. **Pending Overflow**: With interrupts off while `TCNT2` wraps, `power_stats()` must still count the overflow that waits for its ISR.
+*/
+
+#include "check.h"
+#include "power.h"
+#include "sim.h"
+#include <avr/interrupt.h>
+#include <avr/io.h>
+#include <stdint.h>
+#include <util/delay.h>
+
+#define RUN_MS 2000
+#define ISR_US 50
+#define MAIN_US 200
+#define CYCLES_PER_TICK (F_CPU / POWER_TICKS_PER_SEC)
+#define CYCLES_PER_MS (F_CPU / 1000)
+
+static volatile uint32_t ticks = 0;
+
+ISR(TIMER1_COMPA_vect) {
+	ticks++;
+	_delay_us(ISR_US);
+}
+
+static void timer1_start(void) {
+	TCCR1A = 0;
+	TCCR1B = (1 << WGM12) | (1 << CS11); // CTC, prescaler of 8
+	OCR1A = F_CPU / 8 / 1000 - 1;
+	TCNT1 = 0;
+	TIMSK1 = (1 << OCIE1A);
+}
+
+static void timer1_stop(void) {
+	TCCR1B = 0;
+	TIMSK1 = 0;
+}
+
+// Runs the main loop for `ms` of virtual time
+static void run_ms(uint32_t ms) {
+	uint64_t end = sim_cycles + (uint64_t)ms * CYCLES_PER_MS;
+	uint32_t wakeups = 0;
+
+	while (sim_cycles < end) {
+		power_sleep();
+		if (++wakeups % 10 == 0)
+		_delay_us(MAIN_US);
+	}
+}
+
+// Average current from the cycles the model spent asleep and awake, in uA
+static uint32_t model_ua(uint64_t cycles, uint64_t slept) {
+	return ((cycles - slept) * POWER_ACTIVE_UA + slept * POWER_IDLE_UA) / cycles;
+}
+
+static void check_busy(void) {
+	power_stats_t s;
+	uint64_t start, slept, cycles;
+	uint32_t elapsed, asleep, ua, want, isr_ticks;
+	uint8_t i;
+
+	timer1_start();
+	power_init();
+	start = sim_cycles;
+	slept = sim_slept();
+	run_ms(RUN_MS);
+	power_stats(&s);
+	cycles = sim_cycles - start;
+	slept = sim_slept() - slept;
+	elapsed = cycles / CYCLES_PER_TICK;
+
+	for (asleep = 0, i = 0; i < POWER_MODES; i++)
+	asleep += s.asleep[i];
+	CHECK(s.awake + asleep + 1 >= elapsed && s.awake + asleep <= elapsed + 1, "busy: awake %lu + asleep %lu ticks, %lu passed",
+		(unsigned long)s.awake, (unsigned long)asleep, (unsigned long)elapsed);
+	CHECK(asleep == s.asleep[POWER_IDLE], "busy: %lu ticks asleep in other modes than idle", (unsigned long)(asleep - s.asleep[POWER_IDLE]));
+	isr_ticks = ticks * ISR_US * (F_CPU / 1000000) / CYCLES_PER_TICK;
+	CHECK(asleep + 1 >= slept / CYCLES_PER_TICK && asleep <= (slept / CYCLES_PER_TICK) + isr_ticks + s.wakeups / 4,
+		"busy: %lu ticks asleep, the model slept %lu and the ISRs ran %lu", (unsigned long)asleep,
+		(unsigned long)(slept / CYCLES_PER_TICK), (unsigned long)isr_ticks);
+	CHECK(s.wakeups >= ticks && s.wakeups <= ticks + elapsed / 256 + 1, "busy: %lu wake-ups for %lu interrupts and %lu overflows",
+		(unsigned long)s.wakeups, (unsigned long)ticks, (unsigned long)(elapsed / 256));
+
+	ua = power_average_ua();
+	want = model_ua(cycles, slept + (uint64_t)isr_ticks * CYCLES_PER_TICK);
+	CHECK(ua > POWER_IDLE_UA && ua < POWER_ACTIVE_UA, "busy: average %lu uA, not between idle and active", (unsigned long)ua);
+	CHECK(ua + 20 >= want && ua <= want + 20, "busy: average %lu uA, the model gives %lu", (unsigned long)ua, (unsigned long)want);
+	printf("busy: %lu uA; the model gives %lu counting the ISRs as sleep, %lu counting them awake\n", (unsigned long)ua,
+		(unsigned long)want, (unsigned long)model_ua(cycles, slept));
+}
+
+static void check_idle(void) {
+	power_stats_t s;
+	uint64_t start = sim_cycles;
+	uint32_t elapsed, ua;
+
+	timer1_stop();
+	power_init();
+	run_ms(RUN_MS);
+	power_stats(&s);
+	elapsed = (sim_cycles - start) / CYCLES_PER_TICK;
+	CHECK(s.wakeups + 1 >= elapsed / 256 && s.wakeups <= elapsed / 256 + 1, "idle: %lu wake-ups in %lu overflows", (unsigned long)s.wakeups,
+		(unsigned long)(elapsed / 256));
+	ua = power_average_ua();
+	CHECK(ua >= POWER_IDLE_UA && ua <= POWER_IDLE_UA + 100, "idle: average %lu uA", (unsigned long)ua);
+}
+
+static void check_pending_overflow(void) {
+	power_stats_t s;
+	uint64_t start;
+	uint32_t elapsed, counted;
+	uint8_t i;
+
+	power_init();
+	start = sim_cycles;
+	cli();
+	sim_run(300 * CYCLES_PER_TICK); // TCNT2 wraps and the overflow waits for its ISR
+	power_stats(&s);
+	sei();
+	elapsed = (sim_cycles - start) / CYCLES_PER_TICK;
+	for (counted = s.awake, i = 0; i < POWER_MODES; i++)
+	counted += s.asleep[i];
+	CHECK(counted + 1 >= elapsed && counted <= elapsed + 1, "overflow pending: %lu ticks counted, %lu passed", (unsigned long)counted,
+		(unsigned long)elapsed);
+}
+
+int main(void) {
+	sei();
+	check_busy();
+	check_idle();
+	check_pending_overflow();
+	return check_done();
+}
@@ -0,0 +1,113 @@
+/*
+The `test_sched.c` file runs `sched.c` on the register model with the main loop of the sketches, `sched_run()` and `sched_sleep()`, and
+checks that tasks run on time while the CPU sleeps.
+
+1. **Clock**: `sched_now()` must follow the CPU clock / 1024 whatever the tickless wake-ups have done to the Timer2 match.
+
+2. **Deadlines**: Periodic tasks of 5 ms and 500 ms and a one-shot task that sets its own next delay must each run within one tick of
+their deadline, which only happens if `sched_sleep()` brings the Timer2 match forward to it (without it a sleeping CPU wakes every 255
+ticks, 16 ms).
+
+3. **Sleep**: With nothing but those tasks, the CPU must spend most of the time asleep.
+*/
+
+#include "check.h"
+#include "sched.h"
+#include "sim.h"
+#include <avr/interrupt.h>
+
+#define TICK_CYCLES 1024ULL
+#define RUN_MS 2000
+#define MAX_RUNS 512
+
+typedef struct {
+	uint8_t id;
+	uint32_t runs;
+	uint64_t at[MAX_RUNS]; // Cycle of each run
+	int64_t worst; // Largest distance from the deadline, in cycles
+} record_t;
+
+static record_t fast, slow, oneshot;
+static uint32_t clock_errors = 0;
+static uint16_t oneshot_delays[] = {3, 17, 1, 40, 8};
+
+static void record(record_t *r) {
+	uint64_t ticks = sim_cycles / TICK_CYCLES;
+	uint32_t now = sched_now();
+
+	if (now != (uint32_t)ticks && now != (uint32_t)ticks - 1) // Timer2 counts on the shared prescaler, so allow one tick of phase
+	clock_errors++;
+	if (r->runs < MAX_RUNS)
+	r->at[r->runs] = sim_cycles;
+	r->runs++;
+}
+
+static void fast_task(void) {
+	record(&fast);
+}
+
+static void slow_task(void) {
+	record(&slow);
+}
+
+static void oneshot_task(void) {
+	record(&oneshot);
+	sched_wake_in(oneshot.id, oneshot_delays[oneshot.runs % 5]);
+}
+
+// Checks that the runs of `r` are `period_ms` apart, starting at `first`
+static void check_periodic(const char *name, record_t *r, uint64_t first, uint32_t period_ms) {
+	uint64_t period = SCHED_MS(period_ms) * TICK_CYCLES;
+	uint32_t i;
+	int64_t late;
+
+	for (i = 0; i < r->runs && i < MAX_RUNS; i++) {
+		late = (int64_t)(r->at[i] - (first + i * period));
+		if (late < 0)
+		late = -late;
+		if (late > r->worst)
+		r->worst = late;
+	}
+	CHECK(r->worst <= 2 * (int64_t)TICK_CYCLES, "%s: a run was %lld cycles off its deadline", name, (long long)r->worst);
+}
+
+int main(void) {
+	uint64_t start, end, slept;
+	uint32_t i;
+	int64_t late, worst = 0;
+
+	sched_init();
+	fast.id = sched_add(fast_task, 5, 5);
+	slow.id = sched_add(slow_task, 500, 500);
+	oneshot.id = sched_add(oneshot_task, 2, 0);
+	start = sim_cycles;
+	sei();
+
+	end = start + RUN_MS * (F_CPU / 1000);
+	while (sim_cycles < end) {
+		sched_run();
+		sched_sleep();
+	}
+	slept = sim_slept();
+
+	CHECK(clock_errors == 0, "sched_now() was off the CPU clock %lu times", (unsigned long)clock_errors);
+	CHECK(fast.runs >= 399 && fast.runs <= 400, "5 ms task: %lu runs in %d ms", (unsigned long)fast.runs, RUN_MS);
+	CHECK(slow.runs == 4, "500 ms task: %lu runs in %d ms", (unsigned long)slow.runs, RUN_MS);
+	check_periodic("5 ms task", &fast, start + SCHED_MS(5) * TICK_CYCLES, 5);
+	check_periodic("500 ms task", &slow, start + SCHED_MS(500) * TICK_CYCLES, 500);
+
+	for (i = 1; i < oneshot.runs && i < MAX_RUNS; i++) {
+		late = (int64_t)(oneshot.at[i] - oneshot.at[i - 1]) - (int64_t)(SCHED_MS(oneshot_delays[i % 5]) * TICK_CYCLES);
+		if (late < 0)
+		late = -late;
+		if (late > worst)
+		worst = late;
+	}
+	CHECK(oneshot.runs > 50, "one-shot task: only %lu runs", (unsigned long)oneshot.runs);
+	CHECK(worst <= 2 * (int64_t)TICK_CYCLES, "one-shot task: a run was %lld cycles off its delay", (long long)worst);
+
+	CHECK(slept * 100 / (end - start) >= 80, "asleep %llu%% of the time", (unsigned long long)(slept * 100 / (end - start)));
+	printf("asleep %llu%% of the time, worst deadline error %lld cycles\n", (unsigned long long)(slept * 100 / (end - start)),
+		(long long)(fast.worst > slow.worst ? fast.worst : slow.worst));
+	return check_done();
+}
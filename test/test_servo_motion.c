@@ -0,0 +1,124 @@
+/*
+The `test_servo_motion.c` file runs the moves of `servo_motion.c` frame by frame and checks both profiles against the limits they were
+given. The frame ISR is called directly with interrupts off, so a move of several minutes takes no time and the real Timer1 never adds a
+frame of its own.
+
+1. **Trapezoid**: Each move must end exactly on its target, never move faster than `vmax` and never change speed by more than `amax` per
+frame, with two ticks of slack for the fraction of a tick in the limits and the rounding of `OCR1A`. A move retargeted behind the servo
+must brake before it turns.
+
+2. **S-Curve**: Each move must end exactly on its target without going backwards or past it, and must take at least 2D / `vmax` frames,
+which is what keeps its peak speed at `vmax`. The position follows the cycloid in 1/256 steps of the move, so the speed of a single frame
+may be off by one step.
+
+3. **Slow Moves**: A full sweep at 5 ticks per second takes 76000 frames, more than a 16-bit frame count holds, and must still take all
+of them.
+*/
+
+#include "check.h"
+#include "servo_motion.h"
+#include "sim.h"
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <stdlib.h>
+
+#define MAX_FRAMES 600000UL
+
+void TIMER1_OVF_vect(void);
+
+typedef struct {
+	uint32_t frames;
+	int32_t max_speed; // Largest step of a frame, ticks
+	int32_t max_accel; // Largest change of that step between frames, ticks
+	uint8_t backwards; // Moved against the direction of the move
+	uint8_t overshoot; // Went past the target
+} move_t;
+
+static int32_t last_step; // Step of the last frame, carried over a retarget
+
+// Runs frames until the move to `to` is over, or for `limit` frames
+static move_t run(uint16_t to, uint32_t limit) {
+	move_t m = {0, 0, 0, 0, 0};
+	int32_t last = OCR1A, step;
+	int32_t dir = to >= last ? 1 : -1;
+
+	while (servo_busy() && m.frames < limit) {
+		TIMER1_OVF_vect();
+		m.frames++;
+		step = (int32_t)OCR1A - last;
+		last = OCR1A;
+		if (abs(step) > m.max_speed)
+		m.max_speed = abs(step);
+		if (abs(step - last_step) > m.max_accel)
+		m.max_accel = abs(step - last_step);
+		last_step = step;
+		if (step * dir < 0)
+		m.backwards = 1;
+		if (((int32_t)OCR1A - to) * dir > 0)
+		m.overshoot = 1;
+	}
+	return m;
+}
+
+static void check_trapezoid(uint16_t from, uint16_t to, uint16_t vmax, uint16_t amax) {
+	move_t m;
+	int32_t v = vmax / SERVO_FRAME_HZ, a = amax / (SERVO_FRAME_HZ * SERVO_FRAME_HZ);
+
+	servo_init(from);
+	servo_profile(SERVO_TRAPEZOID);
+	servo_move_to(to, vmax, amax);
+	last_step = 0;
+	m = run(to, MAX_FRAMES);
+	CHECK(!servo_busy() && OCR1A == to, "trapezoid %u to %u: ended at %u", from, to, OCR1A);
+	CHECK(m.max_speed <= v + 2, "trapezoid %u to %u: %ld ticks in a frame, vmax is %ld", from, to, (long)m.max_speed, (long)v);
+	CHECK(m.max_accel <= a + 2, "trapezoid %u to %u: speed changed by %ld ticks, amax is %ld", from, to, (long)m.max_accel, (long)a);
+	CHECK(!m.backwards && !m.overshoot, "trapezoid %u to %u: went backwards or past the target", from, to);
+}
+
+static void check_retarget(void) {
+	move_t m;
+
+	servo_init(SERVO_MIN);
+	servo_profile(SERVO_TRAPEZOID);
+	servo_move_to(SERVO_MAX, 2500, 5000);
+	last_step = 0;
+	run(SERVO_MAX, 30); // Cruising at 50 ticks per frame
+	servo_move_to(SERVO_MIN, 2500, 5000);
+	m = run(SERVO_MIN, MAX_FRAMES);
+	CHECK(!servo_busy() && OCR1A == SERVO_MIN, "retarget: ended at %u", OCR1A);
+	CHECK(m.max_accel <= 5000 / 2500 + 2, "retarget: speed changed by %ld ticks", (long)m.max_accel);
+	CHECK(m.max_speed <= 2500 / SERVO_FRAME_HZ + 2, "retarget: %ld ticks in a frame", (long)m.max_speed);
+}
+
+static void check_scurve(uint16_t from, uint16_t to, uint16_t vmax, uint16_t amax) {
+	move_t m;
+	uint32_t d = to > from ? to - from : from - to;
+	uint32_t t = 2 * d * SERVO_FRAME_HZ / vmax; // Fewest frames at vmax
+
+	servo_init(from);
+	servo_profile(SERVO_SCURVE);
+	servo_move_to(to, vmax, amax);
+	last_step = 0;
+	m = run(to, MAX_FRAMES);
+	CHECK(!servo_busy() && OCR1A == to, "S-curve %u to %u: ended at %u", from, to, OCR1A);
+	CHECK(m.frames >= t, "S-curve %u to %u at %u ticks/s: %lu frames, want at least %lu", from, to, vmax, (unsigned long)m.frames,
+		(unsigned long)t);
+	CHECK(m.max_speed <= (int32_t)(vmax / SERVO_FRAME_HZ + 2 * d / 256 + 1), "S-curve %u to %u: %ld ticks in a frame", from, to,
+		(long)m.max_speed);
+	CHECK(!m.backwards && !m.overshoot, "S-curve %u to %u: went backwards or past the target", from, to);
+}
+
+int main(void) {
+	check_trapezoid(SERVO_MIN, SERVO_MAX, 2500, 5000);
+	check_trapezoid(SERVO_MAX, SERVO_MIN, 20000, 60000);
+	check_trapezoid(3000, 3010, 2500, 5000); // Too short to reach vmax
+	check_trapezoid(SERVO_MIN, SERVO_MAX, 5, 5000);
+	check_retarget();
+
+	check_scurve(SERVO_MIN, SERVO_MAX, 2500, 5000);
+	check_scurve(SERVO_MAX, 2000, 20000, 60000);
+	check_scurve(3000, 3010, 2500, 5000);
+	check_scurve(SERVO_MIN, SERVO_MAX, 5, 5000); // 76000 frames
+	check_scurve(SERVO_MAX, SERVO_MIN, 20, 5000); // 19000 frames
+	return check_done();
+}
@@ -0,0 +1,166 @@
+/*
+The `test_servo_mux.c` file runs `servo_mux.c` on the register model with all 8 channels on PORTD and follows the pins with a watcher.
+
+1. **Edges**: The widths include two equal pairs, a pair 1 tick apart and one 6 ticks apart, closer than `SERVO_MUX_GUARD`, so the
+merged edges and the wait inside `TIMER1_COMPB_vect` are both used. Every pin must rise at the frame start, together with the others, and
+fall `width` ticks later, up to `TOLERANCE` ticks late; channels with the same width must fall in the same write. A channel set to 0 stays
+low, and a frame is 20 ms.
+
+2. **Commit**: New widths committed halfway through a frame must not change any edge of that frame, must all show in the next one, and
+`servo_mux_pending()` must be 1 until they do.
+
+3. **Jitter**: `servo_mux_jitter()` must count the frames measured, and its worst cases must be small and no better than what the pins
+show.
+*/
+
+#include "check.h"
+#include "servo_mux.h"
+#include "sim.h"
+#include <avr/interrupt.h>
+#include <stdint.h>
+
+#define CYCLES_PER_TICK 8 // Timer1 at F_CPU / 8
+#define CYCLES_PER_US (F_CPU / 1000000)
+#define TOLERANCE 4 // Ticks a fall may be late by (ISR latency); 1 early is rounding, the pins and TCNT1 change apart
+#define RISE_MAX 40 // Ticks from the frame start to the rising edge, worst case
+
+static const uint16_t widths_a[SERVO_MUX_CHANNELS] = {2000, 2000, 1500, 1501, 3000, 999, 4799, 2006};
+static const uint16_t widths_b[SERVO_MUX_CHANNELS] = {1200, 4000, 4000, 0, 2500, 2500, 1000, 3333};
+
+static uint64_t rise[8], fall[8];
+static uint64_t frame_start; // Cycle of the last rising edge
+static uint32_t frames = 0;
+static uint32_t max_error = 0; // Worst fall error the pins showed, in ticks
+
+static void run_us(uint32_t us) {
+	sim_run((uint64_t)us * CYCLES_PER_US);
+}
+
+static void pins_changed(uint8_t port, uint8_t before, uint8_t after) {
+	uint8_t bit;
+
+	if (port != SIM_PORTD)
+	return;
+	if (after & ~before) {
+		frame_start = sim_cycles;
+		frames++;
+	}
+	for (bit = 0; bit < 8; bit++) {
+		if (!(before & (1 << bit)) && (after & (1 << bit)))
+		rise[bit] = sim_cycles;
+		if ((before & (1 << bit)) && !(after & (1 << bit)))
+		fall[bit] = sim_cycles;
+	}
+}
+
+// Runs to just after the next frame start
+static void next_frame(void) {
+	uint32_t seen = frames;
+
+	while (frames == seen)
+	run_us(50);
+}
+
+// Checks the edges of the frame that started last against `widths`, once its pulses are over
+static void check_edges(const uint16_t *widths, const char *what) {
+	uint8_t ch, other;
+	uint32_t ticks, error;
+
+	for (ch = 0; ch < SERVO_MUX_CHANNELS; ch++) {
+		if (!widths[ch]) {
+			CHECK(rise[ch] < frame_start - 10 * CYCLES_PER_US * 1000 || !rise[ch], "%s: channel %u is off but rose", what, ch);
+			continue;
+		}
+		CHECK(rise[ch] == frame_start, "%s: channel %u did not rise with the others", what, ch);
+		CHECK(fall[ch] > rise[ch], "%s: channel %u did not fall", what, ch);
+		ticks = (fall[ch] - rise[ch]) / CYCLES_PER_TICK;
+		error = ticks > widths[ch] ? ticks - widths[ch] : widths[ch] - ticks;
+		CHECK(ticks + 1 >= widths[ch] && ticks <= widths[ch] + TOLERANCE, "%s: channel %u high for %lu ticks, want %u", what, ch,
+			(unsigned long)ticks, widths[ch]);
+		if (error > max_error)
+		max_error = error;
+		for (other = 0; other < ch; other++) {
+			if (widths[other] == widths[ch])
+			CHECK(fall[other] == fall[ch], "%s: channels %u and %u have the same width but fell apart", what, other, ch);
+		}
+	}
+}
+
+static void set_all(const uint16_t *widths) {
+	uint8_t ch;
+
+	for (ch = 0; ch < SERVO_MUX_CHANNELS; ch++)
+	servo_mux_set(ch, widths[ch]);
+}
+
+static void check_frames(void) {
+	uint64_t last;
+	uint8_t i;
+
+	set_all(widths_a);
+	servo_mux_commit();
+	next_frame();
+	next_frame();
+	for (i = 0; i < 5; i++) {
+		last = frame_start;
+		run_us(5000);
+		check_edges(widths_a, "widths A");
+		next_frame();
+		CHECK(frame_start - last == 20000 * CYCLES_PER_US, "frame of %lu us", (unsigned long)((frame_start - last) / CYCLES_PER_US));
+	}
+}
+
+static void check_commit(void) {
+	uint8_t i;
+
+	for (i = 0; i < 4; i++) {
+		next_frame();
+		run_us(700 + 300 * i); // Before, between and after the edges of widths A
+		set_all(widths_b);
+		servo_mux_commit();
+		CHECK(servo_mux_pending(), "commit %u: not pending", i);
+		run_us(5000);
+		check_edges(widths_a, "frame of the commit");
+		next_frame();
+		CHECK(!servo_mux_pending(), "commit %u: still pending in the next frame", i);
+		run_us(5000);
+		check_edges(widths_b, "frame after the commit");
+		set_all(widths_a);
+		servo_mux_commit();
+		next_frame();
+		run_us(5000);
+		check_edges(widths_a, "back to widths A");
+	}
+}
+
+static void check_jitter(void) {
+	servo_mux_jitter_t j;
+	uint8_t i;
+
+	next_frame();
+	run_us(5000);
+	servo_mux_measure(1);
+	for (i = 0; i < 20; i++) {
+		next_frame();
+		run_us(5000);
+		check_edges(widths_a, "measured");
+	}
+	servo_mux_jitter(&j);
+	servo_mux_measure(0);
+	CHECK(j.frames == 20, "jitter: %u frames measured, want 20", j.frames);
+	CHECK(j.rise_max > 0 && j.rise_max <= RISE_MAX, "jitter: rising edge %u ticks late", j.rise_max);
+	CHECK(j.width_max <= TOLERANCE + 2 && j.width_max + 1 >= max_error, "jitter: width error %u ticks, the pins showed %lu", j.width_max,
+		(unsigned long)max_error);
+	printf("jitter: rise %u ticks, width %u ticks over %u frames\n", j.rise_max, j.width_max, j.frames);
+}
+
+int main(void) {
+	sim_watch(pins_changed);
+	servo_mux_init(0xFF);
+	sei();
+
+	check_frames();
+	check_commit();
+	check_jitter();
+	return check_done();
+}
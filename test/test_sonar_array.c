@@ -0,0 +1,177 @@
+/*
+The `test_sonar_array.c` file runs `sonar_array.c` on the register model with four virtual HC-SR04s on the default wiring of its `sonars`
+table: triggers on PC0-PC3, echoes on PB2-PB5, sensors 0 and 1 in slot 0 and sensors 2 and 3 in slot 1.
+
+1. **Sensor Model**: A pin watcher follows PORTC. When a trigger falls, `sim_at()` raises that sensor's echo `ECHO_DELAY_US` later and
+drops it again after `width_us[i]`; a width of 0 never answers.
+
+2. **Frames**: The widths `sonar_read()` publishes and the distances of `sonar_read_mm()` must match the echoes, a silent sensor must read
+`SONAR_TIMEOUT` in both, and the sequence number must go up by one per round.
+
+3. **Slots**: The sensors of a slot must be triggered together. A slot whose echoes have all ended must give way to the next one
+`SONAR_GUARD_US` after its last echo, without waiting for the timeout; a slot with a silent sensor waits for the timeout and the guard.
+
+4. **Other Pins**: The PORTC pins that are not triggers (PC4 and PC5, where `LCD_3.h` puts RW) must keep their level through
+`sonar_init()`, the rounds and `sonar_stop()`.
+
+5. **Pending Timeout**: If the last echo of a slot ends just before the timeout, but its pin change interrupt only runs once the timeout
+has matched as well (interrupts were off), the guard time must still be kept before the next slot is triggered.
+*/
+
+#include "check.h"
+#include "RBT211 Final Project/sonar_array.h"
+#include "sim.h"
+#include <avr/interrupt.h>
+#include <stdint.h>
+
+#define CYCLES_PER_US (F_CPU / 1000000)
+#define ECHO_DELAY_US 250 // From the end of the trigger to the rising edge of the echo
+#define SLACK_US 20 // ISR latency allowed in the slot timing
+#define OTHER_PINS ((1 << PC4) | (1 << PC5))
+
+static uint32_t width_us[SONAR_COUNT] = {1000, 3000, 0, 500};
+static uint64_t trig_rise[SONAR_COUNT], trig_fall[SONAR_COUNT], echo_fall[SONAR_COUNT];
+
+static void run_us(uint32_t us) {
+	sim_run((uint64_t)us * CYCLES_PER_US);
+}
+
+static long us_between(uint64_t from, uint64_t to) {
+	return (long)((int64_t)(to - from) / (int64_t)CYCLES_PER_US);
+}
+
+static void echo_rise(void *arg) {
+	sim_pin(SIM_PORTB, PB2 + (uintptr_t)arg, 1);
+}
+
+static void echo_drop(void *arg) {
+	uintptr_t i = (uintptr_t)arg;
+
+	sim_pin(SIM_PORTB, PB2 + i, 0);
+	echo_fall[i] = sim_cycles;
+}
+
+static void trig_changed(uint8_t port, uint8_t before, uint8_t after) {
+	uintptr_t i;
+
+	if (port != SIM_PORTC)
+	return;
+	for (i = 0; i < SONAR_COUNT; i++) {
+		if (!(before & (1 << i)) && (after & (1 << i)))
+		trig_rise[i] = sim_cycles;
+		if ((before & (1 << i)) && !(after & (1 << i))) {
+			trig_fall[i] = sim_cycles;
+			if (!width_us[i])
+			continue;
+			sim_at(sim_cycles + ECHO_DELAY_US * CYCLES_PER_US, echo_rise, (void *)i);
+			sim_at(sim_cycles + (ECHO_DELAY_US + width_us[i]) * CYCLES_PER_US, echo_drop, (void *)i);
+		}
+	}
+}
+
+// Runs until the sequence number moves on, for up to `ms`; returns the new one
+static uint8_t next_frame(uint8_t seq, uint32_t ms) {
+	uint16_t ticks[SONAR_COUNT];
+
+	while (ms--) {
+		run_us(1000);
+		if (sonar_read(ticks) != seq)
+		return sonar_read(ticks);
+	}
+	return seq;
+}
+
+static void check_frames(void) {
+	uint16_t ticks[SONAR_COUNT], mm[SONAR_COUNT];
+	uint8_t seq = sonar_read(ticks), next, i;
+	long want;
+
+	seq = next_frame(seq, 200); // The first round may have started before the widths were set
+	next = next_frame(seq, 200);
+	CHECK(next == (uint8_t)(seq + 1), "frames: sequence %u after %u", next, seq);
+	sonar_read(ticks);
+	CHECK(sonar_read_mm(mm) == next, "frames: sonar_read_mm gives another sequence number");
+	for (i = 0; i < SONAR_COUNT; i++) {
+		if (!width_us[i]) {
+			CHECK(ticks[i] == SONAR_TIMEOUT && mm[i] == SONAR_TIMEOUT, "sensor %u: %u ticks, %u mm without an echo", i, ticks[i], mm[i]);
+			continue;
+		}
+		want = width_us[i] * SONAR_TICKS_PER_US;
+		CHECK(ticks[i] >= want - 2 && ticks[i] <= want + 2 * SLACK_US, "sensor %u: %u ticks, want %ld", i, ticks[i], want);
+		want = width_us[i] * 343L / 2000;
+		CHECK(mm[i] >= want - 1 && mm[i] <= want + 4, "sensor %u: %u mm, want %ld", i, mm[i], want);
+	}
+}
+
+static void check_slots(void) {
+	uint16_t ticks[SONAR_COUNT];
+	uint64_t rise0, fall0, last_echo, rise2, fall2;
+	uint32_t us;
+	uint8_t seq;
+	long gap;
+
+	seq = next_frame(sonar_read(ticks), 200); // A new round has just started with slot 0
+	run_us(100);
+	CHECK(trig_rise[0] == trig_rise[1] && trig_fall[0] == trig_fall[1], "slot 0: triggers not together");
+	CHECK(us_between(trig_rise[0], trig_fall[0]) >= 10, "trigger pulse of %ld us", us_between(trig_rise[0], trig_fall[0]));
+	rise0 = trig_rise[0];
+	fall0 = trig_fall[0];
+	for (us = 0; trig_rise[2] < fall0 && us < 100000; us += 100)
+	run_us(100);
+	run_us(100);
+	CHECK(trig_rise[2] == trig_rise[3] && trig_fall[2] == trig_fall[3], "slot 1: triggers not together");
+	last_echo = echo_fall[1];
+	rise2 = trig_rise[2];
+	fall2 = trig_fall[2];
+
+	// Slot 0 ends with its echoes, then the guard time
+	gap = us_between(last_echo, rise2);
+	CHECK(last_echo > fall0 && gap >= (long)SONAR_GUARD_US && gap <= (long)SONAR_GUARD_US + SLACK_US,
+		"slot 1 came %ld us after the last echo of slot 0", gap);
+	gap = us_between(rise0, rise2);
+	CHECK(gap < (long)SONAR_TIMEOUT_US, "slot 0 took %ld us, as long as the timeout", gap);
+
+	// Slot 1 has a silent sensor, so it waits for the timeout
+	next_frame(seq, 200);
+	gap = us_between(fall2, trig_rise[0]);
+	CHECK(gap >= (long)(SONAR_TIMEOUT_US + SONAR_GUARD_US) && gap <= (long)(SONAR_TIMEOUT_US + SONAR_GUARD_US) + SLACK_US,
+		"slot 0 came %ld us after the trigger of slot 1", gap);
+}
+
+static void check_pending_timeout(void) {
+	uint64_t on;
+	long gap;
+
+	sonar_stop();
+	run_us(100000);
+	width_us[0] = width_us[1] = SONAR_TIMEOUT_US - ECHO_DELAY_US - 50; // Ends 50 us before the timeout
+	trig_rise[2] = 0;
+	sonar_start();
+	run_us(SONAR_TIMEOUT_US - 100);
+	cli();
+	run_us(200); // The echoes end and the timeout matches while interrupts are off
+	sei();
+	on = sim_cycles;
+	run_us(SONAR_GUARD_US + 1000);
+	gap = trig_rise[2] ? us_between(on, trig_rise[2]) : -1;
+	CHECK(gap >= (long)SONAR_GUARD_US - SLACK_US, "with the timeout pending, slot 1 came %ld us after the echoes were seen", gap);
+}
+
+int main(void) {
+	DDRC |= OTHER_PINS;
+	PORTC |= OTHER_PINS;
+	sim_watch(trig_changed);
+	sonar_init();
+	CHECK((PORTC & OTHER_PINS) == OTHER_PINS, "sonar_init changed PC4/PC5: PORTC 0x%02x", PORTC);
+	sei();
+	sonar_start();
+
+	check_frames();
+	check_slots();
+	CHECK((PORTC & OTHER_PINS) == OTHER_PINS, "the rounds changed PC4/PC5: PORTC 0x%02x", PORTC);
+	check_pending_timeout();
+	sonar_stop();
+	CHECK((PORTC & OTHER_PINS) == OTHER_PINS, "sonar_stop changed PC4/PC5: PORTC 0x%02x", PORTC);
+	CHECK(!(PORTC & 0x0F), "sonar_stop left a trigger high: PORTC 0x%02x", PORTC);
+	return check_done();
+}
@@ -0,0 +1,142 @@
+/*
+The `test_telemetry.c` file checks the frames `telemetry.c` sends, on a stand-in for `uart.c` that records every byte and reports as
+much free space as the test wants.
+
+1. **Frames**: Over a full turn of the sequence number, packets with zero bytes in every field (and in the CRC, which happens about once
+in 128 packets) must come out as one COBS frame of `TELEMETRY_FRAME_SIZE` bytes with no zero before the delimiter. Decoded, each must
+have the version, sequence number, time stamp and echo width little-endian at the offsets of `telemetry.h`, and the CRC-16/CCITT-FALSE
+of bytes 0-8, which the test computes without the avr-libc helper.
+
+2. **Dropped Frames**: With one byte less free than a frame needs, nothing must be sent at all, `telemetry_dropped()` must count the
+frame, and the next frame must show the gap in the sequence number.
+
+The stream of the `final_project_telemetry` sketch is checked with `tools/telemetry_decode.py` by the `telemetry_decode` test.
+*/
+
+#include "check.h"
+#include "RBT211 Final Project/telemetry.h"
+#include "RBT211 Final Project/uart.h"
+#include <stdint.h>
+#include <string.h>
+
+static uint8_t wire[64];
+static uint8_t wire_len = 0;
+static uint8_t tx_free = 255;
+
+uint8_t uart_putc(char c) {
+	if (wire_len < sizeof(wire))
+	wire[wire_len++] = c;
+	return 1;
+}
+
+uint8_t uart_tx_free(void) {
+	return tx_free;
+}
+
+// CRC-16/CCITT-FALSE a byte at a time, without the bit loop of the avr-libc helper; "123456789" gives 0x29B1
+static uint16_t crc16_ccitt_false(const uint8_t *data, uint8_t len) {
+	uint16_t crc = 0xFFFF;
+	uint8_t i, x;
+
+	for (i = 0; i < len; i++) {
+		x = (crc >> 8) ^ data[i];
+		x ^= x >> 4;
+		crc = (crc << 8) ^ ((uint16_t)x << 12) ^ ((uint16_t)x << 5) ^ x;
+	}
+	return crc;
+}
+
+// Decodes a COBS frame of len bytes, without the delimiter, into out; returns the length, or 0 if the encoding is broken
+static uint8_t cobs_decode(const uint8_t *in, uint8_t len, uint8_t *out) {
+	uint8_t i = 0, n = 0, code, k;
+
+	while (i < len) {
+		code = in[i];
+		if (!code || i + code > len)
+		return 0;
+		for (k = 1; k < code; k++)
+		out[n++] = in[i + k];
+		i += code;
+		if (i < len)
+		out[n++] = 0;
+	}
+	return n;
+}
+
+static uint32_t get_le(const uint8_t *p, uint8_t size) {
+	uint32_t value = 0;
+
+	while (size--)
+	value = value << 8 | p[size];
+	return value;
+}
+
+static const uint32_t times[] = {0, 0x000000FF, 0x0000FF00, 0x00FF0000, 0xFF000000, 0x00FF00FF, 0xFF00FF00, 0x01000001, 0xFFFFFFFF};
+static const uint16_t widths[] = {0, 0x00FF, 0xFF00, 0x0100, 0xFFFF, 1160};
+
+static void check_frames(void) {
+	uint8_t packet[32], len, i;
+	uint32_t n, time, bad = 0, crc_zero[2] = {0, 0};
+	uint16_t ticks, crc;
+
+	CHECK(crc16_ccitt_false((const uint8_t *)"123456789", 9) == 0x29B1, "the reference CRC is wrong");
+	for (n = 0; n <= 0x10000; n++) {
+		time = times[n % (sizeof(times) / sizeof(times[0]))];
+		ticks = widths[n / 7 % (sizeof(widths) / sizeof(widths[0]))];
+		wire_len = 0;
+		telemetry_send(time, ticks);
+
+		if (wire_len != TELEMETRY_FRAME_SIZE || wire[wire_len - 1] != 0 || memchr(wire, 0, wire_len - 1)) {
+			bad++;
+			continue;
+		}
+		len = cobs_decode(wire, wire_len - 1, packet);
+		crc = crc16_ccitt_false(packet, TELEMETRY_PACKET_SIZE - 2);
+		if (len != TELEMETRY_PACKET_SIZE || packet[0] != TELEMETRY_VERSION || get_le(packet + 1, 2) != (n & 0xFFFF) ||
+			get_le(packet + 3, 4) != time || get_le(packet + 7, 2) != ticks || get_le(packet + 9, 2) != crc) {
+			if (bad++ < 5) {
+				printf("packet %lu:", (unsigned long)n);
+				for (i = 0; i < len; i++)
+				printf(" %02x", packet[i]);
+				printf(", CRC %04x\n", crc);
+			}
+			continue;
+		}
+		crc_zero[0] += !(crc & 0xFF);
+		crc_zero[1] += !(crc >> 8);
+	}
+	CHECK(!bad, "%lu of 65537 frames wrong", (unsigned long)bad);
+	CHECK(crc_zero[0] && crc_zero[1], "no CRC with a zero byte came up (%lu low, %lu high)", (unsigned long)crc_zero[0],
+		(unsigned long)crc_zero[1]);
+}
+
+static void check_dropped(void) {
+	uint8_t packet[32];
+	uint16_t dropped = telemetry_dropped(), seq;
+
+	tx_free = TELEMETRY_FRAME_SIZE;
+	wire_len = 0;
+	telemetry_send(0, 0);
+	cobs_decode(wire, wire_len - 1, packet);
+	seq = get_le(packet + 1, 2);
+	CHECK(wire_len == TELEMETRY_FRAME_SIZE, "%u bytes free: frame of %u bytes, want %u", tx_free, wire_len, TELEMETRY_FRAME_SIZE);
+
+	tx_free = TELEMETRY_FRAME_SIZE - 1;
+	wire_len = 0;
+	telemetry_send(0, 0);
+	CHECK(wire_len == 0, "%u bytes free: %u bytes of the frame were sent", tx_free, wire_len);
+	CHECK(telemetry_dropped() == dropped + 1, "%u dropped frames counted, want %u", telemetry_dropped(), dropped + 1);
+
+	tx_free = 255;
+	wire_len = 0;
+	telemetry_send(0, 0);
+	cobs_decode(wire, wire_len - 1, packet);
+	CHECK(get_le(packet + 1, 2) == (uint16_t)(seq + 2), "after a drop: sequence %lu, want %u", (unsigned long)get_le(packet + 1, 2),
+		(uint16_t)(seq + 2));
+}
+
+int main(void) {
+	check_frames();
+	check_dropped();
+	return check_done();
+}
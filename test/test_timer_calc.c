@@ -0,0 +1,92 @@
+/*
+The `test_timer_calc.c` file checks the settings `timer_calc.h` works out, at 16 MHz and at the 1 MHz of `Wk3_LightMeter_GM.c`.
+
+1. **Known Settings**: 1 Hz on Timer1 at 16 MHz is a prescaler of 256 with TOP 62499, 50 Hz is a prescaler of 8 with TOP 39999 and the
+0.5 ms and 2.4 ms servo pulses in it are 999 and 4799. A period that is not a whole number of ticks is rounded to the nearest. At 1 MHz,
+1 Hz on Timer1 is a prescaler of 64 with TOP 15624, and 1 kHz on Timer0 a prescaler of 8 with TOP 124. The clock select bits must match
+the prescaler of each timer.
+
+2. **Impossible Settings**: A period longer than the largest prescaler allows, one of a single tick and one that cannot be met within the
+error asked for must all fail `TIMER_OK`, both here and in `#if`, where a sketch uses it.
+
+3. **Smallest Prescaler**: For a range of frequencies on every timer, the prescaler picked must be the smallest that fits, and no larger
+one may have a smaller error.
+*/
+
+#include "check.h"
+#include "timer_calc.h"
+#include <stdint.h>
+
+#if !TIMER_OK(1, TIMER_HZ(50), 0) || TIMER_OK(0, TIMER_HZ(1), 1000000) || TIMER_OK(2, TIMER_HZ(3000000), 100)
+#error "TIMER_OK does not work in #if"
+#endif
+
+#define SETTING(timer, period, n, top) \
+	CHECK(TIMER_PRESCALER(timer, period) == (n) && TIMER_TOP(timer, period) == (top), \
+		"Timer%u, %s at %lu Hz: prescaler %llu, TOP %llu; want %u, %u", timer, #period, (unsigned long)F_CPU, \
+		(unsigned long long)TIMER_PRESCALER(timer, period), (unsigned long long)TIMER_TOP(timer, period), n, top)
+
+static void check_16mhz(void) {
+	SETTING(1, TIMER_HZ(1), 256, 62499);
+	CHECK(TIMER_CS(1, TIMER_HZ(1)) == 4 && TIMER_ERROR_PPM(1, TIMER_HZ(1)) == 0, "Timer1, 1 Hz: wrong clock select or error");
+	SETTING(1, TIMER_HZ(50), 8, 39999);
+	CHECK(TIMER_CS(1, TIMER_HZ(50)) == 2, "Timer1, 50 Hz: clock select %u", (unsigned)TIMER_CS(1, TIMER_HZ(50)));
+	CHECK(TIMER_PULSE(1, TIMER_HZ(50), TIMER_US(500)) == 999 && TIMER_PULSE(1, TIMER_HZ(50), TIMER_US(2400)) == 4799,
+		"servo pulses: %llu and %llu, want 999 and 4799", (unsigned long long)TIMER_PULSE(1, TIMER_HZ(50), TIMER_US(500)),
+		(unsigned long long)TIMER_PULSE(1, TIMER_HZ(50), TIMER_US(2400)));
+	SETTING(1, TIMER_HZ(6), 64, 41666); // 41666.7 ticks, rounded to the nearest
+	SETTING(2, TIMER_MS(1), 64, 249);
+	CHECK(TIMER_CS(2, TIMER_MS(1)) == 4 && TIMER_CS(0, TIMER_MS(1)) == 3, "1 ms: Timer2 and Timer0 clock selects differ wrongly");
+
+	CHECK(!TIMER_OK(0, TIMER_HZ(1), 1000000) && TIMER_PRESCALER(0, TIMER_HZ(1)) == 0, "1 Hz fits Timer0");
+	CHECK(!TIMER_OK(1, TIMER_HZ(16000000), 0), "a period of one tick is accepted");
+	CHECK(!TIMER_OK(2, TIMER_HZ(3000000), 100) && TIMER_OK(2, TIMER_HZ(3000000), 70000), "3 MHz: error %llu ppm",
+		(unsigned long long)TIMER_ERROR_PPM(2, TIMER_HZ(3000000)));
+}
+
+// The error of `period` with prescaler n, by the definition in timer_calc.h
+static uint64_t error_ppm(uint64_t n, uint64_t num, uint64_t den) {
+	return TIMER_ERROR_(n, num, den);
+}
+
+static void check_smallest(void) {
+	static const uint16_t prescalers[] = {1, 8, 32, 64, 128, 256, 1024};
+	uint32_t hz, worse = 0, smaller = 0;
+	uint8_t timer, i;
+	uint16_t n;
+
+	for (timer = 0; timer < 3; timer++) {
+		for (hz = 1; hz < 200000; hz = hz * 21 / 20 + 1) {
+			n = TIMER_PRESCALER_(timer, 1, hz);
+			if (!n)
+			continue;
+			for (i = 0; i < sizeof(prescalers) / sizeof(prescalers[0]); i++) {
+				if (prescalers[i] == n || (timer != 2 && (prescalers[i] == 32 || prescalers[i] == 128)))
+				continue;
+				if (prescalers[i] < n && TIMER_FITS_(timer, prescalers[i], 1, hz))
+				smaller++;
+				if (prescalers[i] > n && error_ppm(prescalers[i], 1, hz) < error_ppm(n, 1, hz))
+				worse++;
+			}
+		}
+	}
+	CHECK(!smaller, "%lu times a smaller prescaler would have fitted", (unsigned long)smaller);
+	CHECK(!worse, "%lu times a larger prescaler was closer", (unsigned long)worse);
+}
+
+#undef F_CPU
+#define F_CPU 1000000UL
+
+static void check_1mhz(void) {
+	SETTING(1, TIMER_HZ(1), 64, 15624);
+	CHECK(TIMER_CS(1, TIMER_HZ(1)) == 3, "Timer1, 1 Hz at 1 MHz: clock select %u", (unsigned)TIMER_CS(1, TIMER_HZ(1)));
+	SETTING(0, TIMER_HZ(1000), 8, 124);
+	CHECK(!TIMER_OK(0, TIMER_HZ(1), 1000000) && TIMER_OK(0, TIMER_HZ(4), 1000), "at 1 MHz Timer0 goes down to 4 Hz, not 1 Hz");
+}
+
+int main(void) {
+	check_16mhz();
+	check_smallest();
+	check_1mhz();
+	return check_done();
+}
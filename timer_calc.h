@@ -0,0 +1,73 @@
+/*
+The `timer_calc.h` file works out timer settings from `F_CPU` at compile time, so a sketch asks for a frequency, a period or a pulse
+width instead of copying numbers like `OCR1A = 15624` that are only right at one clock speed.
+
+1. **Periods**: A period is given as `TIMER_HZ(hz)`, `TIMER_MS(ms)` or `TIMER_US(us)`, which keep it as a fraction of a second so that no
+rounding happens before the timer counts are known. Timers are given by number, 0, 1 or 2.
+
+2. **Solving**: `TIMER_PRESCALER(timer, period)` is the smallest prescaler of that timer with which the period fits in the counter (256
+counts for Timer0 and Timer2, 65536 for Timer1). That is the policy, and no larger prescaler can come closer: each prescaler divides the
+larger ones, so every period a larger one can make, the smaller one can make too, and with finer steps. It is 0 when the period is too long
+for every prescaler. `TIMER_CS(timer, period)` gives the matching clock select bits for `TCCRnB` and `TIMER_TOP(timer, period)`
+the value for `OCRnA` in CTC mode or `ICR1` in fast PWM mode; both count periods of TOP + 1 ticks. `TIMER_PULSE(timer, period, width)` is
+the compare value for a pulse of `width` in a PWM frame of `period`, which lasts compare + 1 ticks in fast PWM mode.
+
+3. **Error**: `TIMER_ERROR_PPM(timer, period)` is how far the period the timer really makes is from the one asked for, in parts per
+million, and `TIMER_OK(timer, period, ppm)` is 1 when the period fits and the error is within `ppm`. Everything here is plain integer
+arithmetic on constants, so the macros also work in `#if`, and a sketch stops the build with `#error` when a setting cannot be met:
+
+	#if !TIMER_OK(1, TIMER_HZ(50), 100)
+	#error "Timer1 cannot make 50 Hz within 100 ppm"
+	#endif
+
+None of this leaves any code in the program; the compiler folds it all into the constants written to the registers. `test/test_timer_calc.c`
+checks known settings at 16 MHz and 1 MHz, settings that cannot be met, and the prescaler policy.
+*/
+
+#ifndef TIMER_CALC_H_
+#define TIMER_CALC_H_
+
+#ifndef F_CPU
+#define F_CPU 16000000UL
+#endif
+
+// Periods as (numerator, denominator) of a second
+#define TIMER_HZ(hz) (1, (hz))
+#define TIMER_MS(ms) ((ms), 1000)
+#define TIMER_US(us) ((us), 1000000)
+#define TIMER_NUM(num, den) (num)
+#define TIMER_DEN(num, den) (den)
+
+#define TIMER_COUNT_MAX(timer) ((timer) == 1 ? 65536ULL : 256ULL)
+
+// Ticks of prescaler n in num/den seconds, rounded
+#define TIMER_TICKS_(n, num, den) ((2ULL * F_CPU * (num) + (n) * (den)) / (2ULL * (n) * (den)))
+#define TIMER_FITS_(timer, n, num, den) (TIMER_TICKS_(n, num, den) <= TIMER_COUNT_MAX(timer))
+
+// Timer2 has the extra prescalers 32 and 128
+#define TIMER_PRESCALER_(timer, num, den) \
+	(TIMER_FITS_(timer, 1, num, den) ? 1 : TIMER_FITS_(timer, 8, num, den) ? 8 : \
+	(timer) == 2 && TIMER_FITS_(timer, 32, num, den) ? 32 : TIMER_FITS_(timer, 64, num, den) ? 64 : \
+	(timer) == 2 && TIMER_FITS_(timer, 128, num, den) ? 128 : TIMER_FITS_(timer, 256, num, den) ? 256 : \
+	TIMER_FITS_(timer, 1024, num, den) ? 1024 : 0)
+
+#define TIMER_CS_(timer, n) \
+	((n) == 1 ? 1 : (n) == 8 ? 2 : (timer) == 2 ? ((n) == 32 ? 3 : (n) == 64 ? 4 : (n) == 128 ? 5 : (n) == 256 ? 6 : 7) : \
+	(n) == 64 ? 3 : (n) == 256 ? 4 : 5)
+
+#define TIMER_TOP_(n, num, den) ((n) ? TIMER_TICKS_(n, num, den) - 1 : 0)
+
+// |ticks * n - F_CPU * num / den| / (F_CPU * num / den), in ppm
+#define TIMER_ERROR_(n, num, den) ((n) ? TIMER_DIFF_((n) * (den) * TIMER_TICKS_(n, num, den), 1ULL * F_CPU * (num)) * 1000000ULL / \
+	(1ULL * F_CPU * (num)) : 1000000ULL)
+#define TIMER_DIFF_(a, b) ((a) > (b) ? (a) - (b) : (b) - (a))
+
+#define TIMER_PRESCALER(timer, period) TIMER_PRESCALER_(timer, TIMER_NUM period, TIMER_DEN period)
+#define TIMER_CS(timer, period) TIMER_CS_(timer, TIMER_PRESCALER(timer, period))
+#define TIMER_TOP(timer, period) TIMER_TOP_(TIMER_PRESCALER(timer, period), TIMER_NUM period, TIMER_DEN period)
+#define TIMER_PULSE(timer, period, width) TIMER_TOP_(TIMER_PRESCALER(timer, period), TIMER_NUM width, TIMER_DEN width)
+#define TIMER_ERROR_PPM(timer, period) TIMER_ERROR_(TIMER_PRESCALER(timer, period), TIMER_NUM period, TIMER_DEN period)
+#define TIMER_OK(timer, period, ppm) \
+	(TIMER_PRESCALER(timer, period) != 0 && TIMER_TOP(timer, period) > 0 && TIMER_ERROR_PPM(timer, period) <= (ppm))
+
+#endif /* TIMER_CALC_H_ */
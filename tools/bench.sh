@@ -0,0 +1,89 @@
+#!/bin/sh
+# Runs the firmware images under simavr and compares the numbers with bench/baseline.csv.
+# Usage: tools/bench.sh [--host] [--save] [--no-build]
+#   --host      run the host builds of the sketches on the register model instead (SIM_BENCH, see host/sim.h) and compare with
+#               bench/baseline_host.csv; needs neither avr-gcc nor simavr, and its cycle counts are the model's, not the chip's
+#   --save      store this run as the new baseline
+#   --no-build  use the images already in $AVR_BUILD or $HOST_BUILD (used by the `bench` CMake target and the `bench_host` test)
+# AVR_BUILD (default build-avr) is the AVR build directory, BENCH_BUILD (default build-bench) the runner's and HOST_BUILD (default
+# build-host) the host build.
+
+set -e
+
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+AVR_BUILD=${AVR_BUILD:-$ROOT/build-avr}
+BENCH_BUILD=${BENCH_BUILD:-$ROOT/build-bench}
+HOST_BUILD=${HOST_BUILD:-$ROOT/build-host}
+save=
+build=1
+host=
+
+for arg in "$@"; do
+	case $arg in
+		--host) host=1 ;;
+		--save) save=--save ;;
+		--no-build) build= ;;
+		*) echo "usage: $0 [--host] [--save] [--no-build]" >&2; exit 2 ;;
+	esac
+done
+
+if [ -n "$host" ]; then
+	if [ -n "$build" ]; then
+		[ -f "$HOST_BUILD/CMakeCache.txt" ] || cmake -S "$ROOT" -B "$HOST_BUILD"
+		cmake --build "$HOST_BUILD"
+	fi
+
+	OUT=$HOST_BUILD/bench_host.csv
+	echo "sketch,metric,value" > "$OUT"
+
+	# Only the lines of the statistics, not what the sketch prints itself
+	run() {
+		SIM_MS=$2 SIM_BENCH=$1 "$HOST_BUILD/$1" 2>/dev/null | grep -a "^$1," >> "$OUT"
+	}
+
+	run bench_lcd_uart 2000
+	run bench_lcd_parallel 1000
+	run bench_lcd_i2c 1000
+	run final_project 3000
+	run interrupts_timers_more 3000
+	run week2_interrupts_avr 3000
+	run week2_interrupts_basic 1000
+	run servo_interfacing_2 4500
+	run light_meter_gm 2000
+	run light_meter_6d 200
+	run fade_led 2000
+
+	python3 "$ROOT/tools/bench_compare.py" "$ROOT/bench/baseline_host.csv" "$OUT" --json "$HOST_BUILD/bench_host.json" $save
+	exit
+fi
+
+if [ -n "$build" ]; then
+	[ -f "$AVR_BUILD/CMakeCache.txt" ] || cmake -S "$ROOT" -B "$AVR_BUILD" -DCMAKE_TOOLCHAIN_FILE="$ROOT/cmake/avr-gcc.cmake"
+	cmake --build "$AVR_BUILD"
+fi
+[ -f "$BENCH_BUILD/CMakeCache.txt" ] || cmake -S "$ROOT/bench" -B "$BENCH_BUILD"
+cmake --build "$BENCH_BUILD"
+
+OUT=$BENCH_BUILD/results.csv
+echo "sketch,metric,value" > "$OUT"
+
+run() {
+	name=$1
+	shift
+	"$BENCH_BUILD/runner" --elf "$AVR_BUILD/$name.elf" --name "$name" "$@" >> "$OUT"
+}
+
+run bench_lcd_uart --ms 2000 --func lcd_data --func lcd_puts --loop bench_pass
+run bench_lcd_parallel --ms 1000 --loop bench_pass --rate chars:32
+run bench_lcd_i2c --ms 1000 --loop bench_pass --rate chars:32 --i2c-ack 0x27
+run final_project --ms 3000 --loop sched_run
+run interrupts_timers_more --ms 3000 --toggle PD2:20
+run week2_interrupts_avr --ms 3000 --toggle PD2:20
+run week2_interrupts_basic --ms 1000 --toggle PD2:20
+run servo_interfacing_2 --ms 2000 --loop sched_run
+run light_meter_gm --freq 1000000 --ms 2000 --loop printBinaryByte --func hc595_show
+run light_meter_6d --ms 200
+run fade_led --ms 2000
+"$BENCH_BUILD/hcsr04" --elf "$AVR_BUILD/final_project.elf" --trace "$ROOT/bench/distance_trace.txt" --csv >> "$OUT"
+
+python3 "$ROOT/tools/bench_compare.py" "$ROOT/bench/baseline.csv" "$OUT" --json "$BENCH_BUILD/results.json" $save
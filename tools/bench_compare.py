@@ -0,0 +1,83 @@
+#!/usr/bin/env python3
+"""Compares a benchmark run with the stored baseline.
+
+Both files are CSV with the columns sketch,metric,value as written by tools/bench.sh. Cycle counts, latencies and durations are better
+when lower and rates (metrics named *_per_*) when higher. A metric that got worse by more than the tolerance is reported as a regression and
+makes the script exit with status 1, and so does a missing baseline. --json also writes the run as {sketch: {metric: value}}, and --save
+copies it over the baseline.
+"""
+
+import argparse
+import csv
+import json
+import os
+import shutil
+import sys
+
+
+def load(path):
+    results = {}
+    with open(path, newline="") as f:
+        for row in csv.DictReader(f):
+            results[(row["sketch"], row["metric"])] = int(row["value"])
+    return results
+
+
+def higher_is_better(metric):
+    return "_per_" in metric
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("baseline")
+    parser.add_argument("results")
+    parser.add_argument("--json", help="also write the results as JSON to this file")
+    parser.add_argument("--tolerance", type=float, default=5.0, help="allowed change in percent (default 5)")
+    parser.add_argument("--save", action="store_true", help="make these results the new baseline")
+    args = parser.parse_args()
+
+    results = load(args.results)
+
+    if args.json:
+        tree = {}
+        for (sketch, metric), value in sorted(results.items()):
+            tree.setdefault(sketch, {})[metric] = value
+        with open(args.json, "w") as f:
+            json.dump(tree, f, indent=2, sort_keys=True)
+            f.write("\n")
+
+    if args.save:
+        shutil.copyfile(args.results, args.baseline)
+        print("saved %d metrics to %s" % (len(results), args.baseline))
+        return 0
+
+    if not os.path.exists(args.baseline):
+        print("no baseline at %s, run tools/bench.sh --save (--host --save for the register model) to store one" % args.baseline)
+        return 1
+
+    baseline = load(args.baseline)
+    regressions = 0
+    print("%-24s %-36s %12s %12s %8s" % ("sketch", "metric", "baseline", "now", "change"))
+    for key in sorted(set(baseline) | set(results)):
+        sketch, metric = key
+        old = baseline.get(key)
+        new = results.get(key)
+        if old is None or new is None:
+            print("%-24s %-36s %12s %12s %8s" % (sketch, metric, old if old is not None else "-", new if new is not None else "-", "n/a"))
+            continue
+        change = 0.0 if old == new else (100.0 * (new - old) / old if old else 100.0)
+        worse = -change if higher_is_better(metric) else change
+        flag = ""
+        if worse > args.tolerance:
+            flag = "  SLOWER"
+            regressions += 1
+        print("%-24s %-36s %12d %12d %+7.1f%%%s" % (sketch, metric, old, new, change, flag))
+
+    if regressions:
+        print("%d metric(s) got worse by more than %.1f%%" % (regressions, args.tolerance))
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,16 @@
+#!/bin/sh
+# Fails if any of the given firmware images links the AVR soft-float
+# multiply or divide. Usage: tools/check_nofloat.sh firmware.elf ...
+
+NM=${AVR_NM:-avr-nm}
+status=0
+
+for elf in "$@"; do
+	if $NM "$elf" | grep -E ' T (__mulsf3|__divsf3)$' >/dev/null; then
+		echo "$elf: links soft-float:" >&2
+		$NM "$elf" | grep -E ' T (__mulsf3|__divsf3)$' >&2
+		status=1
+	fi
+done
+
+exit $status
@@ -0,0 +1,44 @@
+#!/bin/sh
+# Fails if a probe function in the disassembly of tools/pins_probe.c has more instructions than the number at the end of its name
+# (probe_high_1 may have 1), not counting the ret. Usage: tools/check_pins.sh pins_probe.o ...
+
+OBJDUMP=${AVR_OBJDUMP:-avr-objdump}
+
+$OBJDUMP -d "$@" | awk '
+	function check() {
+		if (count > limit) {
+			printf "%s: %d instructions, expected at most %d\n", name, count, limit > "/dev/stderr"
+			status = 1
+		}
+		checked++
+		name = ""
+	}
+	/^[0-9a-f]+ <probe_[a-z_]*_[0-9]+>:$/ {
+		if (name != "")
+		check()
+		name = $2
+		gsub(/[<>:]/, "", name)
+		limit = name
+		sub(/.*_/, "", limit)
+		limit += 0
+		count = 0
+		next
+	}
+	name != "" && /^ +[0-9a-f]+:\t/ {
+		if ($0 !~ /\tret$/)
+		count++
+		next
+	}
+	name != "" && /^$/ {
+		check()
+	}
+	END {
+		if (name != "")
+		check()
+		if (!checked) {
+			print "no probe functions found" > "/dev/stderr"
+			status = 1
+		}
+		exit status
+	}
+'
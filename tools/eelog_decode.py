@@ -0,0 +1,106 @@
+#!/usr/bin/env python3
+"""Decodes the EEPROM sample log written by eelog.c into CSV.
+
+The input is either the text a sketch sends for its dump command ("EE <address> <64 hex digits>" lines; anything else on the line-based
+stream, like the distance reports, is ignored) or a raw 1 KB EEPROM image, for example from avrdude -U eeprom:r:log.bin:r. The blocks
+that pass their CRC are put in sequence order, oldest first, and every sample becomes a CSV line on stdout with the columns
+block,channel,index,value. --names 0=distance,1=light replaces the channel numbers with names. A count of the blocks and samples, and of
+the blocks that failed the CRC, goes to stderr.
+"""
+
+import argparse
+import struct
+import sys
+
+BLOCK_SIZE = 32
+BLOCKS = 32
+HEADER = struct.Struct("<HBBH")  # sequence, channel, count, first sample
+ESCAPE = 0x80
+
+
+def crc8_maxim(data):
+    crc = 0
+    for byte in data:
+        crc ^= byte
+        for _ in range(8):
+            crc = (crc >> 1) ^ 0x8C if crc & 1 else crc >> 1
+    return crc
+
+
+def load(path):
+    with open(path, "rb") as f:
+        data = f.read()
+    if len(data) == BLOCK_SIZE * BLOCKS and not data.lstrip(b"\r\n").startswith(b"EE "):
+        return data
+    image = bytearray(b"\xff" * BLOCK_SIZE * BLOCKS)
+    for line in data.decode("ascii", "replace").splitlines():
+        parts = line.split()
+        if len(parts) != 3 or parts[0] != "EE" or len(parts[2]) != 2 * BLOCK_SIZE:
+            continue
+        try:
+            address = int(parts[1], 16)
+            block = bytes.fromhex(parts[2])
+        except ValueError:
+            continue
+        if address % BLOCK_SIZE == 0 and address < len(image):
+            image[address:address + BLOCK_SIZE] = block
+    return bytes(image)
+
+
+def decode_block(block):
+    sequence, channel, count, value = HEADER.unpack_from(block)
+    samples = [value]
+    i = HEADER.size
+    while len(samples) < count and i < BLOCK_SIZE - 1:
+        byte = block[i]
+        if byte == ESCAPE:
+            value = struct.unpack_from("<H", block, i + 1)[0]
+            i += 3
+        else:
+            value = (value + (byte - 256 if byte > 127 else byte)) & 0xFFFF
+            i += 1
+        samples.append(value)
+    return sequence, channel, samples
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("input", help="dump text or raw EEPROM image")
+    parser.add_argument("--names", default="", help="channel names, e.g. 0=distance,1=light")
+    args = parser.parse_args()
+
+    names = dict(item.split("=", 1) for item in args.names.split(",") if "=" in item)
+    image = load(args.input)
+
+    blocks, bad = [], 0
+    for b in range(BLOCKS):
+        block = image[b * BLOCK_SIZE:(b + 1) * BLOCK_SIZE]
+        if block == b"\xff" * BLOCK_SIZE:
+            continue
+        count = block[3]
+        if count == 0 or count > BLOCK_SIZE - HEADER.size or crc8_maxim(block[:-1]) != block[-1]:
+            bad += 1
+            continue
+        blocks.append(decode_block(block))
+
+    # The sequence numbers wrap at 65536; the oldest block is the one after the biggest gap
+    blocks.sort(key=lambda b: b[0])
+    if blocks:
+        gaps = [(blocks[(i + 1) % len(blocks)][0] - blocks[i][0]) & 0xFFFF for i in range(len(blocks))]
+        first = (gaps.index(max(gaps)) + 1) % len(blocks)
+        blocks = blocks[first:] + blocks[:first]
+
+    out = sys.stdout
+    out.write("block,channel,index,value\n")
+    samples = 0
+    for sequence, channel, values in blocks:
+        name = names.get(str(channel), str(channel))
+        for index, value in enumerate(values):
+            out.write("%d,%s,%d,%d\n" % (sequence, name, index, value))
+        samples += len(values)
+    sys.stderr.write("%d blocks, %d samples, %d bad blocks\n" % (len(blocks), samples, bad))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
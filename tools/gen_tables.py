@@ -0,0 +1,56 @@
+#!/usr/bin/env python3
+"""
+Generates fixmath_tables.h, the lookup tables used by fixmath.h.
+
+The tables are worked out here in floating point once, so the firmware
+only ever reads integers out of flash. Run it from the repository root:
+
+    python3 tools/gen_tables.py > fixmath_tables.h
+"""
+
+import math
+
+GAMMA = 2.2        # LED brightness curve
+SINE_STEPS = 64    # Entries in a quarter sine wave, plus one for 90 degrees
+
+
+def rows(values, per_row, width):
+    for start in range(0, len(values), per_row):
+        chunk = values[start:start + per_row]
+        yield "\t" + ", ".join("%*d" % (width, v) for v in chunk) + ","
+
+
+def main():
+    gamma = [round(255 * (i / 255) ** GAMMA) for i in range(256)]
+    sine = [round(32767 * math.sin(math.pi / 2 * i / SINE_STEPS)) for i in range(SINE_STEPS + 1)]
+
+    print("/*")
+    print("The `fixmath_tables.h` file is generated by `tools/gen_tables.py`. Do not edit it by hand, change the script and run it again.")
+    print("")
+    print("1. **fix_gamma8**: 8-bit brightness to PWM duty with a gamma of %.1f, so equal steps in brightness look equal to the eye." % GAMMA)
+    print("2. **fix_sine_q15**: sin(90 degrees * i / %d) in Q15 for i = 0 to %d, used for smooth S-curves." % (SINE_STEPS, SINE_STEPS))
+    print("*/")
+    print("")
+    print("#ifndef FIXMATH_TABLES_H_")
+    print("#define FIXMATH_TABLES_H_")
+    print("")
+    print("#include <stdint.h>")
+    print("#include <avr/pgmspace.h>")
+    print("")
+    print("#define FIX_SINE_STEPS %d" % SINE_STEPS)
+    print("")
+    print("static const uint8_t fix_gamma8[256] PROGMEM = {")
+    for line in rows(gamma, 16, 3):
+        print(line)
+    print("};")
+    print("")
+    print("static const int16_t fix_sine_q15[FIX_SINE_STEPS + 1] PROGMEM = {")
+    for line in rows(sine, 8, 5):
+        print(line)
+    print("};")
+    print("")
+    print("#endif /* FIXMATH_TABLES_H_ */")
+
+
+if __name__ == "__main__":
+    main()
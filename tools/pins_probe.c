@@ -0,0 +1,36 @@
+/*
+The `pins_probe.c` file is compiled for the ATmega328P only to be disassembled by `tools/check_pins.sh`, which checks that every function
+here is no longer than the instruction count in its name (`ret` not counted). Each one is a `pins.h` operation that must stay that small.
+*/
+
+#include "pins.h"
+#include <stdint.h>
+
+void probe_high_1(void) {
+	PIN_HIGH(PIN_D(6)); // sbi
+}
+
+void probe_low_1(void) {
+	PIN_LOW(PIN_B(5)); // cbi
+}
+
+void probe_output_1(void) {
+	PIN_OUTPUT(PIN_C(3)); // sbi on DDRC
+}
+
+void probe_toggle_2(void) {
+	PIN_TOGGLE(PIN_D(7)); // ldi, out to PIND
+}
+
+void probe_follow_2(void) {
+	if (PIN_IS_LOW(PIN_D(2))) // sbis
+	PIN_HIGH(PIN_B(0)); // sbi
+}
+
+void probe_group_high_3(void) {
+	PIN_GROUP_HIGH(PIN_GROUP(PIN_D(6), PIN_D(7))); // in, ori, out
+}
+
+void probe_group_write_5(uint8_t value) {
+	PIN_GROUP_WRITE(PIN_GROUP(PIN_D(4), PIN_D(5), PIN_D(6), PIN_D(7)), value); // in, andi, andi, or, out
+}
@@ -0,0 +1,153 @@
+#!/usr/bin/env python3
+"""Decodes the binary telemetry of the distance meter into CSV.
+
+The input is the byte stream of a TELEMETRY build of the final project (see RBT211 Final Project/telemetry.h): COBS frames ending in 0x00,
+each holding version, sequence number, time stamp, echo width and a CRC-16/CCITT. The input can be a serial port, which is set to raw mode
+at --baud, a file, or - for stdin. The time stamp and the echo width are in timer ticks whose length depends on the clock, so --f-cpu must
+match the board (16 MHz by default). Every good frame becomes a CSV line on stdout with the columns seq,time_ms,echo_us,distance_cm. A
+timeout has an empty echo_us and distance_cm. Frames with a bad CRC or a broken encoding are counted and skipped, and a jump in the
+sequence number is counted as dropped frames. The totals go to stderr when the input ends or on Ctrl-C.
+"""
+
+import argparse
+import os
+import stat
+import struct
+import sys
+import termios
+
+VERSION = 1
+PACKET = struct.Struct("<BHIH")  # version, sequence, time stamp, echo width; then the CRC
+F_CPU = 16000000
+ECHO_TIMEOUT = 0xFFFF
+US_PER_CM = 58.3  # Round trip at 343 m/s
+
+
+def crc16_ccitt(data):
+    crc = 0xFFFF
+    for byte in data:
+        crc ^= byte << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else crc << 1
+            crc &= 0xFFFF
+    return crc
+
+
+def cobs_decode(frame):
+    out = bytearray()
+    i = 0
+    while i < len(frame):
+        code = frame[i]
+        if code == 0 or i + code > len(frame):
+            return None
+        out += frame[i + 1:i + code]
+        i += code
+        if code < 0xFF and i < len(frame):
+            out.append(0)
+    return bytes(out)
+
+
+def open_input(path, baud):
+    if path == "-":
+        return sys.stdin.buffer
+    f = open(path, "rb", buffering=0)
+    if stat.S_ISCHR(os.fstat(f.fileno()).st_mode):
+        speed = getattr(termios, "B%d" % baud, None)
+        if speed is None:
+            sys.exit("telemetry_decode: unsupported baud rate %d" % baud)
+        attrs = termios.tcgetattr(f)
+        attrs[0] = 0  # iflag
+        attrs[1] = 0  # oflag
+        attrs[2] = termios.CS8 | termios.CREAD | termios.CLOCAL  # cflag
+        attrs[3] = 0  # lflag
+        attrs[4] = attrs[5] = speed
+        attrs[6][termios.VMIN] = 1
+        attrs[6][termios.VTIME] = 0
+        termios.tcsetattr(f, termios.TCSANOW, attrs)
+    return f
+
+
+def echo_ticks_per_us(f_cpu):
+    """Timer1 ticks per us at F_CPU / 8, as ECHO_TICKS_PER_US in echo.h."""
+    if f_cpu % 8000000:
+        sys.exit("telemetry_decode: Timer1 at F_CPU / 8 needs F_CPU to be a multiple of 8 MHz, not %d" % f_cpu)
+    return f_cpu // 8000000
+
+
+class Stats:
+    def __init__(self, tick_us, echo_ticks_per_us):
+        self.tick_us = tick_us
+        self.echo_ticks_per_us = echo_ticks_per_us
+        self.frames = 0
+        self.bad = 0
+        self.dropped = 0
+        self.last_seq = None
+
+    def report(self):
+        total = self.frames + self.dropped
+        sys.stderr.write("%d frames, %d dropped (%.1f%%), %d bad\n" % (
+            self.frames, self.dropped, 100.0 * self.dropped / total if total else 0.0, self.bad))
+
+
+def handle(frame, stats, out):
+    """Writes the CSV line for one frame; returns False for a bad frame."""
+    packet = cobs_decode(frame)
+    if packet is None or len(packet) != PACKET.size + 2:
+        return False
+    if crc16_ccitt(packet[:-2]) != struct.unpack_from("<H", packet, PACKET.size)[0]:
+        return False
+    version, seq, ticks, width = PACKET.unpack_from(packet)
+    if version != VERSION:
+        return False
+
+    if stats.last_seq is not None:
+        stats.dropped += (seq - stats.last_seq - 1) & 0xFFFF
+    stats.last_seq = seq
+    stats.frames += 1
+
+    time_ms = ticks * stats.tick_us / 1000.0
+    if width == ECHO_TIMEOUT:
+        out.write("%d,%.3f,,\n" % (seq, time_ms))
+    else:
+        echo_us = width / stats.echo_ticks_per_us
+        out.write("%d,%.3f,%.1f,%.1f\n" % (seq, time_ms, echo_us, echo_us / US_PER_CM))
+    return True
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("input", help="serial port, file, or - for stdin")
+    parser.add_argument("--baud", type=int, default=57600, help="serial port speed (default 57600)")
+    parser.add_argument("--f-cpu", type=int, default=F_CPU, help="clock of the board in Hz (default 16000000)")
+    parser.add_argument("--tick-us", type=float, help="scheduler tick in us (default 1024 clocks, 64 at 16 MHz)")
+    args = parser.parse_args()
+
+    tick_us = args.tick_us if args.tick_us else 1024e6 / args.f_cpu  # SCHED_TICK_US in sched.h
+    stats = Stats(tick_us, echo_ticks_per_us(args.f_cpu))
+    f = open_input(args.input, args.baud)
+    out = sys.stdout
+    out.write("seq,time_ms,echo_us,distance_cm\n")
+    frame = bytearray()
+    first = True  # The first frame may have started before we did, so it is not counted if it is bad
+    try:
+        while True:
+            data = f.read(256) if f is not sys.stdin.buffer else f.read1(256)
+            if not data:
+                break
+            for byte in data:
+                if byte != 0:
+                    frame.append(byte)
+                    continue
+                if frame and not handle(bytes(frame), stats, out) and not first:
+                    stats.bad += 1
+                first = False
+                frame.clear()
+            out.flush()
+    except KeyboardInterrupt:
+        pass
+    stats.report()
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
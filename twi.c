@@ -0,0 +1,210 @@
+/*
+The `twi.c` file contains the definitions of the functions declared in the `twi.h` file.
+
+1. **Queue**: `queue` holds the transactions, each with its address byte (SLA+R/W), its length and, for a read, the caller's buffer.
+The bytes of the writes are kept in `buffer` in the same order, so the ISR simply takes the next `length` bytes for each write. `tail` is
+the transaction on the bus while `running` is 1.
+
+2. **State Machine**: Every `TWI_vect` looks at the status code in `TWSR`. After a START it sends the address; after an acknowledged
+address or byte it sends the next byte or reads one, asking for one more byte with `TWEA` until the last. When a transaction is done it
+starts the next one with a repeated START, or sends a STOP and clears `running` if the queue is empty.
+
+3. **Starting**: The enqueue functions start the engine with a START only when `running` is 0. A STOP that is still going out would be
+cut short by the START, so they wait for `TWSTO` to clear first.
+
+4. **Waiting**: While the queue is full, or in `twi_flush()`, the caller waits for the ISR. If interrupts are off, the ISR cannot run, so
+`twi_wait()` does its work whenever `TWINT` is set, the way `uart_putc()` drains its own buffer.
+*/
+
+#include "twi.h"
+#include "pindefines.h"
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <util/atomic.h>
+
+#define BUFFER_MASK (TWI_BUFFER_SIZE - 1)
+#define QUEUE_MASK (TWI_QUEUE_SIZE - 1)
+#define GO ((1 << TWINT) | (1 << TWEN) | (1 << TWIE)) // Clears TWINT, which starts the next bus action
+
+typedef struct {
+	uint8_t sla; // Address << 1 | R/W
+	uint8_t length;
+	uint8_t *data; // Read buffer
+} twi_t;
+
+static volatile twi_t queue[TWI_QUEUE_SIZE];
+static volatile uint8_t head = 0; // Next free slot, written by the enqueue functions
+static volatile uint8_t tail = 0; // Transaction in progress, written by the ISR
+
+static volatile uint8_t buffer[TWI_BUFFER_SIZE];
+static volatile uint8_t buffer_head = 0;
+static volatile uint8_t buffer_tail = 0;
+
+static volatile uint8_t running = 0;
+static uint8_t pos; // Bytes of the current transaction done, only used by the ISR
+static volatile uint16_t errors = 0;
+
+void twi_init(void) {
+	#ifdef TWI_INTERNAL_PULLUPS
+	I2C_SDA_PORT |= (1 << I2C_SDA);
+	I2C_SCL_PORT |= (1 << I2C_SCL);
+	#endif
+	TWSR = 0; // Prescaler of 1
+	TWBR = TWI_TWBR;
+	TWCR = (1 << TWEN);
+	head = tail = 0;
+	buffer_head = buffer_tail = 0;
+	running = 0;
+	errors = 0;
+}
+
+static void twi_step(void);
+
+// Lets the engine move on while the caller waits
+static void twi_wait(void) {
+	if (!(SREG & (1 << SREG_I)) && (TWCR & (1 << TWINT)))
+	twi_step();
+}
+
+// Starts the engine if it is stopped; called with interrupts off
+static void kick(void) {
+	if (running)
+	return;
+	running = 1;
+	while (TWCR & (1 << TWSTO)) {} // Let the last STOP finish
+	TWCR = GO | (1 << TWSTA);
+}
+
+// Copies a write into the ring buffer, waiting for room
+static void put_bytes(const uint8_t *data, uint8_t length) {
+	uint8_t i;
+
+	for (i = 0; i < length; i++) {
+		while (((buffer_head + 1) & BUFFER_MASK) == buffer_tail) // Full, wait for the ISR
+		twi_wait();
+		buffer[buffer_head] = data[i];
+		buffer_head = (buffer_head + 1) & BUFFER_MASK;
+	}
+}
+
+// Adds a transaction, waiting for a free slot
+static void add(uint8_t sla, uint8_t *data, uint8_t length) {
+	uint8_t next = (head + 1) & QUEUE_MASK;
+
+	while (next == tail) // Full, wait for the ISR
+	twi_wait();
+	queue[head].sla = sla;
+	queue[head].length = length;
+	queue[head].data = data;
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		head = next;
+		kick();
+	}
+}
+
+// Queues a write of `length` bytes, at most TWI_BUFFER_SIZE - 1. A longer write is dropped and counted as an error.
+void twi_write(uint8_t address, const uint8_t *data, uint8_t length) {
+	if (length >= TWI_BUFFER_SIZE) {
+		errors++;
+		return;
+	}
+	put_bytes(data, length);
+	add(address << 1, 0, length);
+}
+
+// Like twi_write, but adds the bytes to the last queued write to the same address if it has not started yet
+void twi_append(uint8_t address, const uint8_t *data, uint8_t length) {
+	uint8_t last, merged = 0;
+
+	if (length >= TWI_BUFFER_SIZE) {
+		errors++;
+		return;
+	}
+	put_bytes(data, length);
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		last = (head - 1) & QUEUE_MASK;
+		if (head != tail && (last != tail || !running) && queue[last].sla == (address << 1) && queue[last].length <= 255 - length) {
+			queue[last].length += length;
+			merged = 1;
+		}
+	}
+	if (!merged)
+	add(address << 1, 0, length);
+}
+
+// Queues a read of `length` (at least 1) bytes into `data`
+void twi_read(uint8_t address, uint8_t *data, uint8_t length) {
+	if (length)
+	add((address << 1) | 1, data, length);
+}
+
+// Returns 1 when every queued transaction has finished
+uint8_t twi_idle(void) {
+	return !running;
+}
+
+// Waits until every queued transaction has finished
+void twi_flush(void) {
+	while (running)
+	twi_wait();
+}
+
+uint16_t twi_errors(void) {
+	return errors;
+}
+
+// Moves on to the next transaction, or releases the bus
+static void next(void) {
+	tail = (tail + 1) & QUEUE_MASK;
+	if (tail != head)
+	TWCR = GO | (1 << TWSTA); // Repeated START
+	else {
+		TWCR = (1 << TWINT) | (1 << TWEN) | (1 << TWSTO);
+		running = 0;
+	}
+}
+
+// Runs one step of the state machine when TWINT is set
+static void twi_step(void) {
+	volatile twi_t *t = &queue[tail];
+
+	switch (TWSR & 0xF8) {
+		case 0x08: // START sent
+		case 0x10: // Repeated START sent
+		pos = 0;
+		TWDR = t->sla;
+		TWCR = GO;
+		break;
+		case 0x18: // SLA+W acknowledged
+		case 0x28: // Byte acknowledged
+		if (pos < t->length) {
+			TWDR = buffer[buffer_tail];
+			buffer_tail = (buffer_tail + 1) & BUFFER_MASK;
+			pos++;
+			TWCR = GO;
+		} else
+		next();
+		break;
+		case 0x40: // SLA+R acknowledged
+		TWCR = t->length > 1 ? GO | (1 << TWEA) : GO;
+		break;
+		case 0x50: // Byte received, more to come
+		t->data[pos++] = TWDR;
+		TWCR = pos + 1 < t->length ? GO | (1 << TWEA) : GO;
+		break;
+		case 0x58: // Last byte received
+		t->data[pos] = TWDR;
+		next();
+		break;
+		default: // NACK, lost arbitration or bus error: drop the rest of the transaction
+		errors++;
+		if (!(t->sla & 1))
+		buffer_tail = (buffer_tail + t->length - pos) & BUFFER_MASK;
+		next();
+		break;
+	}
+}
+
+ISR(TWI_vect) {
+	twi_step();
+}
@@ -0,0 +1,59 @@
+/*
+The `twi.h` file declares an interrupt driven I2C (TWI) master for the `I2C_SDA`/`I2C_SCL` pins in `pindefines.h` (PC4 and PC5).
+
+1. **Queue**: `twi_write()` and `twi_read()` queue a transaction and return straight away, and `TWI_vect` works through the queue one
+byte per interrupt. The bytes to write are copied into a ring buffer, so the caller can reuse its buffer at once. A read stores its bytes
+in the caller's buffer, which has to stay valid until `twi_idle()` returns 1. If the queue or the ring buffer is full, the call waits for
+the ISR to make room (with interrupts off it sends the bytes itself). A write can be up to `TWI_BUFFER_SIZE - 1` bytes long.
+`twi_flush()` waits until everything has been sent.
+
+2. **Batching**: A queued transaction follows the one before it with a repeated START, and the STOP is only sent when the queue is
+empty, so a burst of transactions holds the bus all the way. `twi_append()` goes further for devices where every byte stands on its own,
+like a PCF8574 port expander: if the last queued transaction is a write to the same address that has not started yet, the bytes are
+added to it, so the whole burst costs one START and one address byte.
+
+3. **Errors**: If the slave does not acknowledge its address or a byte, the rest of that transaction is skipped and counted in
+`twi_errors()`, and the engine goes on with the next one. A read cut short leaves the rest of its buffer unchanged.
+
+4. **Speed**: `TWI_FREQ` sets the SCL frequency, 400 kHz by default, with a TWI prescaler of 1. At 400 kHz a byte and its acknowledge
+take 22.5 us. The bus needs pull-up resistors; most modules have them, and `TWI_INTERNAL_PULLUPS` turns on the weak ones in the chip
+for short wires.
+*/
+
+#ifndef TWI_H_
+#define TWI_H_
+
+#include <stdint.h>
+
+#ifndef F_CPU
+#define F_CPU 16000000UL
+#endif
+
+#ifndef TWI_FREQ
+#define TWI_FREQ 400000UL
+#endif
+#define TWI_TWBR ((F_CPU / TWI_FREQ - 16) / 2)
+#if F_CPU / TWI_FREQ < 16 || TWI_TWBR > 255
+#error "TWI_FREQ cannot be reached with a TWI prescaler of 1"
+#endif
+#define TWI_BYTE_US (9 * 1000000UL / TWI_FREQ) // One byte and its acknowledge
+
+#ifndef TWI_BUFFER_SIZE
+#define TWI_BUFFER_SIZE 64 // Bytes waiting to be written, a power of two no larger than 256
+#endif
+#ifndef TWI_QUEUE_SIZE
+#define TWI_QUEUE_SIZE 8 // Transactions waiting, a power of two no larger than 256
+#endif
+#if (TWI_BUFFER_SIZE & (TWI_BUFFER_SIZE - 1)) || TWI_BUFFER_SIZE > 256 || (TWI_QUEUE_SIZE & (TWI_QUEUE_SIZE - 1)) || TWI_QUEUE_SIZE > 256
+#error "TWI_BUFFER_SIZE and TWI_QUEUE_SIZE must be powers of two no larger than 256"
+#endif
+
+void twi_init(void);
+void twi_write(uint8_t address, const uint8_t *data, uint8_t length);
+void twi_append(uint8_t address, const uint8_t *data, uint8_t length);
+void twi_read(uint8_t address, uint8_t *data, uint8_t length);
+uint8_t twi_idle(void);
+void twi_flush(void);
+uint16_t twi_errors(void);
+
+#endif /* TWI_H_ */